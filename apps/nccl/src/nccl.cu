@@ -2,6 +2,7 @@
 // Licensed under the MIT license.
 
 #include <algorithm>
+#include <array>
 #include <filesystem>
 #include <mscclpp/concurrency_device.hpp>
 #include <mscclpp/core.hpp>
@@ -9,6 +10,7 @@
 #include <mscclpp/sm_channel.hpp>
 #include <mscclpp/sm_channel_device.hpp>
 #include <mscclpp/utils.hpp>
+#include <nlohmann/json.hpp>
 #include <sstream>
 #include <unordered_map>
 #include <vector>
@@ -16,7 +18,9 @@
 #include "allgather.hpp"
 #include "allreduce.hpp"
 #include "broadcast.hpp"
+#include "debug.h"
 #include "nccl.h"
+#include "plan_index.hpp"
 
 #define NCCL_API extern "C" __attribute__((visibility("default")))
 
@@ -44,16 +48,7 @@ struct channelKey {
   bool operator==(const channelKey& other) const { return buff == other.buff && bytes == other.bytes; }
 };
 
-struct planKey {
-  size_t minMessageSize;
-  size_t maxMessageSize;
-  bool isInPlace;
-};
-
-struct executionPlanInstance {
-  planKey key;
-  std::shared_ptr<mscclpp::ExecutionPlan> plan;
-};
+using ExecutionPlanIndex = PlanIndex<std::shared_ptr<mscclpp::ExecutionPlan>>;
 
 namespace std {
 template <>
@@ -74,7 +69,7 @@ struct ncclComm {
   std::vector<std::shared_ptr<mscclpp::Connection>> connections;
   std::vector<std::shared_ptr<mscclpp::SmDevice2DeviceSemaphore>> smSemaphores;
   std::shared_ptr<mscclpp::Executor> executor;
-  std::unordered_map<std::string, std::vector<executionPlanInstance>> executionPlans;
+  std::array<ExecutionPlanIndex, static_cast<size_t>(Collective::Count)> executionPlans;
 
   std::unordered_map<channelKey, ChannelInfo> channelInInfos;
   std::unordered_map<channelKey, ChannelInfo> channelOutInfos;
@@ -160,11 +155,36 @@ static std::vector<mscclpp::SmChannel> setupSmChannels(ncclComm_t comm,
   return channels;
 }
 
-static std::pair<std::string, executionPlanInstance> loadExecutionPlan(const std::string& filename) {
-  std::shared_ptr<mscclpp::ExecutionPlan> plan = std::make_shared<mscclpp::ExecutionPlan>(filename);
-  std::string collective = plan->collective();
-  planKey key{plan->minMessageSize(), plan->maxMessageSize(), plan->isInPlace()};
-  return std::make_pair(collective, executionPlanInstance{key, plan});
+static void loadExecutionPlans(ncclComm_t comm, const std::string& collectiveDir) {
+  for (const auto& entry : std::filesystem::directory_iterator(collectiveDir)) {
+    if (!entry.is_regular_file()) continue;
+    std::shared_ptr<mscclpp::ExecutionPlan> plan;
+    try {
+      plan = std::make_shared<mscclpp::ExecutionPlan>(entry.path());
+    } catch (const nlohmann::json::exception& e) {
+      WARN("Ignoring malformed execution plan %s: %s", entry.path().c_str(), e.what());
+      continue;
+    }
+    Collective collective;
+    if (!getCollective(plan->collective(), collective)) {
+      WARN("Ignoring execution plan %s for unsupported collective %s", entry.path().c_str(),
+           plan->collective().c_str());
+      continue;
+    }
+    comm->executionPlans[static_cast<size_t>(collective)].add({entry.path().filename().string(),
+                                                               plan->minMessageSize(), plan->maxMessageSize(),
+                                                               plan->isInPlace(), plan->priority(), plan});
+  }
+  for (ExecutionPlanIndex& index : comm->executionPlans) {
+    for (const std::string& hole : index.build()) {
+      INFO(MSCCLPP_INIT, "No execution plan covers %s, falling back to the default kernels", hole.c_str());
+    }
+  }
+}
+
+static mscclpp::ExecutionPlan* findExecutionPlan(ncclComm_t comm, Collective collective, size_t bytes, bool isInPlace) {
+  const auto* plan = comm->executionPlans[static_cast<size_t>(collective)].find(bytes, isInPlace);
+  return plan != nullptr ? plan->get() : nullptr;
 }
 
 static std::shared_ptr<mscclpp::DeviceHandle<mscclpp::SmChannel>> setupSmChannelDeviceHandles(
@@ -388,11 +408,12 @@ NCCL_API ncclResult_t ncclCommInitRank(ncclComm_t* comm, int nranks, ncclUniqueI
     if (!std::filesystem::is_directory(collectiveDir)) {
       return ncclInvalidArgument;
     }
-    for (const auto& entry : std::filesystem::directory_iterator(collectiveDir)) {
-      if (entry.is_regular_file()) {
-        auto plan = loadExecutionPlan(entry.path());
-        commPtr->executionPlans[plan.first].push_back(plan.second);
-      }
+    try {
+      loadExecutionPlans(commPtr, collectiveDir);
+    } catch (const mscclpp::Error& e) {
+      WARN("Failed to load execution plans from %s: %s", collectiveDir.c_str(), e.what());
+      delete commPtr;
+      return ncclInvalidUsage;
     }
   }
 
@@ -551,17 +572,10 @@ NCCL_API ncclResult_t ncclBroadcast(const void* sendbuff, void* recvbuff, size_t
   int rank = comm->comm->bootstrap()->getRank();
   int nRank = comm->comm->bootstrap()->getNranks();
 
-  std::vector<executionPlanInstance>& plans = comm->executionPlans["broadcast"];
-  std::shared_ptr<mscclpp::ExecutionPlan> plan;
   void* basePtr = (char*)sendbuff;
   bool inPlace = basePtr == recvbuff;
   const size_t totalBytes = bytes;
-  for (const auto& p : plans) {
-    if (totalBytes >= p.key.minMessageSize && totalBytes < p.key.maxMessageSize && inPlace == p.key.isInPlace) {
-      plan = p.plan;
-      break;
-    }
-  }
+  mscclpp::ExecutionPlan* plan = findExecutionPlan(comm, Collective::Broadcast, totalBytes, inPlace);
 
   if (plan == nullptr) return ncclBroadcastFallback(sendbuff, recvbuff, count, datatype, root, comm, stream);
 
@@ -600,15 +614,8 @@ NCCL_API ncclResult_t ncclAllReduce(const void* sendbuff, void* recvbuff, size_t
   size_t bytes = count * ncclTypeSize(datatype);
   int rank = comm->comm->bootstrap()->getRank();
 
-  std::vector<executionPlanInstance>& plans = comm->executionPlans["allreduce"];
-  std::shared_ptr<mscclpp::ExecutionPlan> plan;
   bool inPlace = sendbuff == recvbuff;
-  for (const auto& p : plans) {
-    if (bytes >= p.key.minMessageSize && bytes < p.key.maxMessageSize && inPlace == p.key.isInPlace) {
-      plan = p.plan;
-      break;
-    }
-  }
+  mscclpp::ExecutionPlan* plan = findExecutionPlan(comm, Collective::AllReduce, bytes, inPlace);
 
   if (plan == nullptr)
     return ncclAllReduceFallback(sendbuff, recvbuff, count, datatype, reductionOperation, comm, stream);
@@ -652,17 +659,10 @@ NCCL_API ncclResult_t ncclAllGather(const void* sendbuff, void* recvbuff, size_t
   int rank = comm->comm->bootstrap()->getRank();
   int nRank = comm->comm->bootstrap()->getNranks();
 
-  std::vector<executionPlanInstance>& plans = comm->executionPlans["allgather"];
-  std::shared_ptr<mscclpp::ExecutionPlan> plan;
   void* basePtr = (char*)sendbuff - rank * bytes;
   bool inPlace = basePtr == recvbuff;
   const size_t totalBytes = bytes * nRank;
-  for (const auto& p : plans) {
-    if (totalBytes >= p.key.minMessageSize && totalBytes < p.key.maxMessageSize && inPlace == p.key.isInPlace) {
-      plan = p.plan;
-      break;
-    }
-  }
+  mscclpp::ExecutionPlan* plan = findExecutionPlan(comm, Collective::AllGather, totalBytes, inPlace);
   if (plan == nullptr) return ncclAllGatherFallback(sendbuff, recvbuff, sendcount, datatype, comm, stream);
 
   switch (datatype) {
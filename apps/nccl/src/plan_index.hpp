@@ -0,0 +1,151 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#ifndef NCCL_PLAN_INDEX_HPP_
+#define NCCL_PLAN_INDEX_HPP_
+
+#include <algorithm>
+#include <limits>
+#include <mscclpp/errors.hpp>
+#include <string>
+#include <vector>
+
+enum class Collective {
+  AllReduce,
+  AllGather,
+  Broadcast,
+  Count,
+};
+
+inline bool getCollective(const std::string& name, Collective& collective) {
+  if (name == "allreduce") {
+    collective = Collective::AllReduce;
+  } else if (name == "allgather") {
+    collective = Collective::AllGather;
+  } else if (name == "broadcast") {
+    collective = Collective::Broadcast;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Maps a message size to the execution plan of a collective. Plans cover the half-open range
+// [minMessageSize, maxMessageSize) for either in-place or out-of-place calls. Where ranges overlap, the plan with the
+// highest priority wins. build() splits the ranges into disjoint segments once, so find() is a binary search over the
+// segment boundaries.
+template <typename Plan>
+class PlanIndex {
+ public:
+  struct Entry {
+    std::string name;
+    size_t minMessageSize;
+    size_t maxMessageSize;
+    bool isInPlace;
+    int priority;
+    Plan plan;
+  };
+
+  void add(Entry entry) { entries_.push_back(std::move(entry)); }
+
+  // Builds the segments. Throws if a range is empty or if two plans with the same priority are both the best choice
+  // for some size. Returns a description of each hole where callers fall back: between the ranges of the plans, below
+  // the smallest minMessageSize and above the largest maxMessageSize.
+  std::vector<std::string> build() {
+    std::vector<std::string> holes;
+    for (bool isInPlace : {false, true}) {
+      buildTable(isInPlace, holes);
+    }
+    return holes;
+  }
+
+  // Returns the plan for the message size, or nullptr if no plan covers it.
+  const Plan* find(size_t bytes, bool isInPlace) const {
+    const Table& table = tables_[isInPlace];
+    auto it = std::upper_bound(table.starts.begin(), table.starts.end(), bytes);
+    if (it == table.starts.begin()) {
+      return nullptr;
+    }
+    const Segment& segment = table.segments[it - table.starts.begin() - 1];
+    return bytes < segment.end ? &entries_[segment.entry].plan : nullptr;
+  }
+
+  size_t size() const { return entries_.size(); }
+
+ private:
+  struct Segment {
+    size_t end;
+    size_t entry;
+  };
+
+  struct Table {
+    std::vector<size_t> starts;
+    std::vector<Segment> segments;
+  };
+
+  void buildTable(bool isInPlace, std::vector<std::string>& holes) {
+    Table& table = tables_[isInPlace];
+    table = Table();
+    std::vector<size_t> bounds;
+    for (const Entry& entry : entries_) {
+      if (entry.isInPlace != isInPlace) continue;
+      if (entry.minMessageSize >= entry.maxMessageSize) {
+        throw mscclpp::Error("Execution plan " + entry.name + " has an empty message size range",
+                             mscclpp::ErrorCode::InvalidUsage);
+      }
+      bounds.push_back(entry.minMessageSize);
+      bounds.push_back(entry.maxMessageSize);
+    }
+    std::sort(bounds.begin(), bounds.end());
+    bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+
+    auto addHole = [&](size_t begin, size_t end) {
+      holes.push_back(std::string(isInPlace ? "in-place" : "out-of-place") + " message sizes [" +
+                      std::to_string(begin) + ", " + std::to_string(end) + ")");
+    };
+    if (!bounds.empty() && bounds.front() > 0) {
+      addHole(0, bounds.front());
+    }
+    for (size_t i = 0; i + 1 < bounds.size(); i++) {
+      size_t begin = bounds[i];
+      size_t end = bounds[i + 1];
+      const size_t none = entries_.size();
+      size_t best = none;
+      size_t tied = none;
+      for (size_t e = 0; e < entries_.size(); e++) {
+        const Entry& entry = entries_[e];
+        if (entry.isInPlace != isInPlace || entry.minMessageSize > begin || entry.maxMessageSize < end) continue;
+        if (best == none || entry.priority > entries_[best].priority) {
+          best = e;
+          tied = none;
+        } else if (entry.priority == entries_[best].priority) {
+          tied = e;
+        }
+      }
+      if (tied != none) {
+        throw mscclpp::Error("Execution plans " + entries_[best].name + " and " + entries_[tied].name +
+                                 " overlap on message sizes [" + std::to_string(begin) + ", " + std::to_string(end) +
+                                 ") with the same priority",
+                             mscclpp::ErrorCode::InvalidUsage);
+      }
+      if (best == none) {
+        addHole(begin, end);
+        continue;
+      }
+      if (!table.segments.empty() && table.segments.back().entry == best && table.segments.back().end == begin) {
+        table.segments.back().end = end;
+        continue;
+      }
+      table.starts.push_back(begin);
+      table.segments.push_back({end, best});
+    }
+    if (!bounds.empty() && bounds.back() < std::numeric_limits<size_t>::max()) {
+      addHole(bounds.back(), std::numeric_limits<size_t>::max());
+    }
+  }
+
+  std::vector<Entry> entries_;
+  Table tables_[2];
+};
+
+#endif  // NCCL_PLAN_INDEX_HPP_
@@ -0,0 +1,102 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// Compares the per-call cost of looking up an execution plan with PlanIndex against the linear scan over a
+// string-keyed map that it replaces, and checks that both pick the same plan.
+//
+// Usage: plan_index_perf [-n lookups] [-p plans]
+
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <unordered_map>
+
+#include "plan_index.hpp"
+
+namespace {
+
+struct LinearEntry {
+  size_t minMessageSize;
+  size_t maxMessageSize;
+  bool isInPlace;
+  int plan;
+};
+
+template <typename F>
+double measureNs(const std::vector<size_t>& sizes, F&& lookup) {
+  int64_t checksum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < sizes.size(); i++) {
+    checksum += lookup(sizes[i], (i & 1) != 0);
+  }
+  auto end = std::chrono::steady_clock::now();
+  // keep the lookups from being optimized away
+  if (checksum == -1) std::cout << checksum;
+  return std::chrono::duration<double, std::nano>(end - start).count() / sizes.size();
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  size_t nLookups = 10000000;
+  int nPlans = 16;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (std::strcmp(argv[i], "-n") == 0) {
+      nLookups = std::stoull(argv[i + 1]);
+    } else if (std::strcmp(argv[i], "-p") == 0) {
+      nPlans = std::stoi(argv[i + 1]);
+    }
+  }
+  if (nLookups == 0 || nPlans <= 0) {
+    std::cerr << "Usage: " << argv[0] << " [-n lookups] [-p plans]" << std::endl;
+    return 1;
+  }
+
+  // Plans tile power-of-two ranges from 1KB, alternating between in-place and out-of-place, as a plan directory
+  // tuned per message size would. The last plans cover no range so that some lookups fall back.
+  PlanIndex<int> index;
+  std::unordered_map<std::string, std::vector<LinearEntry>> linear;
+  for (int p = 0; p < nPlans; p++) {
+    size_t minMessageSize = size_t(1024) << (p / 2);
+    size_t maxMessageSize = minMessageSize * 2;
+    bool isInPlace = p % 2;
+    index.add({"plan" + std::to_string(p), minMessageSize, maxMessageSize, isInPlace, 0, p});
+    linear["allreduce"].push_back({minMessageSize, maxMessageSize, isInPlace, p});
+  }
+  index.build();
+
+  std::mt19937_64 rng(0);
+  std::uniform_int_distribution<int> shift(0, nPlans / 2 + 2);
+  std::vector<size_t> sizes(nLookups);
+  for (size_t& size : sizes) {
+    size = (size_t(1024) << shift(rng)) + rng() % 1024;
+  }
+
+  auto indexLookup = [&](size_t bytes, bool isInPlace) {
+    const int* plan = index.find(bytes, isInPlace);
+    return plan != nullptr ? *plan : -2;
+  };
+  auto linearLookup = [&](size_t bytes, bool isInPlace) {
+    for (const auto& entry : linear["allreduce"]) {
+      if (bytes >= entry.minMessageSize && bytes < entry.maxMessageSize && isInPlace == entry.isInPlace) {
+        return entry.plan;
+      }
+    }
+    return -2;
+  };
+  for (size_t i = 0; i < std::min<size_t>(sizes.size(), 100000); i++) {
+    if (indexLookup(sizes[i], i & 1) != linearLookup(sizes[i], i & 1)) {
+      std::cerr << "Mismatch for " << sizes[i] << " bytes" << std::endl;
+      return 1;
+    }
+  }
+
+  double indexNs = measureNs(sizes, indexLookup);
+  double linearNs = measureNs(sizes, linearLookup);
+  std::cout << std::fixed << std::setprecision(2) << "plans: " << nPlans << ", lookups: " << nLookups
+            << ", linear scan: " << linearNs << " ns, index: " << indexNs << " ns, speedup: " << linearNs / indexNs
+            << "x" << std::endl;
+  return 0;
+}
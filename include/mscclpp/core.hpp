@@ -43,6 +43,18 @@ class Bootstrap {
   virtual void allGather(void* allData, int size) = 0;
   virtual void barrier() = 0;
 
+  /// Start sending data to another process. The data is copied before returning, so the buffer can be reused right
+  /// away. The default implementation calls @ref send and returns a ready future.
+  ///
+  /// @return A future that becomes ready once the data is sent.
+  virtual std::future<void> isend(void* data, int size, int peer, int tag);
+
+  /// Start receiving data from another process. The buffer must stay valid until the returned future is ready. The
+  /// default implementation calls @ref recv and returns a ready future.
+  ///
+  /// @return A future that becomes ready once the data is received.
+  virtual std::future<void> irecv(void* data, int size, int peer, int tag);
+
   void groupBarrier(const std::vector<int>& ranks);
   void send(const std::vector<char>& data, int peer, int tag);
   void recv(std::vector<char>& data, int peer, int tag);
@@ -108,6 +120,31 @@ class TcpBootstrap : public Bootstrap {
   /// @param tag The tag to receive the data with.
   void recv(void* data, int size, int peer, int tag) override;
 
+  /// Start sending data to another process.
+  ///
+  /// The data is copied before returning. A progress thread writes it to the peer socket, so many sends to different
+  /// peers and tags can be in flight at once.
+  ///
+  /// @param data The data to send.
+  /// @param size The size of the data to send.
+  /// @param peer The rank of the process to send the data to.
+  /// @param tag The tag to send the data with.
+  /// @return A future that becomes ready once the data is written to the socket.
+  std::future<void> isend(void* data, int size, int peer, int tag) override;
+
+  /// Start receiving data from another process.
+  ///
+  /// A progress thread receives the messages of all peers and tags as they arrive, in any order, and queues them per
+  /// peer and tag until they are received. Messages with the same peer and tag are received in the order they were
+  /// sent.
+  ///
+  /// @param data The buffer to write the received data to. It must stay valid until the returned future is ready.
+  /// @param size The size of the data to receive.
+  /// @param peer The rank of the process to receive the data from.
+  /// @param tag The tag to receive the data with.
+  /// @return A future that becomes ready once the data is written to the buffer.
+  std::future<void> irecv(void* data, int size, int peer, int tag) override;
+
   /// Gather data from all processes.
   ///
   /// When called by rank `r`, this sends data from `allData[r * size]` to `allData[(r + 1) * size - 1]` to all other
@@ -142,14 +179,15 @@ enum class Transport {
   IB6,            // InfiniBand device 6 transport type.
   IB7,            // InfiniBand device 7 transport type.
   Ethernet,       // Ethernet transport type.
+  SharedMemory,   // Host shared memory transport type.
   NumTransports,  // The number of transports.
 };
 
 const std::string TransportNames[] = {"UNK", "IPC", "NVLS", "IB0", "IB1", "IB2", "IB3",
-                                      "IB4", "IB5", "IB6",  "IB7", "ETH", "NUM"};
+                                      "IB4", "IB5", "IB6",  "IB7", "ETH", "SHM", "NUM"};
 
 namespace detail {
-const size_t TransportFlagsSize = 12;
+const size_t TransportFlagsSize = 13;
 static_assert(TransportFlagsSize == static_cast<size_t>(Transport::NumTransports),
               "TransportFlagsSize must match the number of transports");
 /// Bitset for storing transport flags.
@@ -320,6 +358,47 @@ std::string getIBDeviceName(Transport ibTransport);
 /// @return The InfiniBand transport associated with the specified device name.
 Transport getIBTransportByDeviceName(const std::string& ibDeviceName);
 
+namespace detail {
+
+/// Allocates zeroed host memory that other processes on the same host can map.
+/// @param bytes Number of bytes to allocate.
+/// @return A pointer to the allocated memory.
+void* shmCalloc(size_t bytes);
+
+/// Frees memory allocated by @ref shmCalloc. Other processes that mapped it keep their mappings.
+/// @param ptr The pointer returned by @ref shmCalloc.
+void shmFree(void* ptr);
+
+}  // namespace detail
+
+/// A deleter that calls detail::shmFree for use with std::unique_ptr or std::shared_ptr.
+/// @tparam T Type of each element in the allocated memory.
+template <class T>
+struct ShmDeleter {
+  void operator()(T* ptr) { detail::shmFree(ptr); }
+};
+
+/// Allocates host memory that other processes on the same host can map and returns a std::shared_ptr to it. The
+/// memory is zeroed out. A peer connected by @ref Transport::SharedMemory can only write into registered memory
+/// allocated this way.
+/// @tparam T Type of each element in the allocated memory.
+/// @param count Number of elements to allocate.
+/// @return A std::shared_ptr to the allocated memory.
+template <class T>
+std::shared_ptr<T> allocSharedShm(size_t count = 1) {
+  return std::shared_ptr<T>(static_cast<T*>(detail::shmCalloc(count * sizeof(T))), ShmDeleter<T>());
+}
+
+/// Allocates host memory that other processes on the same host can map and returns a std::unique_ptr to it. The
+/// memory is zeroed out.
+/// @tparam T Type of each element in the allocated memory.
+/// @param count Number of elements to allocate.
+/// @return A std::unique_ptr to the allocated memory.
+template <class T>
+std::unique_ptr<T, ShmDeleter<T>> allocUniqueShm(size_t count = 1) {
+  return std::unique_ptr<T, ShmDeleter<T>>(static_cast<T*>(detail::shmCalloc(count * sizeof(T))));
+}
+
 class Context;
 class Connection;
 
@@ -413,6 +492,45 @@ class Endpoint {
   friend class Connection;
 };
 
+/// A handle to a transfer started by @ref Connection::writeAsync() or @ref Connection::updateAndSyncAsync(). Copies
+/// refer to the same transfer. A request must not be used after its connection is destroyed.
+class Request {
+ public:
+  /// Default constructor. The request is complete.
+  Request() = default;
+
+  /// Check whether the transfer is complete, without blocking.
+  ///
+  /// @return True if the data has landed at the destination and the source can be reused.
+  bool test() const;
+
+  /// Wait until the transfer is complete. Unlike @ref Connection::flush(), this does not wait for later transfers.
+  ///
+  /// @param timeoutUsec The timeout in microseconds, or a negative value to wait forever.
+  void wait(int64_t timeoutUsec = 3e7) const;
+
+ private:
+  Request(Connection* connection, uint64_t id);
+
+  Connection* connection_ = nullptr;
+  uint64_t id_ = 0;
+
+  friend class Connection;
+};
+
+/// Wait until all of the requests are complete. The requests may belong to different connections.
+///
+/// @param requests The requests to wait for.
+/// @param timeoutUsec The timeout in microseconds for all of the requests, or a negative value to wait forever.
+void waitAll(const std::vector<Request>& requests, int64_t timeoutUsec = 3e7);
+
+/// Wait until any of the requests is complete. The requests may belong to different connections.
+///
+/// @param requests The requests to wait for. Must not be empty.
+/// @param timeoutUsec The timeout in microseconds, or a negative value to wait forever.
+/// @return The index of a complete request.
+size_t waitAny(const std::vector<Request>& requests, int64_t timeoutUsec = 3e7);
+
 /// Represents a connection between two processes.
 class Connection {
  public:
@@ -439,6 +557,28 @@ class Connection {
   /// Flush any pending writes to the remote process.
   virtual void flush(int64_t timeoutUsec = 3e7) = 0;
 
+  /// Start the same transfer as @ref write() and return a @ref Request that completes when it does. Requests of a
+  /// connection complete in the order they were started. The default implementation flushes the connection.
+  ///
+  /// @param dst The destination @ref RegisteredMemory.
+  /// @param dstOffset The offset in bytes from the start of the destination @ref RegisteredMemory.
+  /// @param src The source @ref RegisteredMemory.
+  /// @param srcOffset The offset in bytes from the start of the source @ref RegisteredMemory.
+  /// @param size The number of bytes to write.
+  /// @return The request of the transfer.
+  virtual Request writeAsync(RegisteredMemory dst, uint64_t dstOffset, RegisteredMemory src, uint64_t srcOffset,
+                             uint64_t size);
+
+  /// Start the same update as @ref updateAndSync() and return a @ref Request that completes when the new value has
+  /// landed. The default implementation flushes the connection.
+  ///
+  /// @param dst The destination @ref RegisteredMemory.
+  /// @param dstOffset The offset in bytes from the start of the destination @ref RegisteredMemory.
+  /// @param src A pointer to the value to update.
+  /// @param newValue The new value to write.
+  /// @return The request of the update.
+  virtual Request updateAndSyncAsync(RegisteredMemory dst, uint64_t dstOffset, uint64_t* src, uint64_t newValue);
+
   /// Get the transport used by the local process.
   ///
   /// @return The transport used by the local process.
@@ -458,20 +598,56 @@ class Connection {
   // Internal methods for getting implementation pointers.
   static std::shared_ptr<RegisteredMemory::Impl> getImpl(RegisteredMemory& memory);
   static std::shared_ptr<Endpoint::Impl> getImpl(Endpoint& memory);
+
+  // Internal methods for the requests of a connection, which numbers them from 1 up.
+  static Request makeRequest(Connection* connection, uint64_t id);
+  virtual bool testRequest(uint64_t id);
+  virtual void waitRequest(uint64_t id, int64_t timeoutUsec);
+
+  friend class Request;
 };
 
 /// Used to configure an endpoint.
 struct EndpointConfig {
   static const int DefaultMaxCqSize = 1024;
-  static const int DefaultMaxCqPollNum = 1;
+  static const int DefaultMaxCqPollNum = 16;
   static const int DefaultMaxSendWr = 8192;
   static const int DefaultMaxWrPerSend = 64;
+  static const int DefaultIbSignalInterval = 16;
+  static const int DefaultIbMultiRailThreshold = 1024 * 1024;
+  static const int DefaultEthernetNumStagingBuffers = 4;
+  static const int DefaultEthernetStagingBufferSize = 4 * 1024 * 1024;
+  static const int DefaultEthernetStripeSize = 1024 * 1024;
 
   Transport transport;
   int ibMaxCqSize = DefaultMaxCqSize;
   int ibMaxCqPollNum = DefaultMaxCqPollNum;
   int ibMaxSendWr = DefaultMaxSendWr;
   int ibMaxWrPerSend = DefaultMaxWrPerSend;
+  /// An IB connection requests a completion for one in every this many work requests, plus one on flush. The send
+  /// queue slots of the others are reclaimed with it. 1 requests a completion for every work request.
+  int ibSignalInterval = DefaultIbSignalInterval;
+  /// IB transports whose NICs an IB connection stripes large writes across, one QP each. The endpoint transport is
+  /// always one of them and carries small writes and all updateAndSync values. Both ends must use the same number of
+  /// rails. Empty or the endpoint transport alone means a single rail.
+  TransportFlags ibRails;
+  /// Writes of at least this many bytes are split evenly across the rails of a multi-rail IB connection.
+  int ibMultiRailThreshold = DefaultIbMultiRailThreshold;
+  /// Number of pinned host buffers that stage device memory on each side of an Ethernet connection. Copies into one
+  /// buffer overlap socket transfers from the others.
+  int ethernetNumStagingBuffers = DefaultEthernetNumStagingBuffers;
+  /// Size in bytes of each Ethernet staging buffer. Larger writes are sent in chunks of this size.
+  int ethernetStagingBufferSize = DefaultEthernetStagingBufferSize;
+  /// Writes from host memory of at least this many bytes are sent over Ethernet with MSG_ZEROCOPY, which saves the
+  /// copy into the socket buffers but pins the source pages until the kernel releases them. 0 disables it.
+  int ethernetZeroCopyThreshold = 0;
+  /// Number of TCP sockets that an Ethernet connection sends over in parallel, each with its own sender and receiver
+  /// threads. The two ends of a connection may use different numbers.
+  int ethernetNumStreams = 1;
+  /// Striping policy of Ethernet connections with several streams: writes are cut into stripes of at most this many
+  /// bytes, which are dealt to the streams in turn. A stripe is never larger than a staging buffer. Stripes land in
+  /// any order, but before the value of any later updateAndSync.
+  int ethernetStripeSize = DefaultEthernetStripeSize;
 
   /// Default constructor. Sets transport to Transport::Unknown.
   EndpointConfig() : transport(Transport::Unknown) {}
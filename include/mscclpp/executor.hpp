@@ -7,6 +7,7 @@
 #include <memory>
 #include <mscclpp/core.hpp>
 #include <unordered_map>
+#include <vector>
 
 namespace mscclpp {
 
@@ -25,6 +26,14 @@ enum class PacketType {
 
 class ExecutionPlan {
  public:
+  /// Constructor.
+  ///
+  /// When a JSON plan is loaded, adjacent operations of a threadblock that the executor can run as one are fused,
+  /// such as a PUT and the SIGNAL that follows it on the same proxy channels, or copies of contiguous chunks. Setting
+  /// the `MSCCLPP_EXECUTOR_FUSION` environment variable to 0 turns this off, and setting
+  /// `MSCCLPP_EXECUTOR_FUSION_DUMP` to 1 prints the number of operations of each type before and after fusion.
+  ///
+  /// @param planPath The path of the JSON (or binary) execution plan.
   ExecutionPlan(const std::string& planPath);
   ~ExecutionPlan() = default;
 
@@ -33,6 +42,9 @@ class ExecutionPlan {
   size_t minMessageSize() const;
   size_t maxMessageSize() const;
   bool isInPlace() const;
+  /// Return the priority of the plan. When the message size ranges of several plans for the same collective overlap,
+  /// the plan with the highest priority is used.
+  int priority() const;
 
  private:
   struct Impl;
@@ -41,8 +53,107 @@ class ExecutionPlan {
   friend class Executor;
 };
 
+/// Compile an execution plan into the binary plan format.
+///
+/// The binary plan holds the channel tables and the per-threadblock operations in flat arrays and can be passed to
+/// @ref ExecutionPlan in place of the JSON file. It is memory-mapped on load, which avoids parsing JSON when the
+/// executor sets up a plan. The binary format depends on the host architecture and the library version.
+///
+/// @param planPath The path of the JSON (or binary) execution plan.
+/// @param outputPath The path to write the binary plan to.
+void compileExecutionPlan(const std::string& planPath, const std::string& outputPath);
+
+/// The kind of a problem that @ref validateExecutionPlan finds in an execution plan.
+enum class PlanIssueType {
+  /// The plan refers to a rank, channel, barrier or buffer that does not exist, or uses an operation that the executor
+  /// does not implement.
+  Malformed,
+  /// Two ranks do not have the same number of channels of a type to each other. The executor adds the missing channels
+  /// without buffers, so that their semaphores pair up, but no operation can use them.
+  UnpairedChannel,
+  /// A semaphore is not waited on as many times as it is signaled, so a WAIT hangs or a later launch of the plan
+  /// consumes a stale signal.
+  UnbalancedSemaphore,
+  /// Some threadblocks wait for each other in a cycle and never finish.
+  Deadlock,
+  /// An operation accesses bytes outside of a buffer at one of the checked message sizes.
+  OutOfBounds,
+  /// Two threadblocks access the same bytes, at least one of them writes, and no barrier or semaphore orders the
+  /// accesses.
+  Race,
+};
+
+/// A problem in an execution plan.
+struct PlanIssue {
+  PlanIssueType type;
+  /// The rank, threadblock and operation index where the problem is found, or -1 if it does not concern one.
+  int rank;
+  int threadblock;
+  int operation;
+  /// A description of the problem that starts with its location.
+  std::string message;
+};
+
+/// Check an execution plan without running it.
+///
+/// The checks cover the channel pairing across ranks, the balance of signals and waits on each semaphore, deadlocks,
+/// the buffer bounds of every operation, and accesses of different threadblocks to the same bytes that are not
+/// ordered by a barrier, a semaphore or packet flags.
+///
+/// @param planPath The path of the JSON (or binary) execution plan.
+/// @param messageSizes The message sizes in bytes to check the buffer bounds at. If empty, the declared minimum and
+/// maximum message sizes of the plan are checked, or 1 MiB if the plan does not declare them.
+/// @return The problems found, or an empty vector if the plan is valid.
+std::vector<PlanIssue> validateExecutionPlan(const std::string& planPath, const std::vector<size_t>& messageSizes = {});
+
+/// Statistics of an execution context cached by an @ref Executor.
+///
+/// An execution context holds the connections, registered memories, scratch buffer and device plans that an
+/// @ref Executor sets up for one plan and one pair of send/receive allocations.
+struct ExecutionContextStats {
+  /// The name of the execution plan.
+  std::string plan;
+  /// The base address of the send allocation.
+  void* sendBuff;
+  /// The base address of the receive allocation.
+  void* recvBuff;
+  /// The size of the send allocation in bytes.
+  size_t sendBuffSize;
+  /// The size of the receive allocation in bytes.
+  size_t recvBuffSize;
+  /// The number of executions that reused the context.
+  uint64_t hits;
+  /// The time spent setting up the context in microseconds.
+  int64_t setupTimeUs;
+  /// The number of bytes the context allocates or registers: the scratch buffer, the device plans and the send and
+  /// receive allocations.
+  size_t bytesPinned;
+};
+
+/// Statistics of the execution context cache of an @ref Executor.
+struct ExecutorCacheStats {
+  /// The number of executions that found their context in the cache.
+  uint64_t hits;
+  /// The number of executions that had to set up a new context.
+  uint64_t misses;
+  /// The number of contexts removed from the cache, either to fit its limits or by @ref Executor::evict and
+  /// @ref Executor::clear.
+  uint64_t evictions;
+  /// The total number of bytes pinned by the cached contexts.
+  size_t bytesPinned;
+  /// The cached contexts, from the most recently used to the least recently used.
+  std::vector<ExecutionContextStats> contexts;
+};
+
 class Executor {
  public:
+  /// Constructor.
+  ///
+  /// The executor caches an execution context for every plan and pair of send/receive allocations it runs on. The
+  /// cache is unbounded unless the `MSCCLPP_EXECUTOR_MAX_CONTEXTS` or `MSCCLPP_EXECUTOR_MAX_CONTEXT_BYTES`
+  /// environment variables are set, or @ref setCacheLimits is called.
+  ///
+  /// @param comm The communicator.
   Executor(std::shared_ptr<Communicator> comm);
   Executor(const Executor&) = delete;
   Executor& operator=(const Executor&) = delete;
@@ -51,6 +162,28 @@ class Executor {
   void execute(int rank, void* sendbuff, void* recvBuff, size_t sendBuffSize, size_t recvBuffSize, DataType dataType,
                const ExecutionPlan& plan, cudaStream_t stream, PacketType packetType = PacketType::LL16);
 
+  /// Limit the execution contexts kept in the cache. When a new context exceeds a limit, the least recently used
+  /// contexts are destroyed. Setting up a context is collective, so all ranks must use the same limits and run the same
+  /// sequence of executions, or they will not agree on which contexts to set up again.
+  ///
+  /// @param maxContexts The maximum number of cached contexts, or 0 for no limit.
+  /// @param maxBytes The maximum number of bytes pinned by the cached contexts, or 0 for no limit. The most recently
+  /// used context is kept even if it alone exceeds the limit.
+  void setCacheLimits(size_t maxContexts, size_t maxBytes);
+
+  /// Destroy the cached contexts that use the allocation containing the given buffer, e.g., before freeing it. This
+  /// waits for the device to finish pending work. Like @ref setCacheLimits, it must be called on all ranks.
+  ///
+  /// @param buff A pointer into a send or receive allocation.
+  /// @return The number of destroyed contexts.
+  size_t evict(void* buff);
+
+  /// Destroy all cached contexts. This waits for the device to finish pending work and must be called on all ranks.
+  void clear();
+
+  /// Return the statistics of the execution context cache.
+  ExecutorCacheStats cacheStats() const;
+
  private:
   struct Impl;
   std::unique_ptr<Impl> impl_;
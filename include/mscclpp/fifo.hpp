@@ -32,6 +32,19 @@ class Fifo {
   /// Pops a trigger from the FIFO.
   void pop();
 
+  /// Polls the FIFO for consecutive triggers, starting at the head of the FIFO, without popping them. Stops at the
+  /// first entry that is not completely written yet.
+  ///
+  /// @param triggers The array to copy the triggers to.
+  /// @param maxCount The maximum number of triggers to poll.
+  /// @return The number of triggers copied to @p triggers.
+  int pollBatch(ProxyTrigger* triggers, int maxCount);
+
+  /// Pops triggers from the FIFO.
+  ///
+  /// @param count The number of triggers to pop.
+  void popBatch(int count);
+
   /// Flushes the tail of the FIFO.
   ///
   /// @param sync If true, waits for the flush to complete before returning.
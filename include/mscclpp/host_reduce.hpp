@@ -0,0 +1,55 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#ifndef MSCCLPP_HOST_REDUCE_HPP_
+#define MSCCLPP_HOST_REDUCE_HPP_
+
+#include <mscclpp/executor.hpp>
+#include <string>
+#include <vector>
+
+namespace mscclpp {
+
+/// Element-wise operations of @ref hostReduce().
+enum class ReduceOp {
+  SUM,
+  PROD,
+  MIN,
+  MAX,
+};
+
+/// Reduce buffers in host memory element-wise with the widest SIMD instruction set that the CPU supports: AVX-512,
+/// AVX2 or plain C++.
+///
+/// FLOAT16 and BFLOAT16 elements are reduced in FLOAT32 and rounded to nearest even once at the end. INT32 and UINT32
+/// sums and products wrap around. MIN and MAX return the first operand unless the second one compares less or greater
+/// respectively, so a NaN in the second operand is ignored.
+///
+/// @param dst The output buffer. It may be one of @p srcs, but must not partially overlap any of them.
+/// @param srcs The input buffers. Must not be empty.
+/// @param count The number of elements of each buffer.
+/// @param dataType The type of the elements.
+/// @param op The reduction operation.
+/// @param numThreads The number of threads to split the buffers across, including the calling thread. 0 picks one
+/// thread for every 1 MiB of output, up to the number of CPUs.
+void hostReduce(void* dst, const std::vector<const void*>& srcs, size_t count, DataType dataType, ReduceOp op,
+                int numThreads = 0);
+
+/// Reduce @p src into @p dst element-wise: dst[i] = op(dst[i], src[i]). See the other overload for the details.
+///
+/// @param dst The buffer to reduce into.
+/// @param src The buffer to reduce.
+/// @param count The number of elements of each buffer.
+/// @param dataType The type of the elements.
+/// @param op The reduction operation.
+/// @param numThreads The number of threads to split the buffers across, or 0 to pick it by the size.
+void hostReduce(void* dst, const void* src, size_t count, DataType dataType, ReduceOp op, int numThreads = 0);
+
+/// Get the SIMD instruction set that @ref hostReduce() uses on this CPU.
+///
+/// @return "avx512", "avx2" or "scalar".
+std::string hostReduceIsa();
+
+}  // namespace mscclpp
+
+#endif  // MSCCLPP_HOST_REDUCE_HPP_
@@ -17,18 +17,70 @@ enum class ProxyHandlerResult {
   Stop,
 };
 
+/// How the proxy thread waits while its FIFO is empty.
+enum class ProxyWaitPolicy {
+  /// Poll the FIFO continuously. Lowest latency, but the thread keeps a CPU core busy.
+  Spin,
+  /// Poll with a pause instruction in between, then yield the core to other threads after a while.
+  Backoff,
+  /// Back off as above, then park the thread in sleeps of growing length until a trigger arrives or wakeup() is called.
+  Park,
+};
+
+/// Configures the wait policy of a proxy. The default, a pure spin, can be overridden with the environment variable
+/// MSCCLPP_PROXY_WAIT_POLICY set to "spin", "backoff" or "park".
+struct ProxyWaitConfig {
+  ProxyWaitPolicy policy = ProxyWaitPolicy::Spin;
+  /// Number of empty polls with a pause instruction before yielding.
+  int spinCount = 1000;
+  /// Number of empty polls with a yield before parking.
+  int yieldCount = 1000;
+  /// Longest sleep in microseconds of a parked thread between two polls. Triggers pushed by the device are noticed
+  /// after at most this long.
+  int maxParkUs = 100;
+};
+
+/// Statistics of the time a proxy thread spends waiting for triggers.
+struct ProxyWaitStats {
+  /// Total time in nanoseconds during which the FIFO was empty.
+  uint64_t idleNs;
+  /// Number of idle periods that ended after the thread parked.
+  uint64_t wakeups;
+  /// Total and maximum wake-up latency in nanoseconds. The latency of a wake-up is the time from the start of the last
+  /// sleep of an idle period to the poll that found the next trigger, which bounds the delay that parking adds.
+  uint64_t totalWakeupLatencyNs;
+  uint64_t maxWakeupLatencyNs;
+};
+
 class Proxy;
 using ProxyHandler = std::function<ProxyHandlerResult(ProxyTrigger)>;
+/// Handles the triggers that were ready in the FIFO together, in FIFO order. The result applies to the whole batch, and
+/// the triggers are popped only after the handler returns.
+using ProxyBatchHandler = std::function<ProxyHandlerResult(const ProxyTrigger* triggers, int count)>;
 
 class Proxy {
  public:
   Proxy(ProxyHandler handler, std::function<void()> threadInit, size_t fifoSize = DEFAULT_FIFO_SIZE);
   Proxy(ProxyHandler handler, size_t fifoSize = DEFAULT_FIFO_SIZE);
+  /// Constructs a proxy that drains every ready trigger of the FIFO in one pass and hands them to @p handler at once.
+  Proxy(ProxyBatchHandler handler, std::function<void()> threadInit, size_t fifoSize = DEFAULT_FIFO_SIZE);
+  Proxy(ProxyBatchHandler handler, size_t fifoSize = DEFAULT_FIFO_SIZE);
   ~Proxy();
 
   void start();
   void stop();
 
+  /// Sets how the proxy thread waits while the FIFO is empty. Must be called before @ref start().
+  /// @param config The wait policy and its parameters.
+  void setWaitConfig(const ProxyWaitConfig& config);
+
+  /// Wakes up the proxy thread if it is parked. Host threads that push triggers can call it to avoid the latency of a
+  /// park. It is cheap when the thread is not parked.
+  void wakeup();
+
+  /// Returns the statistics of the time the proxy thread waited for triggers so far.
+  ProxyWaitStats waitStats() const;
+
   /// This is a concurrent fifo which is multiple threads from the device
   /// can produce for and the sole proxy thread consumes it.
   /// @return the fifo
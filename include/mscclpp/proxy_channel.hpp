@@ -4,6 +4,9 @@
 #ifndef MSCCLPP_PROXY_CHANNEL_HPP_
 #define MSCCLPP_PROXY_CHANNEL_HPP_
 
+#include <unordered_map>
+#include <vector>
+
 #include "core.hpp"
 #include "proxy.hpp"
 #include "proxy_channel_device.hpp"
@@ -27,7 +30,10 @@ class BaseProxyService {
 class ProxyService : public BaseProxyService {
  public:
   /// Constructor.
-  ProxyService(size_t fifoSize = DEFAULT_FIFO_SIZE);
+  /// @param fifoSize The size of the FIFO of each proxy thread.
+  /// @param numProxies The number of proxy threads. Each thread has its own FIFO and serves the semaphores of a
+  /// share of the connections, so that all triggers of a connection are handled by one thread in FIFO order.
+  ProxyService(size_t fifoSize = DEFAULT_FIFO_SIZE, int numProxies = 1);
 
   /// Build and add a semaphore to the proxy service.
   /// @param connection The connection associated with the semaphore.
@@ -70,12 +76,17 @@ class ProxyService : public BaseProxyService {
  private:
   std::vector<std::shared_ptr<Host2DeviceSemaphore>> semaphores_;
   std::vector<RegisteredMemory> memories_;
-  std::shared_ptr<Proxy> proxy_;
+  std::vector<std::shared_ptr<Proxy>> proxies_;
+  // The proxy of each semaphore, and the proxy that the semaphores of each connection are assigned to
+  std::vector<int> semaphoreProxies_;
+  std::unordered_map<Connection*, int> connectionProxies_;
   int deviceNumaNode;
 
   void bindThread();
 
   ProxyHandlerResult handleTrigger(ProxyTrigger triggerRaw);
+
+  ProxyHandlerResult handleTriggerBatch(const ProxyTrigger* triggers, int count);
 };
 
 /// Proxy channel.
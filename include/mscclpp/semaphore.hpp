@@ -21,12 +21,15 @@ namespace mscclpp {
 /// the local peer that it has completed a data transfer by incrementing the remote peer's outbound semaphore ID and
 /// copying the incremented value to the local peer's inbound semaphore ID.
 ///
-/// @tparam InboundDeleter The deleter for inbound semaphore IDs. This is either `std::default_delete` for host memory
-/// or @ref CudaDeleter for device memory.
+/// @tparam InboundDeleter The deleter for inbound semaphore IDs. This is either `std::default_delete` for host memory,
+/// @ref HostOrShmDeleter for host memory that may be shared or @ref CudaDeleter for device memory.
 /// @tparam OutboundDeleter The deleter for outbound semaphore IDs. This is either `std::default_delete` for host memory
 /// or @ref CudaDeleter for device memory.
+/// @tparam ExpectedDeleter The deleter for the expected inbound semaphore ID, which only the local peer accesses.
+/// Defaults to @p InboundDeleter.
 ///
-template <template <typename> typename InboundDeleter, template <typename> typename OutboundDeleter>
+template <template <typename> typename InboundDeleter, template <typename> typename OutboundDeleter,
+          template <typename> typename ExpectedDeleter = InboundDeleter>
 class BaseSemaphore {
  protected:
   /// The registered memory for the remote peer's inbound semaphore ID.
@@ -41,7 +44,7 @@ class BaseSemaphore {
   /// @ref localInboundSemaphore_.
   ///
   /// The location of @ref expectedInboundSemaphore_ can be either on the host or on the device.
-  std::unique_ptr<uint64_t, InboundDeleter<uint64_t>> expectedInboundSemaphore_;
+  std::unique_ptr<uint64_t, ExpectedDeleter<uint64_t>> expectedInboundSemaphore_;
 
   /// The outbound semaphore ID that is incremented by the local peer and copied to the remote peer's @ref
   /// localInboundSemaphore_.
@@ -56,7 +59,7 @@ class BaseSemaphore {
   /// @param expectedInboundSemaphoreId The expected inbound semaphore ID
   /// @param outboundSemaphoreId The outbound semaphore ID
   BaseSemaphore(std::unique_ptr<uint64_t, InboundDeleter<uint64_t>> localInboundSemaphoreId,
-                std::unique_ptr<uint64_t, InboundDeleter<uint64_t>> expectedInboundSemaphoreId,
+                std::unique_ptr<uint64_t, ExpectedDeleter<uint64_t>> expectedInboundSemaphoreId,
                 std::unique_ptr<uint64_t, OutboundDeleter<uint64_t>> outboundSemaphoreId)
       : localInboundSemaphore_(std::move(localInboundSemaphoreId)),
         expectedInboundSemaphore_(std::move(expectedInboundSemaphoreId)),
@@ -88,8 +91,24 @@ class Host2DeviceSemaphore : public BaseSemaphore<CudaDeleter, std::default_dele
   DeviceHandle deviceHandle();
 };
 
+/// A deleter for host memory that is either allocated by allocUniqueShm() or by `new`.
+/// @tparam T Type of each element in the allocated memory.
+template <class T>
+struct HostOrShmDeleter {
+  /// Whether the memory is allocated by allocUniqueShm().
+  bool shm = false;
+
+  void operator()(T* ptr) {
+    if (shm) {
+      ShmDeleter<T>()(ptr);
+    } else {
+      std::default_delete<T>()(ptr);
+    }
+  }
+};
+
 /// A semaphore for sending signals from the local host to a remote host.
-class Host2HostSemaphore : public BaseSemaphore<std::default_delete, std::default_delete> {
+class Host2HostSemaphore : public BaseSemaphore<HostOrShmDeleter, std::default_delete, std::default_delete> {
  public:
   /// Constructor
   /// @param communicator The communicator.
@@ -87,6 +87,7 @@ void register_core(nb::module_& m) {
       .value("IB5", Transport::IB5)
       .value("IB6", Transport::IB6)
       .value("IB7", Transport::IB7)
+      .value("SharedMemory", Transport::SharedMemory)
       .value("NumTransports", Transport::NumTransports);
 
   nb::class_<TransportFlags>(m, "TransportFlags")
@@ -121,6 +122,16 @@ void register_core(nb::module_& m) {
       .def("serialize", &RegisteredMemory::serialize)
       .def_static("deserialize", &RegisteredMemory::deserialize, nb::arg("data"));
 
+  nb::class_<Request>(m, "Request")
+      .def(nb::init<>())
+      .def("test", &Request::test)
+      .def("wait", &Request::wait, nb::call_guard<nb::gil_scoped_release>(), nb::arg("timeoutUsec") = (int64_t)3e7);
+
+  m.def("wait_all", &waitAll, nb::call_guard<nb::gil_scoped_release>(), nb::arg("requests"),
+        nb::arg("timeoutUsec") = (int64_t)3e7);
+  m.def("wait_any", &waitAny, nb::call_guard<nb::gil_scoped_release>(), nb::arg("requests"),
+        nb::arg("timeoutUsec") = (int64_t)3e7);
+
   nb::class_<Connection>(m, "Connection")
       .def("write", &Connection::write, nb::arg("dst"), nb::arg("dstOffset"), nb::arg("src"), nb::arg("srcOffset"),
            nb::arg("size"))
@@ -131,6 +142,14 @@ void register_core(nb::module_& m) {
           },
           nb::arg("dst"), nb::arg("dstOffset"), nb::arg("src"), nb::arg("newValue"))
       .def("flush", &Connection::flush, nb::call_guard<nb::gil_scoped_release>(), nb::arg("timeoutUsec") = (int64_t)3e7)
+      .def("write_async", &Connection::writeAsync, nb::keep_alive<0, 1>(), nb::arg("dst"), nb::arg("dstOffset"),
+           nb::arg("src"), nb::arg("srcOffset"), nb::arg("size"))
+      .def(
+          "update_and_sync_async",
+          [](Connection* self, RegisteredMemory dst, uint64_t dstOffset, uintptr_t src, uint64_t newValue) {
+            return self->updateAndSyncAsync(dst, dstOffset, (uint64_t*)src, newValue);
+          },
+          nb::keep_alive<0, 1>(), nb::arg("dst"), nb::arg("dstOffset"), nb::arg("src"), nb::arg("newValue"))
       .def("transport", &Connection::transport)
       .def("remote_transport", &Connection::remoteTransport);
 
@@ -146,7 +165,15 @@ void register_core(nb::module_& m) {
       .def_rw("ib_max_cq_size", &EndpointConfig::ibMaxCqSize)
       .def_rw("ib_max_cq_poll_num", &EndpointConfig::ibMaxCqPollNum)
       .def_rw("ib_max_send_wr", &EndpointConfig::ibMaxSendWr)
-      .def_rw("ib_max_wr_per_send", &EndpointConfig::ibMaxWrPerSend);
+      .def_rw("ib_max_wr_per_send", &EndpointConfig::ibMaxWrPerSend)
+      .def_rw("ib_signal_interval", &EndpointConfig::ibSignalInterval)
+      .def_rw("ib_rails", &EndpointConfig::ibRails)
+      .def_rw("ib_multi_rail_threshold", &EndpointConfig::ibMultiRailThreshold)
+      .def_rw("ethernet_num_staging_buffers", &EndpointConfig::ethernetNumStagingBuffers)
+      .def_rw("ethernet_staging_buffer_size", &EndpointConfig::ethernetStagingBufferSize)
+      .def_rw("ethernet_zero_copy_threshold", &EndpointConfig::ethernetZeroCopyThreshold)
+      .def_rw("ethernet_num_streams", &EndpointConfig::ethernetNumStreams)
+      .def_rw("ethernet_stripe_size", &EndpointConfig::ethernetStripeSize);
 
   nb::class_<Context>(m, "Context")
       .def(nb::init<>())
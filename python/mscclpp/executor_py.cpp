@@ -4,6 +4,7 @@
 #include <nanobind/nanobind.h>
 #include <nanobind/stl/shared_ptr.h>
 #include <nanobind/stl/string.h>
+#include <nanobind/stl/vector.h>
 
 #include <mscclpp/executor.hpp>
 #include <mscclpp/gpu.hpp>
@@ -26,7 +27,47 @@ void register_executor(nb::module_& m) {
       .def("name", &ExecutionPlan::name)
       .def("collective", &ExecutionPlan::collective)
       .def("min_message_size", &ExecutionPlan::minMessageSize)
-      .def("max_message_size", &ExecutionPlan::maxMessageSize);
+      .def("max_message_size", &ExecutionPlan::maxMessageSize)
+      .def("priority", &ExecutionPlan::priority);
+
+  m.def("compile_execution_plan", &compileExecutionPlan, nb::arg("planPath"), nb::arg("outputPath"));
+
+  nb::enum_<PlanIssueType>(m, "PlanIssueType")
+      .value("malformed", PlanIssueType::Malformed)
+      .value("unpaired_channel", PlanIssueType::UnpairedChannel)
+      .value("unbalanced_semaphore", PlanIssueType::UnbalancedSemaphore)
+      .value("deadlock", PlanIssueType::Deadlock)
+      .value("out_of_bounds", PlanIssueType::OutOfBounds)
+      .value("race", PlanIssueType::Race);
+
+  nb::class_<PlanIssue>(m, "PlanIssue")
+      .def_ro("type", &PlanIssue::type)
+      .def_ro("rank", &PlanIssue::rank)
+      .def_ro("threadblock", &PlanIssue::threadblock)
+      .def_ro("operation", &PlanIssue::operation)
+      .def_ro("message", &PlanIssue::message);
+
+  m.def("validate_execution_plan", &validateExecutionPlan, nb::arg("planPath"),
+        nb::arg("messageSizes") = std::vector<size_t>{});
+
+  nb::class_<ExecutionContextStats>(m, "ExecutionContextStats")
+      .def_ro("plan", &ExecutionContextStats::plan)
+      .def_prop_ro("send_buff",
+                   [](const ExecutionContextStats& self) { return reinterpret_cast<uintptr_t>(self.sendBuff); })
+      .def_prop_ro("recv_buff",
+                   [](const ExecutionContextStats& self) { return reinterpret_cast<uintptr_t>(self.recvBuff); })
+      .def_ro("send_buff_size", &ExecutionContextStats::sendBuffSize)
+      .def_ro("recv_buff_size", &ExecutionContextStats::recvBuffSize)
+      .def_ro("hits", &ExecutionContextStats::hits)
+      .def_ro("setup_time_us", &ExecutionContextStats::setupTimeUs)
+      .def_ro("bytes_pinned", &ExecutionContextStats::bytesPinned);
+
+  nb::class_<ExecutorCacheStats>(m, "ExecutorCacheStats")
+      .def_ro("hits", &ExecutorCacheStats::hits)
+      .def_ro("misses", &ExecutorCacheStats::misses)
+      .def_ro("evictions", &ExecutorCacheStats::evictions)
+      .def_ro("bytes_pinned", &ExecutorCacheStats::bytesPinned)
+      .def_ro("contexts", &ExecutorCacheStats::contexts);
 
   nb::class_<Executor>(m, "Executor")
       .def(nb::init<std::shared_ptr<Communicator>>(), nb::arg("comm"))
@@ -38,5 +79,11 @@ void register_executor(nb::module_& m) {
                           recvBuffSize, dataType, plan, (cudaStream_t)stream, packetType);
           },
           nb::arg("rank"), nb::arg("sendbuff"), nb::arg("recvBuff"), nb::arg("sendBuffSize"), nb::arg("recvBuffSize"),
-          nb::arg("dataType"), nb::arg("plan"), nb::arg("stream"), nb::arg("packetType") = PacketType::LL16);
+          nb::arg("dataType"), nb::arg("plan"), nb::arg("stream"), nb::arg("packetType") = PacketType::LL16)
+      .def("set_cache_limits", &Executor::setCacheLimits, nb::arg("maxContexts"), nb::arg("maxBytes"))
+      .def(
+          "evict", [](Executor* self, uintptr_t buff) { return self->evict(reinterpret_cast<void*>(buff)); },
+          nb::arg("buff"))
+      .def("clear", &Executor::clear)
+      .def("cache_stats", &Executor::cacheStats);
 }
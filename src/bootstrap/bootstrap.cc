@@ -1,11 +1,19 @@
 // Copyright (c) Microsoft Corporation.
 // Licensed under the MIT license.
 
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/resource.h>
+#include <unistd.h>
 
+#include <atomic>
+#include <climits>
 #include <cstring>
+#include <deque>
 #include <mscclpp/core.hpp>
 #include <mscclpp/errors.hpp>
+#include <mutex>
 #include <sstream>
 #include <thread>
 #include <unordered_map>
@@ -25,6 +33,27 @@ static void setFilesLimit() {
   if (setrlimit(RLIMIT_NOFILE, &filesLimit) != 0) throw SysError("setrlimit failed", errno);
 }
 
+// Below this number of ranks, the ring allGather and barrier take few enough steps that opening sockets to more peers
+// does not pay off.
+static const int LogDepthMinRanks = 16;
+// Above this slice size, allGather is bound by bandwidth rather than by the number of steps. All algorithms move the
+// same number of bytes, so the ring is kept as it does not need a staging buffer.
+static const int LogDepthMaxSliceSize = 64 * 1024;
+
+// Peer socket tags reserved for the log-depth collectives. Tags passed to send() and recv() should be non-negative.
+static const int AllGatherTag = -1;
+static const int BarrierTag = -2;
+
+enum class BootstrapAlgo { Auto, Ring, LogDepth };
+
+static BootstrapAlgo getBootstrapAlgo() {
+  const char* env = getenv("MSCCLPP_BOOTSTRAP_ALGO");
+  if (env == nullptr || strcmp(env, "auto") == 0) return BootstrapAlgo::Auto;
+  if (strcmp(env, "ring") == 0) return BootstrapAlgo::Ring;
+  if (strcmp(env, "logdepth") == 0) return BootstrapAlgo::LogDepth;
+  throw Error(std::string("Invalid MSCCLPP_BOOTSTRAP_ALGO: ") + env, ErrorCode::InvalidUsage);
+}
+
 /* Socket Interface Selection type */
 enum bootstrapInterface_t { findSubnetIf = -1, dontCareIf = -2 };
 
@@ -35,24 +64,45 @@ struct ExtInfo {
   SocketAddress extAddressListen;
 };
 
+MSCCLPP_API_CPP std::future<void> Bootstrap::isend(void* data, int size, int peer, int tag) {
+  std::promise<void> promise;
+  send(data, size, peer, tag);
+  promise.set_value();
+  return promise.get_future();
+}
+
+MSCCLPP_API_CPP std::future<void> Bootstrap::irecv(void* data, int size, int peer, int tag) {
+  std::promise<void> promise;
+  recv(data, size, peer, tag);
+  promise.set_value();
+  return promise.get_future();
+}
+
 MSCCLPP_API_CPP void Bootstrap::groupBarrier(const std::vector<int>& ranks) {
   int dummy = 0;
+  std::vector<int> recvDummies(ranks.size());
+  std::vector<std::future<void>> futures;
   for (auto rank : ranks) {
     if (rank != this->getRank()) {
-      this->send(static_cast<void*>(&dummy), sizeof(dummy), rank, 0);
+      futures.push_back(this->isend(static_cast<void*>(&dummy), sizeof(dummy), rank, 0));
     }
   }
-  for (auto rank : ranks) {
-    if (rank != this->getRank()) {
-      this->recv(static_cast<void*>(&dummy), sizeof(dummy), rank, 0);
+  for (size_t i = 0; i < ranks.size(); i++) {
+    if (ranks[i] != this->getRank()) {
+      futures.push_back(this->irecv(static_cast<void*>(&recvDummies[i]), sizeof(int), ranks[i], 0));
     }
   }
+  for (auto& future : futures) {
+    future.get();
+  }
 }
 
 MSCCLPP_API_CPP void Bootstrap::send(const std::vector<char>& data, int peer, int tag) {
   size_t size = data.size();
-  send((void*)&size, sizeof(size_t), peer, tag);
-  send((void*)data.data(), data.size(), peer, tag + 1);
+  auto sizeSent = isend((void*)&size, sizeof(size_t), peer, tag);
+  auto dataSent = isend((void*)data.data(), data.size(), peer, tag + 1);
+  sizeSent.get();
+  dataSent.get();
 }
 
 MSCCLPP_API_CPP void Bootstrap::recv(std::vector<char>& data, int peer, int tag) {
@@ -68,6 +118,349 @@ struct UniqueIdInternal {
 };
 static_assert(sizeof(UniqueIdInternal) <= sizeof(UniqueId), "UniqueIdInternal is too large to fit into UniqueId");
 
+// Multiplexes the peer sockets of a TcpBootstrap on one thread with epoll. The thread accepts the connections of peers
+// on the listening socket and receives the messages of all peer sockets as they arrive, queuing them per (peer, tag)
+// until they are received. A send is written right away as far as the socket has room, and the thread finishes it.
+// Nothing on the thread waits for a single peer: the listening socket is non-blocking, and the handshake of an accepted
+// socket progresses as its bytes arrive. Every message on a peer socket is an int size followed by the payload. The
+// first two messages carry the rank and the tag of the sender.
+class BootstrapProgress {
+ public:
+  BootstrapProgress(const Socket* listenSock);
+  ~BootstrapProgress();
+
+  std::future<void> send(std::shared_ptr<Socket> sock, const void* data, int size);
+  std::future<void> recv(void* data, int size, int peer, int tag);
+
+ private:
+  struct SendRequest {
+    std::vector<char> buffer;
+    size_t offset;
+    std::promise<void> promise;
+  };
+
+  struct Sender {
+    std::shared_ptr<Socket> sock;
+    std::deque<SendRequest> requests;
+  };
+
+  struct RecvRequest {
+    void* data;
+    int size;
+    std::promise<void> promise;
+  };
+
+  struct Receiver {
+    std::unique_ptr<Socket> sock;
+    int peer = -1;
+    int tag = -1;
+    int nHeaders = 0;
+    int size = 0;
+    int sizeOffset = 0;
+    std::vector<char> payload;
+    int payloadOffset = 0;
+  };
+
+  void run();
+  void watch(int op, int fd, uint32_t events);
+  void acceptPeer();
+  bool progressAccept(Receiver& receiver);
+  void progressReceiver(Receiver& receiver);
+  void closeReceiver(int fd);
+  // The functions below require mutex_.
+  bool progressSender(Sender& sender);
+  void deliver(const std::pair<int, int>& key, std::vector<char>&& message);
+  void fail(std::exception_ptr error);
+
+  static void complete(RecvRequest& request, const std::vector<char>& message);
+
+  const Socket* listenSock_;
+  int epollFd_;
+  int eventFd_;
+  std::atomic_bool running_;
+  std::mutex mutex_;
+  std::unordered_map<int, Sender> senders_;
+  // only accessed by the progress thread
+  std::unordered_map<int, Receiver> receivers_;
+  std::unordered_map<std::pair<int, int>, std::deque<std::vector<char>>, PairHash> arrived_;
+  std::unordered_map<std::pair<int, int>, std::deque<RecvRequest>, PairHash> posted_;
+  std::exception_ptr error_;
+  std::thread thread_;
+};
+
+BootstrapProgress::BootstrapProgress(const Socket* listenSock) : listenSock_(listenSock), running_(true) {
+  epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+  if (epollFd_ == -1) throw SysError("epoll_create1 failed", errno);
+  eventFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (eventFd_ == -1) {
+    int err = errno;
+    ::close(epollFd_);
+    throw SysError("eventfd failed", err);
+  }
+  watch(EPOLL_CTL_ADD, eventFd_, EPOLLIN);
+  int flags = fcntl(listenSock_->getFd(), F_GETFL);
+  if (flags == -1 || fcntl(listenSock_->getFd(), F_SETFL, flags | O_NONBLOCK) == -1) {
+    int err = errno;
+    ::close(eventFd_);
+    ::close(epollFd_);
+    throw SysError("fcntl on the bootstrap listening socket failed", err);
+  }
+  watch(EPOLL_CTL_ADD, listenSock_->getFd(), EPOLLIN);
+  thread_ = std::thread([this]() { run(); });
+}
+
+BootstrapProgress::~BootstrapProgress() {
+  running_ = false;
+  uint64_t one = 1;
+  if (::write(eventFd_, &one, sizeof(one)) != sizeof(one)) {
+    WARN("BootstrapProgress: failed to wake up the progress thread");
+  }
+  if (thread_.joinable()) thread_.join();
+  ::close(eventFd_);
+  ::close(epollFd_);
+}
+
+void BootstrapProgress::watch(int op, int fd, uint32_t events) {
+  epoll_event event = {};
+  event.events = events;
+  event.data.fd = fd;
+  if (epoll_ctl(epollFd_, op, fd, &event) == -1) throw SysError("epoll_ctl failed", errno);
+}
+
+std::future<void> BootstrapProgress::send(std::shared_ptr<Socket> sock, const void* data, int size) {
+  SendRequest request;
+  request.buffer.resize(sizeof(int) + size);
+  std::memcpy(request.buffer.data(), &size, sizeof(int));
+  std::memcpy(request.buffer.data() + sizeof(int), data, size);
+  request.offset = 0;
+  std::future<void> future = request.promise.get_future();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (error_) std::rethrow_exception(error_);
+  int fd = sock->getFd();
+  auto it = senders_.find(fd);
+  if (it == senders_.end()) {
+    it = senders_.emplace(fd, Sender{sock, {}}).first;
+    watch(EPOLL_CTL_ADD, fd, 0);
+  }
+  Sender& sender = it->second;
+  sender.requests.push_back(std::move(request));
+  if (sender.requests.size() == 1) {
+    bool done;
+    try {
+      done = progressSender(sender);
+    } catch (...) {
+      sender.requests.clear();
+      throw;
+    }
+    if (!done) {
+      // the socket is full, let the progress thread finish the send
+      watch(EPOLL_CTL_MOD, fd, EPOLLOUT);
+    }
+  }
+  return future;
+}
+
+std::future<void> BootstrapProgress::recv(void* data, int size, int peer, int tag) {
+  RecvRequest request{data, size, {}};
+  std::future<void> future = request.promise.get_future();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (error_) std::rethrow_exception(error_);
+  auto key = std::make_pair(peer, tag);
+  auto it = arrived_.find(key);
+  if (it != arrived_.end() && !it->second.empty()) {
+    complete(request, it->second.front());
+    it->second.pop_front();
+  } else {
+    posted_[key].push_back(std::move(request));
+  }
+  return future;
+}
+
+void BootstrapProgress::run() {
+  const int maxEvents = 64;
+  epoll_event events[maxEvents];
+  try {
+    while (running_) {
+      int nEvents = epoll_wait(epollFd_, events, maxEvents, -1);
+      if (nEvents == -1) {
+        if (errno == EINTR) continue;
+        throw SysError("epoll_wait failed", errno);
+      }
+      for (int i = 0; i < nEvents; i++) {
+        int fd = events[i].data.fd;
+        if (fd == eventFd_) {
+          uint64_t count;
+          (void)::read(eventFd_, &count, sizeof(count));
+        } else if (fd == listenSock_->getFd()) {
+          acceptPeer();
+        } else if (receivers_.count(fd)) {
+          progressReceiver(receivers_.at(fd));
+        } else {
+          std::lock_guard<std::mutex> lock(mutex_);
+          auto it = senders_.find(fd);
+          if (it == senders_.end()) continue;
+          if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+            // the peer is gone; sends still queued to it cannot complete
+            watch(EPOLL_CTL_DEL, fd, 0);
+            if (!it->second.requests.empty()) {
+              throw Error("connection to a bootstrap peer was closed with pending sends", ErrorCode::RemoteError);
+            }
+            senders_.erase(it);
+          } else if (progressSender(it->second)) {
+            watch(EPOLL_CTL_MOD, fd, 0);
+          }
+        }
+      }
+    }
+  } catch (const std::exception& e) {
+    if (running_) {
+      WARN("BootstrapProgress: %s", e.what());
+      fail(std::current_exception());
+    }
+  }
+}
+
+void BootstrapProgress::acceptPeer() {
+  // async, so that accept() returns when the peer has not sent its handshake yet
+  auto sock =
+      std::make_unique<Socket>(nullptr, MSCCLPP_SOCKET_MAGIC, SocketTypeUnknown, listenSock_->getAbortFlag(), 1);
+  sock->accept(listenSock_);
+  int fd = sock->getFd();
+  // there was nothing to accept after all, or the connection was not from a peer
+  if (fd == -1) return;
+  Receiver& receiver = receivers_[fd];
+  receiver.sock = std::move(sock);
+  watch(EPOLL_CTL_ADD, fd, EPOLLIN);
+  progressReceiver(receiver);
+}
+
+// Returns whether the handshake of Socket::accept() is complete. Drops the connection if it fails.
+bool BootstrapProgress::progressAccept(Receiver& receiver) {
+  int fd = receiver.sock->getFd();
+  try {
+    receiver.sock->accept(listenSock_);
+  } catch (const Error& e) {
+    if (e.getErrorCode() == ErrorCode::Aborted) throw;
+    WARN("BootstrapProgress: dropping a connection that failed to handshake: %s", e.what());
+    // the socket may have closed the descriptor already, which removed it from epoll
+    if (receiver.sock->getFd() != -1) watch(EPOLL_CTL_DEL, fd, 0);
+    receivers_.erase(fd);
+    return false;
+  }
+  if (receiver.sock->getState() == SocketStateAccepting) {
+    // not a peer; the socket closed the descriptor, which removed it from epoll
+    receivers_.erase(fd);
+    return false;
+  }
+  return receiver.sock->getState() == SocketStateReady;
+}
+
+void BootstrapProgress::progressReceiver(Receiver& receiver) {
+  if (receiver.sock->getState() != SocketStateReady && !progressAccept(receiver)) return;
+  for (;;) {
+    try {
+      if (receiver.sizeOffset < (int)sizeof(int)) {
+        int n = receiver.sock->tryRecv(reinterpret_cast<char*>(&receiver.size) + receiver.sizeOffset,
+                                       sizeof(int) - receiver.sizeOffset);
+        receiver.sizeOffset += n;
+        if (receiver.sizeOffset < (int)sizeof(int)) return;
+        if (receiver.size < 0) throw Error("Invalid bootstrap message size", ErrorCode::RemoteError);
+        receiver.payload.resize(receiver.size);
+        receiver.payloadOffset = 0;
+      }
+      if (receiver.payloadOffset < receiver.size) {
+        receiver.payloadOffset += receiver.sock->tryRecv(receiver.payload.data() + receiver.payloadOffset,
+                                                         receiver.size - receiver.payloadOffset);
+        if (receiver.payloadOffset < receiver.size) return;
+      }
+    } catch (const Error& e) {
+      if (e.getErrorCode() != ErrorCode::RemoteError || receiver.sizeOffset != 0) throw;
+      // the peer closed the connection between two messages
+      closeReceiver(receiver.sock->getFd());
+      return;
+    }
+    receiver.sizeOffset = 0;
+    if (receiver.nHeaders < 2) {
+      if (receiver.size != sizeof(int)) throw Error("Invalid bootstrap connection header", ErrorCode::RemoteError);
+      std::memcpy(receiver.nHeaders == 0 ? &receiver.peer : &receiver.tag, receiver.payload.data(), sizeof(int));
+      receiver.nHeaders++;
+      continue;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    deliver(std::make_pair(receiver.peer, receiver.tag), std::move(receiver.payload));
+    receiver.payload = std::vector<char>();
+  }
+}
+
+void BootstrapProgress::closeReceiver(int fd) {
+  Receiver& receiver = receivers_.at(fd);
+  watch(EPOLL_CTL_DEL, fd, 0);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = posted_.find(std::make_pair(receiver.peer, receiver.tag));
+    if (it != posted_.end()) {
+      for (RecvRequest& request : it->second) {
+        request.promise.set_exception(std::make_exception_ptr(
+            Error("connection closed by bootstrap peer " + std::to_string(receiver.peer), ErrorCode::RemoteError)));
+      }
+      posted_.erase(it);
+    }
+  }
+  receivers_.erase(fd);
+}
+
+bool BootstrapProgress::progressSender(Sender& sender) {
+  while (!sender.requests.empty()) {
+    SendRequest& request = sender.requests.front();
+    request.offset +=
+        sender.sock->trySend(request.buffer.data() + request.offset, request.buffer.size() - request.offset);
+    if (request.offset < request.buffer.size()) return false;
+    request.promise.set_value();
+    sender.requests.pop_front();
+  }
+  return true;
+}
+
+void BootstrapProgress::deliver(const std::pair<int, int>& key, std::vector<char>&& message) {
+  auto it = posted_.find(key);
+  if (it != posted_.end() && !it->second.empty()) {
+    complete(it->second.front(), message);
+    it->second.pop_front();
+    return;
+  }
+  arrived_[key].push_back(std::move(message));
+}
+
+void BootstrapProgress::complete(RecvRequest& request, const std::vector<char>& message) {
+  if (message.size() > static_cast<size_t>(request.size)) {
+    std::stringstream ss;
+    ss << "Message truncated : received " << message.size() << " bytes instead of " << request.size;
+    request.promise.set_exception(std::make_exception_ptr(Error(ss.str(), ErrorCode::InvalidUsage)));
+    return;
+  }
+  std::memcpy(request.data, message.data(), message.size());
+  request.promise.set_value();
+}
+
+void BootstrapProgress::fail(std::exception_ptr error) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  error_ = error;
+  for (auto& [key, requests] : posted_) {
+    for (RecvRequest& request : requests) {
+      request.promise.set_exception(error);
+    }
+  }
+  posted_.clear();
+  for (auto& [fd, sender] : senders_) {
+    for (SendRequest& request : sender.requests) {
+      request.promise.set_exception(error);
+    }
+    sender.requests.clear();
+  }
+}
+
 class TcpBootstrap::Impl {
  public:
   static UniqueId createUniqueId();
@@ -85,6 +478,8 @@ class TcpBootstrap::Impl {
   void allGather(void* allData, int size);
   void send(void* data, int size, int peer, int tag);
   void recv(void* data, int size, int peer, int tag);
+  std::future<void> isend(void* data, int size, int peer, int tag);
+  std::future<void> irecv(void* data, int size, int peer, int tag);
   void barrier();
   void close();
 
@@ -93,6 +488,7 @@ class TcpBootstrap::Impl {
   int rank_;
   int nRanks_;
   int nRanksPerNode_;
+  BootstrapAlgo algo_;
   bool netInitialized;
   std::unique_ptr<Socket> listenSockRoot_;
   std::unique_ptr<Socket> listenSock_;
@@ -105,13 +501,19 @@ class TcpBootstrap::Impl {
   std::thread rootThread_;
   SocketAddress netIfAddr_;
   std::unordered_map<std::pair<int, int>, std::shared_ptr<Socket>, PairHash> peerSendSockets_;
-  std::unordered_map<std::pair<int, int>, std::shared_ptr<Socket>, PairHash> peerRecvSockets_;
+  // isend may be called from several threads at once.
+  std::mutex peerSendSocketsMutex_;
+  std::unique_ptr<BootstrapProgress> progress_;
 
   void netSend(Socket* sock, const void* data, int size);
   void netRecv(Socket* sock, void* data, int size);
 
+  bool useLogDepth(size_t sliceSize);
+  void allGatherRing(void* allData, int size);
+  void allGatherBruck(void* allData, int size);
+  void barrierDissemination();
+
   std::shared_ptr<Socket> getPeerSendSocket(int peer, int tag);
-  std::shared_ptr<Socket> getPeerRecvSocket(int peer, int tag);
 
   static void assignPortToUniqueId(UniqueIdInternal& uniqueId);
   static void netInit(std::string ipPortPair, std::string interface, SocketAddress& netIfAddr);
@@ -144,6 +546,7 @@ TcpBootstrap::Impl::Impl(int rank, int nRanks)
     : rank_(rank),
       nRanks_(nRanks),
       nRanksPerNode_(0),
+      algo_(getBootstrapAlgo()),
       netInitialized(false),
       peerCommAddresses_(nRanks, SocketAddress()),
       barrierArr_(nRanks, 0),
@@ -414,9 +817,12 @@ void TcpBootstrap::Impl::establishConnections(int64_t timeoutSec) {
   ringRecvSocket_ = std::make_unique<Socket>(nullptr, MSCCLPP_SOCKET_MAGIC, SocketTypeUnknown, abortFlag_);
   TIMEOUT(ringRecvSocket_->accept(listenSock_.get(), getLeftTime()));
 
-  // AllGather all listen handlers
+  // AllGather all listen handlers. Peer sockets need these addresses, so only the ring can be used here.
   peerCommAddresses_[rank_] = listenSock_->getAddr();
-  allGather(peerCommAddresses_.data(), sizeof(SocketAddress));
+  allGatherRing(peerCommAddresses_.data(), sizeof(SocketAddress));
+
+  // From now on, peers connect to the listening socket to send messages, which the progress thread receives.
+  progress_ = std::make_unique<BootstrapProgress>(listenSock_.get());
 
   TRACE(MSCCLPP_INIT, "rank %d nranks %d - DONE", rank_, nRanks_);
 }
@@ -441,7 +847,28 @@ int TcpBootstrap::Impl::getNranksPerNode() {
   return nRanksPerNode_;
 }
 
+bool TcpBootstrap::Impl::useLogDepth(size_t sliceSize) {
+  // the Bruck allGather sends up to half of the data in a single message
+  if (nRanks_ < 2 || sliceSize * nRanks_ > INT_MAX) return false;
+  switch (algo_) {
+    case BootstrapAlgo::Ring:
+      return false;
+    case BootstrapAlgo::LogDepth:
+      return true;
+    default:
+      return nRanks_ >= LogDepthMinRanks && sliceSize <= LogDepthMaxSliceSize;
+  }
+}
+
 void TcpBootstrap::Impl::allGather(void* allData, int size) {
+  if (useLogDepth(size)) {
+    allGatherBruck(allData, size);
+  } else {
+    allGatherRing(allData, size);
+  }
+}
+
+void TcpBootstrap::Impl::allGatherRing(void* allData, int size) {
   char* data = static_cast<char*>(allData);
   int rank = rank_;
   int nRanks = nRanks_;
@@ -465,7 +892,50 @@ void TcpBootstrap::Impl::allGather(void* allData, int size) {
   TRACE(MSCCLPP_INIT, "rank %d nranks %d size %d - DONE", rank, nRanks, size);
 }
 
+// Bruck's allGather: ceil(log2(nRanks)) steps for any number of ranks. Ranks keep the slices they have gathered in a
+// staging buffer rotated so that their own slice comes first; at the step of distance d, every rank sends the first
+// min(d, nRanks - d) slices to rank - d and appends the slices received from rank + d.
+void TcpBootstrap::Impl::allGatherBruck(void* allData, int size) {
+  char* data = static_cast<char*>(allData);
+  int rank = rank_;
+  int nRanks = nRanks_;
+
+  TRACE(MSCCLPP_INIT, "rank %d nranks %d size %d", rank, nRanks, size);
+
+  std::vector<char> staging(static_cast<size_t>(nRanks) * size);
+  std::memcpy(staging.data(), data + static_cast<size_t>(rank) * size, size);
+  for (int distance = 1; distance < nRanks; distance <<= 1) {
+    int nSlices = std::min(distance, nRanks - distance);
+    int sendPeer = (rank - distance + nRanks) % nRanks;
+    int recvPeer = (rank + distance) % nRanks;
+    char* recvData = staging.data() + static_cast<size_t>(distance) * size;
+    auto received = irecv(recvData, nSlices * size, recvPeer, AllGatherTag);
+    isend(staging.data(), nSlices * size, sendPeer, AllGatherTag).get();
+    received.get();
+  }
+  for (int i = 1; i < nRanks; i++) {
+    std::memcpy(data + static_cast<size_t>((rank + i) % nRanks) * size, staging.data() + static_cast<size_t>(i) * size,
+                size);
+  }
+
+  TRACE(MSCCLPP_INIT, "rank %d nranks %d size %d - DONE", rank, nRanks, size);
+}
+
+// Dissemination barrier: at the step of distance d, every rank notifies rank + d and waits for rank - d. After
+// ceil(log2(nRanks)) steps every rank has transitively heard from all others.
+void TcpBootstrap::Impl::barrierDissemination() {
+  int sendDummy = 0;
+  int recvDummy = 0;
+  for (int distance = 1; distance < nRanks_; distance <<= 1) {
+    auto received = irecv(&recvDummy, sizeof(recvDummy), (rank_ - distance + nRanks_) % nRanks_, BarrierTag);
+    auto sent = isend(&sendDummy, sizeof(sendDummy), (rank_ + distance) % nRanks_, BarrierTag);
+    sent.get();
+    received.get();
+  }
+}
+
 std::shared_ptr<Socket> TcpBootstrap::Impl::getPeerSendSocket(int peer, int tag) {
+  std::lock_guard<std::mutex> lock(peerSendSocketsMutex_);
   auto it = peerSendSockets_.find(std::make_pair(peer, tag));
   if (it != peerSendSockets_.end()) {
     return it->second;
@@ -478,24 +948,6 @@ std::shared_ptr<Socket> TcpBootstrap::Impl::getPeerSendSocket(int peer, int tag)
   return sock;
 }
 
-std::shared_ptr<Socket> TcpBootstrap::Impl::getPeerRecvSocket(int peer, int tag) {
-  auto it = peerRecvSockets_.find(std::make_pair(peer, tag));
-  if (it != peerRecvSockets_.end()) {
-    return it->second;
-  }
-  for (;;) {
-    auto sock = std::make_shared<Socket>(nullptr, MSCCLPP_SOCKET_MAGIC, SocketTypeUnknown, abortFlag_);
-    sock->accept(listenSock_.get());
-    int recvPeer, recvTag;
-    netRecv(sock.get(), &recvPeer, sizeof(int));
-    netRecv(sock.get(), &recvTag, sizeof(int));
-    peerRecvSockets_[std::make_pair(recvPeer, recvTag)] = sock;
-    if (recvPeer == peer && recvTag == tag) {
-      return sock;
-    }
-  }
-}
-
 void TcpBootstrap::Impl::netSend(Socket* sock, const void* data, int size) {
   sock->send(&size, sizeof(int));
   sock->send(const_cast<void*>(data), size);
@@ -512,25 +964,36 @@ void TcpBootstrap::Impl::netRecv(Socket* sock, void* data, int size) {
   sock->recv(data, std::min(recvSize, size));
 }
 
-void TcpBootstrap::Impl::send(void* data, int size, int peer, int tag) {
-  auto sock = getPeerSendSocket(peer, tag);
-  netSend(sock.get(), data, size);
+void TcpBootstrap::Impl::send(void* data, int size, int peer, int tag) { isend(data, size, peer, tag).get(); }
+
+void TcpBootstrap::Impl::recv(void* data, int size, int peer, int tag) { irecv(data, size, peer, tag).get(); }
+
+std::future<void> TcpBootstrap::Impl::isend(void* data, int size, int peer, int tag) {
+  if (!progress_) throw Error("TcpBootstrap is not initialized", ErrorCode::InvalidUsage);
+  return progress_->send(getPeerSendSocket(peer, tag), data, size);
 }
 
-void TcpBootstrap::Impl::recv(void* data, int size, int peer, int tag) {
-  auto sock = getPeerRecvSocket(peer, tag);
-  netRecv(sock.get(), data, size);
+std::future<void> TcpBootstrap::Impl::irecv(void* data, int size, int peer, int tag) {
+  if (!progress_) throw Error("TcpBootstrap is not initialized", ErrorCode::InvalidUsage);
+  return progress_->recv(data, size, peer, tag);
 }
 
-void TcpBootstrap::Impl::barrier() { allGather(barrierArr_.data(), sizeof(int)); }
+void TcpBootstrap::Impl::barrier() {
+  if (useLogDepth(sizeof(int))) {
+    barrierDissemination();
+  } else {
+    allGatherRing(barrierArr_.data(), sizeof(int));
+  }
+}
 
 void TcpBootstrap::Impl::close() {
+  progress_.reset();
   listenSockRoot_.reset(nullptr);
   listenSock_.reset(nullptr);
   ringRecvSocket_.reset(nullptr);
   ringSendSocket_.reset(nullptr);
+  std::lock_guard<std::mutex> lock(peerSendSocketsMutex_);
   peerSendSockets_.clear();
-  peerRecvSockets_.clear();
 }
 
 MSCCLPP_API_CPP UniqueId TcpBootstrap::createUniqueId() { return Impl::createUniqueId(); }
@@ -553,6 +1016,14 @@ MSCCLPP_API_CPP void TcpBootstrap::recv(void* data, int size, int peer, int tag)
   pimpl_->recv(data, size, peer, tag);
 }
 
+MSCCLPP_API_CPP std::future<void> TcpBootstrap::isend(void* data, int size, int peer, int tag) {
+  return pimpl_->isend(data, size, peer, tag);
+}
+
+MSCCLPP_API_CPP std::future<void> TcpBootstrap::irecv(void* data, int size, int peer, int tag) {
+  return pimpl_->irecv(data, size, peer, tag);
+}
+
 MSCCLPP_API_CPP void TcpBootstrap::allGather(void* allData, int size) { pimpl_->allGather(allData, size); }
 
 MSCCLPP_API_CPP void TcpBootstrap::initialize(UniqueId uniqueId, int64_t timeoutSec) {
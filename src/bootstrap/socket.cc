@@ -6,6 +6,7 @@
 
 #include <errno.h>
 #include <ifaddrs.h>
+#include <linux/errqueue.h>
 #include <net/if.h>
 #include <stdlib.h>
 #include <string.h>
@@ -23,6 +24,8 @@ namespace mscclpp {
 
 #define MSCCLPP_SOCKET_SEND 0
 #define MSCCLPP_SOCKET_RECV 1
+// how long sendv()/recvv() wait for a non-blocking socket to become ready before checking the abort flag again
+#define MSCCLPP_SOCKET_POLL_TIMEOUT_MS 100
 
 /* Format a string representation of a (union mscclppSocketAddress *) socket address using getnameinfo()
  *
@@ -350,6 +353,10 @@ Socket::Socket(const SocketAddress* addr, uint64_t magic, enum SocketType type,
   state_ = SocketStateInitialized;
   magic_ = magic;
   type_ = type;
+  acceptMagic_ = 0;
+  acceptMagicOffset_ = 0;
+  acceptType_ = SocketTypeUnknown;
+  acceptTypeOffset_ = 0;
 
   if (addr) {
     /* IPv4/IPv6 support */
@@ -500,7 +507,8 @@ void Socket::accept(const Socket* listenSocket, int64_t timeout) {
     connectRetries_ = listenSocket->getConnectRetries();
     acceptRetries_ = listenSocket->getAcceptRetries();
     abortFlag_ = listenSocket->getAbortFlag();
-    asyncFlag_ = listenSocket->getAsyncFlag();
+    // a socket created async stays async, so that its owner can accept without waiting for the peer
+    asyncFlag_ = asyncFlag_ || listenSocket->getAsyncFlag();
     magic_ = listenSocket->getMagic();
     type_ = listenSocket->getType();
     addr_ = listenSocket->getAddr();
@@ -573,6 +581,133 @@ void Socket::recvUntilEnd(void* ptr, int size, int* closed) {
   } while (bytes > 0 && (offset) < size);
 }
 
+int Socket::trySend(const void* ptr, int size) {
+  int offset = 0;
+  socketProgress(MSCCLPP_SOCKET_SEND, const_cast<void*>(ptr), size, &offset);
+  return offset;
+}
+
+int Socket::tryRecv(void* ptr, int size) {
+  int offset = 0;
+  int closed;
+  socketProgressOpt(MSCCLPP_SOCKET_RECV, ptr, size, &offset, 0, &closed);
+  // report bytes received before the peer closed the connection; the next call throws
+  if (closed && offset == 0) {
+    char line[SOCKET_NAME_MAXLEN + 1];
+    throw Error("connection closed by remote peer " + std::string(SocketToString(&addr_, line, 0)),
+                ErrorCode::RemoteError);
+  }
+  return offset;
+}
+
+int Socket::sendv(struct iovec* iov, int iovcnt, int flags) {
+  if (state_ != SocketStateReady) {
+    std::stringstream ss;
+    ss << "socket state (" << state_ << ") is not ready";
+    throw Error(ss.str(), ErrorCode::InternalError);
+  }
+  struct msghdr msg = {};
+  msg.msg_iov = iov;
+  msg.msg_iovlen = iovcnt;
+  int zeroCopySends = 0;
+  while (msg.msg_iovlen > 0) {
+    ssize_t bytes = ::sendmsg(fd_, &msg, flags | MSG_NOSIGNAL);
+    if (bytes == -1) {
+      if (errno == EWOULDBLOCK || errno == EAGAIN) {
+        pollReady(POLLOUT);
+      } else if (errno == ENOBUFS && (flags & MSG_ZEROCOPY)) {
+        // out of memory for pinned pages: the kernel wants the data copied
+        flags &= ~MSG_ZEROCOPY;
+      } else if (errno != EINTR) {
+        throw SysError("sendmsg failed", errno);
+      }
+      if (abortFlag_ && *abortFlag_ != 0) {
+        throw Error("aborted", ErrorCode::Aborted);
+      }
+      continue;
+    }
+    if (flags & MSG_ZEROCOPY) zeroCopySends++;
+    // skip the iovecs that are fully sent and advance into the partially sent one
+    while (msg.msg_iovlen > 0 && bytes >= static_cast<ssize_t>(msg.msg_iov->iov_len)) {
+      bytes -= msg.msg_iov->iov_len;
+      msg.msg_iov++;
+      msg.msg_iovlen--;
+    }
+    if (msg.msg_iovlen > 0) {
+      msg.msg_iov->iov_base = static_cast<char*>(msg.msg_iov->iov_base) + bytes;
+      msg.msg_iov->iov_len -= bytes;
+    }
+    if (abortFlag_ && *abortFlag_ != 0) {
+      throw Error("aborted", ErrorCode::Aborted);
+    }
+  }
+  return zeroCopySends;
+}
+
+ssize_t Socket::recvv(const struct iovec* iov, int iovcnt) {
+  if (state_ != SocketStateReady) {
+    std::stringstream ss;
+    ss << "socket state (" << state_ << ") is not ready";
+    throw Error(ss.str(), ErrorCode::InternalError);
+  }
+  while (true) {
+    ssize_t bytes = ::readv(fd_, iov, iovcnt);
+    if (bytes >= 0) return bytes;
+    if (state_ == SocketStateClosed) return 0;
+    if (errno == EWOULDBLOCK || errno == EAGAIN) {
+      pollReady(POLLIN);
+    } else if (errno != EINTR) {
+      throw SysError("readv failed", errno);
+    }
+    if (abortFlag_ && *abortFlag_ != 0) {
+      throw Error("aborted", ErrorCode::Aborted);
+    }
+  }
+}
+
+void Socket::pollReady(short events) {
+  struct pollfd pfd;
+  memset(&pfd, 0, sizeof(struct pollfd));
+  pfd.fd = fd_;
+  pfd.events = events;
+  if (::poll(&pfd, 1, MSCCLPP_SOCKET_POLL_TIMEOUT_MS) == -1 && errno != EINTR) {
+    throw SysError("poll failed", errno);
+  }
+}
+
+bool Socket::enableZeroCopy() {
+#if defined(SO_ZEROCOPY) && defined(SO_EE_ORIGIN_ZEROCOPY)
+  int one = 1;
+  if (setsockopt(fd_, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0) return true;
+  INFO(MSCCLPP_NET, "setsockopt(SO_ZEROCOPY) failed, errno %d", errno);
+#endif
+  return false;
+}
+
+int Socket::recvZeroCopyCompletions() {
+  int completed = 0;
+#if defined(SO_ZEROCOPY) && defined(SO_EE_ORIGIN_ZEROCOPY)
+  while (true) {
+    char control[CMSG_SPACE(sizeof(struct sock_extended_err))];
+    struct msghdr msg = {};
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (::recvmsg(fd_, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) == -1) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK) return completed;
+      throw SysError("recvmsg(MSG_ERRQUEUE) failed", errno);
+    }
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      auto* err = reinterpret_cast<struct sock_extended_err*>(CMSG_DATA(cmsg));
+      if (err->ee_errno != 0 || err->ee_origin != SO_EE_ORIGIN_ZEROCOPY) continue;
+      // the notification covers the sends numbered ee_info to ee_data
+      completed += err->ee_data - err->ee_info + 1;
+    }
+  }
+#endif
+  return completed;
+}
+
 void Socket::close() {
   if (fd_ >= 0) ::close(fd_);
   state_ = SocketStateClosed;
@@ -614,33 +749,32 @@ void Socket::tryAccept() {
 }
 
 void Socket::finalizeAccept() {
-  uint64_t magic;
-  enum SocketType type;
-  int received = 0;
-  socketProgress(MSCCLPP_SOCKET_RECV, &magic, sizeof(magic), &received);
-  if (received == 0) return;
-  socketWait(MSCCLPP_SOCKET_RECV, &magic, sizeof(magic), &received);
-  if (magic != magic_) {
-    WARN("finalizeAccept: wrong magic %lx != %lx", magic, magic_);
-    ::close(fd_);
-    fd_ = -1;
-    // Ignore spurious connection and accept again
-    state_ = SocketStateAccepting;
-    return;
-  } else {
-    received = 0;
-    socketWait(MSCCLPP_SOCKET_RECV, &type, sizeof(type), &received);
-    if (type != type_) {
-      state_ = SocketStateError;
+  // The magic and the type may arrive in pieces. What has arrived is kept across calls, so an async socket returns
+  // instead of waiting for the rest.
+  if (acceptMagicOffset_ < (int)sizeof(acceptMagic_)) {
+    socketProgress(MSCCLPP_SOCKET_RECV, &acceptMagic_, sizeof(acceptMagic_), &acceptMagicOffset_);
+    if (acceptMagicOffset_ < (int)sizeof(acceptMagic_)) return;
+    if (acceptMagic_ != magic_) {
+      WARN("finalizeAccept: wrong magic %lx != %lx", acceptMagic_, magic_);
       ::close(fd_);
       fd_ = -1;
-      std::stringstream ss;
-      ss << "wrong socket type " << type << " != " << type_;
-      throw Error(ss.str(), ErrorCode::InternalError);
-    } else {
-      state_ = SocketStateReady;
+      acceptMagicOffset_ = 0;
+      // Ignore spurious connection and accept again
+      state_ = SocketStateAccepting;
+      return;
     }
   }
+  socketProgress(MSCCLPP_SOCKET_RECV, &acceptType_, sizeof(acceptType_), &acceptTypeOffset_);
+  if (acceptTypeOffset_ < (int)sizeof(acceptType_)) return;
+  if (acceptType_ != type_) {
+    state_ = SocketStateError;
+    ::close(fd_);
+    fd_ = -1;
+    std::stringstream ss;
+    ss << "wrong socket type " << acceptType_ << " != " << type_;
+    throw Error(ss.str(), ErrorCode::InternalError);
+  }
+  state_ = SocketStateReady;
 }
 
 void Socket::startConnect() {
@@ -30,17 +30,36 @@ MSCCLPP_API_CPP RegisteredMemory Communicator::registerMemory(void* ptr, size_t
   return context()->registerMemory(ptr, size, transports);
 }
 
+// Starts sending `data` like Bootstrap::send(const std::vector<char>&, int, int) does, but returns before it is sent,
+// so that the sends of all Setuppables of one Communicator::setup() are in flight together.
+static std::vector<std::future<void>> isendOnSetup(std::shared_ptr<Bootstrap> bootstrap, const std::vector<char>& data,
+                                                   int remoteRank, int tag) {
+  size_t size = data.size();
+  std::vector<std::future<void>> sent;
+  sent.push_back(bootstrap->isend(&size, sizeof(size_t), remoteRank, tag));
+  sent.push_back(bootstrap->isend(const_cast<char*>(data.data()), data.size(), remoteRank, tag + 1));
+  return sent;
+}
+
+static void waitSent(std::vector<std::future<void>>& sent) {
+  for (auto& future : sent) future.get();
+  sent.clear();
+}
+
 struct MemorySender : public Setuppable {
   MemorySender(RegisteredMemory memory, int remoteRank, int tag)
       : memory_(memory), remoteRank_(remoteRank), tag_(tag) {}
 
   void beginSetup(std::shared_ptr<Bootstrap> bootstrap) override {
-    bootstrap->send(memory_.serialize(), remoteRank_, tag_);
+    sent_ = isendOnSetup(bootstrap, memory_.serialize(), remoteRank_, tag_);
   }
 
+  void endSetup(std::shared_ptr<Bootstrap>) override { waitSent(sent_); }
+
   RegisteredMemory memory_;
   int remoteRank_;
   int tag_;
+  std::vector<std::future<void>> sent_;
 };
 
 MSCCLPP_API_CPP void Communicator::sendMemoryOnSetup(RegisteredMemory memory, int remoteRank, int tag) {
@@ -76,7 +95,7 @@ struct Communicator::Impl::Connector : public Setuppable {
         localEndpoint_(comm.context()->createEndpoint(localConfig)) {}
 
   void beginSetup(std::shared_ptr<Bootstrap> bootstrap) override {
-    bootstrap->send(localEndpoint_.serialize(), remoteRank_, tag_);
+    sent_ = isendOnSetup(bootstrap, localEndpoint_.serialize(), remoteRank_, tag_);
   }
 
   void endSetup(std::shared_ptr<Bootstrap> bootstrap) override {
@@ -88,6 +107,7 @@ struct Communicator::Impl::Connector : public Setuppable {
     connectionPromise_.set_value(connection);
     INFO(MSCCLPP_INIT, "Connection %d -> %d created (%s)", comm_.bootstrap()->getRank(), remoteRank_,
          connection->getTransportName().c_str());
+    waitSent(sent_);
   }
 
   std::promise<std::shared_ptr<Connection>> connectionPromise_;
@@ -96,6 +116,7 @@ struct Communicator::Impl::Connector : public Setuppable {
   int remoteRank_;
   int tag_;
   Endpoint localEndpoint_;
+  std::vector<std::future<void>> sent_;
 };
 
 MSCCLPP_API_CPP NonblockingFuture<std::shared_ptr<Connection>> Communicator::connectOnSetup(
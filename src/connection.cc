@@ -7,6 +7,9 @@
 #include <mscclpp/npkit/npkit.hpp>
 #endif
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <mscclpp/utils.hpp>
 #include <sstream>
 #include <thread>
@@ -36,10 +39,75 @@ std::string Connection::getTransportName() {
          TransportNames[static_cast<int>(this->remoteTransport())];
 }
 
+Request Connection::writeAsync(RegisteredMemory dst, uint64_t dstOffset, RegisteredMemory src, uint64_t srcOffset,
+                               uint64_t size) {
+  write(dst, dstOffset, src, srcOffset, size);
+  flush();
+  return Request();
+}
+
+Request Connection::updateAndSyncAsync(RegisteredMemory dst, uint64_t dstOffset, uint64_t* src, uint64_t newValue) {
+  updateAndSync(dst, dstOffset, src, newValue);
+  flush();
+  return Request();
+}
+
+Request Connection::makeRequest(Connection* connection, uint64_t id) { return Request(connection, id); }
+
+bool Connection::testRequest(uint64_t) { return true; }
+
+void Connection::waitRequest(uint64_t id, int64_t timeoutUsec) {
+  Timer timer;
+  while (!testRequest(id)) {
+    if (timeoutUsec >= 0 && timer.elapsed() > timeoutUsec) {
+      throw Error("Request timed out: waited for " + std::to_string(timer.elapsed() / 1e6) + " seconds",
+                  ErrorCode::Timeout);
+    }
+    // the transports complete requests from other threads or the NIC, so let them run
+    std::this_thread::yield();
+  }
+}
+
+// Request
+
+Request::Request(Connection* connection, uint64_t id) : connection_(connection), id_(id) {}
+
+bool Request::test() const { return connection_ == nullptr || connection_->testRequest(id_); }
+
+void Request::wait(int64_t timeoutUsec) const {
+  if (connection_ != nullptr) {
+    connection_->waitRequest(id_, timeoutUsec);
+  }
+}
+
+void waitAll(const std::vector<Request>& requests, int64_t timeoutUsec) {
+  Timer timer;
+  for (const Request& request : requests) {
+    request.wait(timeoutUsec < 0 ? -1 : std::max<int64_t>(timeoutUsec - timer.elapsed(), 0));
+  }
+}
+
+size_t waitAny(const std::vector<Request>& requests, int64_t timeoutUsec) {
+  if (requests.empty()) {
+    throw Error("waitAny needs at least one request", ErrorCode::InvalidUsage);
+  }
+  Timer timer;
+  while (true) {
+    for (size_t i = 0; i < requests.size(); ++i) {
+      if (requests[i].test()) return i;
+    }
+    if (timeoutUsec >= 0 && timer.elapsed() > timeoutUsec) {
+      throw Error("waitAny timed out: waited for " + std::to_string(timer.elapsed() / 1e6) + " seconds",
+                  ErrorCode::Timeout);
+    }
+    std::this_thread::yield();
+  }
+}
+
 // CudaIpcConnection
 
 CudaIpcConnection::CudaIpcConnection(Endpoint localEndpoint, Endpoint remoteEndpoint, cudaStream_t stream)
-    : stream_(stream) {
+    : stream_(stream), firstRequest_(1) {
   if (localEndpoint.transport() != Transport::CudaIpc) {
     throw mscclpp::Error("Cuda IPC connection can only be made from a Cuda IPC endpoint", ErrorCode::InvalidUsage);
   }
@@ -56,6 +124,15 @@ CudaIpcConnection::CudaIpcConnection(Endpoint localEndpoint, Endpoint remoteEndp
   INFO(MSCCLPP_P2P, "Cuda IPC connection created");
 }
 
+CudaIpcConnection::~CudaIpcConnection() {
+  for (auto event : requestEvents_) {
+    cudaEventDestroy(event);
+  }
+  for (auto event : freeEvents_) {
+    cudaEventDestroy(event);
+  }
+}
+
 Transport CudaIpcConnection::transport() { return Transport::CudaIpc; }
 
 Transport CudaIpcConnection::remoteTransport() { return Transport::CudaIpc; }
@@ -111,19 +188,88 @@ void CudaIpcConnection::flush(int64_t timeoutUsec) {
   MSCCLPP_CUDATHROW(cudaStreamSynchronize(stream_));
   INFO(MSCCLPP_P2P, "CudaIpcConnection flushing connection");
 
+  // the events of all requests have passed
+  freeEvents_.insert(freeEvents_.end(), requestEvents_.begin(), requestEvents_.end());
+  firstRequest_ += requestEvents_.size();
+  requestEvents_.clear();
+
 #if defined(ENABLE_NPKIT) && defined(ENABLE_NPKIT_EVENT_CONN_CUDA_IPC_FLUSH_EXIT)
   NpKit::CollectCpuEvent(NPKIT_EVENT_CONN_CUDA_IPC_FLUSH_EXIT, 0, 0, *NpKit::GetCpuTimestamp(), 0);
 #endif
 }
 
+Request CudaIpcConnection::writeAsync(RegisteredMemory dst, uint64_t dstOffset, RegisteredMemory src,
+                                      uint64_t srcOffset, uint64_t size) {
+  write(dst, dstOffset, src, srcOffset, size);
+  return record();
+}
+
+Request CudaIpcConnection::updateAndSyncAsync(RegisteredMemory dst, uint64_t dstOffset, uint64_t* src,
+                                              uint64_t newValue) {
+  updateAndSync(dst, dstOffset, src, newValue);
+  return record();
+}
+
+Request CudaIpcConnection::record() {
+  progress();
+  cudaEvent_t event;
+  if (freeEvents_.empty()) {
+    MSCCLPP_CUDATHROW(cudaEventCreateWithFlags(&event, cudaEventDisableTiming));
+  } else {
+    event = freeEvents_.back();
+    freeEvents_.pop_back();
+  }
+  try {
+    MSCCLPP_CUDATHROW(cudaEventRecord(event, stream_));
+  } catch (...) {
+    freeEvents_.push_back(event);
+    throw;
+  }
+  requestEvents_.push_back(event);
+  return makeRequest(this, firstRequest_ + requestEvents_.size() - 1);
+}
+
+void CudaIpcConnection::progress() {
+  while (!requestEvents_.empty()) {
+    cudaError_t err = cudaEventQuery(requestEvents_.front());
+    if (err == cudaErrorNotReady) break;
+    MSCCLPP_CUDATHROW(err);
+    freeEvents_.push_back(requestEvents_.front());
+    requestEvents_.pop_front();
+    firstRequest_++;
+  }
+}
+
+bool CudaIpcConnection::testRequest(uint64_t id) {
+  progress();
+  return id < firstRequest_;
+}
+
+void CudaIpcConnection::waitRequest(uint64_t id, int64_t timeoutUsec) {
+  if (testRequest(id)) return;
+  if (timeoutUsec >= 0) {
+    INFO(MSCCLPP_P2P, "CudaIpcConnection wait: timeout is not supported, ignored");
+  }
+  AvoidCudaGraphCaptureGuard guard;
+  MSCCLPP_CUDATHROW(cudaEventSynchronize(requestEvents_[id - firstRequest_]));
+  progress();
+}
+
 // IBConnection
 
 IBConnection::IBConnection(Endpoint localEndpoint, Endpoint remoteEndpoint, Context& context)
-    : transport_(localEndpoint.transport()),
-      remoteTransport_(remoteEndpoint.transport()),
-      dummyAtomicSource_(std::make_unique<uint64_t>(0)) {
-  qp = getImpl(localEndpoint)->ibQp_;
-  qp->rtr(getImpl(remoteEndpoint)->ibQpInfo_);
+    : IBConnection(localEndpoint.transport(), remoteEndpoint.transport(), getImpl(localEndpoint)->ibQp_,
+                   getImpl(remoteEndpoint)->ibQpInfo_, context) {}
+
+IBConnection::IBConnection(Transport transport, Transport remoteTransport, IbQp* qp, const IbQpInfo& remoteQpInfo,
+                           Context& context)
+    : transport_(transport),
+      remoteTransport_(remoteTransport),
+      qp(qp),
+      dummyAtomicSource_(std::make_unique<uint64_t>(0)),
+      batching_(false),
+      lastRequest_(0) {
+  qp->rtr(remoteQpInfo);
   qp->rts();
   dummyAtomicSourceMem_ = context.registerMemory(dummyAtomicSource_.get(), sizeof(uint64_t), transport_);
   validateTransport(dummyAtomicSourceMem_, transport_);
@@ -141,6 +287,16 @@ void IBConnection::write(RegisteredMemory dst, uint64_t dstOffset, RegisteredMem
   NpKit::CollectCpuEvent(NPKIT_EVENT_CONN_CUDA_IPC_WRITE_ENTRY, uint32_t(size), 0, *NpKit::GetCpuTimestamp(), 0);
 #endif
 
+  // the QP signals one in every few work requests, which is enough to reclaim the send queue
+  stageWrite(dst, dstOffset, src, srcOffset, size, /*signaled=*/false);
+
+#if defined(ENABLE_NPKIT) && defined(ENABLE_NPKIT_EVENT_CONN_IB_WRITE_EXIT)
+  NpKit::CollectCpuEvent(NPKIT_EVENT_CONN_CUDA_IPC_WRITE_EXIT, uint32_t(size), 0, *NpKit::GetCpuTimestamp(), 0);
+#endif
+}
+
+void IBConnection::stageWrite(RegisteredMemory dst, uint64_t dstOffset, RegisteredMemory src, uint64_t srcOffset,
+                              uint64_t size, bool signaled) {
   validateTransport(dst, remoteTransport(), dstOffset, size);
   validateTransport(src, transport(), srcOffset, size);
 
@@ -156,16 +312,15 @@ void IBConnection::write(RegisteredMemory dst, uint64_t dstOffset, RegisteredMem
   auto dstMrInfo = dstTransportInfo.ibMrInfo;
   auto srcMr = srcTransportInfo.ibMr;
 
-  qp->stageSend(srcMr, dstMrInfo, (uint32_t)size, /*wrId=*/0, /*srcOffset=*/srcOffset, /*dstOffset=*/dstOffset,
-                /*signaled=*/true);
+  if (qp->isStagingFull()) {
+    qp->postSend();
+  }
+  qp->stageSend(srcMr, dstMrInfo, (uint32_t)size, /*wrId=*/lastRequest_, /*srcOffset=*/srcOffset,
+                /*dstOffset=*/dstOffset, signaled);
 
-  qp->postSend();
+  post();
   INFO(MSCCLPP_NET, "IBConnection write: from %p to %p, size %lu", (uint8_t*)srcMr->getBuff() + srcOffset,
        (uint8_t*)dstMrInfo.addr + dstOffset, size);
-
-#if defined(ENABLE_NPKIT) && defined(ENABLE_NPKIT_EVENT_CONN_IB_WRITE_EXIT)
-  NpKit::CollectCpuEvent(NPKIT_EVENT_CONN_CUDA_IPC_WRITE_EXIT, uint32_t(size), 0, *NpKit::GetCpuTimestamp(), 0);
-#endif
 }
 
 void IBConnection::updateAndSync(RegisteredMemory dst, uint64_t dstOffset, uint64_t* src, uint64_t newValue) {
@@ -173,6 +328,15 @@ void IBConnection::updateAndSync(RegisteredMemory dst, uint64_t dstOffset, uint6
   NpKit::CollectCpuEvent(NPKIT_EVENT_CONN_IB_UPDATE_AND_SYNC_ENTRY, 0, 0, *NpKit::GetCpuTimestamp(), 0);
 #endif
 
+  stageUpdate(dst, dstOffset, src, newValue, /*signaled=*/false);
+
+#if defined(ENABLE_NPKIT) && defined(ENABLE_NPKIT_EVENT_CONN_IB_UPDATE_AND_SYNC_EXIT)
+  NpKit::CollectCpuEvent(NPKIT_EVENT_CONN_IB_UPDATE_AND_SYNC_EXIT, 0, 0, *NpKit::GetCpuTimestamp(), 0);
+#endif
+}
+
+void IBConnection::stageUpdate(RegisteredMemory dst, uint64_t dstOffset, uint64_t* src, uint64_t newValue,
+                               bool signaled) {
   validateTransport(dst, remoteTransport());
   auto dstTransportInfo = getImpl(dst)->getTransportInfo(remoteTransport());
   if (dstTransportInfo.ibLocal) {
@@ -184,15 +348,15 @@ void IBConnection::updateAndSync(RegisteredMemory dst, uint64_t dstOffset, uint6
   uint64_t oldValue = *src;
   *src = newValue;
 
-  qp->stageAtomicAdd(dstTransportInfo_.ibMr, dstMrInfo, /*wrId=*/0, dstOffset, newValue - oldValue, /*signaled=*/true);
+  if (qp->isStagingFull()) {
+    qp->postSend();
+  }
+  qp->stageAtomicAdd(dstTransportInfo_.ibMr, dstMrInfo, /*wrId=*/lastRequest_, dstOffset, newValue - oldValue,
+                     signaled);
 
-  qp->postSend();
+  post();
   INFO(MSCCLPP_NET, "IBConnection atomic Write: from %p to %p, %lu -> %lu", src, (uint8_t*)dstMrInfo.addr + dstOffset,
        oldValue, newValue);
-
-#if defined(ENABLE_NPKIT) && defined(ENABLE_NPKIT_EVENT_CONN_IB_UPDATE_AND_SYNC_EXIT)
-  NpKit::CollectCpuEvent(NPKIT_EVENT_CONN_IB_UPDATE_AND_SYNC_EXIT, 0, 0, *NpKit::GetCpuTimestamp(), 0);
-#endif
 }
 
 void IBConnection::flush(int64_t timeoutUsec) {
@@ -200,12 +364,21 @@ void IBConnection::flush(int64_t timeoutUsec) {
   NpKit::CollectCpuEvent(NPKIT_EVENT_CONN_IB_FLUSH_ENTRY, 0, 0, *NpKit::GetCpuTimestamp(), 0);
 #endif
 
+  // Only a signaled work request completes, and its completion implies that all earlier ones completed. A signaled
+  // empty write covers the unsignaled work requests after the last signaled one.
+  if (qp->hasUnsignaledTail()) {
+    if (qp->isStagingFull()) {
+      qp->postSend();
+    }
+    qp->stageSignal(/*wrId=*/lastRequest_);
+  }
+  // work requests that a batch staged must be posted before their completions can be polled
+  qp->postSend();
+
   Timer timer;
   while (qp->getNumCqItems()) {
-    int wcNum = qp->pollCq();
-    if (wcNum < 0) {
-      throw mscclpp::IbError("pollCq failed: error no " + std::to_string(errno), errno);
-    } else if (timeoutUsec >= 0) {
+    poll();
+    if (timeoutUsec >= 0) {
       auto elapsed = timer.elapsed();
       if (elapsed > timeoutUsec) {
         throw Error("pollCq timed out: waited for " + std::to_string(elapsed / 1e6) + " seconds. Expected " +
@@ -213,12 +386,6 @@ void IBConnection::flush(int64_t timeoutUsec) {
                     ErrorCode::Timeout);
       }
     }
-    for (int i = 0; i < wcNum; ++i) {
-      int status = qp->getWcStatus(i);
-      if (status != static_cast<int>(WsStatus::Success)) {
-        throw mscclpp::IbError("a work item failed: status " + std::to_string(status), status);
-      }
-    }
   }
   INFO(MSCCLPP_NET, "IBConnection flushing connection");
 
@@ -227,45 +394,447 @@ void IBConnection::flush(int64_t timeoutUsec) {
 #endif
 }
 
+Request IBConnection::writeAsync(RegisteredMemory dst, uint64_t dstOffset, RegisteredMemory src, uint64_t srcOffset,
+                                 uint64_t size) {
+  lastRequest_++;
+  stageWrite(dst, dstOffset, src, srcOffset, size, /*signaled=*/true);
+  return makeRequest(this, lastRequest_);
+}
+
+Request IBConnection::updateAndSyncAsync(RegisteredMemory dst, uint64_t dstOffset, uint64_t* src, uint64_t newValue) {
+  lastRequest_++;
+  stageUpdate(dst, dstOffset, src, newValue, /*signaled=*/true);
+  return makeRequest(this, lastRequest_);
+}
+
+bool IBConnection::testRequest(uint64_t id) {
+  if (id <= qp->getLastCompletedWrId()) return true;
+  // a request that a batch staged must be posted before it can complete
+  qp->postSend();
+  poll();
+  return id <= qp->getLastCompletedWrId();
+}
+
+int IBConnection::poll() {
+  int wcNum = qp->pollCq();
+  if (wcNum < 0) {
+    throw mscclpp::IbError("pollCq failed: error no " + std::to_string(errno), errno);
+  }
+  for (int i = 0; i < wcNum; ++i) {
+    int status = qp->getWcStatus(i);
+    if (status != static_cast<int>(WsStatus::Success)) {
+      throw mscclpp::IbError("a work item failed: status " + std::to_string(status), status);
+    }
+  }
+  return wcNum;
+}
+
+void IBConnection::beginBatch() { batching_ = true; }
+
+void IBConnection::endBatch() {
+  batching_ = false;
+  qp->postSend();
+}
+
+void IBConnection::post() {
+  if (!batching_) {
+    qp->postSend();
+  }
+}
+
+// MultiRailIBConnection
+
+MultiRailIBConnection::MultiRailIBConnection(Endpoint localEndpoint, Endpoint remoteEndpoint, Context& context)
+    : firstRequest_(1) {
+  auto localImpl = getImpl(localEndpoint);
+  auto remoteImpl = getImpl(remoteEndpoint);
+  if (localImpl->ibRailTransports_.size() != remoteImpl->ibRailTransports_.size()) {
+    throw Error("Both ends of a multi-rail IB connection must use the same number of rails", ErrorCode::InvalidUsage);
+  }
+  threshold_ = localImpl->ibMultiRailThreshold_;
+  rails_.push_back(std::make_unique<IBConnection>(localEndpoint, remoteEndpoint, context));
+  for (size_t i = 0; i < localImpl->ibRailTransports_.size(); ++i) {
+    rails_.push_back(std::make_unique<IBConnection>(localImpl->ibRailTransports_[i], remoteImpl->ibRailTransports_[i],
+                                                    localImpl->ibRailQps_[i], remoteImpl->ibRailQpInfos_[i],
+                                                    context));
+  }
+  pending_.assign(rails_.size(), false);
+  INFO(MSCCLPP_NET, "Multi-rail IB connection over %zu rails created", rails_.size());
+}
+
+Transport MultiRailIBConnection::transport() { return rails_[0]->transport(); }
+
+Transport MultiRailIBConnection::remoteTransport() { return rails_[0]->remoteTransport(); }
+
+void MultiRailIBConnection::write(RegisteredMemory dst, uint64_t dstOffset, RegisteredMemory src, uint64_t srcOffset,
+                                  uint64_t size) {
+  if (size < threshold_) {
+    rails_[0]->write(dst, dstOffset, src, srcOffset, size);
+    return;
+  }
+  uint64_t segment = (size + rails_.size() - 1) / rails_.size();
+  for (size_t i = 0; i < rails_.size() && i * segment < size; ++i) {
+    uint64_t offset = i * segment;
+    rails_[i]->write(dst, dstOffset + offset, src, srcOffset + offset, std::min(segment, size - offset));
+    pending_[i] = true;
+  }
+}
+
+void MultiRailIBConnection::updateAndSync(RegisteredMemory dst, uint64_t dstOffset, uint64_t* src,
+                                          uint64_t newValue) {
+  fence();
+  rails_[0]->updateAndSync(dst, dstOffset, src, newValue);
+}
+
+void MultiRailIBConnection::flush(int64_t timeoutUsec) {
+  for (size_t i = 0; i < rails_.size(); ++i) {
+    rails_[i]->flush(timeoutUsec);
+    pending_[i] = false;
+  }
+  firstRequest_ += requests_.size();
+  requests_.clear();
+}
+
+Request MultiRailIBConnection::writeAsync(RegisteredMemory dst, uint64_t dstOffset, RegisteredMemory src,
+                                          uint64_t srcOffset, uint64_t size) {
+  if (size < threshold_) {
+    return push({rails_[0]->writeAsync(dst, dstOffset, src, srcOffset, size)});
+  }
+  std::vector<Request> railRequests;
+  uint64_t segment = (size + rails_.size() - 1) / rails_.size();
+  for (size_t i = 0; i < rails_.size() && i * segment < size; ++i) {
+    uint64_t offset = i * segment;
+    railRequests.push_back(
+        rails_[i]->writeAsync(dst, dstOffset + offset, src, srcOffset + offset, std::min(segment, size - offset)));
+    pending_[i] = true;
+  }
+  return push(std::move(railRequests));
+}
+
+Request MultiRailIBConnection::updateAndSyncAsync(RegisteredMemory dst, uint64_t dstOffset, uint64_t* src,
+                                                  uint64_t newValue) {
+  fence();
+  return push({rails_[0]->updateAndSyncAsync(dst, dstOffset, src, newValue)});
+}
+
+void MultiRailIBConnection::fence() {
+  // Work requests of different QPs are not ordered with each other, so wait until the other rails complete theirs.
+  for (size_t i = 1; i < rails_.size(); ++i) {
+    if (pending_[i]) {
+      rails_[i]->flush();
+      pending_[i] = false;
+    }
+  }
+}
+
+void MultiRailIBConnection::progress() {
+  while (!requests_.empty() && std::all_of(requests_.front().begin(), requests_.front().end(),
+                                           [](const Request& request) { return request.test(); })) {
+    requests_.pop_front();
+    firstRequest_++;
+  }
+}
+
+Request MultiRailIBConnection::push(std::vector<Request> railRequests) {
+  progress();
+  requests_.push_back(std::move(railRequests));
+  return makeRequest(this, firstRequest_ + requests_.size() - 1);
+}
+
+bool MultiRailIBConnection::testRequest(uint64_t id) {
+  progress();
+  return id < firstRequest_;
+}
+
+void MultiRailIBConnection::beginBatch() {
+  for (auto& rail : rails_) {
+    static_cast<IBConnection*>(rail.get())->beginBatch();
+  }
+}
+
+void MultiRailIBConnection::endBatch() {
+  for (auto& rail : rails_) {
+    static_cast<IBConnection*>(rail.get())->endBatch();
+  }
+}
+
+int MultiRailIBConnection::numRails() const { return rails_.size(); }
+
+// SharedMemoryConnection
+
+SharedMemoryConnection::SharedMemoryConnection(Endpoint localEndpoint, Endpoint remoteEndpoint) {
+  if (localEndpoint.transport() != Transport::SharedMemory || remoteEndpoint.transport() != Transport::SharedMemory) {
+    throw Error("Shared memory connection can only be made between shared memory endpoints", ErrorCode::InvalidUsage);
+  }
+  if (getImpl(remoteEndpoint)->hostHash_ != getImpl(localEndpoint)->hostHash_) {
+    std::stringstream ss;
+    ss << "Shared memory connection can only be made within a node: " << std::hex
+       << getImpl(remoteEndpoint)->hostHash_ << " != " << std::hex << getImpl(localEndpoint)->hostHash_;
+    throw Error(ss.str(), ErrorCode::InvalidUsage);
+  }
+  INFO(MSCCLPP_P2P, "Shared memory connection created");
+}
+
+Transport SharedMemoryConnection::transport() { return Transport::SharedMemory; }
+
+Transport SharedMemoryConnection::remoteTransport() { return Transport::SharedMemory; }
+
+void SharedMemoryConnection::write(RegisteredMemory dst, uint64_t dstOffset, RegisteredMemory src,
+                                   uint64_t srcOffset, uint64_t size) {
+  validateTransport(dst, remoteTransport(), dstOffset, size);
+  validateTransport(src, transport(), srcOffset, size);
+  if (dst.data() == nullptr) {
+    throw Error("dst is not in shared memory", ErrorCode::InvalidUsage);
+  }
+  std::memcpy(static_cast<char*>(dst.data()) + dstOffset, static_cast<char*>(src.data()) + srcOffset, size);
+}
+
+void SharedMemoryConnection::updateAndSync(RegisteredMemory dst, uint64_t dstOffset, uint64_t* src,
+                                           uint64_t newValue) {
+  validateTransport(dst, remoteTransport(), dstOffset, sizeof(uint64_t));
+  if (dst.data() == nullptr) {
+    throw Error("dst is not in shared memory", ErrorCode::InvalidUsage);
+  }
+  *src = newValue;
+  // orders the copies of earlier writes before the value
+  __atomic_store_n(reinterpret_cast<uint64_t*>(static_cast<char*>(dst.data()) + dstOffset), newValue,
+                   __ATOMIC_RELEASE);
+}
+
+void SharedMemoryConnection::flush(int64_t) {}
+
+Request SharedMemoryConnection::writeAsync(RegisteredMemory dst, uint64_t dstOffset, RegisteredMemory src,
+                                           uint64_t srcOffset, uint64_t size) {
+  write(dst, dstOffset, src, srcOffset, size);
+  return Request();
+}
+
+Request SharedMemoryConnection::updateAndSyncAsync(RegisteredMemory dst, uint64_t dstOffset, uint64_t* src,
+                                                   uint64_t newValue) {
+  updateAndSync(dst, dstOffset, src, newValue);
+  return Request();
+}
+
 // EthernetConnection
 
-EthernetConnection::EthernetConnection(Endpoint localEndpoint, Endpoint remoteEndpoint, uint64_t sendBufferSize,
-                                       uint64_t recvBufferSize)
-    : abortFlag_(0), sendBufferSize_(sendBufferSize), recvBufferSize_(recvBufferSize) {
+namespace {
+
+// The receiver acknowledges at least once every this many messages, even if more messages are waiting.
+constexpr uint64_t EthernetAckInterval = 64;
+
+// The sender sends at most this many queued messages with one system call.
+constexpr size_t EthernetMaxSendBatch = 64;
+
+// The receiver reads up to this many bytes beyond the message it is receiving, to pick up the following headers.
+constexpr size_t EthernetRecvAheadSize = 64 * 1024;
+
+// The version of the wire format of Ethernet connections. Both ends must use the same version.
+constexpr uint32_t EthernetWireVersion = 1;
+
+// Flags of an Ethernet message. A marker carries no data and tells the receiver that its stream has passed an
+// updateAndSync. A fenced message waits until the other streams of the connection have passed their markers.
+constexpr uint32_t EthernetMessageMarker = 1;
+constexpr uint32_t EthernetMessageFence = 2;
+
+// Precedes the data of every message on an Ethernet connection and goes out in the same system call as the data.
+struct EthernetMessageHeader {
+  uint32_t version;
+  uint32_t flags;
+  uint64_t dstPtr;
+  uint64_t size;
+  uint64_t seq;
+};
+
+// Reads the byte stream of an Ethernet connection. Data is first taken from a read-ahead buffer. The rest is received
+// straight into the destination with readv(), which also fills the read-ahead buffer with whatever follows, so that
+// the headers and small payloads of back-to-back messages arrive with one system call.
+class EthernetStreamReader {
+ public:
+  EthernetStreamReader(Socket& socket, size_t aheadSize) : socket_(socket), ahead_(aheadSize), begin_(0), end_(0) {}
+
+  // Receives exactly size bytes into dst. Returns false if the peer closed the connection first.
+  bool read(void* dst, uint64_t size) {
+    char* out = static_cast<char*>(dst);
+    uint64_t done = std::min<uint64_t>(size, end_ - begin_);
+    std::memcpy(out, ahead_.data() + begin_, done);
+    begin_ += done;
+    if (done < size) {
+      begin_ = end_ = 0;
+    }
+    while (done < size) {
+      struct iovec iov[2] = {{out + done, size - done}, {ahead_.data(), ahead_.size()}};
+      ssize_t bytes = socket_.recvv(iov, 2);
+      if (bytes == 0) return false;
+      if (static_cast<uint64_t>(bytes) <= size - done) {
+        done += bytes;
+      } else {
+        end_ = bytes - (size - done);
+        done = size;
+      }
+    }
+    return true;
+  }
+
+  // Returns true if more bytes are waiting, in the read-ahead buffer or in the socket.
+  bool pending() {
+    if (begin_ < end_) return true;
+    struct pollfd pfd = {socket_.getFd(), POLLIN, 0};
+    return ::poll(&pfd, 1, 0) > 0;
+  }
+
+ private:
+  Socket& socket_;
+  std::vector<char> ahead_;
+  size_t begin_;
+  size_t end_;
+};
+
+// Returns the device that ptr belongs to, or -1 if the CPU can access ptr directly.
+int getDeviceOf(const void* ptr) {
+  cudaPointerAttributes attr;
+  if (cudaPointerGetAttributes(&attr, ptr) != cudaSuccess) {
+    // Memory that is unknown to the runtime, or no GPU at all
+    (void)cudaGetLastError();
+    return -1;
+  }
+  return attr.type == cudaMemoryTypeDevice ? attr.device : -1;
+}
+
+class CudaStagingCopier : public StagingCopier {
+ public:
+  CudaStagingCopier(int numBuffers, uint64_t bufferSize, cudaMemcpyKind kind)
+      : stream_(cudaStreamNonBlocking), kind_(kind), buffers_(numBuffers, nullptr), events_(numBuffers, nullptr) {
+    try {
+      for (int i = 0; i < numBuffers; ++i) {
+        MSCCLPP_CUDATHROW(cudaHostAlloc(&buffers_[i], bufferSize, cudaHostAllocDefault));
+        MSCCLPP_CUDATHROW(cudaEventCreateWithFlags(&events_[i], cudaEventDisableTiming));
+      }
+    } catch (...) {
+      release();
+      throw;
+    }
+  }
+
+  ~CudaStagingCopier() { release(); }
+
+  char* buffer(int index) override { return buffers_[index]; }
+
+  void copyAsync(void* dst, const void* src, uint64_t size, int index) override {
+    AvoidCudaGraphCaptureGuard cgcGuard;
+    MSCCLPP_CUDATHROW(cudaMemcpyAsync(dst, src, size, kind_, stream_));
+    MSCCLPP_CUDATHROW(cudaEventRecord(events_[index], stream_));
+  }
+
+  void wait(int index) override { MSCCLPP_CUDATHROW(cudaEventSynchronize(events_[index])); }
+
+ private:
+  void release() {
+    cudaStreamSynchronize(stream_);
+    for (auto event : events_) {
+      if (event != nullptr) cudaEventDestroy(event);
+    }
+    for (auto buffer : buffers_) {
+      if (buffer != nullptr) cudaFreeHost(buffer);
+    }
+  }
+
+  CudaStreamWithFlags stream_;
+  cudaMemcpyKind kind_;
+  std::vector<char*> buffers_;
+  std::vector<cudaEvent_t> events_;
+};
+
+}  // namespace
+
+EthernetConnection::EthernetConnection(Endpoint localEndpoint, Endpoint remoteEndpoint)
+    : abortFlag_(0),
+      numStagingBuffers_(getImpl(localEndpoint)->ethernetNumStagingBuffers_),
+      stagingBufferSize_(getImpl(localEndpoint)->ethernetStagingBufferSize_),
+      stripeSize_(std::min<uint64_t>(getImpl(localEndpoint)->ethernetStripeSize_, stagingBufferSize_)),
+      zeroCopyThreshold_(getImpl(localEndpoint)->ethernetZeroCopyThreshold_),
+      nextStream_(0),
+      stopSending_(false),
+      recvClosed_(false),
+      firstRequest_(1) {
   // Validating Transport Protocol
   if (localEndpoint.transport() != Transport::Ethernet || remoteEndpoint.transport() != Transport::Ethernet) {
     throw mscclpp::Error("Ethernet connection can only be made from Ethernet endpoints", ErrorCode::InvalidUsage);
   }
 
-  // Instanciating Buffers
-  sendBuffer_.resize(sendBufferSize_);
-  recvBuffer_.resize(recvBufferSize_);
+  for (int i = numStagingBuffers_ - 1; i >= 0; --i) {
+    freeSendBuffers_.push_back(i);
+  }
 
-  // Creating Thread to Accept the Connection
+  // Creating Thread to Accept One Connection per Stream of the Remote Endpoint
   auto parameter = (getImpl(localEndpoint)->socket_).get();
-  std::thread t([this, parameter]() {
-    recvSocket_ = std::make_unique<Socket>(nullptr, MSCCLPP_SOCKET_MAGIC, SocketTypeUnknown, abortFlag_);
-    recvSocket_->accept(parameter);
+  int numRecvStreams = getImpl(remoteEndpoint)->ethernetNumStreams_;
+  std::thread t([this, parameter, numRecvStreams]() {
+    for (int i = 0; i < numRecvStreams; ++i) {
+      auto stream = std::make_unique<RecvStream>();
+      stream->socket = std::make_unique<Socket>(nullptr, MSCCLPP_SOCKET_MAGIC, SocketTypeUnknown, abortFlag_);
+      stream->socket->accept(parameter);
+      recvStreams_.push_back(std::move(stream));
+    }
   });
 
-  // Starting Connection
-  sendSocket_ = std::make_unique<Socket>(&(getImpl(remoteEndpoint)->socketAddress_), MSCCLPP_SOCKET_MAGIC,
-                                         SocketTypeBootstrap, abortFlag_);
-  sendSocket_->connect();
+  // Starting Connections
+  for (int i = 0; i < getImpl(localEndpoint)->ethernetNumStreams_; ++i) {
+    auto stream = std::make_unique<SendStream>();
+    stream->socket = std::make_unique<Socket>(&(getImpl(remoteEndpoint)->socketAddress_), MSCCLPP_SOCKET_MAGIC,
+                                              SocketTypeBootstrap, abortFlag_);
+    stream->socket->connect();
+    sendStreams_.push_back(std::move(stream));
+  }
 
-  // Ensure the Connection was Established
+  // Ensure the Connections were Established
   t.join();
 
-  // Starting Thread to Receive Messages
-  threadRecvMessages_ = std::thread(&EthernetConnection::recvMessages, this);
+  if (zeroCopyThreshold_ > 0) {
+    for (auto& stream : sendStreams_) {
+      if (!stream->socket->enableZeroCopy()) {
+        WARN("MSG_ZEROCOPY is not supported, Ethernet data is copied into the socket buffers");
+        zeroCopyThreshold_ = 0;
+        break;
+      }
+    }
+  }
+
+  // Starting Threads to Send and Receive Messages and Acknowledgements
+  for (auto& stream : sendStreams_) {
+    stream->threadSendMessages = std::thread(&EthernetConnection::sendMessages, this, std::ref(*stream));
+    stream->threadRecvAcks = std::thread(&EthernetConnection::recvAcks, this, std::ref(*stream));
+  }
+  for (auto& stream : recvStreams_) {
+    stream->threadRecvMessages = std::thread(&EthernetConnection::recvMessages, this, std::ref(*stream));
+  }
 
-  INFO(MSCCLPP_NET, "Ethernet connection created");
+  INFO(MSCCLPP_NET, "Ethernet connection created with %zu send and %zu receive streams, %d staging buffers of %lu bytes",
+       sendStreams_.size(), recvStreams_.size(), numStagingBuffers_, stagingBufferSize_);
 }
 
 EthernetConnection::~EthernetConnection() {
-  sendSocket_->close();
-  recvSocket_->close();
-  threadRecvMessages_.join();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopSending_ = true;
+  }
+  cv_.notify_all();
+  // closing a socket alone does not wake up the threads that use it, and a sender blocked on a full socket buffer
+  // never sees stopSending_
+  for (auto& stream : sendStreams_) {
+    ::shutdown(stream->socket->getFd(), SHUT_RDWR);
+  }
+  for (auto& stream : sendStreams_) {
+    stream->threadSendMessages.join();
+    stream->threadRecvAcks.join();
+    stream->socket->close();
+  }
+  for (auto& stream : recvStreams_) {
+    ::shutdown(stream->socket->getFd(), SHUT_RDWR);
+  }
+  for (auto& stream : recvStreams_) {
+    stream->threadRecvMessages.join();
+    stream->socket->close();
+  }
 }
 
 Transport EthernetConnection::transport() { return Transport::Ethernet; }
@@ -283,29 +852,37 @@ void EthernetConnection::write(RegisteredMemory dst, uint64_t dstOffset, Registe
   validateTransport(src, transport(), srcOffset, size);
 
   // Initializing Variables
-  char* srcPtr = reinterpret_cast<char*>(src.data()) + srcOffset / sizeof(char);
-  char* dstPtr = reinterpret_cast<char*>(dst.originalDataPtr()) + dstOffset / sizeof(char);
-  uint64_t sentDataSize = 0;
-  uint64_t headerSize = 0;
-
-  // Copying Meta Data to Send Buffer
-  char* dstPtrBytes = reinterpret_cast<char*>(&dstPtr);
-  std::copy(dstPtrBytes, dstPtrBytes + sizeof(dstPtr), sendBuffer_.data() + headerSize / sizeof(char));
-  headerSize += sizeof(dstPtr);
-  char* sizeBytes = reinterpret_cast<char*>(&size);
-  std::copy(sizeBytes, sizeBytes + sizeof(size), sendBuffer_.data() + headerSize / sizeof(char));
-  headerSize += sizeof(size);
-
-  // Getting Data From GPU and Sending Message
-  while (sentDataSize < size) {
-    uint64_t dataSize =
-        std::min(sendBufferSize_ - headerSize / sizeof(char), (size - sentDataSize) / sizeof(char)) * sizeof(char);
-    uint64_t messageSize = dataSize + headerSize;
-    mscclpp::memcpyCuda<char>(sendBuffer_.data() + headerSize / sizeof(char),
-                              (char*)srcPtr + (sentDataSize / sizeof(char)), dataSize, cudaMemcpyDeviceToHost);
-    sendSocket_->send(sendBuffer_.data(), messageSize);
-    sentDataSize += messageSize;
-    headerSize = 0;
+  char* srcPtr = reinterpret_cast<char*>(src.data()) + srcOffset;
+  char* dstPtr = reinterpret_cast<char*>(dst.originalDataPtr()) + dstOffset;
+  bool staged = getDeviceOf(srcPtr) >= 0;
+  if (staged && !sendCopier_) {
+    sendCopier_ = std::make_unique<CudaStagingCopier>(numStagingBuffers_, stagingBufferSize_, cudaMemcpyDeviceToHost);
+  }
+  // a single stream sends whole staging buffers, several streams share the data in stripes
+  uint64_t chunkSize = sendStreams_.size() > 1 ? stripeSize_ : stagingBufferSize_;
+
+  // Splitting the Data into Chunks that are Dealt to the Streams in Turn. The sender threads send a chunk while the
+  // next one is being copied, and the receiver places each chunk at its own destination.
+  for (uint64_t offset = 0; offset < size; offset += chunkSize) {
+    SendItem item;
+    item.dstPtr = dstPtr + offset;
+    item.size = std::min(chunkSize, size - offset);
+    item.value = 0;
+    item.flags = 0;
+    if (staged) {
+      item.buffer = acquireSendBuffer();
+      item.data = sendCopier_->buffer(item.buffer);
+      sendCopier_->copyAsync(sendCopier_->buffer(item.buffer), srcPtr + offset, item.size, item.buffer);
+    } else {
+      item.buffer = -1;
+      item.data = srcPtr + offset;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      enqueue(*sendStreams_[nextStream_], item);
+      nextStream_ = (nextStream_ + 1) % sendStreams_.size();
+    }
+    cv_.notify_all();
   }
 
   INFO(MSCCLPP_NET, "EthernetConnection write: from %p to %p, size %lu", srcPtr, dstPtr, size);
@@ -326,37 +903,56 @@ void EthernetConnection::updateAndSync(RegisteredMemory dst, uint64_t dstOffset,
   // Initializing Variables
   uint64_t oldValue = *src;
   uint64_t* dstPtr = reinterpret_cast<uint64_t*>(reinterpret_cast<char*>(dst.originalDataPtr()) + dstOffset);
-  uint64_t dataSize = sizeof(uint64_t);
-  uint64_t messageSize = 0;
   *src = newValue;
 
-  // Copying Data to Send Buffer
-  char* dstPtrBytes = reinterpret_cast<char*>(&dstPtr);
-  std::copy(dstPtrBytes, dstPtrBytes + sizeof(dstPtr), sendBuffer_.data() + messageSize / sizeof(char));
-  messageSize += sizeof(dstPtr);
-  char* sizeBytes = reinterpret_cast<char*>(&dataSize);
-  std::copy(sizeBytes, sizeBytes + sizeof(dataSize), sendBuffer_.data() + messageSize / sizeof(char));
-  messageSize += sizeof(dataSize);
-  char* dataBytes = reinterpret_cast<char*>(src);
-  std::copy(dataBytes, dataBytes + dataSize, sendBuffer_.data() + messageSize / sizeof(char));
-  messageSize += dataSize;
-
-  // Sending Message
-  sendSocket_->send(sendBuffer_.data(), messageSize);
-
-  INFO(MSCCLPP_NET, "EthernetConnection atomic write: from %p to %p, %lu -> %lu", src, dstPtr + dstOffset, oldValue,
-       newValue);
+  // Queueing the Value behind the Pending Writes. With several streams, every other stream carries a marker, and the
+  // receiver holds the value back until all streams have passed their markers.
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 1; i < sendStreams_.size(); ++i) {
+      enqueue(*sendStreams_[i], {nullptr, 0, nullptr, -1, 0, EthernetMessageMarker, 0});
+    }
+    enqueue(*sendStreams_[0], {reinterpret_cast<char*>(dstPtr), sizeof(uint64_t), nullptr, -1, newValue,
+                               sendStreams_.size() > 1 ? EthernetMessageFence : 0u, 0});
+  }
+  cv_.notify_all();
+
+  INFO(MSCCLPP_NET, "EthernetConnection atomic write: from %p to %p, %lu -> %lu", src, dstPtr, oldValue, newValue);
 
 #if defined(ENABLE_NPKIT) && defined(ENABLE_NPKIT_EVENT_CONN_ETH_UPDATE_AND_SYNC_EXIT)
   NpKit::CollectCpuEvent(NPKIT_EVENT_CONN_ETH_UPDATE_AND_SYNC_EXIT, 0, 0, *NpKit::GetCpuTimestamp(), 0);
 #endif
 }
 
-void EthernetConnection::flush(int64_t) {
+void EthernetConnection::flush(int64_t timeoutUsec) {
 #if defined(ENABLE_NPKIT) && defined(ENABLE_NPKIT_EVENT_CONN_ETH_FLUSH_ENTRY)
   NpKit::CollectCpuEvent(NPKIT_EVENT_CONN_ETH_FLUSH_ENTRY, 0, 0, *NpKit::GetCpuTimestamp(), 0);
 #endif
 
+  // Waiting until the receiver acknowledges every chunk queued so far on every stream
+  std::unique_lock<std::mutex> lock(mutex_);
+  std::vector<uint64_t> seqs;
+  for (auto& stream : sendStreams_) {
+    seqs.push_back(stream->lastSeq);
+  }
+  auto flushed = [this, &seqs] { return acked(seqs); };
+  auto done = [this, &flushed] { return flushed() || sendError_; };
+  if (timeoutUsec < 0) {
+    cv_.wait(lock, done);
+  } else if (!cv_.wait_for(lock, std::chrono::microseconds(timeoutUsec), done)) {
+    uint64_t pending = 0;
+    for (size_t i = 0; i < sendStreams_.size(); ++i) {
+      pending += seqs[i] - std::min(seqs[i], sendStreams_[i]->ackedSeq);
+    }
+    throw Error("EthernetConnection flush timed out: waited for " + std::to_string(timeoutUsec / 1e6) +
+                    " seconds, " + std::to_string(pending) + " messages are not acknowledged",
+                ErrorCode::Timeout);
+  }
+  if (!flushed()) {
+    std::rethrow_exception(sendError_);
+  }
+  firstRequest_ += requestSeqs_.size();
+  requestSeqs_.clear();
   INFO(MSCCLPP_NET, "EthernetConnection flushing connection");
 
 #if defined(ENABLE_NPKIT) && defined(ENABLE_NPKIT_EVENT_CONN_ETH_FLUSH_EXIT)
@@ -364,53 +960,312 @@ void EthernetConnection::flush(int64_t) {
 #endif
 }
 
-void EthernetConnection::recvMessages() {
-  // Declarating Variables
-  char* ptr;
-  uint64_t size;
-  uint64_t recvSize;
-  int closed = 0;
-  bool received = true;
+Request EthernetConnection::writeAsync(RegisteredMemory dst, uint64_t dstOffset, RegisteredMemory src,
+                                       uint64_t srcOffset, uint64_t size) {
+  write(dst, dstOffset, src, srcOffset, size);
+  return record();
+}
+
+Request EthernetConnection::updateAndSyncAsync(RegisteredMemory dst, uint64_t dstOffset, uint64_t* src,
+                                               uint64_t newValue) {
+  updateAndSync(dst, dstOffset, src, newValue);
+  return record();
+}
 
-  // Receiving Messages Until Connection is Closed
-  while (recvSocket_->getState() != SocketStateClosed) {
+Request EthernetConnection::record() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  while (!requestSeqs_.empty() && acked(requestSeqs_.front())) {
+    requestSeqs_.pop_front();
+    firstRequest_++;
+  }
+  std::vector<uint64_t> seqs;
+  for (auto& stream : sendStreams_) {
+    seqs.push_back(stream->lastSeq);
+  }
+  requestSeqs_.push_back(std::move(seqs));
+  return makeRequest(this, firstRequest_ + requestSeqs_.size() - 1);
+}
+
+bool EthernetConnection::acked(const std::vector<uint64_t>& seqs) const {
+  // zero-copy sources must also be released by the kernel before they can be reused
+  for (size_t i = 0; i < sendStreams_.size(); ++i) {
+    const SendStream& stream = *sendStreams_[i];
+    if (stream.ackedSeq < seqs[i] || stream.zeroCopyCompleted < stream.zeroCopySends) return false;
+  }
+  return true;
+}
+
+bool EthernetConnection::testRequest(uint64_t id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (id < firstRequest_ || acked(requestSeqs_[id - firstRequest_])) return true;
+  if (sendError_) {
+    std::rethrow_exception(sendError_);
+  }
+  return false;
+}
+
+void EthernetConnection::waitRequest(uint64_t id, int64_t timeoutUsec) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (id < firstRequest_) return;
+  const std::vector<uint64_t> seqs = requestSeqs_[id - firstRequest_];
+  auto done = [this, &seqs] { return acked(seqs) || sendError_; };
+  if (timeoutUsec < 0) {
+    cv_.wait(lock, done);
+  } else if (!cv_.wait_for(lock, std::chrono::microseconds(timeoutUsec), done)) {
+    throw Error("EthernetConnection request timed out: waited for " + std::to_string(timeoutUsec / 1e6) + " seconds",
+                ErrorCode::Timeout);
+  }
+  if (!acked(seqs)) {
+    std::rethrow_exception(sendError_);
+  }
+}
+
+int EthernetConnection::acquireSendBuffer() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  cv_.wait(lock, [this] { return !freeSendBuffers_.empty() || sendError_; });
+  if (sendError_) {
+    std::rethrow_exception(sendError_);
+  }
+  int buffer = freeSendBuffers_.back();
+  freeSendBuffers_.pop_back();
+  return buffer;
+}
+
+void EthernetConnection::enqueue(SendStream& stream, const SendItem& item) {
+  if (sendError_) {
+    std::rethrow_exception(sendError_);
+  }
+  stream.queue.push_back(item);
+  stream.queue.back().seq = ++stream.lastSeq;
+}
+
+void EthernetConnection::sendMessages(SendStream& stream) {
+  std::vector<SendItem> batch;
+  std::vector<EthernetMessageHeader> headers;
+  std::vector<struct iovec> iov;
+  std::vector<int> gatheredBuffers;
+  while (true) {
+    // Taking Every Queued Item, up to a Limit, to Send Them Together
+    batch.clear();
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this, &stream] { return !stream.queue.empty() || stopSending_; });
+      if (stream.queue.empty()) return;
+      while (!stream.queue.empty() && batch.size() < EthernetMaxSendBatch) {
+        batch.push_back(stream.queue.front());
+        stream.queue.pop_front();
+      }
+    }
+
+    try {
+      // Sends the gathered headers and data with one system call and recycles their staging buffers
+      auto sendGathered = [&]() {
+        if (iov.empty()) return;
+        stream.socket->sendv(iov.data(), iov.size());
+        iov.clear();
+        if (gatheredBuffers.empty()) return;
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          freeSendBuffers_.insert(freeSendBuffers_.end(), gatheredBuffers.begin(), gatheredBuffers.end());
+        }
+        gatheredBuffers.clear();
+        cv_.notify_all();
+      };
+
+      headers.resize(batch.size());
+      for (size_t i = 0; i < batch.size(); ++i) {
+        SendItem& item = batch[i];
+        const char* data = item.data != nullptr ? item.data : reinterpret_cast<const char*>(&item.value);
+        if (item.buffer >= 0) {
+          // Sending what is gathered before waiting for the copy to the staging buffer
+          sendGathered();
+          sendCopier_->wait(item.buffer);
+          gatheredBuffers.push_back(item.buffer);
+        }
+        headers[i] = {EthernetWireVersion, item.flags, reinterpret_cast<uint64_t>(item.dstPtr), item.size, item.seq};
+        iov.push_back({&headers[i], sizeof(EthernetMessageHeader)});
+        if (zeroCopyThreshold_ > 0 && item.buffer < 0 && item.data != nullptr && item.size >= zeroCopyThreshold_) {
+          // The pages of a zero-copy send stay in use until the kernel reports its completion, so the data goes in
+          // a system call of its own, after the headers before it
+          sendGathered();
+          struct iovec payload = {const_cast<char*>(data), item.size};
+          int zeroCopySends = stream.socket->sendv(&payload, 1, MSG_ZEROCOPY);
+          std::lock_guard<std::mutex> lock(mutex_);
+          stream.zeroCopySends += zeroCopySends;
+        } else if (item.size > 0) {
+          iov.push_back({const_cast<char*>(data), item.size});
+        }
+      }
+      sendGathered();
+    } catch (const std::exception& e) {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // the destructor shuts the socket down under a sender that is still busy
+        if (!stopSending_) WARN("EthernetConnection sender stopped: %s", e.what());
+        sendError_ = std::current_exception();
+      }
+      cv_.notify_all();
+      return;
+    }
+  }
+}
+
+void EthernetConnection::recvMessages(RecvStream& stream) {
+  EthernetStreamReader reader(*stream.socket, EthernetRecvAheadSize);
+  EthernetMessageHeader header;
+  uint64_t ackedSeq = 0;
+  uint64_t fences = 0;
+  int next = 0;  // the staging buffer for the next chunk that goes to device memory
+
+  // Waits until the copies of the earlier chunks to the device complete
+  auto land = [this, &stream] {
+    for (int i = 0; stream.copier && i < numStagingBuffers_; ++i) {
+      stream.copier->wait(i);
+    }
+  };
+
+  try {
+    // Receiving Messages Until Connection is Closed
+    while (true) {
 #if defined(ENABLE_NPKIT) && defined(ENABLE_NPKIT_EVENT_CONN_ETH_RECV_META_ENTRY)
-    NpKit::CollectCpuEvent(NPKIT_EVENT_CONN_ETH_RECV_META_ENTRY, 0, 0, *NpKit::GetCpuTimestamp(), 1);
+      NpKit::CollectCpuEvent(NPKIT_EVENT_CONN_ETH_RECV_META_ENTRY, 0, 0, *NpKit::GetCpuTimestamp(), 1);
 #endif
 
-    // Receiving Data Address
-    if (closed == 0) recvSocket_->recvUntilEnd(&ptr, sizeof(char*), &closed);
-    received &= !closed;
-
-    // Receiving data size
-    if (closed == 0) recvSocket_->recvUntilEnd(&size, sizeof(uint64_t), &closed);
-    received &= !closed;
+      // Receiving the Header
+      if (!reader.read(&header, sizeof(header))) break;
+      if (header.version != EthernetWireVersion) {
+        throw Error("EthernetConnection received a message of wire version " + std::to_string(header.version) +
+                        ", expected " + std::to_string(EthernetWireVersion),
+                    ErrorCode::InternalError);
+      }
+      char* ptr = reinterpret_cast<char*>(header.dstPtr);
+      uint64_t size = header.size;
 
 #if defined(ENABLE_NPKIT) && defined(ENABLE_NPKIT_EVENT_CONN_ETH_RECV_META_EXIT)
-    NpKit::CollectCpuEvent(NPKIT_EVENT_CONN_ETH_RECV_META_EXIT, uint32_t(size), 0, *NpKit::GetCpuTimestamp(), 1);
+      NpKit::CollectCpuEvent(NPKIT_EVENT_CONN_ETH_RECV_META_EXIT, uint32_t(size), 0, *NpKit::GetCpuTimestamp(), 1);
 #endif
 
+      if (header.flags & EthernetMessageMarker) {
+        // Everything this stream received before the marker has landed
+        land();
+        {
+          std::lock_guard<std::mutex> lock(recvMutex_);
+          stream.markers++;
+        }
+        recvCv_.notify_all();
+      } else if (header.flags & EthernetMessageFence) {
+        // Waiting for the other streams to pass the markers that were sent along with this message
+        land();
+        fences++;
+        std::unique_lock<std::mutex> lock(recvMutex_);
+        auto passed = [this, &stream, fences] {
+          for (auto& other : recvStreams_) {
+            if (other.get() != &stream && other->markers < fences) return false;
+          }
+          return true;
+        };
+        recvCv_.wait(lock, [this, &passed] { return passed() || recvClosed_; });
+        if (!passed()) break;
+      }
+
 #if defined(ENABLE_NPKIT) && defined(ENABLE_NPKIT_EVENT_CONN_ETH_RECV_DATA_ENTRY)
-    NpKit::CollectCpuEvent(NPKIT_EVENT_CONN_ETH_RECV_DATA_ENTRY, uint32_t(size), 0, *NpKit::GetCpuTimestamp(), 1);
+      NpKit::CollectCpuEvent(NPKIT_EVENT_CONN_ETH_RECV_DATA_ENTRY, uint32_t(size), 0, *NpKit::GetCpuTimestamp(), 1);
 #endif
 
-    // Receiving Data and Copying Data yo GPU
-    recvSize = 0;
-    while (recvSize < size && closed == 0) {
-      uint64_t messageSize = std::min(recvBufferSize_, (size - recvSize) / sizeof(char)) * sizeof(char);
-      recvSocket_->recvUntilEnd(recvBuffer_.data(), messageSize, &closed);
-      received &= !closed;
-
-      if (received)
-        mscclpp::memcpyCuda<char>((char*)ptr + (recvSize / sizeof(char)), recvBuffer_.data(), messageSize,
-                                  cudaMemcpyHostToDevice);
-      recvSize += messageSize;
-    }
+      bool closed = false;
+      int device = size > 0 ? getDeviceOf(ptr) : -1;
+      if (device < 0) {
+        // Host memory is received in place, after the earlier chunks have landed on the device, so that a semaphore
+        // in host memory is never updated ahead of the data it guards
+        land();
+        closed = !reader.read(ptr, size);
+      } else {
+        if (!stream.copier) {
+          MSCCLPP_CUDATHROW(cudaSetDevice(device));
+          stream.copier =
+              std::make_unique<CudaStagingCopier>(numStagingBuffers_, stagingBufferSize_, cudaMemcpyHostToDevice);
+        }
+        // Receiving into the Staging Buffers in Turn. A buffer is reused once its copy to the device completes.
+        for (uint64_t offset = 0; offset < size && !closed; offset += stagingBufferSize_) {
+          uint64_t chunkSize = std::min(stagingBufferSize_, size - offset);
+          stream.copier->wait(next);
+          closed = !reader.read(stream.copier->buffer(next), chunkSize);
+          if (closed) break;
+          stream.copier->copyAsync(ptr + offset, stream.copier->buffer(next), chunkSize, next);
+          next = (next + 1) % numStagingBuffers_;
+        }
+      }
+      if (closed) break;
 
 #if defined(ENABLE_NPKIT) && defined(ENABLE_NPKIT_EVENT_CONN_ETH_RECV_DATA_EXIT)
-    NpKit::CollectCpuEvent(NPKIT_EVENT_CONN_ETH_RECV_DATA_EXIT, uint32_t(size), 0, *NpKit::GetCpuTimestamp(), 1);
+      NpKit::CollectCpuEvent(NPKIT_EVENT_CONN_ETH_RECV_DATA_EXIT, uint32_t(size), 0, *NpKit::GetCpuTimestamp(), 1);
 #endif
+
+      // Acknowledging once no further message is waiting, or after EthernetAckInterval messages, so that a stream of
+      // back-to-back messages costs one acknowledgement per batch
+      if (header.seq - ackedSeq >= EthernetAckInterval || !reader.pending()) {
+        land();
+        stream.socket->send(&header.seq, sizeof(header.seq));
+        ackedSeq = header.seq;
+      }
+    }
+  } catch (const std::exception& e) {
+    WARN("EthernetConnection receiver stopped: %s", e.what());
+  }
+
+  // Releasing the streams that wait for markers this stream will never pass
+  {
+    std::lock_guard<std::mutex> lock(recvMutex_);
+    recvClosed_ = true;
+  }
+  recvCv_.notify_all();
+}
+
+void EthernetConnection::recvAcks(SendStream& stream) {
+  uint64_t seq;
+  int closed = 0;
+  try {
+    while (true) {
+      if (zeroCopyThreshold_ > 0) {
+        // Zero-copy completions arrive on the error queue of the socket, which poll() reports as POLLERR
+        struct pollfd pfd = {stream.socket->getFd(), POLLIN, 0};
+        if (::poll(&pfd, 1, -1) < 0) {
+          if (errno == EINTR) continue;
+          throw SysError("poll failed", errno);
+        }
+        if (pfd.revents & POLLERR) {
+          int completed = stream.socket->recvZeroCopyCompletions();
+          if (completed > 0) {
+            {
+              std::lock_guard<std::mutex> lock(mutex_);
+              stream.zeroCopyCompleted += completed;
+            }
+            cv_.notify_all();
+            if (!(pfd.revents & (POLLIN | POLLHUP))) continue;
+          }
+        }
+      }
+      stream.socket->recvUntilEnd(&seq, sizeof(seq), &closed);
+      if (closed) break;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stream.ackedSeq = std::max(stream.ackedSeq, seq);
+      }
+      cv_.notify_all();
+    }
+  } catch (const std::exception& e) {
+    WARN("EthernetConnection acknowledgement receiver stopped: %s", e.what());
+  }
+
+  // Failing the pending and future flushes instead of letting them wait for acknowledgements that never come
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!sendError_ && !stopSending_) {
+      sendError_ = std::make_exception_ptr(
+          Error("EthernetConnection is closed by the remote peer", ErrorCode::RemoteError));
+    }
   }
+  cv_.notify_all();
 }
 
 }  // namespace mscclpp
@@ -51,12 +51,18 @@ MSCCLPP_API_CPP std::shared_ptr<Connection> Context::connect(Endpoint localEndpo
     if (!AllIBTransports.has(remoteEndpoint.transport())) {
       throw mscclpp::Error("Local transport is IB but remote is not", ErrorCode::InvalidUsage);
     }
-    conn = std::make_shared<IBConnection>(localEndpoint, remoteEndpoint, *this);
+    if (localEndpoint.pimpl_->ibRailTransports_.empty()) {
+      conn = std::make_shared<IBConnection>(localEndpoint, remoteEndpoint, *this);
+    } else {
+      conn = std::make_shared<MultiRailIBConnection>(localEndpoint, remoteEndpoint, *this);
+    }
   } else if (localEndpoint.transport() == Transport::Ethernet) {
     if (remoteEndpoint.transport() != Transport::Ethernet) {
       throw mscclpp::Error("Local transport is Ethernet but remote is not", ErrorCode::InvalidUsage);
     }
     conn = std::make_shared<EthernetConnection>(localEndpoint, remoteEndpoint);
+  } else if (localEndpoint.transport() == Transport::SharedMemory) {
+    conn = std::make_shared<SharedMemoryConnection>(localEndpoint, remoteEndpoint);
   } else {
     throw mscclpp::Error("Unsupported transport", ErrorCode::InternalError);
   }
@@ -18,8 +18,41 @@ Endpoint::Impl::Impl(EndpointConfig config, Context::Impl& contextImpl)
     ibLocal_ = true;
     ibQp_ = contextImpl.getIbContext(transport_)
                 ->createQp(config.ibMaxCqSize, config.ibMaxCqPollNum, config.ibMaxSendWr, 0, config.ibMaxWrPerSend);
+    if (config.ibSignalInterval <= 0) {
+      throw Error("IB signal interval must be positive", ErrorCode::InvalidUsage);
+    }
+    ibQp_->setSignalInterval(config.ibSignalInterval);
     ibQpInfo_ = ibQp_->getInfo();
+    if ((config.ibRails & ~AllIBTransports).any()) {
+      throw Error("IB rails must be IB transports", ErrorCode::InvalidUsage);
+    }
+    if (config.ibMultiRailThreshold <= 0) {
+      throw Error("IB multi-rail threshold must be positive", ErrorCode::InvalidUsage);
+    }
+    ibMultiRailThreshold_ = config.ibMultiRailThreshold;
+    for (auto rail : {Transport::IB0, Transport::IB1, Transport::IB2, Transport::IB3, Transport::IB4, Transport::IB5,
+                      Transport::IB6, Transport::IB7}) {
+      if (rail == transport_ || !config.ibRails.has(rail)) continue;
+      IbQp* qp = contextImpl.getIbContext(rail)->createQp(config.ibMaxCqSize, config.ibMaxCqPollNum,
+                                                          config.ibMaxSendWr, 0, config.ibMaxWrPerSend);
+      qp->setSignalInterval(config.ibSignalInterval);
+      ibRailTransports_.push_back(rail);
+      ibRailQps_.push_back(qp);
+      ibRailQpInfos_.push_back(qp->getInfo());
+    }
   } else if (transport_ == Transport::Ethernet) {
+    if (config.ethernetNumStagingBuffers <= 0 || config.ethernetStagingBufferSize <= 0) {
+      throw Error("Ethernet staging buffers must be non-empty", ErrorCode::InvalidUsage);
+    }
+    if (config.ethernetNumStreams <= 0 || config.ethernetStripeSize <= 0) {
+      throw Error("Ethernet connections need at least one stream and non-empty stripes", ErrorCode::InvalidUsage);
+    }
+    ethernetNumStagingBuffers_ = config.ethernetNumStagingBuffers;
+    ethernetStagingBufferSize_ = config.ethernetStagingBufferSize;
+    ethernetZeroCopyThreshold_ = config.ethernetZeroCopyThreshold;
+    ethernetStripeSize_ = config.ethernetStripeSize;
+    ethernetNumStreams_ = config.ethernetNumStreams;
+
     // Configuring Ethernet Interfaces
     abortFlag_ = 0;
     int ret = FindInterfaces(netIfName_, &socketAddress_, MAX_IF_NAME_SIZE, 1);
@@ -40,10 +73,18 @@ MSCCLPP_API_CPP std::vector<char> Endpoint::serialize() {
   std::copy_n(reinterpret_cast<char*>(&pimpl_->hostHash_), sizeof(pimpl_->hostHash_), std::back_inserter(data));
   if (AllIBTransports.has(pimpl_->transport_)) {
     std::copy_n(reinterpret_cast<char*>(&pimpl_->ibQpInfo_), sizeof(pimpl_->ibQpInfo_), std::back_inserter(data));
+    int numRails = pimpl_->ibRailTransports_.size();
+    std::copy_n(reinterpret_cast<char*>(&numRails), sizeof(numRails), std::back_inserter(data));
+    std::copy_n(reinterpret_cast<char*>(pimpl_->ibRailTransports_.data()), numRails * sizeof(Transport),
+                std::back_inserter(data));
+    std::copy_n(reinterpret_cast<char*>(pimpl_->ibRailQpInfos_.data()), numRails * sizeof(IbQpInfo),
+                std::back_inserter(data));
   }
   if ((pimpl_->transport_) == Transport::Ethernet) {
     std::copy_n(reinterpret_cast<char*>(&pimpl_->socketAddress_), sizeof(pimpl_->socketAddress_),
                 std::back_inserter(data));
+    std::copy_n(reinterpret_cast<char*>(&pimpl_->ethernetNumStreams_), sizeof(pimpl_->ethernetNumStreams_),
+                std::back_inserter(data));
   }
   return data;
 }
@@ -62,10 +103,21 @@ Endpoint::Impl::Impl(const std::vector<char>& serialization) {
     ibLocal_ = false;
     std::copy_n(it, sizeof(ibQpInfo_), reinterpret_cast<char*>(&ibQpInfo_));
     it += sizeof(ibQpInfo_);
+    int numRails;
+    std::copy_n(it, sizeof(numRails), reinterpret_cast<char*>(&numRails));
+    it += sizeof(numRails);
+    ibRailTransports_.resize(numRails);
+    ibRailQpInfos_.resize(numRails);
+    std::copy_n(it, numRails * sizeof(Transport), reinterpret_cast<char*>(ibRailTransports_.data()));
+    it += numRails * sizeof(Transport);
+    std::copy_n(it, numRails * sizeof(IbQpInfo), reinterpret_cast<char*>(ibRailQpInfos_.data()));
+    it += numRails * sizeof(IbQpInfo);
   }
   if (transport_ == Transport::Ethernet) {
     std::copy_n(it, sizeof(socketAddress_), reinterpret_cast<char*>(&socketAddress_));
     it += sizeof(socketAddress_);
+    std::copy_n(it, sizeof(ethernetNumStreams_), reinterpret_cast<char*>(&ethernetNumStreams_));
+    it += sizeof(ethernetNumStreams_);
   }
 }
 
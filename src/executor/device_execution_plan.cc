@@ -0,0 +1,173 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "device_execution_plan.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <mscclpp/errors.hpp>
+#include <string>
+
+namespace mscclpp {
+
+namespace {
+
+uint8_t getNOffsets(const Operation& op) { return std::max(op.nInputs, op.nOutputs); }
+
+uint8_t getNIndexes(const Operation& op) { return std::max<uint8_t>({op.nInputs, op.nOutputs, 1}); }
+
+// Bytes from the header of a threadblock plan to its operation offset table.
+size_t getOperationTableOffset(const ThreadblockExecutionPlan& plan) {
+  return sizeof(DeviceExecutionPlan) +
+         DeviceExecutionPlan::alignUp(plan.smChannels.size() * sizeof(DeviceHandle<SmChannel>)) +
+         DeviceExecutionPlan::alignUp(plan.proxyChannels.size() * sizeof(DeviceHandle<ProxyChannel>)) +
+         DeviceExecutionPlan::alignUp(plan.nvlsChannels.size() *
+                                      sizeof(DeviceHandle<NvlsConnection::DeviceMulticastPointer>));
+}
+
+size_t getPlanSize(const ThreadblockExecutionPlan& plan) {
+  size_t size = getOperationTableOffset(plan) + plan.operations.size() * sizeof(uint32_t);
+  for (const Operation& op : plan.operations) {
+    size += getDeviceOperationSize(op);
+  }
+  return DeviceExecutionPlan::alignUp(size);
+}
+
+void encodeOperation(DeviceOperation& record, const Operation& op) {
+  record.type = op.type;
+  record.channelType = op.channelType;
+  record.srcBufferType = op.srcBufferType;
+  record.dstBufferType = op.dstBufferType;
+  record.nInputs = op.nInputs;
+  record.nOutputs = op.nOutputs;
+  record.inputOffsetsBufferType = op.inputOffsetsBufferType;
+  record.outputOffsetsBufferType = op.outputOffsetsBufferType;
+  record.hasSrcOffset = op.hasSrcOffset;
+  record.hasDstOffset = op.hasDstOffset;
+  record.nOffsets = getNOffsets(op);
+  record.nIndexes = getNIndexes(op);
+  if (op.type == OperationType::BARRIER) {
+    record.deviceSyncerIndex = op.deviceSyncerIndex;
+    record.nThreadBlocks = op.nThreadBlocks;
+    return;
+  }
+  record.srcOffset = op.srcOffset;
+  record.dstOffset = op.dstOffset;
+  record.size = op.size;
+  std::copy_n(op.inputOffsets, record.nOffsets, record.inputOffsets());
+  std::copy_n(op.outputOffsets, record.nOffsets, record.outputOffsets());
+  std::copy_n(op.inputChannelIndexes, record.nIndexes, record.inputChannelIndexes());
+  std::copy_n(op.outputChannelIndexes, record.nIndexes, record.outputChannelIndexes());
+}
+
+Operation decodeOperation(DeviceOperation& record) {
+  Operation op;
+  std::memset(&op, 0, sizeof(op));
+  op.type = record.type;
+  op.channelType = record.channelType;
+  op.srcBufferType = record.srcBufferType;
+  op.dstBufferType = record.dstBufferType;
+  op.nInputs = record.nInputs;
+  op.nOutputs = record.nOutputs;
+  op.inputOffsetsBufferType = record.inputOffsetsBufferType;
+  op.outputOffsetsBufferType = record.outputOffsetsBufferType;
+  op.hasSrcOffset = record.hasSrcOffset;
+  op.hasDstOffset = record.hasDstOffset;
+  if (record.type == OperationType::BARRIER) {
+    op.deviceSyncerIndex = record.deviceSyncerIndex;
+    op.nThreadBlocks = record.nThreadBlocks;
+    return op;
+  }
+  op.srcOffset = record.srcOffset;
+  op.dstOffset = record.dstOffset;
+  op.size = record.size;
+  std::copy_n(record.inputOffsets(), record.nOffsets, op.inputOffsets);
+  std::copy_n(record.outputOffsets(), record.nOffsets, op.outputOffsets);
+  std::copy_n(record.inputChannelIndexes(), record.nIndexes, op.inputChannelIndexes);
+  std::copy_n(record.outputChannelIndexes(), record.nIndexes, op.outputChannelIndexes);
+  return op;
+}
+
+}  // namespace
+
+size_t getDeviceOperationSize(const Operation& op) {
+  return DeviceOperation::recordSize(getNOffsets(op), getNIndexes(op));
+}
+
+EncodedExecutionPlans encodeDeviceExecutionPlans(const std::vector<ThreadblockExecutionPlan>& threadblocks) {
+  EncodedExecutionPlans plans;
+  plans.nThreadblocks = threadblocks.size();
+  size_t tableSize = DeviceExecutionPlan::alignUp(threadblocks.size() * sizeof(uint32_t));
+  std::vector<uint32_t> planOffsets;
+  size_t totalSize = tableSize;
+  for (size_t threadblock = 0; threadblock < threadblocks.size(); threadblock++) {
+    const ThreadblockExecutionPlan& plan = threadblocks[threadblock];
+    if (plan.operations.size() > std::numeric_limits<uint16_t>::max()) {
+      throw Error("Threadblock " + std::to_string(threadblock) + " has " + std::to_string(plan.operations.size()) +
+                      " operations, exceeding device execution plan support (" +
+                      std::to_string(std::numeric_limits<uint16_t>::max()) + ")",
+                  ErrorCode::ExecutorError);
+    }
+    size_t maxChannels = std::max({plan.smChannels.size(), plan.proxyChannels.size(), plan.nvlsChannels.size()});
+    if (maxChannels > std::numeric_limits<uint8_t>::max()) {
+      throw Error("Threadblock " + std::to_string(threadblock) + " has " + std::to_string(maxChannels) +
+                      " channels of one type, exceeding device execution plan support (" +
+                      std::to_string(std::numeric_limits<uint8_t>::max()) + ")",
+                  ErrorCode::ExecutorError);
+    }
+    size_t planSize = getPlanSize(plan);
+    if (planSize > MAX_DEVICE_EXECUTION_PLAN_SIZE) {
+      throw Error("Threadblock " + std::to_string(threadblock) + " plan takes " + std::to_string(planSize) +
+                      " bytes, exceeding device execution plan support (" +
+                      std::to_string(MAX_DEVICE_EXECUTION_PLAN_SIZE) + ")",
+                  ErrorCode::ExecutorError);
+    }
+    planOffsets.push_back(totalSize);
+    totalSize += planSize;
+    plans.maxPlanSize = std::max(plans.maxPlanSize, planSize);
+  }
+
+  plans.data.assign(totalSize, 0);
+  std::memcpy(plans.data.data(), planOffsets.data(), planOffsets.size() * sizeof(uint32_t));
+  for (size_t threadblock = 0; threadblock < threadblocks.size(); threadblock++) {
+    const ThreadblockExecutionPlan& plan = threadblocks[threadblock];
+    DeviceExecutionPlan* devicePlan = reinterpret_cast<DeviceExecutionPlan*>(&plans.data[planOffsets[threadblock]]);
+    devicePlan->size = getPlanSize(plan);
+    devicePlan->nOperations = plan.operations.size();
+    devicePlan->nSmChannels = plan.smChannels.size();
+    devicePlan->nProxyChannels = plan.proxyChannels.size();
+    devicePlan->nNvlsChannels = plan.nvlsChannels.size();
+    std::copy(plan.smChannels.begin(), plan.smChannels.end(), devicePlan->smChannels());
+    std::copy(plan.proxyChannels.begin(), plan.proxyChannels.end(), devicePlan->proxyChannels());
+    std::copy(plan.nvlsChannels.begin(), plan.nvlsChannels.end(), devicePlan->nvlsChannels());
+    uint32_t offset = getOperationTableOffset(plan) + plan.operations.size() * sizeof(uint32_t);
+    for (size_t i = 0; i < plan.operations.size(); i++) {
+      devicePlan->operationOffsets()[i] = offset;
+      encodeOperation(devicePlan->operation(i), plan.operations[i]);
+      offset += getDeviceOperationSize(plan.operations[i]);
+    }
+  }
+  return plans;
+}
+
+ThreadblockExecutionPlan decodeDeviceExecutionPlan(const EncodedExecutionPlans& plans, int threadblock) {
+  if (threadblock < 0 || threadblock >= plans.nThreadblocks) {
+    throw Error("Threadblock " + std::to_string(threadblock) + " is not in the device execution plans",
+                ErrorCode::InvalidUsage);
+  }
+  // the accessors of the plan take non-const pointers
+  char* data = const_cast<char*>(plans.data.data());
+  DeviceExecutionPlan* devicePlan =
+      reinterpret_cast<DeviceExecutionPlan*>(data + reinterpret_cast<const uint32_t*>(data)[threadblock]);
+  ThreadblockExecutionPlan plan;
+  plan.smChannels.assign(devicePlan->smChannels(), devicePlan->smChannels() + devicePlan->nSmChannels);
+  plan.proxyChannels.assign(devicePlan->proxyChannels(), devicePlan->proxyChannels() + devicePlan->nProxyChannels);
+  plan.nvlsChannels.assign(devicePlan->nvlsChannels(), devicePlan->nvlsChannels() + devicePlan->nNvlsChannels);
+  for (int i = 0; i < devicePlan->nOperations; i++) {
+    plan.operations.push_back(decodeOperation(devicePlan->operation(i)));
+  }
+  return plan;
+}
+
+}  // namespace mscclpp
@@ -0,0 +1,562 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "execution_interpreter.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <map>
+#include <mscclpp/errors.hpp>
+#include <mscclpp/host_reduce.hpp>
+#include <mutex>
+#include <thread>
+#include <tuple>
+
+namespace mscclpp {
+
+namespace {
+
+// MAX_DEVICE_SYNCERS of execution_kernel.hpp, the number of barriers that BARRIER operations can use.
+constexpr int NumDeviceSyncers = 16;
+
+constexpr int NumOperationTypes = static_cast<int>(OperationType::MULTI_LOAD_REDUCE_STORE) + 1;
+
+// Thrown in the threads of a run once another thread of the run failed.
+struct RunAborted {};
+
+struct Semaphore {
+  std::atomic<uint64_t> inbound{0};
+  // Shared by all threadblocks that wait on the semaphore, like the expected value of a device semaphore.
+  std::atomic<uint64_t> expected{0};
+};
+
+struct Channel {
+  int peer;
+  BufferType srcBufferType;
+  BufferType dstBufferType;
+  // signaled by the peer
+  Semaphore* inbound;
+  // the semaphore of the peer that this channel signals
+  Semaphore* outbound;
+};
+
+// A reusable barrier of the threadblocks of one rank, like DeviceSyncer.
+struct Barrier {
+  std::atomic<uint32_t> count{0};
+  std::atomic<uint32_t> generation{0};
+};
+
+struct RankState {
+  // in the order of the channels of the executor, which the threadblock channel maps index
+  std::vector<Channel> smChannels;
+  std::vector<Channel> proxyChannels;
+  std::vector<NvlsInfo> nvlsInfos;
+  // [threadblock] = indexes into the channels above
+  std::vector<std::vector<int>> threadblockSmChannels;
+  std::vector<std::vector<int>> threadblockProxyChannels;
+  std::vector<std::vector<int>> threadblockNvlsChannels;
+  // [threadblock] = operations with offsets and sizes in bytes
+  std::vector<std::vector<Operation>> operations;
+  // 8-byte words, so that packets can be accessed atomically
+  std::vector<uint64_t> scratch;
+  size_t scratchSize;
+  std::unique_ptr<Barrier[]> barriers;
+};
+
+struct Buffer {
+  char* data = nullptr;
+  size_t size = 0;
+};
+
+// The state that the threads of one run share.
+struct RunState {
+  // [rank][BufferType]
+  std::vector<std::array<Buffer, 4>> buffers;
+  DataType dataType;
+  size_t elementSize;
+  uint32_t flag;
+  std::chrono::steady_clock::time_point deadline;
+  std::atomic_bool failed{false};
+  std::mutex mutex;
+  std::exception_ptr error;
+  InterpreterStats stats;
+};
+
+size_t getDataTypeSize(DataType dataType) {
+  switch (dataType) {
+    case DataType::FLOAT16:
+    case DataType::BFLOAT16:
+      return 2;
+    default:
+      return 4;
+  }
+}
+
+// Runs the operations of one threadblock of one rank.
+class ThreadblockRunner {
+ public:
+  ThreadblockRunner(RankState& state, RunState& run, int rank, int threadblock)
+      : run_(run), rank_(rank), threadblock_(threadblock), state_(state) {}
+
+  void run() {
+    const std::vector<Operation>& ops = state_.operations[threadblock_];
+    std::array<uint64_t, NumOperationTypes> counts = {};
+    std::array<uint64_t, NumOperationTypes> nanoseconds = {};
+    for (opIndex_ = 0; opIndex_ < ops.size(); opIndex_++) {
+      const Operation& op = ops[opIndex_];
+      auto start = std::chrono::steady_clock::now();
+      execute(op);
+      auto elapsed = std::chrono::steady_clock::now() - start;
+      int type = static_cast<int>(op.type);
+      counts[type]++;
+      nanoseconds[type] += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    }
+    std::lock_guard<std::mutex> lock(run_.mutex);
+    for (int type = 0; type < NumOperationTypes; type++) {
+      run_.stats.opCounts[type] += counts[type];
+      run_.stats.opNanoseconds[type] += nanoseconds[type];
+    }
+    run_.stats.remoteBytes += remoteBytes_;
+  }
+
+ private:
+  void execute(const Operation& op) {
+    switch (op.type) {
+      case OperationType::NOP:
+      case OperationType::FLUSH:
+        // a whole threadblock is one thread, and proxy writes complete before they return
+        break;
+      case OperationType::BARRIER:
+        barrier(op.deviceSyncerIndex, op.nThreadBlocks);
+        break;
+      case OperationType::SIGNAL:
+        for (int i = 0; i < op.nOutputs; i++) {
+          signal(channel(op.channelType, op.outputChannelIndexes[i]));
+        }
+        break;
+      case OperationType::WAIT:
+        for (int i = 0; i < op.nInputs; i++) {
+          wait(channel(op.channelType, op.inputChannelIndexes[i]));
+        }
+        break;
+      case OperationType::PUT:
+      case OperationType::PUT_WITH_SIGNAL:
+      case OperationType::PUT_WITH_SIGNAL_AND_FLUSH:
+        put(op);
+        break;
+      case OperationType::GET:
+        for (int i = 0; i < op.nInputs; i++) {
+          const Channel& ch = channel(ChannelType::SM, op.inputChannelIndexes[i]);
+          std::memcpy(origin(ch, op.inputOffsets[i], op.size), remote(ch, op.outputOffsets[i], op.size), op.size);
+        }
+        break;
+      case OperationType::COPY:
+        std::memmove(local(op.dstBufferType, op.dstOffset, op.size), local(op.srcBufferType, op.srcOffset, op.size),
+                     op.size);
+        break;
+      case OperationType::READ_REDUCE_COPY:
+        readReduceCopySend(op, false);
+        break;
+      case OperationType::READ_REDUCE_COPY_SEND:
+        readReduceCopySend(op, true);
+        break;
+      case OperationType::REDUCE_SEND:
+        reduceSend(op);
+        break;
+      case OperationType::PUT_PACKET:
+        putPacket(op);
+        break;
+      case OperationType::REDUCE_PACKET:
+        reduceSendPacket(op, false);
+        break;
+      case OperationType::REDUCE_SEND_PACKET:
+        reduceSendPacket(op, true);
+        break;
+      case OperationType::COPY_PACKET:
+        readPackets(local(op.dstBufferType, op.dstOffset, op.size),
+                    local(op.srcBufferType, packetBase() + 2 * size_t(op.srcOffset), 2 * size_t(op.size)), op.size);
+        break;
+      case OperationType::TRANSFORM_TO_PACKET:
+        writePackets(local(op.dstBufferType, packetBase() + 2 * size_t(op.dstOffset), 2 * size_t(op.size)),
+                     local(op.srcBufferType, op.srcOffset, op.size), op.size);
+        break;
+      case OperationType::MULTI_LOAD_REDUCE_STORE:
+        multiLoadReduceStore(op);
+        break;
+      default:
+        throw Error(where() + "executionKernel does not implement this operation", ErrorCode::ExecutorError);
+    }
+  }
+
+  std::string where() const {
+    const Operation& op = state_.operations[threadblock_][opIndex_];
+    return "Rank " + std::to_string(rank_) + " threadblock " + std::to_string(threadblock_) + " operation " +
+           std::to_string(opIndex_) + " (" + operationTypeToString(op.type) + "): ";
+  }
+
+  char* access(int rank, BufferType type, uint64_t offset, uint64_t size) {
+    const Buffer& buffer = run_.buffers[rank][static_cast<int>(type)];
+    if (buffer.data == nullptr || offset + size > buffer.size) {
+      throw Error(where() + "bytes [" + std::to_string(offset) + ", " + std::to_string(offset + size) +
+                      ") are out of the " + bufferTypeToString(type) + " buffer of rank " + std::to_string(rank) +
+                      " (" + std::to_string(buffer.size) + " bytes)",
+                  ErrorCode::ExecutorError);
+    }
+    return buffer.data + offset;
+  }
+
+  char* local(BufferType type, uint64_t offset, uint64_t size) { return access(rank_, type, offset, size); }
+
+  // The local memory of a channel.
+  char* origin(const Channel& ch, uint64_t offset, uint64_t size) { return local(ch.srcBufferType, offset, size); }
+
+  // The memory of the peer of a channel.
+  char* remote(const Channel& ch, uint64_t offset, uint64_t size) {
+    remoteBytes_ += size;
+    return access(ch.peer, ch.dstBufferType, offset, size);
+  }
+
+  const Channel& channel(ChannelType type, int index) {
+    if (type != ChannelType::SM && type != ChannelType::PROXY) {
+      throw Error(where() + "needs an SM or proxy channel", ErrorCode::ExecutorError);
+    }
+    bool sm = type == ChannelType::SM;
+    const std::vector<int>& indexes =
+        sm ? state_.threadblockSmChannels[threadblock_] : state_.threadblockProxyChannels[threadblock_];
+    if (index >= static_cast<int>(indexes.size())) {
+      throw Error(where() + "the threadblock has no " + (sm ? "SM" : "proxy") + " channel " + std::to_string(index),
+                  ErrorCode::ExecutorError);
+    }
+    return sm ? state_.smChannels[indexes[index]] : state_.proxyChannels[indexes[index]];
+  }
+
+  const NvlsInfo& nvls(int index) {
+    const std::vector<int>& indexes = state_.threadblockNvlsChannels[threadblock_];
+    if (index >= static_cast<int>(indexes.size())) {
+      throw Error(where() + "the threadblock has no NVLS channel " + std::to_string(index), ErrorCode::ExecutorError);
+    }
+    return state_.nvlsInfos[indexes[index]];
+  }
+
+  template <typename Predicate>
+  void spinUntil(Predicate ready) {
+    while (!ready()) {
+      if (run_.failed.load(std::memory_order_relaxed)) {
+        throw RunAborted();
+      }
+      if (std::chrono::steady_clock::now() > run_.deadline) {
+        throw Error(where() + "timed out", ErrorCode::Timeout);
+      }
+      std::this_thread::yield();
+    }
+  }
+
+  void signal(const Channel& ch) { ch.outbound->inbound.fetch_add(1, std::memory_order_release); }
+
+  void wait(const Channel& ch) {
+    uint64_t expected = ch.inbound->expected.fetch_add(1, std::memory_order_relaxed) + 1;
+    spinUntil([&] { return ch.inbound->inbound.load(std::memory_order_acquire) >= expected; });
+  }
+
+  void barrier(uint32_t index, uint32_t nThreadBlocks) {
+    if (index >= NumDeviceSyncers) {
+      throw Error(where() + "barrier " + std::to_string(index) + " does not exist", ErrorCode::ExecutorError);
+    }
+    Barrier& b = state_.barriers[index];
+    uint32_t generation = b.generation.load(std::memory_order_acquire);
+    if (b.count.fetch_add(1, std::memory_order_acq_rel) + 1 == nThreadBlocks) {
+      b.count.store(0, std::memory_order_relaxed);
+      b.generation.fetch_add(1, std::memory_order_release);
+    } else {
+      spinUntil([&] { return b.generation.load(std::memory_order_acquire) != generation; });
+    }
+  }
+
+  // acc[i] += src[i] for every element, rounded to the data type after each addition like add_elements.
+  void add(char* acc, const char* src, size_t bytes) {
+    hostReduce(acc, src, bytes / run_.elementSize, run_.dataType, ReduceOp::SUM, 1);
+  }
+
+  // LL8 and LL16 packets are laid out alike: each 8 bytes hold 4 bytes of data and then the flag, and are written
+  // and read at once. Packets of the current launch use the half of the scratch buffer that the parity of the flag
+  // selects.
+  size_t packetBase() const { return run_.flag & 0x1 ? 0 : state_.scratchSize >> 1; }
+
+  uint64_t* packetWords(char* packets) {
+    if (reinterpret_cast<uintptr_t>(packets) % sizeof(uint64_t) != 0) {
+      throw Error(where() + "packets are not 8-byte aligned", ErrorCode::ExecutorError);
+    }
+    return reinterpret_cast<uint64_t*>(packets);
+  }
+
+  void writePackets(char* packets, const char* data, size_t bytes) {
+    uint64_t* words = packetWords(packets);
+    for (size_t i = 0; i < bytes / sizeof(uint32_t); i++) {
+      uint32_t value;
+      std::memcpy(&value, data + i * sizeof(uint32_t), sizeof(value));
+      __atomic_store_n(&words[i], (uint64_t(run_.flag) << 32) | value, __ATOMIC_RELEASE);
+    }
+  }
+
+  void readPackets(char* data, char* packets, size_t bytes) {
+    uint64_t* words = packetWords(packets);
+    for (size_t i = 0; i < bytes / sizeof(uint32_t); i++) {
+      uint64_t word;
+      spinUntil([&] {
+        word = __atomic_load_n(&words[i], __ATOMIC_ACQUIRE);
+        return uint32_t(word >> 32) == run_.flag;
+      });
+      uint32_t value = static_cast<uint32_t>(word);
+      std::memcpy(data + i * sizeof(uint32_t), &value, sizeof(value));
+    }
+  }
+
+  void put(const Operation& op) {
+    for (int i = 0; i < op.nOutputs; i++) {
+      const Channel& ch = channel(op.channelType, op.outputChannelIndexes[i]);
+      std::memcpy(remote(ch, op.outputOffsets[i], op.size), origin(ch, op.inputOffsets[i], op.size), op.size);
+      // handlePut ignores the signal of SM channels
+      if (op.type != OperationType::PUT && op.channelType == ChannelType::PROXY) {
+        signal(ch);
+      }
+    }
+  }
+
+  void readReduceCopySend(const Operation& op, bool send) {
+    std::vector<char> tmp(op.size);
+    std::memcpy(tmp.data(), local(op.srcBufferType, op.srcOffset, op.size), op.size);
+    for (int i = 0; i < op.nInputs; i++) {
+      add(tmp.data(), remote(channel(ChannelType::SM, op.inputChannelIndexes[i]), op.inputOffsets[i], op.size),
+          op.size);
+    }
+    std::memcpy(local(op.dstBufferType, op.dstOffset, op.size), tmp.data(), op.size);
+    if (send) {
+      for (int i = 0; i < op.nOutputs; i++) {
+        const Channel& ch = channel(ChannelType::SM, op.outputChannelIndexes[i]);
+        std::memcpy(remote(ch, op.outputOffsets[i], op.size), tmp.data(), op.size);
+      }
+    }
+  }
+
+  void reduceSend(const Operation& op) {
+    std::vector<char> tmp(op.size);
+    std::memcpy(tmp.data(), local(op.srcBufferType, op.srcOffset, op.size), op.size);
+    // handleReduceSend reduces one local input for every output channel
+    for (int i = 0; i < op.nOutputs; i++) {
+      add(tmp.data(), local(op.inputBufferType, op.inputOffsets[i], op.size), op.size);
+    }
+    std::memcpy(local(op.dstBufferType, op.dstOffset, op.size), tmp.data(), op.size);
+    for (int i = 0; i < op.nOutputs; i++) {
+      const Channel& ch = channel(ChannelType::SM, op.outputChannelIndexes[i]);
+      std::memcpy(remote(ch, op.outputOffsets[i], op.size), tmp.data(), op.size);
+    }
+  }
+
+  void putPacket(const Operation& op) {
+    size_t base = packetBase();
+    for (int i = 0; i < op.nOutputs; i++) {
+      const Channel& ch = channel(op.channelType, op.outputChannelIndexes[i]);
+      char* dst = remote(ch, base + 2 * size_t(op.outputOffsets[i]), 2 * size_t(op.size));
+      if (op.channelType == ChannelType::SM) {
+        writePackets(dst, origin(ch, op.inputOffsets[i], op.size), op.size);
+      } else {
+        // a proxy channel copies packets that are already in the local scratch buffer, one 8-byte word at a time
+        uint64_t* dstWords = packetWords(dst);
+        uint64_t* srcWords = packetWords(origin(ch, base + 2 * size_t(op.inputOffsets[i]), 2 * size_t(op.size)));
+        for (size_t w = 0; w < op.size / sizeof(uint32_t); w++) {
+          __atomic_store_n(&dstWords[w], __atomic_load_n(&srcWords[w], __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+        }
+      }
+    }
+  }
+
+  void reduceSendPacket(const Operation& op, bool send) {
+    size_t base = packetBase();
+    // handleReduceSendPacket starts from zero, then adds the packets and the local source in this order
+    std::vector<char> acc(op.size, 0);
+    std::vector<char> tmp(op.size);
+    for (int i = 0; i < op.nInputs; i++) {
+      readPackets(tmp.data(), local(BufferType::SCRATCH, base + 2 * size_t(op.inputOffsets[i]), 2 * size_t(op.size)),
+                  op.size);
+      add(acc.data(), tmp.data(), op.size);
+    }
+    add(acc.data(), local(op.srcBufferType, op.srcOffset, op.size), op.size);
+    std::memcpy(local(op.dstBufferType, op.dstOffset, op.size), acc.data(), op.size);
+    if (send) {
+      for (int i = 0; i < op.nOutputs; i++) {
+        const Channel& ch = channel(ChannelType::SM, op.outputChannelIndexes[i]);
+        writePackets(remote(ch, base + 2 * size_t(op.outputOffsets[i]), 2 * size_t(op.size)), acc.data(), op.size);
+      }
+    }
+  }
+
+  void multiLoadReduceStore(const Operation& op) {
+    const NvlsInfo& in = nvls(op.nvlsInputIndex);
+    const NvlsInfo& out = nvls(op.nvlsOutputIndex);
+    std::vector<char> tmp(op.size, 0);
+    for (size_t i = 0; i < in.ranks.size(); i++) {
+      const char* src = access(in.ranks[i], in.bufferType, op.srcOffset, op.size);
+      if (in.ranks[i] != rank_) remoteBytes_ += op.size;
+      if (i == 0) {
+        std::memcpy(tmp.data(), src, op.size);
+      } else {
+        add(tmp.data(), src, op.size);
+      }
+    }
+    for (int peer : out.ranks) {
+      std::memcpy(access(peer, out.bufferType, op.dstOffset, op.size), tmp.data(), op.size);
+      if (peer != rank_) remoteBytes_ += op.size;
+    }
+  }
+
+  RunState& run_;
+  const int rank_;
+  const int threadblock_;
+  RankState& state_;
+  size_t opIndex_ = 0;
+  uint64_t remoteBytes_ = 0;
+};
+
+}  // namespace
+
+struct ExecutionInterpreter::Impl {
+  std::vector<RankState> ranks;
+  // never moved, since the channels point into it
+  std::deque<Semaphore> semaphores;
+  size_t inputSize;
+  size_t outputSize;
+  uint32_t flag = 0;
+
+  Impl(const CompiledExecutionPlan& plan, size_t inputSize, size_t outputSize)
+      : ranks(plan.operationTemplates.size()), inputSize(inputSize), outputSize(outputSize) {
+    const int nRanks = ranks.size();
+    for (int rank = 0; rank < nRanks; rank++) {
+      if (plan.operationTemplates.find(rank) == plan.operationTemplates.end()) {
+        throw Error("The ranks of the plan must be numbered from 0", ErrorCode::ExecutorError);
+      }
+    }
+    // The i-th semaphore of a rank for a peer pairs with the i-th one of the peer for the rank, as the executor
+    // builds them. A peer with fewer channels still has a semaphore for each, see getUnpairedChannelInfos.
+    std::map<std::tuple<int, int, ChannelType, int>, Semaphore*> semaphoreMap;
+    auto getSemaphore = [&](int rank, int peer, ChannelType type, int i) {
+      Semaphore*& sem = semaphoreMap[{rank, peer, type, i}];
+      if (sem == nullptr) {
+        sem = &semaphores.emplace_back();
+      }
+      return sem;
+    };
+
+    for (int rank = 0; rank < nRanks; rank++) {
+      RankState& state = ranks[rank];
+      for (ChannelType type : {ChannelType::SM, ChannelType::PROXY}) {
+        std::map<int, int> nChannelsToPeer;
+        auto& channels = type == ChannelType::SM ? state.smChannels : state.proxyChannels;
+        for (const ChannelInfo& info : plan.channelInfos.at(rank)) {
+          if (info.channelType != type) continue;
+          for (int peer : info.connectedPeers) {
+            if (peer < 0 || peer >= nRanks) {
+              throw Error("Rank " + std::to_string(rank) + " has a channel to rank " + std::to_string(peer) +
+                              ", which is not in the plan",
+                          ErrorCode::ExecutorError);
+            }
+            int i = nChannelsToPeer[peer]++;
+            channels.push_back({peer, info.srcBufferType, info.dstBufferType, getSemaphore(rank, peer, type, i),
+                                getSemaphore(peer, rank, type, i)});
+          }
+        }
+      }
+      auto nvlsInfos = plan.nvlsInfos.find(rank);
+      if (nvlsInfos != plan.nvlsInfos.end()) {
+        state.nvlsInfos = nvlsInfos->second;
+      }
+      auto getIndexes = [](const std::vector<std::vector<std::pair<int, ChannelKey>>>& map) {
+        std::vector<std::vector<int>> indexes;
+        for (const auto& channels : map) {
+          indexes.emplace_back();
+          for (const auto& [index, _] : channels) {
+            indexes.back().push_back(index);
+          }
+        }
+        return indexes;
+      };
+      state.threadblockSmChannels = getIndexes(plan.threadblockSMChannelMap.at(rank));
+      state.threadblockProxyChannels = getIndexes(plan.threadblockProxyChannelMap.at(rank));
+      state.threadblockNvlsChannels = getIndexes(plan.threadblockNvlsChannelMap.at(rank));
+      for (const auto& templates : plan.operationTemplates.at(rank)) {
+        state.operations.emplace_back();
+        for (const Operation& op : templates) {
+          state.operations.back().push_back(plan.resolveOperation(rank, op, inputSize, outputSize, 0, 0));
+        }
+      }
+      state.scratchSize = plan.getScratchBufferSize(rank, inputSize, outputSize);
+      state.scratch.assign((state.scratchSize + sizeof(uint64_t) - 1) / sizeof(uint64_t), 0);
+      state.barriers = std::make_unique<Barrier[]>(NumDeviceSyncers);
+    }
+  }
+};
+
+ExecutionInterpreter::ExecutionInterpreter(const CompiledExecutionPlan& plan, size_t inputSize, size_t outputSize)
+    : impl_(std::make_unique<Impl>(plan, inputSize, outputSize)) {}
+
+ExecutionInterpreter::~ExecutionInterpreter() = default;
+
+int ExecutionInterpreter::nRanks() const { return impl_->ranks.size(); }
+
+InterpreterStats ExecutionInterpreter::run(const std::vector<void*>& inputs, const std::vector<void*>& outputs,
+                                           DataType dataType, int64_t timeoutUsec) {
+  const int nRanks = this->nRanks();
+  if (static_cast<int>(inputs.size()) != nRanks || static_cast<int>(outputs.size()) != nRanks) {
+    throw Error("The plan needs the input and output buffers of " + std::to_string(nRanks) + " ranks",
+                ErrorCode::InvalidUsage);
+  }
+  RunState run;
+  run.buffers.resize(nRanks);
+  for (int rank = 0; rank < nRanks; rank++) {
+    RankState& state = impl_->ranks[rank];
+    run.buffers[rank][static_cast<int>(BufferType::INPUT)] = {static_cast<char*>(inputs[rank]), impl_->inputSize};
+    run.buffers[rank][static_cast<int>(BufferType::OUTPUT)] = {static_cast<char*>(outputs[rank]), impl_->outputSize};
+    run.buffers[rank][static_cast<int>(BufferType::SCRATCH)] = {reinterpret_cast<char*>(state.scratch.data()),
+                                                                state.scratchSize};
+  }
+  run.dataType = dataType;
+  run.elementSize = getDataTypeSize(dataType);
+  // like the static flag of Executor::Impl::launchKernel, which starts at 1
+  run.flag = ++impl_->flag;
+  auto start = std::chrono::steady_clock::now();
+  run.deadline = start + std::chrono::microseconds(timeoutUsec);
+  run.stats.opCounts.assign(NumOperationTypes, 0);
+  run.stats.opNanoseconds.assign(NumOperationTypes, 0);
+
+  std::vector<std::thread> threads;
+  for (int rank = 0; rank < nRanks; rank++) {
+    for (size_t threadblock = 0; threadblock < impl_->ranks[rank].operations.size(); threadblock++) {
+      threads.emplace_back([this, &run, rank, threadblock] {
+        try {
+          ThreadblockRunner(impl_->ranks[rank], run, rank, threadblock).run();
+        } catch (const RunAborted&) {
+        } catch (...) {
+          std::lock_guard<std::mutex> lock(run.mutex);
+          if (!run.error) {
+            run.error = std::current_exception();
+          }
+          run.failed = true;
+        }
+      });
+    }
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  if (run.error) {
+    std::rethrow_exception(run.error);
+  }
+  run.stats.elapsedUs =
+      std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+  return run.stats;
+}
+
+}  // namespace mscclpp
@@ -3,10 +3,15 @@
 
 #include "execution_plan.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <fstream>
+#include <limits>
 #include <set>
 
+#include "execution_plan_fusion.hpp"
+
 namespace {
 template <typename T, typename Predicate>
 std::vector<T> filter(const std::vector<T>& vec, Predicate pred) {
@@ -94,187 +99,12 @@ std::set groupChannelType{mscclpp::ChannelType::NVLS};
 namespace mscclpp {
 using json = nlohmann::json;
 
-ExecutionPlan::Impl::Impl(const std::string planPath) : planPath(planPath), isUsingPacket(false) {
-  std::ifstream file(this->planPath);
-  json obj = json::parse(file);
-  this->name = obj["name"];
-  this->collective = obj["collective"];
-  this->isInPlace = obj["inplace"];
-  this->minMessageSize = obj.value("min_message_size", 0);
-  this->maxMessageSize = obj.value("max_message_size", std::numeric_limits<uint64_t>::max());
-}
-
-std::vector<ChannelInfo> ExecutionPlan::Impl::getChannelInfos(int rank, ChannelType channelType) const {
-  auto pred = [channelType](const ChannelInfo& info) { return info.channelType == channelType; };
-  return filter(this->channelInfos.at(rank), pred);
-}
-
-std::vector<ChannelInfo> ExecutionPlan::Impl::getChannelInfos(int rank, BufferType dstBufferType) const {
-  auto pred = [dstBufferType](const ChannelInfo& info) { return info.dstBufferType == dstBufferType; };
-  return filter(this->channelInfos.at(rank), pred);
-}
-
-std::vector<ChannelInfo> ExecutionPlan::Impl::getChannelInfosByDstRank(int rank, BufferType bufferType) const {
-  auto pred = [bufferType](const ChannelInfo& info) { return info.dstBufferType == bufferType; };
-  return filter(this->channelInfosByDstRank.at(rank), pred);
-}
-
-std::vector<ChannelInfo> ExecutionPlan::Impl::getUnpairedChannelInfos(int rank, int worldSize,
-                                                                      ChannelType channelType) {
-  std::vector<ChannelInfo> unpaired;
-  for (int peer = 0; peer < worldSize; peer++) {
-    if (peer == rank) {
-      continue;
-    }
-    if (this->channelCountMap[{rank, channelType}][peer] < this->channelCountMap[{peer, channelType}][rank]) {
-      int count = this->channelCountMap[{peer, channelType}][rank] - this->channelCountMap[{rank, channelType}][peer];
-      for (int i = 0; i < count; i++) {
-        ChannelInfo info;
-        info.srcBufferType = BufferType::NONE;
-        info.dstBufferType = BufferType::NONE;
-        info.channelType = channelType;
-        info.connectedPeers.push_back(peer);
-        unpaired.push_back(info);
-      }
-    }
-  }
-  return unpaired;
-}
-
-std::vector<NvlsInfo> ExecutionPlan::Impl::getNvlsInfos(int rank, size_t sendBuffserSize, size_t recvBufferSize) const {
-  if (sendBuffserSize == 0 && recvBufferSize == 0) {
-    return this->nvlsInfos.at(rank);
-  }
-  size_t chunkSize = this->getUpperBoundChunkSize(rank, sendBuffserSize, recvBufferSize);
-  std::vector<NvlsInfo> infos = this->nvlsInfos.at(rank);
-  for (auto& info : infos) {
-    info.bufferSize = info.bufferSize * chunkSize;
-  }
-  return infos;
-}
-
-std::vector<int> ExecutionPlan::Impl::getConnectedPeers(int rank) const {
-  std::set<int> peers;
-  for (const auto& info : this->channelInfos.at(rank)) {
-    for (int peer : info.connectedPeers) {
-      peers.insert(peer);
-    }
-  }
-  for (const auto& info : this->channelInfosByDstRank.at(rank)) {
-    for (int peer : info.connectedPeers) {
-      peers.insert(peer);
-    }
-  }
-  return std::vector<int>(peers.begin(), peers.end());
-}
-
-std::vector<BufferType> ExecutionPlan::Impl::getConnectedBufferTypes(int rank) const {
-  std::set<BufferType> bufferTypes;
-  for (const auto& info : this->channelInfos.at(rank)) {
-    bufferTypes.insert(info.dstBufferType);
-  }
-  return std::vector<BufferType>(bufferTypes.begin(), bufferTypes.end());
-}
-
-size_t ExecutionPlan::Impl::getScratchBufferSize(int rank, size_t inputSize, size_t outputSize) const {
-  size_t sizePerRank = 0;
-  if (this->inputChunks.at(rank) != 0)
-    sizePerRank = inputSize / this->inputChunks.at(rank);
-  else if (this->outputChunks.at(rank) != 0)
-    sizePerRank = outputSize / this->outputChunks.at(rank);
-  else
-    throw mscclpp::Error("Output or Input chunks must be greater than 0", mscclpp::ErrorCode::ExecutorError);
-
-  if (this->isUsingPacket) {
-    return sizePerRank * this->scratchChunks.at(rank) * 2 /* data + flag*/ * 2 /*double buffer*/;
-  }
-  return sizePerRank * this->scratchChunks.at(rank);
-}
-
-size_t ExecutionPlan::Impl::getMaxScratchBufferSize(int rank) const {
-  if (this->maxMessageSize == std::numeric_limits<uint64_t>::max()) {
-    return std::numeric_limits<size_t>::max();
-  }
-  size_t sizePerChunk = 0;
-  if (this->inputChunks.at(rank) != 0)
-    sizePerChunk = maxMessageSize / this->inputChunks.at(rank);
-  else if (this->outputChunks.at(rank) != 0)
-    sizePerChunk = maxMessageSize / this->outputChunks.at(rank);
-  else
-    throw mscclpp::Error("Output or Input chunks must be greater than 0", mscclpp::ErrorCode::ExecutorError);
-
-  return this->getScratchBufferSize(rank, sizePerChunk * this->inputChunks.at(rank),
-                                    sizePerChunk * this->outputChunks.at(rank));
-}
-
-std::vector<Operation> ExecutionPlan::Impl::getOperations(int rank, int threadblock) const {
-  return this->operations.at(rank)[threadblock];
-}
-
-int ExecutionPlan::Impl::getThreadblockCount(int rank) const { return this->operations.at(rank).size(); }
-
-int ExecutionPlan::Impl::getNThreadsPerBlock() const { return this->nThreadsPerBlock; }
-
-void ExecutionPlan::Impl::loadExecutionPlan(size_t inputSize, size_t outputSize, size_t contsSrcOffset,
-                                            size_t constDstOffset) {
-  std::ifstream file(this->planPath);
-  json obj = json::parse(file);
-  if (this->name != obj["name"]) {
-    throw Error("Plan name does not match", ErrorCode::ExecutorError);
-  }
-  this->collective = obj["collective"];
-  std::string protocol = obj["protocol"];
-  if (protocol == "LL") {
-    this->isUsingPacket = true;
-  }
-  this->inputSize = inputSize;
-  this->outputSize = outputSize;
-  this->nThreadsPerBlock = obj.value("num_threads_per_block", 1024);
-  this->minMessageSize = obj.value("min_message_size", 0);
-  this->maxMessageSize = obj.value("max_message_size", std::numeric_limits<uint64_t>::max());
-  this->isInPlace = obj["inplace"];
-  const auto& gpus = obj["gpus"];
-
-  for (const auto& gpu : gpus) {
-    int rank = gpu["id"];
-    this->inputChunks[rank] = gpu["inputChunks"];
-    this->outputChunks[rank] = gpu["outputChunks"];
-    this->scratchChunks[rank] = gpu["scratchChunks"];
-    this->chunkGroups[rank] = gpu["chunkGroups"];
-  }
-  this->setupChannels(gpus);
-  this->setupOperations(gpus, contsSrcOffset, constDstOffset);
-}
-
-void ExecutionPlan::Impl::lightLoadExecutionPlan(size_t inputSize, size_t outputSize, size_t contsSrcOffset,
-                                                 size_t constDstOffset) {
-  std::ifstream file(this->planPath);
-  json obj = json::parse(file);
-  if (this->name != obj["name"]) {
-    throw Error("Plan name does not match", ErrorCode::ExecutorError);
-  }
-  std::string protocol = obj["protocol"];
-  if (protocol == "LL") {
-    this->isUsingPacket = true;
-  }
-  const auto& gpus = obj["gpus"];
-
-  for (const auto& gpu : gpus) {
-    int rank = gpu["id"];
-    this->inputChunks[rank] = gpu["inputChunks"];
-    this->outputChunks[rank] = gpu["outputChunks"];
-    this->scratchChunks[rank] = gpu["scratchChunks"];
-    this->chunkGroups[rank] = gpu["chunkGroups"];
-  }
-
-  this->inputSize = inputSize;
-  this->outputSize = outputSize;
-  this->setupOperations(gpus, contsSrcOffset, constDstOffset);
-}
+namespace {
 
-void ExecutionPlan::Impl::parseChannels(
-    const json& gpu, std::vector<ChannelInfo>& channelInfos, std::vector<NvlsInfo>& nvlsInfos,
-    std::map<std::tuple<int, BufferType, BufferType, ChannelType>, std::vector<int>>& chanConnectedPeersMap, int rank) {
+void parseChannels(const json& gpu, std::vector<ChannelInfo>& channelInfos, std::vector<NvlsInfo>& nvlsInfos,
+                   std::map<std::tuple<int, BufferType, BufferType, ChannelType>, std::vector<int>>& chanConnectedPeersMap,
+                   std::unordered_map<std::pair<int, ChannelType>, std::unordered_map<int, int>>& channelCountMap,
+                   int rank) {
   for (const auto& channel : gpu["channels"]) {
     ChannelType chanType = convertToChannelType(channel["type"]);
 
@@ -297,7 +127,7 @@ void ExecutionPlan::Impl::parseChannels(
       for (const auto& peer : channel["connectedTo"]) {
         info.connectedPeers.push_back(peer);
         chanConnectedPeersMap[{peer, info.srcBufferType, info.dstBufferType, info.channelType}].push_back(rank);
-        this->channelCountMap[{rank, info.channelType}][peer]++;
+        channelCountMap[{rank, info.channelType}][peer]++;
       }
       channelInfos.push_back(info);
     }
@@ -306,16 +136,16 @@ void ExecutionPlan::Impl::parseChannels(
 
 // Construct the channel info. Step 1. Flatten SM and PROXY channels into separate vectors.
 // Step 2. For each threadblock, construct a vector of channel indexes and keys.
-void ExecutionPlan::Impl::setupChannels(const json& gpus) {
+void setupChannels(const json& gpus, CompiledExecutionPlan& plan) {
   using mapKey = std::tuple<int, BufferType, BufferType, ChannelType>;
   std::map<mapKey, std::vector<int>> chanConnectedPeersMap;
   for (const auto& gpu : gpus) {
     int rank = gpu["id"];
     std::vector<ChannelInfo> channelInfos;
     std::vector<NvlsInfo> nvlsInfos;
-    this->parseChannels(gpu, channelInfos, nvlsInfos, chanConnectedPeersMap, rank);
-    this->channelInfos[rank] = channelInfos;
-    this->nvlsInfos[rank] = nvlsInfos;
+    parseChannels(gpu, channelInfos, nvlsInfos, chanConnectedPeersMap, plan.channelCountMap, rank);
+    plan.channelInfos[rank] = channelInfos;
+    plan.nvlsInfos[rank] = nvlsInfos;
   }
 
   for (const auto& [key, connectedFrom] : chanConnectedPeersMap) {
@@ -325,7 +155,7 @@ void ExecutionPlan::Impl::setupChannels(const json& gpus) {
     info.dstBufferType = dstBufferType;
     info.channelType = channelType;
     info.connectedPeers = connectedFrom;
-    this->channelInfosByDstRank[peer].push_back(info);
+    plan.channelInfosByDstRank[peer].push_back(info);
   }
 
   // setup threadblockChannelMap
@@ -334,16 +164,15 @@ void ExecutionPlan::Impl::setupChannels(const json& gpus) {
     auto channelTypes = {ChannelType::SM, ChannelType::PROXY, ChannelType::NVLS};
     std::unordered_map<ChannelKey, std::vector<int>> channelMap;
     for (auto channelType : channelTypes) {
-      const std::vector<ChannelInfo> channelInfos = this->getChannelInfos(rank, channelType);
       int index = 0;
       if (channelType == ChannelType::NVLS) {
-        const std::vector<NvlsInfo> nvlsInfos = this->getNvlsInfos(rank);
-        for (const auto& info : nvlsInfos) {
+        for (const auto& info : plan.nvlsInfos.at(rank)) {
           ChannelKey key = {info.bufferType, info.bufferType, ChannelType::NVLS};
           channelMap[key].push_back(index++);
         }
       } else {
-        for (const auto& info : channelInfos) {
+        for (const auto& info : plan.channelInfos.at(rank)) {
+          if (info.channelType != channelType) continue;
           ChannelKey key = {info.srcBufferType, info.dstBufferType, info.channelType};
           for (size_t i = 0; i < info.connectedPeers.size(); i++) {
             channelMap[key].push_back(index++);
@@ -352,20 +181,20 @@ void ExecutionPlan::Impl::setupChannels(const json& gpus) {
       }
     }
     int nthreadblocks = gpu["threadblocks"].size();
-    this->threadblockSMChannelMap[rank].resize(nthreadblocks);
-    this->threadblockProxyChannelMap[rank].resize(nthreadblocks);
-    this->threadblockNvlsChannelMap[rank].resize(nthreadblocks);
+    plan.threadblockSMChannelMap[rank].resize(nthreadblocks);
+    plan.threadblockProxyChannelMap[rank].resize(nthreadblocks);
+    plan.threadblockNvlsChannelMap[rank].resize(nthreadblocks);
     for (const auto& threadblock : gpu["threadblocks"]) {
       for (const auto& channel : threadblock["channels"]) {
         ChannelType channelType = convertToChannelType(channel["ctype"]);
         ChannelKey key = {convertToBufferType(channel["src"]), convertToBufferType(channel["dst"]), channelType};
         for (int id : channel["cids"]) {
           if (channelType == ChannelType::SM) {
-            this->threadblockSMChannelMap[rank][threadblock["id"]].emplace_back(channelMap[key][id], key);
+            plan.threadblockSMChannelMap[rank][threadblock["id"]].emplace_back(channelMap[key][id], key);
           } else if (channelType == ChannelType::PROXY) {
-            this->threadblockProxyChannelMap[rank][threadblock["id"]].emplace_back(channelMap[key][id], key);
+            plan.threadblockProxyChannelMap[rank][threadblock["id"]].emplace_back(channelMap[key][id], key);
           } else if (channelType == ChannelType::NVLS) {
-            this->threadblockNvlsChannelMap[rank][threadblock["id"]].emplace_back(channelMap[key][id], key);
+            plan.threadblockNvlsChannelMap[rank][threadblock["id"]].emplace_back(channelMap[key][id], key);
           }
         }
       }
@@ -373,30 +202,17 @@ void ExecutionPlan::Impl::setupChannels(const json& gpus) {
   }
 }
 
-void ExecutionPlan::Impl::setupOperations(const json& gpus, size_t constSrcOffset, size_t constDstOffset) {
-  auto getConstOffset = [&](BufferType type) -> size_t {
-    switch (type) {
-      case BufferType::INPUT:
-        return constSrcOffset;
-      case BufferType::OUTPUT:
-        return constDstOffset;
-      case BufferType::SCRATCH:
-        return 0;
-      default:
-        throw Error("Invalid buffer type", ErrorCode::ExecutorError);
-    }
-  };
-
-  // setup threadblocks and operations
+// Lower the operations of each threadblock. Offsets and sizes are kept in chunk units, see ChunkLayout.
+void setupOperationTemplates(const json& gpus, CompiledExecutionPlan& plan) {
   for (const auto& gpu : gpus) {
     int rank = gpu["id"];
     for (const auto& threadblock : gpu["threadblocks"]) {
       std::unordered_map<ChannelKey, std::vector<int>> channelIndexes;
       std::vector<Operation> ops;
       int threadblockId = threadblock["id"];
-      const auto& smChannels = this->threadblockSMChannelMap[rank][threadblockId];
-      const auto& proxyChannels = this->threadblockProxyChannelMap[rank][threadblockId];
-      const auto& nvlsChannels = this->threadblockNvlsChannelMap[rank][threadblockId];
+      const auto& smChannels = plan.threadblockSMChannelMap[rank][threadblockId];
+      const auto& proxyChannels = plan.threadblockProxyChannelMap[rank][threadblockId];
+      const auto& nvlsChannels = plan.threadblockNvlsChannelMap[rank][threadblockId];
       for (size_t i = 0; i < smChannels.size(); i++) {
         const auto& [_, key] = smChannels[i];
         channelIndexes[key].push_back(i);
@@ -410,8 +226,9 @@ void ExecutionPlan::Impl::setupOperations(const json& gpus, size_t constSrcOffse
         channelIndexes[key].push_back(i);
       }
       for (const auto& op : threadblock["ops"]) {
-        Operation operation = {};
-        std::vector<uint32_t> chunkIndexes;
+        // zero the whole record, including padding, so that the binary plan is deterministic
+        Operation operation;
+        std::memset(&operation, 0, sizeof(operation));
         operation.type = static_cast<mscclpp::OperationType>(getOpType(op["name"]));
         if (op.contains("ctype")) {
           operation.channelType = convertToChannelType(op["ctype"]);
@@ -421,20 +238,17 @@ void ExecutionPlan::Impl::setupOperations(const json& gpus, size_t constSrcOffse
             BufferType srcBufferType = convertToBufferType(op["srcbuff"]);
             operation.nvlsInputIndex =
                 channelIndexes[{srcBufferType, srcBufferType, ChannelType::NVLS}][op["i_cids"][0]["id"]];
-            chunkIndexes.push_back((uint32_t)op["srcoff"]);
           } else {
             operation.nInputs = op["i_cids"].size();
+            BufferType srcBufferType = convertToBufferType(op["i_buff"]["src"]);
+            BufferType dstBufferType = convertToBufferType(op["i_buff"]["dst"]);
             for (int i = 0; i < operation.nInputs; i++) {
-              BufferType srcBufferType = convertToBufferType(op["i_buff"]["src"]);
-              BufferType dstBufferType = convertToBufferType(op["i_buff"]["dst"]);
               // Get the relevant channel index in rank channelInfos
               operation.inputChannelIndexes[i] =
                   channelIndexes[{srcBufferType, dstBufferType, operation.channelType}][op["i_cids"][i]["id"]];
-              operation.inputOffsets[i] =
-                  this->getOffset(rank, this->inputSize, this->outputSize, (uint32_t)op["i_cids"][i]["off"]) +
-                  getConstOffset(srcBufferType);
-              chunkIndexes.push_back((uint32_t)op["i_cids"][i]["off"]);
+              operation.inputOffsets[i] = op["i_cids"][i]["off"];
             }
+            operation.inputOffsetsBufferType = srcBufferType;
           }
         }
         // will have either srcs or i_cids
@@ -442,30 +256,25 @@ void ExecutionPlan::Impl::setupOperations(const json& gpus, size_t constSrcOffse
           operation.nInputs = op["srcs"].size();
           operation.inputBufferType = convertToBufferType(op["srcs"][0]["buff"]);
           for (int i = 0; i < operation.nInputs; i++) {
-            operation.inputOffsets[i] =
-                this->getOffset(rank, this->inputSize, this->outputSize, (uint32_t)op["srcs"][i]["off"]) +
-                getConstOffset(operation.inputBufferType);
-            chunkIndexes.push_back((uint32_t)op["srcs"][i]["off"]);
+            operation.inputOffsets[i] = op["srcs"][i]["off"];
           }
+          operation.inputOffsetsBufferType = operation.inputBufferType;
         }
         if (op.contains("o_cids")) {
           operation.nOutputs = op["o_cids"].size();
-          for (int i = 0; i < operation.nOutputs; i++) {
-            if (operation.channelType == mscclpp::ChannelType::NVLS) {
-              BufferType dstBufferType = convertToBufferType(op["dstbuff"]);
-              operation.nvlsInputIndex =
-                  channelIndexes[{dstBufferType, dstBufferType, ChannelType::NVLS}][op["o_cids"][0]["id"]];
-              chunkIndexes.push_back((uint32_t)op["dstoff"]);
-            } else {
-              BufferType srcBufferType = convertToBufferType(op["o_buff"]["src"]);
-              BufferType dstBufferType = convertToBufferType(op["o_buff"]["dst"]);
+          if (operation.channelType == mscclpp::ChannelType::NVLS) {
+            BufferType dstBufferType = convertToBufferType(op["dstbuff"]);
+            operation.nvlsInputIndex =
+                channelIndexes[{dstBufferType, dstBufferType, ChannelType::NVLS}][op["o_cids"][0]["id"]];
+          } else {
+            BufferType srcBufferType = convertToBufferType(op["o_buff"]["src"]);
+            BufferType dstBufferType = convertToBufferType(op["o_buff"]["dst"]);
+            for (int i = 0; i < operation.nOutputs; i++) {
               operation.outputChannelIndexes[i] =
                   channelIndexes[{srcBufferType, dstBufferType, operation.channelType}][op["o_cids"][i]["id"]];
-              operation.outputOffsets[i] =
-                  this->getOffset(rank, this->inputSize, this->outputSize, (uint32_t)op["o_cids"][i]["off"]) +
-                  getConstOffset(dstBufferType);
-              chunkIndexes.push_back((uint32_t)op["o_cids"][i]["off"]);
+              operation.outputOffsets[i] = op["o_cids"][i]["off"];
             }
+            operation.outputOffsetsBufferType = dstBufferType;
           }
         }
         // will have either dsts or o_cids
@@ -473,29 +282,26 @@ void ExecutionPlan::Impl::setupOperations(const json& gpus, size_t constSrcOffse
           operation.nOutputs = op["dsts"].size();
           operation.outputBufferType = convertToBufferType(op["dsts"][0]["buff"]);
           for (int i = 0; i < operation.nOutputs; i++) {
-            operation.outputOffsets[i] =
-                this->getOffset(rank, this->inputSize, this->outputSize, (uint32_t)op["dsts"][i]["off"]) +
-                getConstOffset(operation.outputBufferType);
-            chunkIndexes.push_back((uint32_t)op["dsts"][i]["off"]);
+            operation.outputOffsets[i] = op["dsts"][i]["off"];
           }
+          operation.outputOffsetsBufferType = operation.outputBufferType;
         }
         if (op.contains("srcbuff")) {
           operation.srcBufferType = convertToBufferType(op["srcbuff"]);
         }
         if (op.contains("srcoff")) {
-          operation.srcOffset = this->getOffset(rank, this->inputSize, this->outputSize, (uint32_t)op["srcoff"]);
-          chunkIndexes.push_back((uint32_t)op["srcoff"]);
+          operation.srcOffset = op["srcoff"];
+          operation.hasSrcOffset = true;
         }
         if (op.contains("dstbuff")) {
           operation.dstBufferType = convertToBufferType(op["dstbuff"]);
         }
         if (op.contains("dstoff")) {
-          operation.dstOffset = this->getOffset(rank, this->inputSize, this->outputSize, (uint32_t)op["dstoff"]);
-          chunkIndexes.push_back((uint32_t)op["dstoff"]);
+          operation.dstOffset = op["dstoff"];
+          operation.hasDstOffset = true;
         }
         if (op.contains("cnt")) {
-          operation.size =
-              this->getNChunkSize(rank, this->inputSize, this->outputSize, (uint32_t)op["cnt"], chunkIndexes);
+          operation.size = op["cnt"];
         }
         if (op.contains("barrier_id")) {
           operation.deviceSyncerIndex = op["barrier_id"];
@@ -505,13 +311,378 @@ void ExecutionPlan::Impl::setupOperations(const json& gpus, size_t constSrcOffse
         }
         ops.push_back(operation);
       }
-      this->operations[rank].push_back(ops);
+      plan.operationTemplates[rank].push_back(std::move(ops));
+    }
+  }
+}
+
+}  // namespace
+
+std::string operationTypeToString(OperationType type) {
+  switch (type) {
+    case OperationType::NOP:
+      return "NOP";
+    case OperationType::BARRIER:
+      return "BARRIER";
+    case OperationType::PUT:
+      return "PUT";
+    case OperationType::PUT_PACKET:
+      return "PUT_PACKET";
+    case OperationType::PUT_WITH_SIGNAL:
+      return "PUT_WITH_SIGNAL";
+    case OperationType::PUT_WITH_SIGNAL_AND_FLUSH:
+      return "PUT_WITH_SIGNAL_AND_FLUSH";
+    case OperationType::GET:
+      return "GET";
+    case OperationType::COPY:
+      return "COPY";
+    case OperationType::COPY_PACKET:
+      return "COPY_PACKET";
+    case OperationType::TRANSFORM_TO_PACKET:
+      return "TRANSFORM_TO_PACKET";
+    case OperationType::SIGNAL:
+      return "SIGNAL";
+    case OperationType::WAIT:
+      return "WAIT";
+    case OperationType::FLUSH:
+      return "FLUSH";
+    case OperationType::REDUCE:
+      return "REDUCE";
+    case OperationType::REDUCE_PACKET:
+      return "REDUCE_PACKET";
+    case OperationType::REDUCE_SEND:
+      return "REDUCE_SEND";
+    case OperationType::REDUCE_SEND_PACKET:
+      return "REDUCE_SEND_PACKET";
+    case OperationType::READ_REDUCE_COPY:
+      return "READ_REDUCE_COPY";
+    case OperationType::READ_REDUCE_COPY_SEND:
+      return "READ_REDUCE_COPY_SEND";
+    case OperationType::MULTI_LOAD_REDUCE_STORE:
+      return "MULTI_LOAD_REDUCE_STORE";
+    default:
+      return "UNKNOWN";
+  }
+}
+
+std::string bufferTypeToString(BufferType type) {
+  switch (type) {
+    case BufferType::INPUT:
+      return "input";
+    case BufferType::OUTPUT:
+      return "output";
+    case BufferType::SCRATCH:
+      return "scratch";
+    default:
+      return "none";
+  }
+}
+
+std::string channelTypeToString(ChannelType type) {
+  switch (type) {
+    case ChannelType::SM:
+      return "SM";
+    case ChannelType::PROXY:
+      return "proxy";
+    case ChannelType::NVLS:
+      return "NVLS";
+    default:
+      return "none";
+  }
+}
+
+CompiledExecutionPlan lowerExecutionPlan(const json& obj) {
+  CompiledExecutionPlan plan;
+  plan.name = obj["name"];
+  plan.collective = obj["collective"];
+  std::string protocol = obj["protocol"];
+  if (protocol == "LL") {
+    plan.isUsingPacket = true;
+  }
+  plan.nThreadsPerBlock = obj.value("num_threads_per_block", 1024);
+  plan.minMessageSize = obj.value("min_message_size", 0);
+  plan.maxMessageSize = obj.value("max_message_size", std::numeric_limits<uint64_t>::max());
+  plan.priority = obj.value("priority", 0);
+  plan.isInPlace = obj["inplace"];
+  const auto& gpus = obj["gpus"];
+
+  for (const auto& gpu : gpus) {
+    int rank = gpu["id"];
+    plan.inputChunks[rank] = gpu["inputChunks"];
+    plan.outputChunks[rank] = gpu["outputChunks"];
+    plan.scratchChunks[rank] = gpu["scratchChunks"];
+    plan.chunkGroups[rank] = gpu["chunkGroups"];
+  }
+  setupChannels(gpus, plan);
+  setupOperationTemplates(gpus, plan);
+  return plan;
+}
+
+CompiledExecutionPlan loadCompiledExecutionPlan(const std::string& path) {
+  if (isBinaryExecutionPlan(path)) {
+    return readBinaryExecutionPlan(path);
+  }
+  std::ifstream file(path);
+  CompiledExecutionPlan plan = lowerExecutionPlan(json::parse(file));
+  fuseOperationsFromEnv(plan);
+  return plan;
+}
+
+ExecutionPlan::Impl::Impl(const std::string planPath) : planPath(planPath) {
+  if (isBinaryExecutionPlan(this->planPath)) {
+    static_cast<CompiledExecutionPlan&>(*this) = readBinaryExecutionPlan(this->planPath, true);
+    return;
+  }
+  std::ifstream file(this->planPath);
+  json obj = json::parse(file);
+  this->name = obj["name"];
+  this->collective = obj["collective"];
+  this->isInPlace = obj["inplace"];
+  this->minMessageSize = obj.value("min_message_size", 0);
+  this->maxMessageSize = obj.value("max_message_size", std::numeric_limits<uint64_t>::max());
+  this->priority = obj.value("priority", 0);
+}
+
+std::vector<ChannelInfo> ExecutionPlan::Impl::getChannelInfos(int rank, ChannelType channelType) const {
+  auto pred = [channelType](const ChannelInfo& info) { return info.channelType == channelType; };
+  return filter(this->channelInfos.at(rank), pred);
+}
+
+std::vector<ChannelInfo> ExecutionPlan::Impl::getChannelInfos(int rank, BufferType dstBufferType) const {
+  auto pred = [dstBufferType](const ChannelInfo& info) { return info.dstBufferType == dstBufferType; };
+  return filter(this->channelInfos.at(rank), pred);
+}
+
+std::vector<ChannelInfo> ExecutionPlan::Impl::getChannelInfosByDstRank(int rank, BufferType bufferType) const {
+  auto pred = [bufferType](const ChannelInfo& info) { return info.dstBufferType == bufferType; };
+  return filter(this->channelInfosByDstRank.at(rank), pred);
+}
+
+std::vector<ChannelInfo> ExecutionPlan::Impl::getUnpairedChannelInfos(int rank, int worldSize,
+                                                                      ChannelType channelType) {
+  std::vector<ChannelInfo> unpaired;
+  for (int peer = 0; peer < worldSize; peer++) {
+    if (peer == rank) {
+      continue;
+    }
+    if (this->channelCountMap[{rank, channelType}][peer] < this->channelCountMap[{peer, channelType}][rank]) {
+      int count = this->channelCountMap[{peer, channelType}][rank] - this->channelCountMap[{rank, channelType}][peer];
+      for (int i = 0; i < count; i++) {
+        ChannelInfo info;
+        info.srcBufferType = BufferType::NONE;
+        info.dstBufferType = BufferType::NONE;
+        info.channelType = channelType;
+        info.connectedPeers.push_back(peer);
+        unpaired.push_back(info);
+      }
+    }
+  }
+  return unpaired;
+}
+
+std::vector<NvlsInfo> ExecutionPlan::Impl::getNvlsInfos(int rank, size_t sendBuffserSize, size_t recvBufferSize) const {
+  if (sendBuffserSize == 0 && recvBufferSize == 0) {
+    return this->nvlsInfos.at(rank);
+  }
+  size_t chunkSize = this->getUpperBoundChunkSize(rank, sendBuffserSize, recvBufferSize);
+  std::vector<NvlsInfo> infos = this->nvlsInfos.at(rank);
+  for (auto& info : infos) {
+    info.bufferSize = info.bufferSize * chunkSize;
+  }
+  return infos;
+}
+
+std::vector<int> ExecutionPlan::Impl::getConnectedPeers(int rank) const {
+  std::set<int> peers;
+  for (const auto& info : this->channelInfos.at(rank)) {
+    for (int peer : info.connectedPeers) {
+      peers.insert(peer);
+    }
+  }
+  for (const auto& info : this->channelInfosByDstRank.at(rank)) {
+    for (int peer : info.connectedPeers) {
+      peers.insert(peer);
     }
   }
+  return std::vector<int>(peers.begin(), peers.end());
+}
+
+std::vector<BufferType> ExecutionPlan::Impl::getConnectedBufferTypes(int rank) const {
+  std::set<BufferType> bufferTypes;
+  for (const auto& info : this->channelInfos.at(rank)) {
+    bufferTypes.insert(info.dstBufferType);
+  }
+  return std::vector<BufferType>(bufferTypes.begin(), bufferTypes.end());
 }
 
-std::pair<size_t, uint32_t> ExecutionPlan::Impl::getSizeAndChunksForRank(int rank, size_t inputSize,
-                                                                         size_t outputSize) const {
+size_t CompiledExecutionPlan::getScratchBufferSize(int rank, size_t inputSize, size_t outputSize) const {
+  size_t sizePerRank = 0;
+  if (this->inputChunks.at(rank) != 0)
+    sizePerRank = inputSize / this->inputChunks.at(rank);
+  else if (this->outputChunks.at(rank) != 0)
+    sizePerRank = outputSize / this->outputChunks.at(rank);
+  else
+    throw mscclpp::Error("Output or Input chunks must be greater than 0", mscclpp::ErrorCode::ExecutorError);
+
+  if (this->isUsingPacket) {
+    return sizePerRank * this->scratchChunks.at(rank) * 2 /* data + flag*/ * 2 /*double buffer*/;
+  }
+  return sizePerRank * this->scratchChunks.at(rank);
+}
+
+std::pair<size_t, size_t> CompiledExecutionPlan::getBufferSizes(size_t messageSize, uint32_t alignment) const {
+  size_t inputSize = std::max<size_t>(messageSize / alignment * alignment, alignment);
+  size_t outputSize = inputSize;
+  auto inputIt = this->inputChunks.find(0);
+  auto outputIt = this->outputChunks.find(0);
+  if (inputIt != this->inputChunks.end() && outputIt != this->outputChunks.end() && inputIt->second != 0 &&
+      outputIt->second != 0) {
+    outputSize = inputSize * outputIt->second / inputIt->second;
+  }
+  return {inputSize, outputSize};
+}
+
+size_t ExecutionPlan::Impl::getMaxScratchBufferSize(int rank) const {
+  if (this->maxMessageSize == std::numeric_limits<uint64_t>::max()) {
+    return std::numeric_limits<size_t>::max();
+  }
+  size_t sizePerChunk = 0;
+  if (this->inputChunks.at(rank) != 0)
+    sizePerChunk = maxMessageSize / this->inputChunks.at(rank);
+  else if (this->outputChunks.at(rank) != 0)
+    sizePerChunk = maxMessageSize / this->outputChunks.at(rank);
+  else
+    throw mscclpp::Error("Output or Input chunks must be greater than 0", mscclpp::ErrorCode::ExecutorError);
+
+  return this->getScratchBufferSize(rank, sizePerChunk * this->inputChunks.at(rank),
+                                    sizePerChunk * this->outputChunks.at(rank));
+}
+
+std::vector<Operation> ExecutionPlan::Impl::getOperations(int rank, int threadblock) const {
+  return this->operations.at(rank)[threadblock];
+}
+
+int ExecutionPlan::Impl::getThreadblockCount(int rank) const { return this->operations.at(rank).size(); }
+
+int ExecutionPlan::Impl::getNThreadsPerBlock() const { return this->nThreadsPerBlock; }
+
+void ExecutionPlan::Impl::loadExecutionPlan(size_t inputSize, size_t outputSize, size_t contsSrcOffset,
+                                            size_t constDstOffset) {
+  if (!this->compiledPlan) {
+    CompiledExecutionPlan plan = loadCompiledExecutionPlan(this->planPath);
+    if (this->name != plan.name) {
+      throw Error("Plan name does not match", ErrorCode::ExecutorError);
+    }
+    this->compiledPlan = std::make_shared<const CompiledExecutionPlan>(std::move(plan));
+  }
+  static_cast<CompiledExecutionPlan&>(*this) = *this->compiledPlan;
+  this->inputSize = inputSize;
+  this->outputSize = outputSize;
+  this->setupOperations(contsSrcOffset, constDstOffset);
+}
+
+// The size-independent part of the plan is kept from loadExecutionPlan, so only the offsets need to be recomputed.
+void ExecutionPlan::Impl::lightLoadExecutionPlan(size_t inputSize, size_t outputSize, size_t contsSrcOffset,
+                                                 size_t constDstOffset) {
+  this->inputSize = inputSize;
+  this->outputSize = outputSize;
+  this->setupOperations(contsSrcOffset, constDstOffset);
+}
+
+void ExecutionPlan::Impl::setupOperations(size_t constSrcOffset, size_t constDstOffset) {
+  for (const auto& [rank, threadblocks] : this->operationTemplates) {
+    for (const auto& templates : threadblocks) {
+      std::vector<Operation> ops;
+      ops.reserve(templates.size());
+      for (const auto& op : templates) {
+        ops.push_back(
+            this->resolveOperation(rank, op, this->inputSize, this->outputSize, constSrcOffset, constDstOffset));
+      }
+      this->operations[rank].push_back(std::move(ops));
+    }
+  }
+}
+
+ChunkLayout CompiledExecutionPlan::getChunkLayout(int rank, size_t inputSize, size_t outputSize,
+                                                  size_t constSrcOffset, size_t constDstOffset,
+                                                  uint32_t alignment) const {
+  if (inputSize % alignment != 0) {
+    throw Error("inputSize must be a multiple of alignment", ErrorCode::ExecutorError);
+  }
+  // ChunkLayout and the device offsets are 32-bit.
+  if (constSrcOffset > std::numeric_limits<uint32_t>::max() || constDstOffset > std::numeric_limits<uint32_t>::max()) {
+    throw Error("Buffer offset does not fit in 32 bits", ErrorCode::ExecutorError);
+  }
+
+  const int nGroups = this->chunkGroups.at(rank);
+  auto rankSizeAndChunks = getSizeAndChunksForRank(rank, inputSize, outputSize);
+  uint32_t nChunks = rankSizeAndChunks.second;
+  uint32_t nelems = rankSizeAndChunks.first / (alignment * sizeof(uint8_t));
+  if (nelems % nGroups != 0) {
+    throw Error("Input size must be a multiple of nGroups", ErrorCode::ExecutorError);
+  }
+
+  ChunkLayout layout;
+  layout.nelemsPerGroup = nelems / nGroups;
+  layout.nChunksPerGroup = nChunks / nGroups;
+  if (layout.nelemsPerGroup == 0 || layout.nChunksPerGroup == 0) {
+    throw Error("Message size is too small for the execution plan", ErrorCode::ExecutorError);
+  }
+  layout.minNelems = layout.nelemsPerGroup / layout.nChunksPerGroup;
+  layout.remainder = layout.nelemsPerGroup % layout.nChunksPerGroup;
+  layout.alignment = alignment;
+  layout.constSrcOffset = constSrcOffset;
+  layout.constDstOffset = constDstOffset;
+  return layout;
+}
+
+Operation CompiledExecutionPlan::resolveOperation(int rank, const Operation& op, size_t inputSize, size_t outputSize,
+                                                  size_t constSrcOffset, size_t constDstOffset) const {
+  auto getConstOffset = [&](BufferType type) -> size_t {
+    switch (type) {
+      case BufferType::INPUT:
+        return constSrcOffset;
+      case BufferType::OUTPUT:
+        return constDstOffset;
+      case BufferType::SCRATCH:
+        return 0;
+      default:
+        throw Error("Invalid buffer type", ErrorCode::ExecutorError);
+    }
+  };
+
+  Operation operation = op;
+  std::vector<uint32_t> chunkIndexes;
+  if (op.inputOffsetsBufferType != BufferType::NONE) {
+    for (int i = 0; i < op.nInputs; i++) {
+      operation.inputOffsets[i] =
+          this->getOffset(rank, inputSize, outputSize, op.inputOffsets[i]) + getConstOffset(op.inputOffsetsBufferType);
+      chunkIndexes.push_back(op.inputOffsets[i]);
+    }
+  }
+  if (op.outputOffsetsBufferType != BufferType::NONE) {
+    for (int i = 0; i < op.nOutputs; i++) {
+      operation.outputOffsets[i] = this->getOffset(rank, inputSize, outputSize, op.outputOffsets[i]) +
+                                   getConstOffset(op.outputOffsetsBufferType);
+      chunkIndexes.push_back(op.outputOffsets[i]);
+    }
+  }
+  if (op.hasSrcOffset) {
+    operation.srcOffset = this->getOffset(rank, inputSize, outputSize, op.srcOffset);
+    chunkIndexes.push_back(op.srcOffset);
+  }
+  if (op.hasDstOffset) {
+    operation.dstOffset = this->getOffset(rank, inputSize, outputSize, op.dstOffset);
+    chunkIndexes.push_back(op.dstOffset);
+  }
+  if (op.size != 0) {
+    operation.size = this->getNChunkSize(rank, inputSize, outputSize, op.size, chunkIndexes);
+  }
+  return operation;
+}
+
+std::pair<size_t, uint32_t> CompiledExecutionPlan::getSizeAndChunksForRank(int rank, size_t inputSize,
+                                                                           size_t outputSize) const {
   std::pair<size_t, uint32_t> sizePerRank;
   if (this->inputChunks.at(rank) == 0 && this->outputChunks.at(rank) == 0) {
     throw mscclpp::Error("Output or Input chunks must be greater than 0", mscclpp::ErrorCode::ExecutorError);
@@ -528,8 +699,8 @@ std::pair<size_t, uint32_t> ExecutionPlan::Impl::getSizeAndChunksForRank(int ran
   return sizePerRank;
 }
 
-size_t ExecutionPlan::Impl::getOffset(int rank, size_t inputSize, size_t outputSize, uint32_t chunkIndex,
-                                      uint32_t alignment) const {
+size_t CompiledExecutionPlan::getOffset(int rank, size_t inputSize, size_t outputSize, uint32_t chunkIndex,
+                                        uint32_t alignment) const {
   if (inputSize % alignment != 0) {
     throw Error("inputSize must be a multiple of alignment", ErrorCode::ExecutorError);
   }
@@ -553,8 +724,8 @@ size_t ExecutionPlan::Impl::getOffset(int rank, size_t inputSize, size_t outputS
   return static_cast<size_t>(offset) * alignment;
 }
 
-size_t ExecutionPlan::Impl::getNChunkSize(int rank, size_t inputSize, size_t outputSize, uint32_t nChunks,
-                                          const std::vector<uint32_t> chunkIndexes) const {
+size_t CompiledExecutionPlan::getNChunkSize(int rank, size_t inputSize, size_t outputSize, uint32_t nChunks,
+                                            const std::vector<uint32_t> chunkIndexes) const {
   size_t nChunkSize = 0;
   for (uint32_t index : chunkIndexes) {
     uint32_t beginOff = getOffset(rank, inputSize, outputSize, index);
@@ -585,6 +756,8 @@ size_t ExecutionPlan::Impl::getUpperBoundChunkSize(int rank, size_t inputSize, s
 void ExecutionPlan::Impl::reset() {
   this->operations.clear();
   this->channelInfos.clear();
+  this->channelInfosByDstRank.clear();
+  this->channelCountMap.clear();
   this->nvlsInfos.clear();
   this->threadblockSMChannelMap.clear();
   this->threadblockProxyChannelMap.clear();
@@ -593,6 +766,7 @@ void ExecutionPlan::Impl::reset() {
   this->outputChunks.clear();
   this->scratchChunks.clear();
   this->chunkGroups.clear();
+  this->operationTemplates.clear();
 }
 
 void ExecutionPlan::Impl::operationsReset() { this->operations.clear(); }
@@ -609,4 +783,6 @@ size_t ExecutionPlan::maxMessageSize() const { return this->impl_->maxMessageSiz
 
 bool ExecutionPlan::isInPlace() const { return this->impl_->isInPlace; }
 
+int ExecutionPlan::priority() const { return this->impl_->priority; }
+
 }  // namespace mscclpp
@@ -0,0 +1,376 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+#include "api.h"
+#include "execution_plan.hpp"
+
+// Layout of a binary execution plan. All integers are in host byte order; a plan is only meant to be loaded on the
+// same kind of machine it was compiled on, which is checked through the record sizes stored in the header.
+//
+//   header:    magic[8] | version u32 | sizeof(Operation) u32 | flags u32 |
+//              nThreadsPerBlock i32 | minMessageSize u64 | maxMessageSize u64 | priority i32 | name | collective
+//   chunks:    inputChunks | outputChunks | scratchChunks | chunkGroups        (rank-keyed maps of u32)
+//   channels:  channelInfos | channelInfosByDstRank | nvlsInfos                (rank-keyed maps of tables)
+//   tb maps:   threadblockSMChannelMap | threadblockProxyChannelMap | threadblockNvlsChannelMap
+//   ops:       operationTemplates, for each rank and threadblock a count followed by a flat array of
+//              Operation records in chunk units
+//
+// Rank-keyed maps are written as a count followed by (rank, value) pairs sorted by rank. Strings and vectors are
+// written as a u32 count followed by their elements.
+
+namespace {
+
+constexpr char BinaryPlanMagic[8] = {'M', 'S', 'C', 'C', 'L', 'P', 'L', 'N'};
+constexpr uint32_t BinaryPlanVersion = 3;
+constexpr uint32_t BinaryPlanFlagUsingPacket = 0x1;
+constexpr uint32_t BinaryPlanFlagInPlace = 0x2;
+
+static_assert(std::is_trivially_copyable_v<mscclpp::Operation>, "Operation is written to the binary plan as raw bytes");
+
+class PlanWriter {
+ public:
+  template <typename T>
+  void put(const T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    const char* ptr = reinterpret_cast<const char*>(&value);
+    buffer_.insert(buffer_.end(), ptr, ptr + sizeof(T));
+  }
+
+  void putBytes(const void* data, size_t size) {
+    const char* ptr = reinterpret_cast<const char*>(data);
+    buffer_.insert(buffer_.end(), ptr, ptr + size);
+  }
+
+  void putString(const std::string& str) {
+    put<uint32_t>(str.size());
+    putBytes(str.data(), str.size());
+  }
+
+  template <typename T, typename F>
+  void putRankMap(const std::unordered_map<int, T>& map, F&& putValue) {
+    std::vector<int> ranks;
+    for (const auto& [rank, _] : map) {
+      ranks.push_back(rank);
+    }
+    std::sort(ranks.begin(), ranks.end());
+    put<uint32_t>(ranks.size());
+    for (int rank : ranks) {
+      put<int32_t>(rank);
+      putValue(map.at(rank));
+    }
+  }
+
+  const std::vector<char>& buffer() const { return buffer_; }
+
+ private:
+  std::vector<char> buffer_;
+};
+
+class PlanReader {
+ public:
+  PlanReader(const char* data, size_t size) : cur_(data), end_(data + size) {}
+
+  template <typename T>
+  T get() {
+    static_assert(std::is_trivially_copyable_v<T>);
+    T value;
+    getBytes(&value, sizeof(T));
+    return value;
+  }
+
+  void getBytes(void* data, size_t size) {
+    if (size > static_cast<size_t>(end_ - cur_)) {
+      throw mscclpp::Error("Truncated binary execution plan", mscclpp::ErrorCode::ExecutorError);
+    }
+    std::memcpy(data, cur_, size);
+    cur_ += size;
+  }
+
+  std::string getString() {
+    uint32_t size = get<uint32_t>();
+    std::string str(size, '\0');
+    getBytes(str.data(), size);
+    return str;
+  }
+
+  template <typename T, typename F>
+  void getRankMap(std::unordered_map<int, T>& map, F&& getValue) {
+    uint32_t nRanks = get<uint32_t>();
+    for (uint32_t i = 0; i < nRanks; i++) {
+      int rank = get<int32_t>();
+      getValue(map[rank]);
+    }
+  }
+
+  bool atEnd() const { return cur_ == end_; }
+
+ private:
+  const char* cur_;
+  const char* end_;
+};
+
+// Read-only private mapping of a whole file, unmapped on destruction.
+class MappedFile {
+ public:
+  MappedFile(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw mscclpp::SysError("open " + path + " failed", errno);
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+      int err = errno;
+      ::close(fd);
+      throw mscclpp::SysError("fstat " + path + " failed", err);
+    }
+    size_ = st.st_size;
+    if (size_ > 0) {
+      void* addr = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+      if (addr == MAP_FAILED) {
+        int err = errno;
+        ::close(fd);
+        throw mscclpp::SysError("mmap " + path + " failed", err);
+      }
+      data_ = static_cast<const char*>(addr);
+    }
+    ::close(fd);
+  }
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile() {
+    if (data_ != nullptr) {
+      ::munmap(const_cast<char*>(data_), size_);
+    }
+  }
+
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+void putChannelInfos(PlanWriter& writer, const std::vector<mscclpp::ChannelInfo>& infos) {
+  writer.put<uint32_t>(infos.size());
+  for (const auto& info : infos) {
+    writer.put(info.srcBufferType);
+    writer.put(info.dstBufferType);
+    writer.put(info.channelType);
+    writer.put<uint32_t>(info.connectedPeers.size());
+    writer.putBytes(info.connectedPeers.data(), info.connectedPeers.size() * sizeof(int));
+  }
+}
+
+void getChannelInfos(PlanReader& reader, std::vector<mscclpp::ChannelInfo>& infos) {
+  infos.resize(reader.get<uint32_t>());
+  for (auto& info : infos) {
+    info.srcBufferType = reader.get<mscclpp::BufferType>();
+    info.dstBufferType = reader.get<mscclpp::BufferType>();
+    info.channelType = reader.get<mscclpp::ChannelType>();
+    info.connectedPeers.resize(reader.get<uint32_t>());
+    reader.getBytes(info.connectedPeers.data(), info.connectedPeers.size() * sizeof(int));
+  }
+}
+
+void putNvlsInfos(PlanWriter& writer, const std::vector<mscclpp::NvlsInfo>& infos) {
+  writer.put<uint32_t>(infos.size());
+  for (const auto& info : infos) {
+    writer.put(info.bufferType);
+    writer.put<uint64_t>(info.bufferSize);
+    writer.put<uint32_t>(info.ranks.size());
+    writer.putBytes(info.ranks.data(), info.ranks.size() * sizeof(int));
+  }
+}
+
+void getNvlsInfos(PlanReader& reader, std::vector<mscclpp::NvlsInfo>& infos) {
+  infos.resize(reader.get<uint32_t>());
+  for (auto& info : infos) {
+    info.bufferType = reader.get<mscclpp::BufferType>();
+    info.bufferSize = reader.get<uint64_t>();
+    info.ranks.resize(reader.get<uint32_t>());
+    reader.getBytes(info.ranks.data(), info.ranks.size() * sizeof(int));
+  }
+}
+
+using ThreadblockChannelMap = std::vector<std::vector<std::pair<int, mscclpp::ChannelKey>>>;
+
+void putThreadblockChannelMap(PlanWriter& writer, const ThreadblockChannelMap& map) {
+  writer.put<uint32_t>(map.size());
+  for (const auto& channels : map) {
+    writer.put<uint32_t>(channels.size());
+    for (const auto& [index, key] : channels) {
+      writer.put<int32_t>(index);
+      writer.put(key.srcBufferType);
+      writer.put(key.dstBufferType);
+      writer.put(key.channelType);
+    }
+  }
+}
+
+void getThreadblockChannelMap(PlanReader& reader, ThreadblockChannelMap& map) {
+  map.resize(reader.get<uint32_t>());
+  for (auto& channels : map) {
+    channels.resize(reader.get<uint32_t>());
+    for (auto& [index, key] : channels) {
+      index = reader.get<int32_t>();
+      key.srcBufferType = reader.get<mscclpp::BufferType>();
+      key.dstBufferType = reader.get<mscclpp::BufferType>();
+      key.channelType = reader.get<mscclpp::ChannelType>();
+    }
+  }
+}
+
+using OperationTemplates = std::vector<std::vector<mscclpp::Operation>>;
+
+void putOperationTemplates(PlanWriter& writer, const OperationTemplates& threadblocks) {
+  writer.put<uint32_t>(threadblocks.size());
+  for (const auto& ops : threadblocks) {
+    writer.put<uint32_t>(ops.size());
+    writer.putBytes(ops.data(), ops.size() * sizeof(mscclpp::Operation));
+  }
+}
+
+void getOperationTemplates(PlanReader& reader, OperationTemplates& threadblocks) {
+  threadblocks.resize(reader.get<uint32_t>());
+  for (auto& ops : threadblocks) {
+    ops.resize(reader.get<uint32_t>());
+    reader.getBytes(ops.data(), ops.size() * sizeof(mscclpp::Operation));
+  }
+}
+
+}  // namespace
+
+namespace mscclpp {
+
+bool isBinaryExecutionPlan(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  char magic[sizeof(BinaryPlanMagic)];
+  if (!file.read(magic, sizeof(magic))) {
+    return false;
+  }
+  return std::memcmp(magic, BinaryPlanMagic, sizeof(magic)) == 0;
+}
+
+void writeBinaryExecutionPlan(const CompiledExecutionPlan& plan, const std::string& path) {
+  PlanWriter writer;
+  writer.putBytes(BinaryPlanMagic, sizeof(BinaryPlanMagic));
+  writer.put<uint32_t>(BinaryPlanVersion);
+  writer.put<uint32_t>(sizeof(Operation));
+  uint32_t flags = 0;
+  if (plan.isUsingPacket) flags |= BinaryPlanFlagUsingPacket;
+  if (plan.isInPlace) flags |= BinaryPlanFlagInPlace;
+  writer.put<uint32_t>(flags);
+  writer.put<int32_t>(plan.nThreadsPerBlock);
+  writer.put<uint64_t>(plan.minMessageSize);
+  writer.put<uint64_t>(plan.maxMessageSize);
+  writer.put<int32_t>(plan.priority);
+  writer.putString(plan.name);
+  writer.putString(plan.collective);
+
+  auto putU32 = [&](uint32_t value) { writer.put<uint32_t>(value); };
+  writer.putRankMap(plan.inputChunks, putU32);
+  writer.putRankMap(plan.outputChunks, putU32);
+  writer.putRankMap(plan.scratchChunks, putU32);
+  writer.putRankMap(plan.chunkGroups, putU32);
+
+  auto putInfos = [&](const std::vector<ChannelInfo>& infos) { putChannelInfos(writer, infos); };
+  writer.putRankMap(plan.channelInfos, putInfos);
+  writer.putRankMap(plan.channelInfosByDstRank, putInfos);
+  writer.putRankMap(plan.nvlsInfos, [&](const std::vector<NvlsInfo>& infos) { putNvlsInfos(writer, infos); });
+
+  auto putMap = [&](const ThreadblockChannelMap& map) { putThreadblockChannelMap(writer, map); };
+  writer.putRankMap(plan.threadblockSMChannelMap, putMap);
+  writer.putRankMap(plan.threadblockProxyChannelMap, putMap);
+  writer.putRankMap(plan.threadblockNvlsChannelMap, putMap);
+
+  writer.putRankMap(plan.operationTemplates,
+                    [&](const OperationTemplates& threadblocks) { putOperationTemplates(writer, threadblocks); });
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file) {
+    throw Error("Failed to open " + path + " for writing", ErrorCode::InvalidUsage);
+  }
+  file.write(writer.buffer().data(), writer.buffer().size());
+  if (!file) {
+    throw Error("Failed to write " + path, ErrorCode::InternalError);
+  }
+}
+
+CompiledExecutionPlan readBinaryExecutionPlan(const std::string& path, bool metadataOnly) {
+  MappedFile file(path);
+  PlanReader reader(file.data(), file.size());
+  CompiledExecutionPlan plan;
+
+  char magic[sizeof(BinaryPlanMagic)];
+  reader.getBytes(magic, sizeof(magic));
+  if (std::memcmp(magic, BinaryPlanMagic, sizeof(magic)) != 0) {
+    throw Error(path + " is not a binary execution plan", ErrorCode::ExecutorError);
+  }
+  if (reader.get<uint32_t>() != BinaryPlanVersion) {
+    throw Error("Unsupported binary execution plan version", ErrorCode::ExecutorError);
+  }
+  if (reader.get<uint32_t>() != sizeof(Operation)) {
+    throw Error("Binary execution plan was compiled with a different operation layout", ErrorCode::ExecutorError);
+  }
+  uint32_t flags = reader.get<uint32_t>();
+  plan.isUsingPacket = flags & BinaryPlanFlagUsingPacket;
+  plan.isInPlace = flags & BinaryPlanFlagInPlace;
+  plan.nThreadsPerBlock = reader.get<int32_t>();
+  plan.minMessageSize = reader.get<uint64_t>();
+  plan.maxMessageSize = reader.get<uint64_t>();
+  plan.priority = reader.get<int32_t>();
+  plan.name = reader.getString();
+  plan.collective = reader.getString();
+  if (metadataOnly) {
+    return plan;
+  }
+
+  auto getU32 = [&](uint32_t& value) { value = reader.get<uint32_t>(); };
+  reader.getRankMap(plan.inputChunks, getU32);
+  reader.getRankMap(plan.outputChunks, getU32);
+  reader.getRankMap(plan.scratchChunks, getU32);
+  reader.getRankMap(plan.chunkGroups, getU32);
+
+  auto getInfos = [&](std::vector<ChannelInfo>& infos) { getChannelInfos(reader, infos); };
+  reader.getRankMap(plan.channelInfos, getInfos);
+  reader.getRankMap(plan.channelInfosByDstRank, getInfos);
+  reader.getRankMap(plan.nvlsInfos, [&](std::vector<NvlsInfo>& infos) { getNvlsInfos(reader, infos); });
+
+  auto getMap = [&](ThreadblockChannelMap& map) { getThreadblockChannelMap(reader, map); };
+  reader.getRankMap(plan.threadblockSMChannelMap, getMap);
+  reader.getRankMap(plan.threadblockProxyChannelMap, getMap);
+  reader.getRankMap(plan.threadblockNvlsChannelMap, getMap);
+
+  reader.getRankMap(plan.operationTemplates,
+                    [&](OperationTemplates& threadblocks) { getOperationTemplates(reader, threadblocks); });
+  if (!reader.atEnd()) {
+    throw Error("Trailing data in binary execution plan", ErrorCode::ExecutorError);
+  }
+
+  // channelCountMap is derived from the channel tables in the same way as the JSON loader does.
+  for (const auto& [rank, infos] : plan.channelInfos) {
+    for (const auto& info : infos) {
+      for (int peer : info.connectedPeers) {
+        plan.channelCountMap[{rank, info.channelType}][peer]++;
+      }
+    }
+  }
+  return plan;
+}
+
+MSCCLPP_API_CPP void compileExecutionPlan(const std::string& planPath, const std::string& outputPath) {
+  writeBinaryExecutionPlan(loadCompiledExecutionPlan(planPath), outputPath);
+}
+
+}  // namespace mscclpp
@@ -0,0 +1,246 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "execution_plan_effects.hpp"
+
+#include <map>
+
+namespace mscclpp {
+
+namespace {
+
+// MAX_DEVICE_SYNCERS of execution_kernel.hpp, the number of barriers that BARRIER operations can use.
+constexpr int NumDeviceSyncers = 16;
+
+template <typename Map>
+const typename Map::mapped_type& getOrEmpty(const Map& map, int rank) {
+  static const typename Map::mapped_type empty{};
+  auto it = map.find(rank);
+  return it == map.end() ? empty : it->second;
+}
+
+}  // namespace
+
+PlanEffects::PlanEffects(const CompiledExecutionPlan& plan)
+    : plan_(plan),
+      nRanks_(plan.operationTemplates.size()),
+      smChannels_(plan.operationTemplates.size()),
+      proxyChannels_(plan.operationTemplates.size()) {
+  for (int rank = 0; rank < nRanks_; rank++) {
+    for (ChannelType type : {ChannelType::SM, ChannelType::PROXY}) {
+      auto& channels = type == ChannelType::SM ? smChannels_[rank] : proxyChannels_[rank];
+      std::map<int, int> nChannelsToPeer;
+      for (const ChannelInfo& info : getOrEmpty(plan_.channelInfos, rank)) {
+        if (info.channelType != type) continue;
+        for (int peer : info.connectedPeers) {
+          bool valid = peer >= 0 && peer < nRanks_ && peer != rank;
+          channels.push_back({peer, info.srcBufferType, info.dstBufferType, valid ? nChannelsToPeer[peer]++ : 0});
+        }
+      }
+    }
+  }
+}
+
+const std::vector<PlanChannel>& PlanEffects::channels(int rank, ChannelType type) const {
+  return type == ChannelType::SM ? smChannels_.at(rank) : proxyChannels_.at(rank);
+}
+
+int PlanEffects::getChannel(int rank, int threadblock, ChannelType type, int index) const {
+  if (type != ChannelType::SM && type != ChannelType::PROXY) {
+    throw MalformedOperation{"needs an SM or proxy channel"};
+  }
+  bool sm = type == ChannelType::SM;
+  const auto& map = getOrEmpty(sm ? plan_.threadblockSMChannelMap : plan_.threadblockProxyChannelMap, rank);
+  const auto& channels = this->channels(rank, type);
+  if (threadblock >= static_cast<int>(map.size()) || index >= static_cast<int>(map[threadblock].size())) {
+    throw MalformedOperation{"the threadblock has no " + channelTypeToString(type) + " channel " +
+                             std::to_string(index)};
+  }
+  int channel = map[threadblock][index].first;
+  if (channel < 0 || channel >= static_cast<int>(channels.size())) {
+    throw MalformedOperation{"the " + channelTypeToString(type) + " channel " + std::to_string(index) +
+                             " of the threadblock is channel " + std::to_string(channel) + " of rank " +
+                             std::to_string(rank) + ", which does not exist"};
+  }
+  int peer = channels[channel].peer;
+  if (peer < 0 || peer >= nRanks_ || peer == rank) {
+    throw MalformedOperation{"the " + channelTypeToString(type) + " channel " + std::to_string(index) +
+                             " of the threadblock has no valid peer"};
+  }
+  return channel;
+}
+
+const NvlsInfo& PlanEffects::getNvlsChannel(int rank, int threadblock, int index) const {
+  const auto& map = getOrEmpty(plan_.threadblockNvlsChannelMap, rank);
+  const auto& infos = getOrEmpty(plan_.nvlsInfos, rank);
+  if (threadblock >= static_cast<int>(map.size()) || index >= static_cast<int>(map[threadblock].size()) ||
+      map[threadblock][index].first < 0 || map[threadblock][index].first >= static_cast<int>(infos.size())) {
+    throw MalformedOperation{"the threadblock has no NVLS channel " + std::to_string(index)};
+  }
+  return infos[map[threadblock][index].first];
+}
+
+OperationEffects PlanEffects::getEffects(int rank, int threadblock, const Operation& op) const {
+  OperationEffects effects;
+  auto access = [&](int target, BufferType type, uint64_t offset, uint64_t size, bool write, bool packet = false,
+                    int channel = -1) {
+    if (type != BufferType::INPUT && type != BufferType::OUTPUT && type != BufferType::SCRATCH) {
+      throw MalformedOperation{"accesses no buffer (buffer type " + std::to_string(static_cast<int>(type)) + ")"};
+    }
+    if (target < 0 || target >= nRanks_) {
+      throw MalformedOperation{"accesses rank " + std::to_string(target) + ", which is not in the plan"};
+    }
+    if (packet) {
+      // data and flag
+      offset *= 2;
+      size *= 2;
+    }
+    effects.accesses.push_back({target, type, offset, offset + size, write, packet, channel});
+  };
+  // The channel through which the operation accesses the memory of the peer. The local side of the transfer goes
+  // through the channel as well, so that a proxy channel can order it with the signals that follow.
+  auto channel = [&](ChannelType type, int index) { return getChannel(rank, threadblock, type, index); };
+  auto peerOf = [&](ChannelType type, int channel) -> const PlanChannel& { return channels(rank, type)[channel]; };
+  auto signal = [&](ChannelType type, int channel) {
+    const PlanChannel& ch = peerOf(type, channel);
+    effects.signals.emplace_back(ch.peer, rank, type, ch.pairIndex);
+  };
+  if (op.nInputs > MAX_CHANNEL_PER_OPERATION || op.nOutputs > MAX_CHANNEL_PER_OPERATION) {
+    throw MalformedOperation{"has more than " + std::to_string(MAX_CHANNEL_PER_OPERATION) + " inputs or outputs"};
+  }
+
+  switch (op.type) {
+    case OperationType::NOP:
+      break;
+    case OperationType::FLUSH:
+      for (int i = 0; i < op.nOutputs; i++) {
+        effects.flushes.push_back(channel(ChannelType::PROXY, op.outputChannelIndexes[i]));
+      }
+      break;
+    case OperationType::BARRIER:
+      if (op.deviceSyncerIndex >= NumDeviceSyncers) {
+        throw MalformedOperation{"barrier " + std::to_string(op.deviceSyncerIndex) + " does not exist"};
+      }
+      if (op.nThreadBlocks == 0 || op.nThreadBlocks > plan_.operationTemplates.at(rank).size()) {
+        throw MalformedOperation{"waits for " + std::to_string(op.nThreadBlocks) + " threadblocks, but rank " +
+                                 std::to_string(rank) + " has " +
+                                 std::to_string(plan_.operationTemplates.at(rank).size())};
+      }
+      break;
+    case OperationType::SIGNAL:
+      for (int i = 0; i < op.nOutputs; i++) {
+        signal(op.channelType, channel(op.channelType, op.outputChannelIndexes[i]));
+      }
+      break;
+    case OperationType::WAIT:
+      for (int i = 0; i < op.nInputs; i++) {
+        const PlanChannel& ch = peerOf(op.channelType, channel(op.channelType, op.inputChannelIndexes[i]));
+        effects.waits.emplace_back(rank, ch.peer, op.channelType, ch.pairIndex);
+      }
+      break;
+    case OperationType::PUT:
+    case OperationType::PUT_WITH_SIGNAL:
+    case OperationType::PUT_WITH_SIGNAL_AND_FLUSH:
+      for (int i = 0; i < op.nOutputs; i++) {
+        int c = channel(op.channelType, op.outputChannelIndexes[i]);
+        const PlanChannel& ch = peerOf(op.channelType, c);
+        access(rank, ch.srcBufferType, op.inputOffsets[i], op.size, false, false, c);
+        access(ch.peer, ch.dstBufferType, op.outputOffsets[i], op.size, true, false, c);
+        // handlePut ignores the signal and the flush of SM channels
+        if (op.type != OperationType::PUT && op.channelType == ChannelType::PROXY) {
+          signal(op.channelType, c);
+          if (op.type == OperationType::PUT_WITH_SIGNAL_AND_FLUSH) effects.flushes.push_back(c);
+        }
+      }
+      break;
+    case OperationType::GET:
+      for (int i = 0; i < op.nInputs; i++) {
+        int c = channel(ChannelType::SM, op.inputChannelIndexes[i]);
+        const PlanChannel& ch = peerOf(ChannelType::SM, c);
+        access(ch.peer, ch.dstBufferType, op.outputOffsets[i], op.size, false, false, c);
+        access(rank, ch.srcBufferType, op.inputOffsets[i], op.size, true, false, c);
+      }
+      break;
+    case OperationType::COPY:
+      access(rank, op.srcBufferType, op.srcOffset, op.size, false);
+      access(rank, op.dstBufferType, op.dstOffset, op.size, true);
+      break;
+    case OperationType::READ_REDUCE_COPY:
+    case OperationType::READ_REDUCE_COPY_SEND:
+      access(rank, op.srcBufferType, op.srcOffset, op.size, false);
+      for (int i = 0; i < op.nInputs; i++) {
+        int c = channel(ChannelType::SM, op.inputChannelIndexes[i]);
+        const PlanChannel& ch = peerOf(ChannelType::SM, c);
+        access(ch.peer, ch.dstBufferType, op.inputOffsets[i], op.size, false, false, c);
+      }
+      access(rank, op.dstBufferType, op.dstOffset, op.size, true);
+      if (op.type == OperationType::READ_REDUCE_COPY_SEND) {
+        for (int i = 0; i < op.nOutputs; i++) {
+          int c = channel(ChannelType::SM, op.outputChannelIndexes[i]);
+          const PlanChannel& ch = peerOf(ChannelType::SM, c);
+          access(ch.peer, ch.dstBufferType, op.outputOffsets[i], op.size, true, false, c);
+        }
+      }
+      break;
+    case OperationType::REDUCE_SEND:
+      access(rank, op.srcBufferType, op.srcOffset, op.size, false);
+      for (int i = 0; i < op.nOutputs; i++) {
+        access(rank, op.inputBufferType, op.inputOffsets[i], op.size, false);
+      }
+      access(rank, op.dstBufferType, op.dstOffset, op.size, true);
+      for (int i = 0; i < op.nOutputs; i++) {
+        int c = channel(ChannelType::SM, op.outputChannelIndexes[i]);
+        const PlanChannel& ch = peerOf(ChannelType::SM, c);
+        access(ch.peer, ch.dstBufferType, op.outputOffsets[i], op.size, true, false, c);
+      }
+      break;
+    case OperationType::PUT_PACKET:
+      for (int i = 0; i < op.nOutputs; i++) {
+        int c = channel(op.channelType, op.outputChannelIndexes[i]);
+        const PlanChannel& ch = peerOf(op.channelType, c);
+        // a proxy channel copies packets that are already in the local scratch buffer
+        access(rank, ch.srcBufferType, op.inputOffsets[i], op.size, false, op.channelType == ChannelType::PROXY, c);
+        access(ch.peer, ch.dstBufferType, op.outputOffsets[i], op.size, true, true, c);
+      }
+      break;
+    case OperationType::REDUCE_PACKET:
+    case OperationType::REDUCE_SEND_PACKET:
+      for (int i = 0; i < op.nInputs; i++) {
+        access(rank, BufferType::SCRATCH, op.inputOffsets[i], op.size, false, true);
+      }
+      access(rank, op.srcBufferType, op.srcOffset, op.size, false);
+      access(rank, op.dstBufferType, op.dstOffset, op.size, true);
+      if (op.type == OperationType::REDUCE_SEND_PACKET) {
+        for (int i = 0; i < op.nOutputs; i++) {
+          int c = channel(ChannelType::SM, op.outputChannelIndexes[i]);
+          const PlanChannel& ch = peerOf(ChannelType::SM, c);
+          access(ch.peer, ch.dstBufferType, op.outputOffsets[i], op.size, true, true, c);
+        }
+      }
+      break;
+    case OperationType::COPY_PACKET:
+      access(rank, op.srcBufferType, op.srcOffset, op.size, false, true);
+      access(rank, op.dstBufferType, op.dstOffset, op.size, true);
+      break;
+    case OperationType::TRANSFORM_TO_PACKET:
+      access(rank, op.srcBufferType, op.srcOffset, op.size, false);
+      access(rank, op.dstBufferType, op.dstOffset, op.size, true, true);
+      break;
+    case OperationType::MULTI_LOAD_REDUCE_STORE: {
+      const NvlsInfo& in = getNvlsChannel(rank, threadblock, op.nvlsInputIndex);
+      const NvlsInfo& out = getNvlsChannel(rank, threadblock, op.nvlsOutputIndex);
+      for (int peer : in.ranks) {
+        access(peer, in.bufferType, op.srcOffset, op.size, false);
+      }
+      for (int peer : out.ranks) {
+        access(peer, out.bufferType, op.dstOffset, op.size, true);
+      }
+      break;
+    }
+    default:
+      throw MalformedOperation{"executionKernel does not implement this operation"};
+  }
+  return effects;
+}
+
+}  // namespace mscclpp
@@ -0,0 +1,356 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "execution_plan_fusion.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <tuple>
+
+#include "execution_plan_effects.hpp"
+
+namespace mscclpp {
+
+namespace {
+
+constexpr int NumOperationTypes = static_cast<int>(OperationType::MULTI_LOAD_REDUCE_STORE) + 1;
+
+// Operations that do the same to every element of their ranges, so that two of them on adjacent ranges are one
+// operation on the union. REDUCE is not here, because executionKernel does not implement it.
+bool isElementwise(OperationType type) {
+  switch (type) {
+    case OperationType::PUT:
+    case OperationType::GET:
+    case OperationType::COPY:
+    case OperationType::PUT_PACKET:
+    case OperationType::COPY_PACKET:
+    case OperationType::TRANSFORM_TO_PACKET:
+    case OperationType::REDUCE_PACKET:
+    case OperationType::REDUCE_SEND:
+    case OperationType::REDUCE_SEND_PACKET:
+    case OperationType::READ_REDUCE_COPY:
+    case OperationType::READ_REDUCE_COPY_SEND:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// The offsets that executionKernel reads for an elementwise operation.
+struct OffsetUse {
+  int nInputOffsets;
+  int nOutputOffsets;
+  bool srcAndDst;
+};
+
+OffsetUse getOffsetUse(const Operation& op) {
+  switch (op.type) {
+    case OperationType::GET:
+      return {op.nInputs, op.nInputs, false};
+    case OperationType::PUT:
+    case OperationType::PUT_PACKET:
+      return {op.nOutputs, op.nOutputs, false};
+    case OperationType::REDUCE_SEND:
+      return {op.nOutputs, op.nOutputs, true};
+    default:
+      return {op.nInputs, op.nOutputs, true};
+  }
+}
+
+// The channels that SIGNAL, WAIT and FLUSH go through.
+const uint8_t* channelIndexes(const Operation& op, int& count) {
+  if (op.type == OperationType::WAIT) {
+    count = op.nInputs;
+    return op.inputChannelIndexes;
+  }
+  count = op.nOutputs;
+  return op.outputChannelIndexes;
+}
+
+std::vector<uint8_t> sortedChannels(const uint8_t* indexes, int count) {
+  std::vector<uint8_t> channels(indexes, indexes + count);
+  std::sort(channels.begin(), channels.end());
+  return channels;
+}
+
+bool areAliased(BufferType a, BufferType b) {
+  return (a == BufferType::INPUT || a == BufferType::OUTPUT) && (b == BufferType::INPUT || b == BufferType::OUTPUT);
+}
+
+class Fuser {
+ public:
+  Fuser(const CompiledExecutionPlan& plan, FusionStats& stats) : plan_(plan), effects_(plan), stats_(stats) {}
+
+  void run(int rank, int threadblock, std::vector<Operation>& ops);
+
+ private:
+  bool fuseLast(std::vector<Operation>& ops);
+  bool fuseSignal(Operation& first, const Operation& second) const;
+  bool fuseReduceSend(Operation& reduce, const Operation& put) const;
+  bool mergeChannels(Operation& first, const Operation& second) const;
+  bool mergeRanges(Operation& first, const Operation& second) const;
+  bool conflicts(const Operation& first, const Operation& second) const;
+
+  const CompiledExecutionPlan& plan_;
+  PlanEffects effects_;
+  FusionStats& stats_;
+  int rank_ = 0;
+  int threadblock_ = 0;
+};
+
+void Fuser::run(int rank, int threadblock, std::vector<Operation>& ops) {
+  rank_ = rank;
+  threadblock_ = threadblock;
+  std::vector<Operation> fused;
+  fused.reserve(ops.size());
+  for (const Operation& op : ops) {
+    // executionKernel syncs the threads after it copies the plan into shared memory
+    if (op.type == OperationType::NOP && fused.empty()) {
+      stats_.nopsRemoved++;
+      continue;
+    }
+    fused.push_back(op);
+    while (fuseLast(fused)) {
+    }
+  }
+  while (!fused.empty() && fused.back().type == OperationType::NOP) {
+    fused.pop_back();
+    stats_.nopsRemoved++;
+  }
+  ops = std::move(fused);
+}
+
+// Fuses the last operation of `ops` into the ones before it. Returns true if it did.
+bool Fuser::fuseLast(std::vector<Operation>& ops) {
+  size_t n = ops.size();
+  if (n < 2) return false;
+  Operation& first = ops[n - 2];
+  const Operation& second = ops[n - 1];
+  // BARRIER starts and ends with __syncthreads()
+  if (second.type == OperationType::NOP &&
+      (first.type == OperationType::NOP || first.type == OperationType::BARRIER)) {
+    ops.pop_back();
+    stats_.nopsRemoved++;
+    return true;
+  }
+  if (first.type == OperationType::NOP && second.type == OperationType::BARRIER) {
+    ops.erase(ops.end() - 2);
+    stats_.nopsRemoved++;
+    return true;
+  }
+  if (fuseSignal(first, second)) {
+    ops.pop_back();
+    stats_.signalsFused++;
+    return true;
+  }
+  // REDUCE_SEND writes the sum to the peers from the thread that computes it, so the NOP that makes the sum visible
+  // to the threads of the PUT is not needed either
+  if (fuseReduceSend(first, second)) {
+    ops.pop_back();
+    stats_.reducesFused++;
+    return true;
+  }
+  if (n >= 3 && first.type == OperationType::NOP && fuseReduceSend(ops[n - 3], second)) {
+    ops.resize(n - 2);
+    stats_.reducesFused++;
+    stats_.nopsRemoved++;
+    return true;
+  }
+  if (mergeChannels(first, second) || mergeRanges(first, second)) {
+    ops.pop_back();
+    stats_.operationsMerged++;
+    return true;
+  }
+  return false;
+}
+
+bool Fuser::fuseSignal(Operation& first, const Operation& second) const {
+  if (first.channelType != ChannelType::PROXY || first.nOutputs != second.nOutputs) return false;
+  bool putAndSignal = first.type == OperationType::PUT && second.type == OperationType::SIGNAL &&
+                      second.channelType == ChannelType::PROXY;
+  bool putWithSignalAndFlush = first.type == OperationType::PUT_WITH_SIGNAL && second.type == OperationType::FLUSH;
+  if (!putAndSignal && !putWithSignalAndFlush) return false;
+  if (sortedChannels(first.outputChannelIndexes, first.nOutputs) !=
+      sortedChannels(second.outputChannelIndexes, second.nOutputs)) {
+    return false;
+  }
+  first.type = putAndSignal ? OperationType::PUT_WITH_SIGNAL : OperationType::PUT_WITH_SIGNAL_AND_FLUSH;
+  return true;
+}
+
+bool Fuser::fuseReduceSend(Operation& reduce, const Operation& put) const {
+  // handleReduceSend adds as many inputs as it has outputs
+  if (reduce.type != OperationType::REDUCE || put.type != OperationType::PUT || put.channelType != ChannelType::SM ||
+      !reduce.hasSrcOffset || !reduce.hasDstOffset || reduce.inputOffsetsBufferType == BufferType::NONE ||
+      reduce.nInputs != put.nOutputs || reduce.size != put.size || put.nOutputs == 0 ||
+      put.inputOffsetsBufferType != reduce.dstBufferType || put.outputOffsetsBufferType == BufferType::NONE ||
+      put.nInputs < put.nOutputs) {
+    return false;
+  }
+  auto rankChannels = plan_.threadblockSMChannelMap.find(rank_);
+  if (rankChannels == plan_.threadblockSMChannelMap.end() ||
+      threadblock_ >= static_cast<int>(rankChannels->second.size())) {
+    return false;
+  }
+  const auto& channels = rankChannels->second[threadblock_];
+  for (int i = 0; i < put.nOutputs; i++) {
+    // the PUT sends what the REDUCE wrote
+    if (put.outputChannelIndexes[i] >= channels.size() ||
+        channels[put.outputChannelIndexes[i]].second.srcBufferType != reduce.dstBufferType ||
+        put.inputOffsets[i] != reduce.dstOffset) {
+      return false;
+    }
+  }
+  reduce.type = OperationType::REDUCE_SEND;
+  reduce.channelType = ChannelType::SM;
+  reduce.nOutputs = put.nOutputs;
+  std::copy(put.outputChannelIndexes, put.outputChannelIndexes + put.nOutputs, reduce.outputChannelIndexes);
+  std::copy(put.outputOffsets, put.outputOffsets + put.nOutputs, reduce.outputOffsets);
+  reduce.outputOffsetsBufferType = put.outputOffsetsBufferType;
+  return true;
+}
+
+bool Fuser::mergeChannels(Operation& first, const Operation& second) const {
+  if (first.type != second.type || first.channelType != second.channelType) return false;
+  if (first.type != OperationType::SIGNAL && first.type != OperationType::WAIT && first.type != OperationType::FLUSH) {
+    return false;
+  }
+  int nFirst, nSecond;
+  const uint8_t* firstChannels = channelIndexes(first, nFirst);
+  const uint8_t* secondChannels = channelIndexes(second, nSecond);
+  if (nFirst + nSecond > MAX_CHANNEL_PER_OPERATION) return false;
+  // each thread handles one channel, and two threads must not update the same semaphore
+  for (int i = 0; i < nSecond; i++) {
+    if (std::find(firstChannels, firstChannels + nFirst, secondChannels[i]) != firstChannels + nFirst) return false;
+  }
+  uint8_t* channels = first.type == OperationType::WAIT ? first.inputChannelIndexes : first.outputChannelIndexes;
+  std::copy(secondChannels, secondChannels + nSecond, channels + nFirst);
+  if (first.type == OperationType::WAIT) {
+    first.nInputs += nSecond;
+  } else {
+    first.nOutputs += nSecond;
+  }
+  return true;
+}
+
+bool Fuser::mergeRanges(Operation& first, const Operation& second) const {
+  if (first.type != second.type || !isElementwise(first.type) || first.size == 0 || second.size == 0) return false;
+  auto head = [](const Operation& op) {
+    return std::make_tuple(op.channelType, op.srcBufferType, op.dstBufferType, op.nInputs, op.nOutputs,
+                           op.inputOffsetsBufferType, op.outputOffsetsBufferType, op.hasSrcOffset, op.hasDstOffset);
+  };
+  if (head(first) != head(second)) return false;
+  // the channel indexes, or the buffer types of local inputs and outputs
+  int nIndexes = std::max({first.nInputs, first.nOutputs, static_cast<uint8_t>(1)});
+  if (!std::equal(first.inputChannelIndexes, first.inputChannelIndexes + nIndexes, second.inputChannelIndexes) ||
+      !std::equal(first.outputChannelIndexes, first.outputChannelIndexes + nIndexes, second.outputChannelIndexes)) {
+    return false;
+  }
+  // Chunks i to i + n and i + n to i + n + m are the bytes of chunks i to i + n + m at every message size, so every
+  // offset must continue the same offset of the first operation. An offset that ChunkLayout does not resolve stays a
+  // chunk index, which the kernel takes for bytes.
+  OffsetUse use = getOffsetUse(first);
+  auto follows = [&](uint32_t firstOffset, uint32_t secondOffset) { return secondOffset == firstOffset + first.size; };
+  if (use.srcAndDst && (!first.hasSrcOffset || !first.hasDstOffset || !follows(first.srcOffset, second.srcOffset) ||
+                        !follows(first.dstOffset, second.dstOffset))) {
+    return false;
+  }
+  if (use.nInputOffsets > 0 &&
+      (first.inputOffsetsBufferType == BufferType::NONE || use.nInputOffsets > first.nInputs)) {
+    return false;
+  }
+  if (use.nOutputOffsets > 0 &&
+      (first.outputOffsetsBufferType == BufferType::NONE || use.nOutputOffsets > first.nOutputs)) {
+    return false;
+  }
+  for (int i = 0; i < use.nInputOffsets; i++) {
+    if (!follows(first.inputOffsets[i], second.inputOffsets[i])) return false;
+  }
+  for (int i = 0; i < use.nOutputOffsets; i++) {
+    if (!follows(first.outputOffsets[i], second.outputOffsets[i])) return false;
+  }
+  if (conflicts(first, second)) return false;
+  first.size += second.size;
+  return true;
+}
+
+// Returns true if `second` may access bytes that `first` writes or the other way around. Each thread runs both
+// operations on the same elements in order, but the merged operation spreads the elements over the threads
+// differently. The offsets are chunk indexes, which order bytes like byte offsets. Packet offsets are not comparable
+// to data offsets, and the input and output of an in-place plan overlap in ways that chunk indexes do not show.
+bool Fuser::conflicts(const Operation& first, const Operation& second) const {
+  if (rank_ >= effects_.nRanks()) return true;
+  OperationEffects firstEffects, secondEffects;
+  try {
+    firstEffects = effects_.getEffects(rank_, threadblock_, first);
+    secondEffects = effects_.getEffects(rank_, threadblock_, second);
+  } catch (const MalformedOperation&) {
+    return true;
+  }
+  for (const MemoryAccess& a : firstEffects.accesses) {
+    for (const MemoryAccess& b : secondEffects.accesses) {
+      if (a.rank != b.rank || (!a.write && !b.write)) continue;
+      if (a.bufferType != b.bufferType) {
+        if (plan_.isInPlace && areAliased(a.bufferType, b.bufferType)) return true;
+        continue;
+      }
+      if (a.packet != b.packet || (a.begin < b.end && b.begin < a.end)) return true;
+    }
+  }
+  return false;
+}
+
+std::vector<uint64_t> countOperations(const CompiledExecutionPlan& plan) {
+  std::vector<uint64_t> counts(NumOperationTypes, 0);
+  for (const auto& [rank, threadblocks] : plan.operationTemplates) {
+    for (const auto& ops : threadblocks) {
+      for (const Operation& op : ops) counts[static_cast<int>(op.type)]++;
+    }
+  }
+  return counts;
+}
+
+uint64_t sum(const std::vector<uint64_t>& counts) {
+  uint64_t total = 0;
+  for (uint64_t count : counts) total += count;
+  return total;
+}
+
+}  // namespace
+
+FusionStats fuseOperations(CompiledExecutionPlan& plan) {
+  FusionStats stats;
+  stats.opCountsBefore = countOperations(plan);
+  Fuser fuser(plan, stats);
+  for (auto& [rank, threadblocks] : plan.operationTemplates) {
+    for (size_t threadblock = 0; threadblock < threadblocks.size(); threadblock++) {
+      fuser.run(rank, threadblock, threadblocks[threadblock]);
+    }
+  }
+  stats.opCountsAfter = countOperations(plan);
+  return stats;
+}
+
+void fuseOperationsFromEnv(CompiledExecutionPlan& plan) {
+  const char* enabled = std::getenv("MSCCLPP_EXECUTOR_FUSION");
+  if (enabled != nullptr && std::strcmp(enabled, "0") == 0) return;
+  FusionStats stats = fuseOperations(plan);
+  const char* dump = std::getenv("MSCCLPP_EXECUTOR_FUSION_DUMP");
+  if (dump == nullptr || std::strcmp(dump, "1") != 0) return;
+  std::ostringstream out;
+  out << "fused plan " << plan.name << ": " << sum(stats.opCountsBefore) << " -> " << sum(stats.opCountsAfter)
+      << " operations (" << stats.signalsFused << " signals fused, " << stats.reducesFused << " reduces fused, "
+      << stats.operationsMerged << " merged, " << stats.nopsRemoved << " NOPs removed)" << std::endl;
+  for (int type = 0; type < NumOperationTypes; type++) {
+    if (stats.opCountsBefore[type] == 0 && stats.opCountsAfter[type] == 0) continue;
+    out << "  " << std::left << std::setw(26) << operationTypeToString(static_cast<OperationType>(type)) << std::right
+        << std::setw(8) << stats.opCountsBefore[type] << " -> " << stats.opCountsAfter[type] << std::endl;
+  }
+  std::cout << out.str() << std::flush;
+}
+
+}  // namespace mscclpp
@@ -0,0 +1,538 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "execution_plan_validator.hpp"
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <tuple>
+
+#include "api.h"
+#include "execution_plan_effects.hpp"
+
+namespace mscclpp {
+
+namespace {
+
+// The message size that is checked if a plan declares no message size range.
+constexpr size_t DefaultMessageSize = 1 << 20;
+
+// MAX_DEVICE_SYNCERS of execution_kernel.hpp, the number of barriers that BARRIER operations can use.
+constexpr int NumDeviceSyncers = 16;
+
+struct Access : MemoryAccess {
+  int thread;
+  int op;
+};
+
+// A vector clock: clock[thread] is the number of operations of the thread that happen before a point of execution.
+using Clock = std::vector<uint32_t>;
+
+void join(Clock& clock, const Clock& other) {
+  for (size_t i = 0; i < clock.size(); i++) {
+    clock[i] = std::max(clock[i], other[i]);
+  }
+}
+
+class PlanValidator {
+ public:
+  explicit PlanValidator(const CompiledExecutionPlan& plan) : plan_(plan), effectsOf_(plan) {}
+
+  std::vector<PlanIssue> validate(const std::vector<size_t>& messageSizes) {
+    if (!checkRanks()) {
+      return issues_;
+    }
+    checkChannels();
+    checkChannelPairing();
+    checkOperations();
+    checkSemaphoreBalance();
+    bool deadlocked = !simulate();
+    std::vector<size_t> sizes = messageSizes.empty() ? getDeclaredMessageSizes() : messageSizes;
+    for (size_t messageSize : sizes) {
+      std::vector<Access> accesses = getAccesses(messageSize);
+      // the order of the operations is unknown past a deadlock
+      if (!deadlocked) {
+        checkRaces(accesses, messageSize);
+      }
+    }
+    return issues_;
+  }
+
+ private:
+  std::string where(int thread, int opIndex) const {
+    auto [rank, threadblock] = threads_[thread];
+    return "Rank " + std::to_string(rank) + " threadblock " + std::to_string(threadblock) + " operation " +
+           std::to_string(opIndex) + " (" + operationTypeToString(operations(thread)[opIndex].type) + "): ";
+  }
+
+  void addIssue(PlanIssueType type, int rank, int threadblock, int opIndex, const std::string& message) {
+    issues_.push_back({type, rank, threadblock, opIndex, message});
+  }
+
+  void addIssue(PlanIssueType type, int thread, int opIndex, const std::string& message) {
+    addIssue(type, threads_[thread].first, threads_[thread].second, opIndex, where(thread, opIndex) + message);
+  }
+
+  const std::vector<Operation>& operations(int thread) const {
+    auto [rank, threadblock] = threads_[thread];
+    return plan_.operationTemplates.at(rank)[threadblock];
+  }
+
+  template <typename Map>
+  static const typename Map::mapped_type& getOrEmpty(const Map& map, int rank) {
+    static const typename Map::mapped_type empty{};
+    auto it = map.find(rank);
+    return it == map.end() ? empty : it->second;
+  }
+
+  bool checkRanks() {
+    nRanks_ = plan_.operationTemplates.size();
+    for (int rank = 0; rank < nRanks_; rank++) {
+      if (plan_.operationTemplates.find(rank) == plan_.operationTemplates.end()) {
+        addIssue(PlanIssueType::Malformed, -1, -1, -1, "The ranks of the plan must be numbered from 0");
+        return false;
+      }
+    }
+    for (int rank = 0; rank < nRanks_; rank++) {
+      const auto& threadblocks = plan_.operationTemplates.at(rank);
+      for (size_t threadblock = 0; threadblock < threadblocks.size(); threadblock++) {
+        threads_.emplace_back(rank, threadblock);
+      }
+    }
+    return true;
+  }
+
+  void checkChannels() {
+    for (int rank = 0; rank < nRanks_; rank++) {
+      for (ChannelType type : {ChannelType::SM, ChannelType::PROXY}) {
+        for (const PlanChannel& ch : effectsOf_.channels(rank, type)) {
+          if (isPeer(rank, ch)) continue;
+          addIssue(PlanIssueType::Malformed, rank, -1, -1,
+                   "Rank " + std::to_string(rank) + " has a " + channelTypeToString(type) + " channel to rank " +
+                       std::to_string(ch.peer) + ", which is not a peer in the plan");
+        }
+      }
+    }
+  }
+
+  bool isPeer(int rank, const PlanChannel& ch) const { return ch.peer >= 0 && ch.peer < nRanks_ && ch.peer != rank; }
+
+  // The executor pairs the channels of two ranks by their index, and getUnpairedChannelInfos() fills in channels for
+  // the rank with fewer of them.
+  void checkChannelPairing() {
+    for (ChannelType type : {ChannelType::SM, ChannelType::PROXY}) {
+      std::vector<std::vector<int>> counts(nRanks_, std::vector<int>(nRanks_, 0));
+      for (int rank = 0; rank < nRanks_; rank++) {
+        for (const PlanChannel& ch : effectsOf_.channels(rank, type)) {
+          if (isPeer(rank, ch)) counts[rank][ch.peer]++;
+        }
+      }
+      for (int rank = 0; rank < nRanks_; rank++) {
+        for (int peer = rank + 1; peer < nRanks_; peer++) {
+          if (counts[rank][peer] == counts[peer][rank]) continue;
+          addIssue(PlanIssueType::UnpairedChannel, rank, -1, -1,
+                   "Rank " + std::to_string(rank) + " has " + std::to_string(counts[rank][peer]) + " " +
+                       channelTypeToString(type) + " channels to rank " + std::to_string(peer) + ", but rank " +
+                       std::to_string(peer) + " has " + std::to_string(counts[peer][rank]) + " to rank " +
+                       std::to_string(rank));
+        }
+      }
+    }
+
+    for (int rank = 0; rank < nRanks_; rank++) {
+      for (const NvlsInfo& info : getOrEmpty(plan_.nvlsInfos, rank)) {
+        for (int peer : info.ranks) {
+          std::string prefix =
+              "Rank " + std::to_string(rank) + " has an NVLS channel with rank " + std::to_string(peer);
+          if (peer < 0 || peer >= nRanks_) {
+            addIssue(PlanIssueType::Malformed, rank, -1, -1, prefix + ", which is not in the plan");
+            continue;
+          }
+          const auto& peerInfos = getOrEmpty(plan_.nvlsInfos, peer);
+          bool paired = std::any_of(peerInfos.begin(), peerInfos.end(), [&](const NvlsInfo& peerInfo) {
+            return peerInfo.ranks == info.ranks && peerInfo.bufferType == info.bufferType;
+          });
+          if (!paired) {
+            addIssue(PlanIssueType::UnpairedChannel, rank, -1, -1,
+                     prefix + ", but rank " + std::to_string(peer) + " has no NVLS channel with the same ranks");
+          }
+        }
+        if (std::find(info.ranks.begin(), info.ranks.end(), rank) == info.ranks.end()) {
+          addIssue(PlanIssueType::Malformed, rank, -1, -1,
+                   "Rank " + std::to_string(rank) + " has an NVLS channel that it is not part of");
+        }
+      }
+    }
+  }
+
+  // The effects of `op`, the operation `opIndex` of `thread`. The offsets and size of the accesses are only meaningful
+  // if `op` is resolved.
+  std::vector<Access> getAccesses(int thread, int opIndex, const Operation& op) const {
+    auto [rank, threadblock] = threads_[thread];
+    std::vector<Access> accesses;
+    for (const MemoryAccess& access : effectsOf_.getEffects(rank, threadblock, op).accesses) {
+      accesses.push_back({access, thread, opIndex});
+    }
+    return accesses;
+  }
+
+  // Finds the operations that the executor cannot run and collects the semaphore operations of the others.
+  void checkOperations() {
+    effects_.resize(threads_.size());
+    valid_.resize(threads_.size());
+    for (size_t thread = 0; thread < threads_.size(); thread++) {
+      const std::vector<Operation>& ops = operations(thread);
+      for (size_t i = 0; i < ops.size(); i++) {
+        try {
+          effects_[thread].push_back(effectsOf_.getEffects(threads_[thread].first, threads_[thread].second, ops[i]));
+          valid_[thread].push_back(true);
+        } catch (const MalformedOperation& e) {
+          addIssue(PlanIssueType::Malformed, thread, i, e.message);
+          effects_[thread].emplace_back();
+          valid_[thread].push_back(false);
+        }
+      }
+    }
+  }
+
+  std::string semaphoreToString(const SemaphoreKey& key) const {
+    auto [waiter, signaler, type, pairIndex] = key;
+    return "the semaphore of " + channelTypeToString(type) + " channel #" + std::to_string(pairIndex) +
+           " from rank " + std::to_string(signaler) + " to rank " + std::to_string(waiter);
+  }
+
+  void checkSemaphoreBalance() {
+    // [semaphore] = {signals, waits, first operation}
+    std::map<SemaphoreKey, std::tuple<int, int, int, int>> counts;
+    for (size_t thread = 0; thread < threads_.size(); thread++) {
+      for (size_t i = 0; i < effects_[thread].size(); i++) {
+        for (const SemaphoreKey& key : effects_[thread][i].signals) {
+          auto it = counts.try_emplace(key, 0, 0, thread, i).first;
+          std::get<0>(it->second)++;
+          signalsByThread_[key][thread]++;
+          totalSignals_[key]++;
+        }
+        for (const SemaphoreKey& key : effects_[thread][i].waits) {
+          auto it = counts.try_emplace(key, 0, 0, thread, i).first;
+          std::get<1>(it->second)++;
+        }
+      }
+    }
+    for (const auto& [key, count] : counts) {
+      auto [nSignals, nWaits, thread, opIndex] = count;
+      if (nSignals == nWaits) continue;
+      addIssue(PlanIssueType::UnbalancedSemaphore, thread, opIndex,
+               semaphoreToString(key) + " is signaled " + std::to_string(nSignals) + " times and waited on " +
+                   std::to_string(nWaits) + " times");
+    }
+  }
+
+  // Runs the semaphores and barriers of the plan on one schedule and records the vector clock of every operation.
+  // Returns false if some threadblocks never finish.
+  bool simulate() {
+    const size_t nThreads = threads_.size();
+    struct ThreadState {
+      size_t next = 0;
+      // whether the current operation took its semaphore tickets or arrived at its barrier
+      bool started = false;
+      std::vector<uint64_t> tickets;
+      uint32_t generation = 0;
+      Clock clock;
+    };
+    struct SemaphoreState {
+      uint64_t count = 0;
+      uint64_t nextTicket = 0;
+      // [thread] = the clocks of the signals of the thread, in order
+      std::map<int, std::vector<Clock>> signals;
+      // [thread] = the number of waits of the thread so far
+      std::map<int, uint32_t> waits;
+    };
+    struct BarrierState {
+      uint32_t count = 0;
+      Clock clock;
+      // [generation] = the joined clock of the threadblocks that arrived
+      std::vector<Clock> generations;
+    };
+    std::vector<ThreadState> states(nThreads);
+    std::map<SemaphoreKey, SemaphoreState> semaphores;
+    std::vector<std::vector<BarrierState>> barriers(nRanks_, std::vector<BarrierState>(NumDeviceSyncers));
+    epochs_.assign(nThreads, {});
+    for (size_t thread = 0; thread < nThreads; thread++) {
+      states[thread].clock.assign(nThreads, 0);
+      epochs_[thread].emplace_back(0, states[thread].clock);
+    }
+    auto acquire = [&](int thread, const Clock& clock) {
+      ThreadState& state = states[thread];
+      join(state.clock, clock);
+      epochs_[thread].emplace_back(state.next, state.clock);
+    };
+
+    auto step = [&](int thread) {
+      ThreadState& state = states[thread];
+      const std::vector<Operation>& ops = operations(thread);
+      if (state.next == ops.size()) return false;
+      const Operation& op = ops[state.next];
+      const OperationEffects& effects = effects_[thread][state.next];
+      Clock released = state.clock;
+      released[thread] = state.next + 1;
+      if (valid_[thread][state.next] && op.type == OperationType::BARRIER) {
+        BarrierState& barrier = barriers[threads_[thread].first][op.deviceSyncerIndex];
+        if (!state.started) {
+          state.started = true;
+          state.generation = barrier.generations.size();
+          if (barrier.count++ == 0) barrier.clock.assign(nThreads, 0);
+          join(barrier.clock, released);
+          if (barrier.count == op.nThreadBlocks) {
+            barrier.generations.push_back(barrier.clock);
+            barrier.count = 0;
+          }
+        }
+        if (state.generation >= barrier.generations.size()) return false;
+        acquire(thread, barrier.generations[state.generation]);
+      }
+      if (!effects.waits.empty()) {
+        if (!state.started) {
+          state.started = true;
+          state.tickets.clear();
+          for (const SemaphoreKey& key : effects.waits) {
+            state.tickets.push_back(++semaphores[key].nextTicket);
+          }
+        }
+        for (size_t i = 0; i < effects.waits.size(); i++) {
+          if (semaphores[effects.waits[i]].count < state.tickets[i]) return false;
+        }
+        Clock clock(nThreads, 0);
+        for (const SemaphoreKey& key : effects.waits) {
+          SemaphoreState& semaphore = semaphores[key];
+          // The m-th wait of a threadblock waits for at least m signals. Of those, all but the signals of other
+          // threadblocks come from a given threadblock, so its first (m - others) signals happen before.
+          uint32_t m = ++semaphore.waits[thread];
+          for (const auto& [signaler, clocks] : semaphore.signals) {
+            int64_t others = totalSignals_[key] - signalsByThread_[key][signaler];
+            int64_t n = std::min<int64_t>(clocks.size(), int64_t(m) - others);
+            if (n > 0) join(clock, clocks[n - 1]);
+          }
+        }
+        acquire(thread, clock);
+      }
+      for (const SemaphoreKey& key : effects.signals) {
+        SemaphoreState& semaphore = semaphores[key];
+        semaphore.count++;
+        semaphore.signals[thread].push_back(released);
+      }
+      state.started = false;
+      state.next++;
+      return true;
+    };
+
+    bool progress = true;
+    while (progress) {
+      progress = false;
+      for (size_t thread = 0; thread < nThreads; thread++) {
+        while (step(thread)) progress = true;
+      }
+    }
+
+    int blocked = 0, first = -1;
+    for (size_t thread = 0; thread < nThreads; thread++) {
+      if (states[thread].next < operations(thread).size()) {
+        if (blocked++ == 0) first = thread;
+      }
+    }
+    if (blocked == 0) return true;
+    addIssue(PlanIssueType::Deadlock, first, states[first].next,
+             "never completes, and " + std::to_string(blocked) + " threadblocks in total are blocked");
+    return false;
+  }
+
+  // Whether operation `a` of `threadA` happens before operation `b` of `threadB`.
+  bool happensBefore(int threadA, int a, int threadB, int b) const {
+    if (threadA == threadB) return a < b;
+    const auto& epochs = epochs_[threadB];
+    auto it = std::upper_bound(epochs.begin(), epochs.end(), b,
+                               [](int op, const std::pair<int, Clock>& epoch) { return op < epoch.first; });
+    return std::prev(it)->second[threadA] > static_cast<uint32_t>(a);
+  }
+
+  std::vector<size_t> getDeclaredMessageSizes() const {
+    std::vector<size_t> sizes;
+    if (plan_.minMessageSize > 0) {
+      sizes.push_back(plan_.minMessageSize);
+    }
+    // Like getMaxScratchBufferSize(), the exclusive maximum stands for the largest messages.
+    if (plan_.maxMessageSize != std::numeric_limits<uint64_t>::max()) {
+      sizes.push_back(plan_.maxMessageSize);
+    }
+    if (sizes.empty()) {
+      sizes.push_back(DefaultMessageSize);
+    }
+    return sizes;
+  }
+
+  // Returns the accesses of all operations at `messageSize` and checks that they are within the buffers.
+  std::vector<Access> getAccesses(size_t messageSize) {
+    auto [inputSize, outputSize] = plan_.getBufferSizes(messageSize);
+    const std::string atSize = "at message size " + std::to_string(inputSize) + ", ";
+
+    std::vector<size_t> scratchSizes(nRanks_, 0);
+    for (int rank = 0; rank < nRanks_; rank++) {
+      try {
+        scratchSizes[rank] = plan_.getScratchBufferSize(rank, inputSize, outputSize);
+      } catch (const std::exception& e) {
+        addIssue(PlanIssueType::OutOfBounds, rank, -1, -1,
+                 "Rank " + std::to_string(rank) + ": " + atSize + "the scratch buffer size is unknown: " + e.what());
+      }
+    }
+    auto getBufferSize = [&](int rank, BufferType type, bool packet) -> size_t {
+      switch (type) {
+        case BufferType::INPUT:
+          return inputSize;
+        case BufferType::OUTPUT:
+          return outputSize;
+        default:
+          // packets of one launch use one half of the scratch buffer
+          return packet ? scratchSizes[rank] / 2 : scratchSizes[rank];
+      }
+    };
+
+    std::vector<bool> laidOut(nRanks_, true);
+    for (int rank = 0; rank < nRanks_; rank++) {
+      try {
+        plan_.getChunkLayout(rank, inputSize, outputSize, 0, 0);
+      } catch (const std::exception& e) {
+        addIssue(PlanIssueType::OutOfBounds, rank, -1, -1,
+                 "Rank " + std::to_string(rank) + ": " + atSize + "the chunks cannot be laid out: " + e.what());
+        laidOut[rank] = false;
+      }
+    }
+
+    std::vector<Access> accesses;
+    for (size_t thread = 0; thread < threads_.size(); thread++) {
+      const int rank = threads_[thread].first;
+      const std::vector<Operation>& ops = operations(thread);
+      for (size_t i = 0; i < ops.size() && laidOut[rank]; i++) {
+        if (!valid_[thread][i]) continue;
+        std::vector<Access> opAccesses;
+        try {
+          opAccesses = getAccesses(thread, i, plan_.resolveOperation(rank, ops[i], inputSize, outputSize, 0, 0));
+        } catch (const std::exception& e) {
+          addIssue(PlanIssueType::OutOfBounds, thread, i,
+                   atSize + "the chunks of the operation cannot be laid out: " + e.what());
+          continue;
+        }
+        for (const Access& access : opAccesses) {
+          size_t bufferSize = getBufferSize(access.rank, access.bufferType, access.packet);
+          if (access.end <= bufferSize) continue;
+          addIssue(PlanIssueType::OutOfBounds, thread, i,
+                   atSize + "bytes [" + std::to_string(access.begin) + ", " + std::to_string(access.end) +
+                       ") are out of the " + bufferTypeToString(access.bufferType) + " buffer of rank " +
+                       std::to_string(access.rank) + " (" + std::to_string(bufferSize) +
+                       (access.packet ? " bytes of packets)" : " bytes)"));
+          break;
+        }
+        accesses.insert(accesses.end(), opAccesses.begin(), opAccesses.end());
+      }
+    }
+    return accesses;
+  }
+
+  std::string describe(const Access& access) const {
+    return std::string(access.write ? "writes" : "reads") + " bytes [" + std::to_string(access.begin) + ", " +
+           std::to_string(access.end) + ") of the " + bufferTypeToString(access.bufferType) + " buffer of rank " +
+           std::to_string(access.rank) + (access.packet ? " as packets" : "");
+  }
+
+  void checkRaces(std::vector<Access>& accesses, size_t messageSize) {
+    // the input and output buffers are the same memory for an in-place plan
+    auto getBuffer = [&](const Access& access) {
+      bool aliased = plan_.isInPlace && access.bufferType == BufferType::OUTPUT;
+      return std::make_pair(access.rank, aliased ? BufferType::INPUT : access.bufferType);
+    };
+    std::sort(accesses.begin(), accesses.end(), [&](const Access& a, const Access& b) {
+      return std::make_pair(getBuffer(a), a.begin) < std::make_pair(getBuffer(b), b.begin);
+    });
+    std::vector<const Access*> active;
+    for (size_t i = 0; i < accesses.size(); i++) {
+      const Access& access = accesses[i];
+      if (i > 0 && getBuffer(accesses[i - 1]) != getBuffer(access)) {
+        active.clear();
+      }
+      active.erase(std::remove_if(active.begin(), active.end(),
+                                  [&](const Access* other) { return other->end <= access.begin; }),
+                   active.end());
+      for (const Access* other : active) {
+        if (other->thread == access.thread || !(other->write || access.write)) continue;
+        // a packet read waits for the flags of the packet write
+        if (other->packet && access.packet && other->write != access.write) continue;
+        if (happensBefore(other->thread, other->op, access.thread, access.op) ||
+            happensBefore(access.thread, access.op, other->thread, other->op)) {
+          continue;
+        }
+        const Access* first = other;
+        const Access* second = &access;
+        if (std::make_pair(first->thread, first->op) > std::make_pair(second->thread, second->op)) {
+          std::swap(first, second);
+        }
+        if (!races_.emplace(first->thread, first->op, second->thread, second->op).second) continue;
+        auto [rank, threadblock] = threads_[second->thread];
+        addIssue(PlanIssueType::Race, first->thread, first->op,
+                 describe(*first) + ", which rank " + std::to_string(rank) + " threadblock " +
+                     std::to_string(threadblock) + " operation " + std::to_string(second->op) + " (" +
+                     operationTypeToString(operations(second->thread)[second->op].type) + ") " + describe(*second) +
+                     " at message size " + std::to_string(messageSize) + ", with no barrier or semaphore in between");
+      }
+      if (access.begin < access.end) {
+        active.push_back(&access);
+      }
+    }
+  }
+
+  const CompiledExecutionPlan& plan_;
+  int nRanks_ = 0;
+  // [thread] = {rank, threadblock}
+  std::vector<std::pair<int, int>> threads_;
+  PlanEffects effectsOf_;
+  // [thread][operation]
+  std::vector<std::vector<OperationEffects>> effects_;
+  std::vector<std::vector<bool>> valid_;
+  std::map<SemaphoreKey, std::map<int, int64_t>> signalsByThread_;
+  std::map<SemaphoreKey, int64_t> totalSignals_;
+  // [thread] = {first operation, clock} for each point where the thread acquires a barrier or semaphore
+  std::vector<std::vector<std::pair<int, Clock>>> epochs_;
+  std::set<std::tuple<int, int, int, int>> races_;
+  std::vector<PlanIssue> issues_;
+};
+
+}  // namespace
+
+std::string planIssueTypeToString(PlanIssueType type) {
+  switch (type) {
+    case PlanIssueType::Malformed:
+      return "Malformed";
+    case PlanIssueType::UnpairedChannel:
+      return "UnpairedChannel";
+    case PlanIssueType::UnbalancedSemaphore:
+      return "UnbalancedSemaphore";
+    case PlanIssueType::Deadlock:
+      return "Deadlock";
+    case PlanIssueType::OutOfBounds:
+      return "OutOfBounds";
+    case PlanIssueType::Race:
+      return "Race";
+    default:
+      return "Unknown";
+  }
+}
+
+std::vector<PlanIssue> validateExecutionPlan(const CompiledExecutionPlan& plan,
+                                             const std::vector<size_t>& messageSizes) {
+  return PlanValidator(plan).validate(messageSizes);
+}
+
+MSCCLPP_API_CPP std::vector<PlanIssue> validateExecutionPlan(const std::string& planPath,
+                                                             const std::vector<size_t>& messageSizes) {
+  return validateExecutionPlan(loadCompiledExecutionPlan(planPath), messageSizes);
+}
+
+}  // namespace mscclpp
@@ -0,0 +1,703 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "execution_simulator.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <map>
+#include <mscclpp/errors.hpp>
+#include <queue>
+
+#include "execution_plan_effects.hpp"
+
+namespace mscclpp {
+
+namespace {
+
+// Events closer than this, in microseconds, happen at the same time.
+constexpr double Epsilon = 1e-9;
+
+constexpr double Infinity = std::numeric_limits<double>::infinity();
+
+// memory, and an egress and an ingress for every other link type
+constexpr int NumResourcesPerRank = 1 + 2 * (NumLinkTypes - 1);
+
+// from GB/s
+double toBytesPerUs(double bandwidth) { return bandwidth * 1e3; }
+
+class Simulator {
+ public:
+  Simulator(const CompiledExecutionPlan& plan, size_t inputSize, size_t outputSize, const SimulationOptions& options)
+      : plan_(plan), options_(options), effectsOf_(plan), nRanks_(plan.operationTemplates.size()) {
+    if (options_.nRanksPerNode <= 0) {
+      throw Error("nRanksPerNode must be positive", ErrorCode::InvalidUsage);
+    }
+    for (int rank = 0; rank < nRanks_; rank++) {
+      if (plan_.operationTemplates.find(rank) == plan_.operationTemplates.end()) {
+        throw Error("The ranks of the plan must be numbered from 0", ErrorCode::ExecutorError);
+      }
+    }
+    for (int rank = 0; rank < nRanks_; rank++) {
+      const auto& threadblocks = plan_.operationTemplates.at(rank);
+      for (size_t threadblock = 0; threadblock < threadblocks.size(); threadblock++) {
+        Thread thread;
+        thread.rank = rank;
+        thread.threadblock = threadblock;
+        thread.firstOp = ops_.size();
+        threads_.push_back(thread);
+        for (size_t i = 0; i < threadblocks[threadblock].size(); i++) {
+          addOperation(threads_.size() - 1, i, inputSize, outputSize);
+        }
+      }
+    }
+    findPacketWriters();
+    capacities_.resize(nRanks_ * NumResourcesPerRank);
+    for (int rank = 0; rank < nRanks_; rank++) {
+      for (int type = 0; type < NumLinkTypes; type++) {
+        double capacity = toBytesPerUs(options_.links.get(static_cast<LinkType>(type)).bandwidth);
+        capacities_[getResource(rank, static_cast<LinkType>(type), false)] = capacity;
+        capacities_[getResource(rank, static_cast<LinkType>(type), true)] = capacity;
+      }
+    }
+  }
+
+  SimulationResult run() {
+    now_ = options_.launchUs;
+    for (size_t thread = 0; thread < threads_.size(); thread++) {
+      startOperation(thread);
+    }
+    while (true) {
+      while (!events_.empty() && events_.top().time <= now_ + Epsilon) {
+        Event event = events_.top();
+        events_.pop();
+        event.action();
+      }
+      retryBlocked();
+      if (!events_.empty() && events_.top().time <= now_ + Epsilon) continue;
+      double next = events_.empty() ? Infinity : events_.top().time;
+      updateRates();
+      for (const Flow& flow : flows_) {
+        next = std::min(next, now_ + flow.remaining / flow.rate);
+      }
+      if (next == Infinity) break;
+      advanceFlows(next - now_);
+      now_ = next;
+    }
+    for (const Thread& thread : threads_) {
+      if (thread.phase == Phase::Done) continue;
+      throw Error(where(thread.firstOp + thread.next) + "never completes, so the plan deadlocks",
+                  ErrorCode::ExecutorError);
+    }
+    return getResult();
+  }
+
+ private:
+  enum class Phase {
+    // waiting for semaphores, a barrier, packets or proxy flushes before running the operation
+    Blocked,
+    Running,
+    // waiting for the proxy to finish the transfers of PUT_WITH_SIGNAL_AND_FLUSH
+    Flushing,
+    Done,
+  };
+
+  struct Thread {
+    int rank;
+    int threadblock;
+    // the index of the first operation of the threadblock in ops_
+    int firstOp;
+    size_t next = 0;
+    Phase phase = Phase::Blocked;
+    // for WAIT, the number of signals that each semaphore must have received
+    std::vector<uint64_t> tickets;
+    // for BARRIER, the generation of the barrier that the threadblock arrived at
+    size_t generation = 0;
+  };
+
+  struct OperationState {
+    Operation op = {};
+    OperationEffects effects;
+    SimulatedOperation record;
+    bool proxy = false;
+    // the operation whose end or completion released this one, or -1
+    int predecessor = -1;
+    // proxy transfers and signals that did not land yet
+    int pendingParts = 0;
+    bool released = false;
+    bool completed = false;
+    double firstTransferUs = Infinity;
+    double lastTransferUs = 0;
+    // the operations that write the packets that this one reads
+    std::vector<int> packetWriters;
+  };
+
+  struct Event {
+    double time;
+    uint64_t seq;
+    std::function<void()> action;
+  };
+
+  struct Later {
+    bool operator()(const Event& a, const Event& b) const {
+      return a.time != b.time ? a.time > b.time : a.seq > b.seq;
+    }
+  };
+
+  // A transfer that progresses at the rate of its most contended resource.
+  struct Flow {
+    // {resource, bytes}
+    std::vector<std::pair<int, double>> demands;
+    // the bytes per microsecond of all demands together, such as the bandwidth of a threadblock
+    double maxRate;
+    double bytes;
+    // the fraction of the transfer that is left
+    double remaining = 1.0;
+    // the fraction per microsecond
+    double rate = 0.0;
+    std::function<void()> done;
+  };
+
+  struct ProxyRequest {
+    int op;
+    int channel;
+    bool signal;
+    SemaphoreKey semaphore;
+    std::vector<std::pair<int, double>> demands;
+    double latencyUs;
+    double readyUs;
+  };
+
+  struct ProxyChannel {
+    // requests that the proxy has posted, in order
+    std::deque<ProxyRequest> posted;
+    bool busy = false;
+    // requests that did not land yet
+    int outstanding = 0;
+    int lastOp = -1;
+    double lastLandedUs = 0;
+  };
+
+  struct Semaphore {
+    uint64_t nextTicket = 0;
+    // {time, operation} of every signal that landed, in order
+    std::vector<std::pair<double, int>> signals;
+  };
+
+  struct Barrier {
+    uint32_t count = 0;
+    size_t generations = 0;
+    int lastOp = -1;
+    // [generation] = the last operation that arrived
+    std::vector<int> released;
+  };
+
+  std::string where(int opIndex) const {
+    const SimulatedOperation& record = ops_[opIndex].record;
+    return "Rank " + std::to_string(record.rank) + " threadblock " + std::to_string(record.threadblock) +
+           " operation " + std::to_string(record.index) + " (" + operationTypeToString(record.type) + "): ";
+  }
+
+  void addOperation(int thread, int index, size_t inputSize, size_t outputSize) {
+    const Thread& t = threads_[thread];
+    OperationState state;
+    const Operation& op = plan_.operationTemplates.at(t.rank)[t.threadblock][index];
+    state.record = {t.rank, t.threadblock, index, op.type, 0, 0, 0, 0, {}, {}};
+    ops_.push_back(std::move(state));
+    OperationState& s = ops_.back();
+    try {
+      s.op = plan_.resolveOperation(t.rank, op, inputSize, outputSize, 0, 0);
+      s.effects = effectsOf_.getEffects(t.rank, t.threadblock, s.op);
+    } catch (const MalformedOperation& e) {
+      throw Error(where(ops_.size() - 1) + e.message, ErrorCode::ExecutorError);
+    } catch (const Error& e) {
+      throw Error(where(ops_.size() - 1) + e.what(), ErrorCode::ExecutorError);
+    }
+    switch (op.type) {
+      case OperationType::PUT:
+      case OperationType::PUT_WITH_SIGNAL:
+      case OperationType::PUT_WITH_SIGNAL_AND_FLUSH:
+      case OperationType::PUT_PACKET:
+      case OperationType::SIGNAL:
+        s.proxy = op.channelType == ChannelType::PROXY;
+        break;
+      default:
+        s.proxy = false;
+    }
+    if (op.type == OperationType::MULTI_LOAD_REDUCE_STORE) {
+      std::map<int, double> demands;
+      s.record.bytes[static_cast<int>(LinkType::NVLS)] = addNvlsDemands(t.rank, s.effects, demands);
+      return;
+    }
+    for (const MemoryAccess& access : s.effects.accesses) {
+      s.record.bytes[static_cast<int>(getLinkType(t.rank, access.rank))] += access.end - access.begin;
+    }
+  }
+
+  // Packet reads wait for all writes of the same bytes, which a plan makes once per launch.
+  void findPacketWriters() {
+    std::map<std::pair<int, BufferType>, std::vector<std::pair<const MemoryAccess*, int>>> writes;
+    for (size_t i = 0; i < ops_.size(); i++) {
+      for (const MemoryAccess& access : ops_[i].effects.accesses) {
+        if (access.packet && access.write) writes[{access.rank, access.bufferType}].emplace_back(&access, i);
+      }
+    }
+    for (size_t i = 0; i < ops_.size(); i++) {
+      std::vector<int>& writers = ops_[i].packetWriters;
+      for (const MemoryAccess& access : ops_[i].effects.accesses) {
+        if (!access.packet || access.write) continue;
+        for (auto [write, op] : writes[{access.rank, access.bufferType}]) {
+          if (op != static_cast<int>(i) && write->begin < access.end && access.begin < write->end) {
+            writers.push_back(op);
+          }
+        }
+      }
+      std::sort(writers.begin(), writers.end());
+      writers.erase(std::unique(writers.begin(), writers.end()), writers.end());
+    }
+  }
+
+  LinkType getLinkType(int rank, int peer) const {
+    if (rank == peer) return LinkType::Memory;
+    if (rank / options_.nRanksPerNode != peer / options_.nRanksPerNode) return LinkType::IB;
+    return options_.links.pcieWithinNode ? LinkType::PCIe : LinkType::NVLink;
+  }
+
+  int getResource(int rank, LinkType type, bool ingress) const {
+    int index = type == LinkType::Memory ? 0 : 1 + 2 * (static_cast<int>(type) - 1) + (ingress ? 1 : 0);
+    return rank * NumResourcesPerRank + index;
+  }
+
+  // The loads that `access` of an operation of `rank` puts on the resources that it crosses.
+  void addDemands(int rank, const MemoryAccess& access, std::map<int, double>& demands) const {
+    double bytes = access.end - access.begin;
+    LinkType link = getLinkType(rank, access.rank);
+    if (link == LinkType::Memory) {
+      demands[getResource(rank, link, false)] += bytes;
+      return;
+    }
+    int from = access.write ? rank : access.rank;
+    int to = access.write ? access.rank : rank;
+    demands[getResource(from, link, false)] += bytes;
+    demands[getResource(to, link, true)] += bytes;
+  }
+
+  // The switch reduces what MULTI_LOAD_REDUCE_STORE loads from the ranks of its group and multicasts what it stores,
+  // so the issuing rank receives and sends each byte once. Returns the bytes that the issuing rank receives and sends.
+  double addNvlsDemands(int rank, const OperationEffects& effects, std::map<int, double>& demands) const {
+    double loaded = 0, stored = 0;
+    for (const MemoryAccess& access : effects.accesses) {
+      double bytes = access.end - access.begin;
+      if (access.write) {
+        stored = std::max(stored, bytes);
+        demands[getResource(access.rank, LinkType::NVLS, true)] += bytes;
+      } else {
+        loaded = std::max(loaded, bytes);
+        demands[getResource(access.rank, LinkType::NVLS, false)] += bytes;
+      }
+    }
+    demands[getResource(rank, LinkType::NVLS, true)] += loaded;
+    demands[getResource(rank, LinkType::NVLS, false)] += stored;
+    return loaded + stored;
+  }
+
+  double getLatency(int rank, int peer) const { return options_.links.get(getLinkType(rank, peer)).latencyUs; }
+
+  void at(double time, std::function<void()> action) { events_.push({time, nextSeq_++, std::move(action)}); }
+
+  void startFlow(int op, const std::map<int, double>& demands, double maxRate, std::function<void()> done) {
+    Flow flow;
+    flow.demands.assign(demands.begin(), demands.end());
+    flow.maxRate = maxRate;
+    flow.bytes = 0;
+    for (const auto& demand : demands) flow.bytes += demand.second;
+    OperationState& state = ops_[op];
+    state.firstTransferUs = std::min(state.firstTransferUs, now_);
+    flow.done = [this, op, done = std::move(done)]() {
+      ops_[op].lastTransferUs = std::max(ops_[op].lastTransferUs, now_);
+      done();
+    };
+    if (flow.bytes == 0) {
+      at(now_, flow.done);
+      return;
+    }
+    flows_.push_back(std::move(flow));
+  }
+
+  void updateRates() {
+    std::vector<int> nFlows(capacities_.size(), 0);
+    for (const Flow& flow : flows_) {
+      for (const auto& demand : flow.demands) nFlows[demand.first]++;
+    }
+    for (Flow& flow : flows_) {
+      flow.rate = flow.maxRate / flow.bytes;
+      for (const auto& [resource, bytes] : flow.demands) {
+        if (bytes > 0) flow.rate = std::min(flow.rate, capacities_[resource] / nFlows[resource] / bytes);
+      }
+    }
+  }
+
+  void advanceFlows(double duration) {
+    std::vector<std::function<void()>> done;
+    for (auto it = flows_.begin(); it != flows_.end();) {
+      it->remaining -= it->rate * duration;
+      if (it->remaining <= it->rate * Epsilon) {
+        done.push_back(std::move(it->done));
+        it = flows_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    for (auto& action : done) at(now_ + duration, std::move(action));
+  }
+
+  void startOperation(int thread) {
+    Thread& t = threads_[thread];
+    const auto& ops = plan_.operationTemplates.at(t.rank)[t.threadblock];
+    if (t.next == ops.size()) {
+      t.phase = Phase::Done;
+      return;
+    }
+    int index = t.firstOp + t.next;
+    OperationState& state = ops_[index];
+    state.record.startUs = now_;
+    state.predecessor = t.next > 0 ? index - 1 : -1;
+    t.phase = Phase::Blocked;
+    if (state.op.type == OperationType::BARRIER) {
+      Barrier& barrier = barriers_[{t.rank, state.op.deviceSyncerIndex}];
+      t.generation = barrier.generations;
+      barrier.lastOp = index;
+      if (++barrier.count == state.op.nThreadBlocks) {
+        barrier.count = 0;
+        barrier.generations++;
+        at(now_ + options_.barrierUs, [&barrier, index]() { barrier.released.push_back(index); });
+      }
+    }
+    t.tickets.clear();
+    for (const SemaphoreKey& key : state.effects.waits) {
+      t.tickets.push_back(++semaphores_[key].nextTicket);
+    }
+    tryRun(thread);
+  }
+
+  // Runs the next operation of `thread` if what it waits for has happened.
+  void tryRun(int thread) {
+    Thread& t = threads_[thread];
+    int index = t.firstOp + t.next;
+    OperationState& state = ops_[index];
+    double readyUs = -Infinity;
+    int dependency = -1;
+    auto after = [&](double time, int op) {
+      if (time > readyUs) {
+        readyUs = time;
+        dependency = op;
+      }
+    };
+    if (state.op.type == OperationType::BARRIER) {
+      const Barrier& barrier = barriers_[{t.rank, state.op.deviceSyncerIndex}];
+      if (t.generation >= barrier.released.size()) return;
+      after(now_, barrier.released[t.generation]);
+    }
+    for (size_t i = 0; i < state.effects.waits.size(); i++) {
+      const Semaphore& semaphore = semaphores_[state.effects.waits[i]];
+      if (semaphore.signals.size() < t.tickets[i]) return;
+      auto [time, op] = semaphore.signals[t.tickets[i] - 1];
+      after(time, op);
+    }
+    for (int writer : state.packetWriters) {
+      if (!ops_[writer].completed) return;
+      after(ops_[writer].record.completeUs, writer);
+    }
+    if (state.op.type == OperationType::FLUSH) {
+      for (int channel : state.effects.flushes) {
+        const ProxyChannel& ch = proxyChannels_[{t.rank, channel}];
+        if (ch.outstanding > 0) return;
+        if (ch.lastOp >= 0) after(ch.lastLandedUs, ch.lastOp);
+      }
+    }
+    state.record.waitUs = now_ - state.record.startUs;
+    if (state.record.waitUs > Epsilon && dependency >= 0) state.predecessor = dependency;
+    t.phase = Phase::Running;
+    at(now_ + options_.operationUs, [this, thread]() { runOperation(thread); });
+  }
+
+  void retryBlocked() {
+    for (size_t thread = 0; thread < threads_.size(); thread++) {
+      Thread& t = threads_[thread];
+      if (t.phase == Phase::Blocked) {
+        tryRun(thread);
+      } else if (t.phase == Phase::Flushing && isFlushed(thread)) {
+        endOperation(thread);
+      }
+    }
+  }
+
+  bool isFlushed(int thread) {
+    const Thread& t = threads_[thread];
+    for (int channel : ops_[t.firstOp + t.next].effects.flushes) {
+      if (proxyChannels_[{t.rank, channel}].outstanding > 0) return false;
+    }
+    return true;
+  }
+
+  void runOperation(int thread) {
+    Thread& t = threads_[thread];
+    int index = t.firstOp + t.next;
+    OperationState& state = ops_[index];
+    if (state.proxy) {
+      postToProxy(thread);
+      if (state.op.type == OperationType::PUT_WITH_SIGNAL_AND_FLUSH) {
+        t.phase = Phase::Flushing;
+        return;
+      }
+      endOperation(thread);
+      return;
+    }
+    if (state.op.type == OperationType::SIGNAL) {
+      for (const SemaphoreKey& key : state.effects.signals) {
+        state.pendingParts++;
+        at(now_ + getLatency(t.rank, std::get<0>(key)), [this, key, index]() { landSignal(key, index); });
+      }
+      endOperation(thread);
+      return;
+    }
+    if (state.effects.accesses.empty()) {
+      endOperation(thread);
+      return;
+    }
+
+    std::map<int, double> demands;
+    double latencyUs = 0;
+    if (state.op.type == OperationType::MULTI_LOAD_REDUCE_STORE) {
+      addNvlsDemands(t.rank, state.effects, demands);
+      latencyUs = options_.links.nvls.latencyUs;
+    } else {
+      for (const MemoryAccess& access : state.effects.accesses) {
+        addDemands(t.rank, access, demands);
+        latencyUs = std::max(latencyUs, getLatency(t.rank, access.rank));
+      }
+    }
+    double maxRate = toBytesPerUs(options_.threadblockBandwidth);
+    bool packets = std::any_of(state.effects.accesses.begin(), state.effects.accesses.end(),
+                               [](const MemoryAccess& access) { return access.packet; });
+    if (packets && options_.packetType == PacketType::LL8) maxRate *= options_.ll8Efficiency;
+    startFlow(index, demands, maxRate,
+              [this, thread, latencyUs]() { at(now_ + latencyUs, [this, thread]() { endOperation(thread); }); });
+  }
+
+  // Pushes the transfers and signals of a proxy operation to the proxy, one transfer and signal per channel.
+  void postToProxy(int thread) {
+    const Thread& t = threads_[thread];
+    int index = t.firstOp + t.next;
+    OperationState& state = ops_[index];
+    std::map<int, std::map<int, double>> transfers;
+    for (const MemoryAccess& access : state.effects.accesses) {
+      addDemands(t.rank, access, transfers[access.channel]);
+    }
+    const auto& channels = effectsOf_.channels(t.rank, ChannelType::PROXY);
+    std::vector<ProxyRequest> requests;
+    for (auto& [channel, demands] : transfers) {
+      double latencyUs = getLatency(t.rank, channels[channel].peer);
+      requests.push_back({index, channel, false, {}, {demands.begin(), demands.end()}, latencyUs, 0});
+    }
+    for (const SemaphoreKey& key : state.effects.signals) {
+      int channel = getProxyChannel(t.rank, key);
+      requests.push_back({index, channel, true, key, {}, getLatency(t.rank, std::get<0>(key)), 0});
+    }
+    for (ProxyRequest& request : requests) {
+      proxyChannels_[{t.rank, request.channel}].outstanding++;
+      state.pendingParts++;
+      request.readyUs = now_ + options_.proxyUs;
+      at(request.readyUs, [this, rank = t.rank, request]() {
+        proxyChannels_[{rank, request.channel}].posted.push_back(request);
+        runProxy(rank, request.channel);
+      });
+    }
+  }
+
+  // the proxy channel of `rank` that signals `key`
+  int getProxyChannel(int rank, const SemaphoreKey& key) const {
+    const auto& channels = effectsOf_.channels(rank, ChannelType::PROXY);
+    for (size_t i = 0; i < channels.size(); i++) {
+      if (channels[i].peer == std::get<0>(key) && channels[i].pairIndex == std::get<3>(key)) return i;
+    }
+    throw Error("No proxy channel signals the semaphore", ErrorCode::InternalError);
+  }
+
+  // Starts the posted requests of a channel in order, each transfer once the previous one finished.
+  void runProxy(int rank, int channel) {
+    ProxyChannel& ch = proxyChannels_[{rank, channel}];
+    while (!ch.busy && !ch.posted.empty()) {
+      ProxyRequest request = std::move(ch.posted.front());
+      ch.posted.pop_front();
+      if (now_ > request.readyUs + Epsilon && ch.lastOp >= 0 && ch.lastOp != request.op) {
+        ops_[request.op].predecessor = ch.lastOp;
+      }
+      auto land = [this, rank, channel, op = request.op]() {
+        ProxyChannel& ch = proxyChannels_[{rank, channel}];
+        ch.outstanding--;
+        ch.lastOp = op;
+        ch.lastLandedUs = now_;
+      };
+      if (request.signal) {
+        at(now_ + request.latencyUs, [this, land, key = request.semaphore, op = request.op]() {
+          land();
+          landSignal(key, op);
+        });
+        continue;
+      }
+      ch.busy = true;
+      std::map<int, double> demands(request.demands.begin(), request.demands.end());
+      startFlow(request.op, demands, Infinity, [this, rank, channel, land, request]() {
+        proxyChannels_[{rank, channel}].busy = false;
+        at(now_ + request.latencyUs, [this, land, op = request.op]() {
+          land();
+          landPart(op);
+        });
+        runProxy(rank, channel);
+      });
+    }
+  }
+
+  void landSignal(const SemaphoreKey& key, int op) {
+    semaphores_[key].signals.emplace_back(now_, op);
+    landPart(op);
+  }
+
+  void landPart(int op) {
+    OperationState& state = ops_[op];
+    state.pendingParts--;
+    state.record.completeUs = std::max(state.record.completeUs, now_);
+    if (state.released && state.pendingParts == 0) state.completed = true;
+  }
+
+  void endOperation(int thread) {
+    Thread& t = threads_[thread];
+    OperationState& state = ops_[t.firstOp + t.next];
+    state.record.endUs = now_;
+    state.record.completeUs = std::max(state.record.completeUs, now_);
+    state.released = true;
+    if (state.pendingParts == 0) state.completed = true;
+    t.next++;
+    startOperation(thread);
+  }
+
+  SimulationResult getResult() {
+    SimulationResult result = {};
+    result.latencyUs = options_.launchUs;
+    int last = -1;
+    for (size_t i = 0; i < ops_.size(); i++) {
+      SimulatedOperation& record = ops_[i].record;
+      double transferUs = ops_[i].lastTransferUs - ops_[i].firstTransferUs;
+      for (int type = 0; type < NumLinkTypes; type++) {
+        result.bytes[type] += record.bytes[type];
+        double bandwidth = toBytesPerUs(options_.links.get(static_cast<LinkType>(type)).bandwidth);
+        record.utilization[type] = transferUs > Epsilon ? record.bytes[type] / (transferUs * bandwidth) : 0;
+      }
+      if (last < 0 || record.completeUs > ops_[last].record.completeUs) last = i;
+      result.latencyUs = std::max(result.latencyUs, record.completeUs);
+      result.operations.push_back(record);
+    }
+    for (int type = 0; type < NumLinkTypes; type++) {
+      double bandwidth = toBytesPerUs(options_.links.get(static_cast<LinkType>(type)).bandwidth);
+      result.utilization[type] = result.bytes[type] / (result.latencyUs * bandwidth * std::max(nRanks_, 1));
+    }
+    for (int op = last; op >= 0; op = ops_[op].predecessor) {
+      result.criticalPath.push_back(op);
+    }
+    std::reverse(result.criticalPath.begin(), result.criticalPath.end());
+    return result;
+  }
+
+  const CompiledExecutionPlan& plan_;
+  const SimulationOptions& options_;
+  PlanEffects effectsOf_;
+  int nRanks_;
+  std::vector<Thread> threads_;
+  // the operations of all threads, by thread and index
+  std::vector<OperationState> ops_;
+  // [resource] = bytes per microsecond
+  std::vector<double> capacities_;
+  double now_ = 0;
+  uint64_t nextSeq_ = 0;
+  std::priority_queue<Event, std::vector<Event>, Later> events_;
+  std::vector<Flow> flows_;
+  // [{rank, channel}]
+  std::map<std::pair<int, int>, ProxyChannel> proxyChannels_;
+  std::map<SemaphoreKey, Semaphore> semaphores_;
+  // [{rank, device syncer}]
+  std::map<std::pair<int, uint32_t>, Barrier> barriers_;
+};
+
+}  // namespace
+
+std::string linkTypeToString(LinkType type) {
+  switch (type) {
+    case LinkType::Memory:
+      return "memory";
+    case LinkType::NVLink:
+      return "NVLink";
+    case LinkType::PCIe:
+      return "PCIe";
+    case LinkType::IB:
+      return "IB";
+    case LinkType::NVLS:
+      return "NVLS";
+    default:
+      return "unknown";
+  }
+}
+
+const LinkParameters& LinkModel::get(LinkType type) const {
+  switch (type) {
+    case LinkType::Memory:
+      return memory;
+    case LinkType::NVLink:
+      return nvlink;
+    case LinkType::PCIe:
+      return pcie;
+    case LinkType::IB:
+      return ib;
+    case LinkType::NVLS:
+      return nvls;
+    default:
+      throw Error("Invalid link type", ErrorCode::InvalidUsage);
+  }
+}
+
+SimulationResult simulateExecutionPlan(const CompiledExecutionPlan& plan, size_t inputSize, size_t outputSize,
+                                       const SimulationOptions& options) {
+  return Simulator(plan, inputSize, outputSize, options).run();
+}
+
+std::vector<PlanSizeRange> derivePlanSizeRanges(const std::vector<size_t>& messageSizes,
+                                                const std::vector<std::vector<double>>& latencies) {
+  for (const auto& planLatencies : latencies) {
+    if (planLatencies.size() != messageSizes.size()) {
+      throw Error("There must be a latency for every message size", ErrorCode::InvalidUsage);
+    }
+  }
+  std::vector<PlanSizeRange> ranges;
+  for (size_t i = 0; i < messageSizes.size(); i++) {
+    if (i > 0 && messageSizes[i] <= messageSizes[i - 1]) {
+      throw Error("The message sizes must be ascending", ErrorCode::InvalidUsage);
+    }
+    int best = -1;
+    for (size_t plan = 0; plan < latencies.size(); plan++) {
+      if (latencies[plan][i] == Infinity) continue;
+      if (best < 0 || latencies[plan][i] < latencies[best][i]) best = plan;
+    }
+    if (best < 0) continue;
+    if (ranges.empty()) {
+      ranges.push_back({best, 0, std::numeric_limits<uint64_t>::max()});
+    } else if (ranges.back().plan != best) {
+      ranges.back().maxMessageSize = messageSizes[i];
+      ranges.push_back({best, messageSizes[i], std::numeric_limits<uint64_t>::max()});
+    }
+  }
+  return ranges;
+}
+
+}  // namespace mscclpp
@@ -1,14 +1,21 @@
 // Copyright (c) Microsoft Corporation.
 // Licensed under the MIT license.
 
+#include <cstdlib>
 #include <mscclpp/executor.hpp>
 #include <mscclpp/nvls.hpp>
 #include <mscclpp/proxy_channel.hpp>
 #include <mscclpp/sm_channel.hpp>
+#include <mscclpp/utils.hpp>
 #include <set>
+#include <type_traits>
+#include <unordered_set>
 
+#include "debug.h"
+#include "device_execution_plan.hpp"
 #include "execution_kernel.hpp"
 #include "execution_plan.hpp"
+#include "lru_cache.hpp"
 
 namespace mscclpp {
 struct ExecutionContextKey {
@@ -118,51 +125,70 @@ struct ExecutionContext {
   std::vector<mscclpp::SmChannel> smChannels;
   std::vector<mscclpp::ProxyChannel> proxyChannels;
   std::vector<mscclpp::NvlsConnection::DeviceMulticastPointer> nvlsChannels;
-  std::unordered_map<DeviceExecutionPlanKey, std::vector<DeviceExecutionPlan>> deviceExecutionPlans;
-  std::unordered_map<DeviceExecutionPlanKey, std::shared_ptr<char>> deviceExecutionPlansBuffers;
+  // Operations are kept in chunk units, so one device plan serves all message sizes. `chunkLayout` converts them to
+  // bytes for the message size of the current launch.
+  EncodedExecutionPlans deviceExecutionPlans;
+  std::shared_ptr<char> deviceExecutionPlansBuffer;
   std::shared_ptr<char> scratchBuffer;
   size_t scratchBufferSize;
   int nthreadsPerBlock;
+  // Message sizes already checked against the plan on the host.
+  std::unordered_set<DeviceExecutionPlanKey> validatedDevicePlans;
   DeviceExecutionPlanKey currentDevicePlan;
+  ChunkLayout chunkLayout;
+  int64_t setupTimeUs;
+  size_t bytesPinned;
+  // Recorded on the stream of every launch, so that evicting the context only waits for its own kernels.
+  std::shared_ptr<std::remove_pointer_t<cudaEvent_t>> lastLaunch;
 };
 
+namespace {
+size_t getEnvSize(const char* name) {
+  const char* value = getenv(name);
+  if (value == nullptr) {
+    return 0;
+  }
+  try {
+    return std::stoull(value);
+  } catch (const std::exception&) {
+    throw Error(std::string("Invalid value for ") + name + ": " + value, ErrorCode::InvalidUsage);
+  }
+}
+}  // namespace
+
 struct Executor::Impl {
   int nranksPerNode;
   int nranks;
   std::shared_ptr<Communicator> comm;
-  std::unordered_map<ExecutionContextKey, ExecutionContext> contexts;
-
-  Impl(std::shared_ptr<Communicator> comm) : comm(comm) {
+  LruCache<ExecutionContextKey, ExecutionContext> contexts;
+
+  Impl(std::shared_ptr<Communicator> comm)
+      : comm(comm),
+        contexts(getEnvSize("MSCCLPP_EXECUTOR_MAX_CONTEXTS"), getEnvSize("MSCCLPP_EXECUTOR_MAX_CONTEXT_BYTES"),
+                 [](const ExecutionContextKey& key, ExecutionContext& context) {
+                   // Kernels launched with the context may still be running.
+                   MSCCLPP_CUDATHROW(cudaEventSynchronize(context.lastLaunch.get()));
+                   INFO(MSCCLPP_INIT, "Executor evicts the execution context of plan %s", key.plan.c_str());
+                 }) {
     this->nranksPerNode = comm->bootstrap()->getNranksPerNode();
     this->nranks = comm->bootstrap()->getNranks();
   }
   ~Impl() = default;
 
-  ExecutionContext setupExecutionContext(int rank, void* sendbuff, void* recvbuff, size_t inputMessageSize,
-                                         size_t outputMessageSize, size_t constSrcOffset, size_t constDstOffset,
-                                         size_t sendMemRange, size_t recvMemRange, const ExecutionPlan& plan) {
+  ExecutionContext& setupExecutionContext(int rank, void* sendbuff, void* recvbuff, size_t inputMessageSize,
+                                          size_t outputMessageSize, size_t constSrcOffset, size_t constDstOffset,
+                                          size_t sendMemRange, size_t recvMemRange, const ExecutionPlan& plan) {
     ExecutionContextKey key = {sendbuff, recvbuff, sendMemRange, recvMemRange, plan.impl_->name};
     DeviceExecutionPlanKey devicePlanKey = {inputMessageSize, outputMessageSize, constSrcOffset, constDstOffset};
-    if (this->contexts.find(key) != this->contexts.end()) {
-      auto& devicePlans = this->contexts[key].deviceExecutionPlans;
-      if (this->contexts[key].currentDevicePlan == devicePlanKey) {
-        return this->contexts[key];
-      } else if (devicePlans.find(devicePlanKey) != devicePlans.end()) {
-        this->contexts[key].currentDevicePlan = devicePlanKey;
-        return this->contexts[key];
+    ExecutionContext* cached = this->contexts.find(key);
+    if (cached != nullptr) {
+      if (!(cached->currentDevicePlan == devicePlanKey)) {
+        this->setupChunkLayout(*cached, devicePlanKey, rank, plan);
       }
-      plan.impl_->operationsReset();
-      plan.impl_->lightLoadExecutionPlan(inputMessageSize, outputMessageSize, constSrcOffset, constDstOffset);
-      this->setupDeviceExecutionPlan(this->contexts[key], devicePlanKey, rank, plan);
-      this->contexts[key].deviceExecutionPlansBuffers[devicePlanKey] =
-          allocExtSharedCuda<char>(devicePlans[devicePlanKey].size() * sizeof(DeviceExecutionPlan));
-      memcpyCuda(this->contexts[key].deviceExecutionPlansBuffers[devicePlanKey].get(),
-                 (char*)devicePlans[devicePlanKey].data(),
-                 devicePlans[devicePlanKey].size() * sizeof(DeviceExecutionPlan), cudaMemcpyHostToDevice);
-      this->contexts[key].currentDevicePlan = devicePlanKey;
-      return this->contexts[key];
+      return *cached;
     }
 
+    Timer timer;
     plan.impl_->reset();
     plan.impl_->loadExecutionPlan(inputMessageSize, outputMessageSize, constSrcOffset, constDstOffset);
 
@@ -180,21 +206,65 @@ struct Executor::Impl {
     context.scratchBufferSize = scratchBufferSize;
     context.proxyService = std::make_shared<ProxyService>();
     context.nthreadsPerBlock = plan.impl_->getNThreadsPerBlock();
+    cudaEvent_t lastLaunch;
+    MSCCLPP_CUDATHROW(cudaEventCreateWithFlags(&lastLaunch, cudaEventDisableTiming));
+    context.lastLaunch = std::shared_ptr<std::remove_pointer_t<cudaEvent_t>>(
+        lastLaunch, [](cudaEvent_t event) { cudaEventDestroy(event); });
     this->setupConnections(context, rank, plan, sendMemRange, recvMemRange);
     this->setupRegisteredMemories(context, sendbuff, recvbuff, sendMemRange, recvMemRange, rank, plan);
     this->setupChannels(context, sendbuff, recvbuff, sendMemRange, recvMemRange, rank, plan);
     this->setupNvlsChannels(context, sendbuff, recvbuff, sendMemRange, recvMemRange, rank, plan);
-    this->setupDeviceExecutionPlan(context, devicePlanKey, rank, plan);
-    context.deviceExecutionPlansBuffers[devicePlanKey] =
-        allocExtSharedCuda<char>(context.deviceExecutionPlans[devicePlanKey].size() * sizeof(DeviceExecutionPlan));
-    memcpyCuda(context.deviceExecutionPlansBuffers[devicePlanKey].get(),
-               (char*)context.deviceExecutionPlans[devicePlanKey].data(),
-               context.deviceExecutionPlans[devicePlanKey].size() * sizeof(DeviceExecutionPlan),
+    this->setupDeviceExecutionPlan(context, rank, plan);
+    const std::vector<char>& devicePlanData = context.deviceExecutionPlans.data;
+    context.deviceExecutionPlansBuffer = allocExtSharedCuda<char>(devicePlanData.size());
+    memcpyCuda(context.deviceExecutionPlansBuffer.get(), devicePlanData.data(), devicePlanData.size(),
                cudaMemcpyHostToDevice);
-    context.currentDevicePlan = devicePlanKey;
+    // loadExecutionPlan above already checked the operations for this message size
+    context.validatedDevicePlans.insert(devicePlanKey);
+    this->setupChunkLayout(context, devicePlanKey, rank, plan);
     context.proxyService->startProxy();
-    this->contexts.insert({key, context});
-    return context;
+    context.setupTimeUs = timer.elapsed();
+    context.bytesPinned = scratchBufferSize + devicePlanData.size() +
+                          this->getRegisteredBufferBytes(rank, plan, sendbuff, recvbuff, sendMemRange, recvMemRange);
+    size_t bytesPinned = context.bytesPinned;
+    return this->contexts.insert(key, std::move(context), bytesPinned);
+  }
+
+  // Counts the send and receive allocations once if the plan registers them, whether for channels or for NVLS.
+  size_t getRegisteredBufferBytes(int rank, const ExecutionPlan& plan, void* sendbuff, void* recvbuff,
+                                  size_t sendMemRange, size_t recvMemRange) {
+    std::set<BufferType> bufferTypes;
+    for (const auto& infos : {plan.impl_->getChannelInfos(rank, ChannelType::SM),
+                              plan.impl_->getChannelInfos(rank, ChannelType::PROXY)}) {
+      for (const ChannelInfo& info : infos) {
+        bufferTypes.insert(info.srcBufferType);
+        bufferTypes.insert(info.dstBufferType);
+      }
+    }
+    for (const NvlsInfo& info : plan.impl_->getNvlsInfos(rank, sendMemRange, recvMemRange)) {
+      bufferTypes.insert(info.bufferType);
+    }
+    size_t bytes = 0;
+    if (bufferTypes.count(BufferType::INPUT)) bytes += sendMemRange;
+    // an in-place plan registers the same allocation as input and output
+    if (bufferTypes.count(BufferType::OUTPUT) && !(bufferTypes.count(BufferType::INPUT) && sendbuff == recvbuff)) {
+      bytes += recvMemRange;
+    }
+    return bytes;
+  }
+
+  void setupChunkLayout(ExecutionContext& context, const DeviceExecutionPlanKey& key, int rank,
+                        const ExecutionPlan& plan) {
+    if (context.validatedDevicePlans.find(key) == context.validatedDevicePlans.end()) {
+      // Resolving the operations on the host throws if the message size does not fit the plan.
+      plan.impl_->operationsReset();
+      plan.impl_->lightLoadExecutionPlan(key.inputMessageSize, key.outputMessageSize, key.constSrcOffset,
+                                         key.constDstOffset);
+      context.validatedDevicePlans.insert(key);
+    }
+    context.chunkLayout = plan.impl_->getChunkLayout(rank, key.inputMessageSize, key.outputMessageSize,
+                                                     key.constSrcOffset, key.constDstOffset);
+    context.currentDevicePlan = key;
   }
 
   TransportFlags getTransportFlags(std::vector<ChannelInfo>& infos, int rank) {
@@ -365,45 +435,29 @@ struct Executor::Impl {
     }
   }
 
-  void setupDeviceExecutionPlan(ExecutionContext& context, const DeviceExecutionPlanKey& key, int rank,
-                                const ExecutionPlan& plan) {
-    std::vector<DeviceExecutionPlan> deviceExecutionPlans;
+  void setupDeviceExecutionPlan(ExecutionContext& context, int rank, const ExecutionPlan& plan) {
+    std::vector<ThreadblockExecutionPlan> threadblockPlans;
     for (int threadblock = 0; threadblock < plan.impl_->getThreadblockCount(rank); threadblock++) {
-      DeviceExecutionPlan deviceExecutionPlan = {};
-      std::vector<Operation> ops = plan.impl_->getOperations(rank, threadblock);
-      deviceExecutionPlan.nOperations = ops.size();
-      deviceExecutionPlan.nSmChannels = plan.impl_->threadblockSMChannelMap.at(rank).at(threadblock).size();
-      deviceExecutionPlan.nProxyChannels = plan.impl_->threadblockProxyChannelMap.at(rank).at(threadblock).size();
-      int chanIndex = 0;
+      ThreadblockExecutionPlan threadblockPlan;
       for (const auto& [index, _] : plan.impl_->threadblockSMChannelMap.at(rank).at(threadblock)) {
-        deviceExecutionPlan.channels.smChannels[chanIndex++] = mscclpp::deviceHandle(context.smChannels[index]);
+        threadblockPlan.smChannels.push_back(mscclpp::deviceHandle(context.smChannels[index]));
       }
-      chanIndex = 0;
       for (const auto& [index, _] : plan.impl_->threadblockProxyChannelMap.at(rank).at(threadblock)) {
-        deviceExecutionPlan.channels.proxyChannels[chanIndex++] = mscclpp::deviceHandle(context.proxyChannels[index]);
+        threadblockPlan.proxyChannels.push_back(mscclpp::deviceHandle(context.proxyChannels[index]));
       }
-      chanIndex = 0;
       for (const auto& [index, _] : plan.impl_->threadblockNvlsChannelMap.at(rank).at(threadblock)) {
-        deviceExecutionPlan.channels.nvlsChannels[chanIndex++] = mscclpp::deviceHandle(context.nvlsChannels[index]);
-      }
-      if (ops.size() > MAX_OPERATION) {
-        throw Error("Executor plan launching " + std::to_string(ops.size()) +
-                        " operations, exceeding device execution plan support (" + std::to_string(MAX_OPERATION) + ")",
-                    ErrorCode::ExecutorError);
+        threadblockPlan.nvlsChannels.push_back(mscclpp::deviceHandle(context.nvlsChannels[index]));
       }
-      for (size_t i = 0; i < ops.size(); i++) {
-        deviceExecutionPlan.operations[i] = ops[i];
-      }
-      deviceExecutionPlans.push_back(deviceExecutionPlan);
+      threadblockPlan.operations = plan.impl_->operationTemplates.at(rank).at(threadblock);
+      threadblockPlans.push_back(std::move(threadblockPlan));
     }
-    context.deviceExecutionPlans[key] = std::move(deviceExecutionPlans);
+    context.deviceExecutionPlans = encodeDeviceExecutionPlans(threadblockPlans);
   }
 
   void launchKernel(ExecutionContext& context, int rank, void* sendbuff, void* recvbuff, DataType dataType,
                     cudaStream_t stream, PacketType packetType) {
     static uint32_t flag = 0;
-    DeviceExecutionPlanKey key = context.currentDevicePlan;
-    int nthreadblocks = context.deviceExecutionPlans[key].size();
+    int nthreadblocks = context.deviceExecutionPlans.nThreadblocks;
 #if defined(ENABLE_NPKIT)
 #if defined(__HIP_PLATFORM_AMD__)
     if (nthreadblocks > NPKIT_MAX_NUM_GPU_THREADBLOCKS) {
@@ -413,26 +467,27 @@ struct Executor::Impl {
                   ErrorCode::ExecutorError);
     }
 #endif
-    size_t sharedMemSize = sizeof(DeviceExecutionPlan) + NPKIT_SHM_NUM_EVENTS * sizeof(NpKitEvent);
+    size_t sharedMemSize = context.deviceExecutionPlans.maxPlanSize + NPKIT_SHM_NUM_EVENTS * sizeof(NpKitEvent);
 #else
-    size_t sharedMemSize = sizeof(DeviceExecutionPlan);
+    size_t sharedMemSize = context.deviceExecutionPlans.maxPlanSize;
 #endif
     switch (packetType) {
       case PacketType::LL16:
         ExecutionKernel::launchKernel<LL16Packet>(
             rank, nthreadblocks, context.nthreadsPerBlock, sendbuff, recvbuff, (void*)context.scratchBuffer.get(),
-            context.scratchBufferSize, dataType, (DeviceExecutionPlan*)context.deviceExecutionPlansBuffers[key].get(),
+            context.scratchBufferSize, dataType, context.deviceExecutionPlansBuffer.get(), context.chunkLayout,
             sharedMemSize, stream, ++flag);
         break;
       case PacketType::LL8:
         ExecutionKernel::launchKernel<LL8Packet>(
             rank, nthreadblocks, context.nthreadsPerBlock, sendbuff, recvbuff, (void*)context.scratchBuffer.get(),
-            context.scratchBufferSize, dataType, (DeviceExecutionPlan*)context.deviceExecutionPlansBuffers[key].get(),
+            context.scratchBufferSize, dataType, context.deviceExecutionPlansBuffer.get(), context.chunkLayout,
             sharedMemSize, stream, ++flag);
         break;
       default:
         throw Error("Invalid packet type", ErrorCode::ExecutorError);
     }
+    MSCCLPP_CUDATHROW(cudaEventRecord(context.lastLaunch.get(), stream));
   }
 };
 
@@ -448,12 +503,37 @@ void Executor::execute(int rank, void* sendbuff, void* recvbuff, size_t sendBuff
   size_t offsetIn = (char*)sendbuff - (char*)sendBasePtr;
   size_t offsetOut = (char*)recvbuff - (char*)recvBasePtr;
 
-  ExecutionContext context =
+  ExecutionContext& context =
       this->impl_->setupExecutionContext(rank, (void*)sendBasePtr, (void*)recvBasePtr, sendBuffSize, recvBuffSize,
                                          offsetIn, offsetOut, sendMemRange, recvMemRange, plan);
   this->impl_->launchKernel(context, rank, sendbuff, recvbuff, dataType, stream, packetType);
 }
 
+void Executor::setCacheLimits(size_t maxContexts, size_t maxBytes) {
+  this->impl_->contexts.setLimits(maxContexts, maxBytes);
+}
+
+size_t Executor::evict(void* buff) {
+  auto contains = [buff](void* base, size_t size) {
+    return (char*)buff >= (char*)base && (char*)buff < (char*)base + size;
+  };
+  return this->impl_->contexts.eraseIf([&](const ExecutionContextKey& key, const ExecutionContext&) {
+    return contains(key.sendBuff, key.sendBuffSize) || contains(key.recvBuff, key.recvBuffSize);
+  });
+}
+
+void Executor::clear() { this->impl_->contexts.clear(); }
+
+ExecutorCacheStats Executor::cacheStats() const {
+  const auto& contexts = this->impl_->contexts;
+  ExecutorCacheStats stats = {contexts.hits(), contexts.misses(), contexts.evictions(), contexts.bytes(), {}};
+  for (const auto& entry : contexts) {
+    stats.contexts.push_back({entry.key.plan, entry.key.sendBuff, entry.key.recvBuff, entry.key.sendBuffSize,
+                              entry.key.recvBuffSize, entry.hits, entry.value.setupTimeUs, entry.bytes});
+  }
+  return stats;
+}
+
 Executor::~Executor() = default;
 
 }  // namespace mscclpp
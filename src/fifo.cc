@@ -1,6 +1,7 @@
 // Copyright (c) Microsoft Corporation.
 // Licensed under the MIT license.
 
+#include <algorithm>
 #include <mscclpp/fifo.hpp>
 #include <mscclpp/gpu_utils.hpp>
 
@@ -53,6 +54,26 @@ MSCCLPP_API_CPP void Fifo::pop() {
   (pimpl->hostTail)++;
 }
 
+MSCCLPP_API_CPP int Fifo::pollBatch(ProxyTrigger* triggers, int maxCount) {
+  maxCount = std::min(maxCount, pimpl->size);
+  int count = 0;
+  for (; count < maxCount; ++count) {
+    ProxyTrigger* ptr = &pimpl->triggers.get()[(pimpl->hostTail + count) % pimpl->size];
+    triggers[count].fst = atomicLoad(&(ptr->fst), memoryOrderAcquire);
+    triggers[count].snd = ptr->snd;
+    // the same check as a single poll: a zero half means the entry is still being written
+    if (triggers[count].fst == 0 || triggers[count].snd == 0) break;
+  }
+  return count;
+}
+
+MSCCLPP_API_CPP void Fifo::popBatch(int count) {
+  for (int i = 0; i < count; ++i) {
+    atomicStore(&(pimpl->triggers.get()[(pimpl->hostTail + i) % pimpl->size].fst), uint64_t{0}, memoryOrderRelease);
+  }
+  pimpl->hostTail += count;
+}
+
 MSCCLPP_API_CPP void Fifo::flushTail(bool sync) {
   // Flush the tail to device memory. This is either triggered every ProxyFlushPeriod to make sure that the fifo can
   // make progress even if there is no request mscclppSync. However, mscclppSync type is for flush request.
@@ -0,0 +1,278 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <mscclpp/errors.hpp>
+#include <mscclpp/host_reduce.hpp>
+#include <mutex>
+#include <thread>
+
+#include "api.h"
+#include "host_reduce_simd.hpp"
+
+namespace mscclpp {
+
+static_assert(static_cast<int>(ReduceOp::SUM) == HostReduceSum && static_cast<int>(ReduceOp::PROD) == HostReduceProd &&
+                  static_cast<int>(ReduceOp::MIN) == HostReduceMin && static_cast<int>(ReduceOp::MAX) == HostReduceMax,
+              "HostReduceKernels are indexed by ReduceOp");
+
+namespace {
+
+struct ScalarVector {
+  static constexpr size_t Width = 1;
+  using F = float;
+  using I = uint32_t;
+
+  static F loadF(const float* p) { return *p; }
+  static void storeF(float* p, F v) { *p = v; }
+  static I loadI(const void* p) { return *static_cast<const uint32_t*>(p); }
+  static void storeI(void* p, I v) { *static_cast<uint32_t*>(p) = v; }
+
+  static F addF(F a, F b) { return a + b; }
+  static F mulF(F a, F b) { return a * b; }
+  static F minF(F a, F b) { return a < b ? a : b; }
+  static F maxF(F a, F b) { return a > b ? a : b; }
+  static I addI(I a, I b) { return a + b; }
+  static I mulI(I a, I b) { return a * b; }
+  static I minI(I a, I b) { return int32_t(a) < int32_t(b) ? a : b; }
+  static I maxI(I a, I b) { return int32_t(a) > int32_t(b) ? a : b; }
+  static I minU(I a, I b) { return a < b ? a : b; }
+  static I maxU(I a, I b) { return a > b ? a : b; }
+
+  static F loadHalf(const uint16_t* p) { return halfToFloatScalar(*p); }
+  static void storeHalf(uint16_t* p, F v) { *p = floatToHalfScalar(v); }
+  static F loadBf16(const uint16_t* p) { return bf16ToFloatScalar(*p); }
+  static void storeBf16(uint16_t* p, F v) { *p = floatToBf16Scalar(v); }
+};
+
+constexpr HostReduceKernels scalarKernels = makeHostReduceKernels<ScalarVector>("scalar");
+
+// Buffers are reduced in blocks of this many elements, so that the output of one input stays in the L1 cache for the
+// next. 16-bit elements are converted into two FLOAT32 blocks on the stack.
+constexpr size_t BlockSize = 2048;
+
+// hostReduce() picks one thread for every this many bytes of output.
+constexpr size_t BytesPerThread = 1 << 20;
+
+// The elements of the parts of different threads start at multiples of this, a cache line of 16-bit elements or more.
+constexpr size_t PartAlignment = 64;
+
+// Worker threads that hostReduce() splits large buffers across. They are started on first use and never stopped.
+class HostReducePool {
+ public:
+  // Runs fn(part) for every part in [0, numParts) on the calling thread and up to numParts - 1 workers. Returns false
+  // without running anything if another thread is using the pool.
+  bool run(int numParts, const std::function<void(int)>& fn) {
+    std::unique_lock<std::mutex> runLock(runMutex_, std::try_to_lock);
+    if (!runLock.owns_lock()) return false;
+    while (static_cast<int>(threads_.size()) < numParts - 1) {
+      threads_.emplace_back(&HostReducePool::work, this);
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      job_ = &fn;
+      numParts_ = numParts;
+      nextPart_ = 0;
+      pending_ = numParts;
+    }
+    cv_.notify_all();
+    runParts();
+    std::unique_lock<std::mutex> lock(mutex_);
+    doneCv_.wait(lock, [this] { return pending_ == 0; });
+    job_ = nullptr;
+    return true;
+  }
+
+ private:
+  // Runs parts of the current job until none is left.
+  void runParts() {
+    while (true) {
+      const std::function<void(int)>* job;
+      int part;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (job_ == nullptr || nextPart_ >= numParts_) return;
+        job = job_;
+        part = nextPart_++;
+      }
+      (*job)(part);
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--pending_ == 0) doneCv_.notify_all();
+    }
+  }
+
+  void work() {
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return job_ != nullptr && nextPart_ < numParts_; });
+      }
+      runParts();
+    }
+  }
+
+  std::mutex runMutex_;
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::condition_variable doneCv_;
+  const std::function<void(int)>* job_ = nullptr;
+  int numParts_ = 0;
+  int nextPart_ = 0;
+  int pending_ = 0;
+};
+
+HostReducePool& hostReducePool() {
+  // Never destroyed, so that exit neither waits for the workers nor terminates them. A forked child starts a pool of
+  // its own, since the workers of its parent do not exist in it.
+  static std::mutex mutex;
+  static HostReducePool* pool = nullptr;
+  static pid_t pid = 0;
+  std::lock_guard<std::mutex> lock(mutex);
+  if (pool == nullptr || pid != getpid()) {
+    pool = new HostReducePool();
+    pid = getpid();
+  }
+  return *pool;
+}
+
+size_t dataTypeSize(DataType dataType) {
+  switch (dataType) {
+    case DataType::INT32:
+    case DataType::UINT32:
+    case DataType::FLOAT32:
+      return 4;
+    case DataType::FLOAT16:
+    case DataType::BFLOAT16:
+      return 2;
+  }
+  throw Error("Invalid data type", ErrorCode::InvalidUsage);
+}
+
+template <class T>
+void reduceBlocks(void (*fn)(T*, const T*, const T*, size_t), void* dst, const std::vector<const void*>& srcs,
+                  size_t begin, size_t end) {
+  T* out = static_cast<T*>(dst);
+  for (size_t block = begin; block < end; block += BlockSize) {
+    size_t n = std::min(BlockSize, end - block);
+    fn(out + block, static_cast<const T*>(srcs[0]) + block, static_cast<const T*>(srcs[1]) + block, n);
+    for (size_t i = 2; i < srcs.size(); ++i) {
+      fn(out + block, out + block, static_cast<const T*>(srcs[i]) + block, n);
+    }
+  }
+}
+
+void reduceBlocks16(const HostReduceKernels& kernels, bool bf16, int op, void* dst,
+                    const std::vector<const void*>& srcs, size_t begin, size_t end) {
+  auto toFloat = bf16 ? kernels.bf16ToFloat : kernels.halfToFloat;
+  auto fromFloat = bf16 ? kernels.floatToBf16 : kernels.floatToHalf;
+  float acc[BlockSize];
+  float in[BlockSize];
+  for (size_t block = begin; block < end; block += BlockSize) {
+    size_t n = std::min(BlockSize, end - block);
+    toFloat(acc, static_cast<const uint16_t*>(srcs[0]) + block, n);
+    for (size_t i = 1; i < srcs.size(); ++i) {
+      toFloat(in, static_cast<const uint16_t*>(srcs[i]) + block, n);
+      kernels.f32[op](acc, acc, in, n);
+    }
+    fromFloat(static_cast<uint16_t*>(dst) + block, acc, n);
+  }
+}
+
+void reduceRange(const HostReduceKernels& kernels, DataType dataType, int op, void* dst,
+                 const std::vector<const void*>& srcs, size_t begin, size_t end) {
+  switch (dataType) {
+    case DataType::FLOAT32:
+      reduceBlocks<float>(kernels.f32[op], dst, srcs, begin, end);
+      break;
+    case DataType::INT32:
+      reduceBlocks<int32_t>(kernels.i32[op], dst, srcs, begin, end);
+      break;
+    case DataType::UINT32:
+      reduceBlocks<uint32_t>(kernels.u32[op], dst, srcs, begin, end);
+      break;
+    case DataType::FLOAT16:
+      reduceBlocks16(kernels, false, op, dst, srcs, begin, end);
+      break;
+    case DataType::BFLOAT16:
+      reduceBlocks16(kernels, true, op, dst, srcs, begin, end);
+      break;
+  }
+}
+
+}  // namespace
+
+const HostReduceKernels* hostReduceKernelsScalar() { return &scalarKernels; }
+
+const HostReduceKernels* hostReduceKernels() {
+  static const HostReduceKernels* kernels = [] {
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (hostReduceKernelsAvx512() != nullptr && __builtin_cpu_supports("avx512f")) {
+      return hostReduceKernelsAvx512();
+    }
+    // every CPU with AVX2 has F16C as well
+    if (hostReduceKernelsAvx2() != nullptr && __builtin_cpu_supports("avx2")) {
+      return hostReduceKernelsAvx2();
+    }
+#endif
+    return hostReduceKernelsScalar();
+  }();
+  return kernels;
+}
+
+MSCCLPP_API_CPP void hostReduce(void* dst, const std::vector<const void*>& srcs, size_t count, DataType dataType,
+                                ReduceOp op, int numThreads) {
+  if (srcs.empty()) {
+    throw Error("hostReduce needs at least one input", ErrorCode::InvalidUsage);
+  }
+  if (numThreads < 0) {
+    throw Error("Invalid number of threads: " + std::to_string(numThreads), ErrorCode::InvalidUsage);
+  }
+  size_t elementSize = dataTypeSize(dataType);
+  if (count == 0) return;
+  if (srcs.size() == 1) {
+    if (dst != srcs[0]) std::memcpy(dst, srcs[0], count * elementSize);
+    return;
+  }
+  // The output is written before the later inputs are read, so an input that is the output goes first. All of the
+  // operations are commutative.
+  std::vector<const void*> inputs(srcs);
+  auto aliased = std::find(inputs.begin(), inputs.end(), dst);
+  if (aliased != inputs.end()) {
+    std::iter_swap(inputs.begin(), aliased);
+  }
+
+  const HostReduceKernels& kernels = *hostReduceKernels();
+  int opIndex = static_cast<int>(op);
+  if (numThreads == 0) {
+    size_t byBytes = std::max<size_t>(count * elementSize / BytesPerThread, 1);
+    numThreads = static_cast<int>(std::min<size_t>(byBytes, std::max(std::thread::hardware_concurrency(), 1u)));
+  }
+  size_t partSize = (count + numThreads - 1) / numThreads;
+  partSize = (partSize + PartAlignment - 1) / PartAlignment * PartAlignment;
+  int numParts = static_cast<int>((count + partSize - 1) / partSize);
+  auto reducePart = [&](int part) {
+    size_t begin = part * partSize;
+    reduceRange(kernels, dataType, opIndex, dst, inputs, begin, std::min(begin + partSize, count));
+  };
+  if (numParts == 1 || !hostReducePool().run(numParts, reducePart)) {
+    for (int part = 0; part < numParts; ++part) {
+      reducePart(part);
+    }
+  }
+}
+
+MSCCLPP_API_CPP void hostReduce(void* dst, const void* src, size_t count, DataType dataType, ReduceOp op,
+                                int numThreads) {
+  hostReduce(dst, std::vector<const void*>{dst, src}, count, dataType, op, numThreads);
+}
+
+MSCCLPP_API_CPP std::string hostReduceIsa() { return hostReduceKernels()->isa; }
+
+}  // namespace mscclpp
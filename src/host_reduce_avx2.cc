@@ -0,0 +1,76 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// Built with -mavx2 -mf16c on x86-64, see CMakeLists.txt. No C++ library header may be included here, see
+// host_reduce_simd.hpp.
+
+#if defined(__AVX2__) && defined(__F16C__)
+#include <immintrin.h>
+
+#include "host_reduce_simd.hpp"
+
+namespace mscclpp {
+namespace {
+
+struct Avx2Vector {
+  static constexpr size_t Width = 8;
+  using F = __m256;
+  using I = __m256i;
+
+  static F loadF(const float* p) { return _mm256_loadu_ps(p); }
+  static void storeF(float* p, F v) { _mm256_storeu_ps(p, v); }
+  static I loadI(const void* p) { return _mm256_loadu_si256(static_cast<const __m256i*>(p)); }
+  static void storeI(void* p, I v) { _mm256_storeu_si256(static_cast<__m256i*>(p), v); }
+
+  static F addF(F a, F b) { return _mm256_add_ps(a, b); }
+  static F mulF(F a, F b) { return _mm256_mul_ps(a, b); }
+  static F minF(F a, F b) { return _mm256_min_ps(a, b); }
+  static F maxF(F a, F b) { return _mm256_max_ps(a, b); }
+  static I addI(I a, I b) { return _mm256_add_epi32(a, b); }
+  static I mulI(I a, I b) { return _mm256_mullo_epi32(a, b); }
+  static I minI(I a, I b) { return _mm256_min_epi32(a, b); }
+  static I maxI(I a, I b) { return _mm256_max_epi32(a, b); }
+  static I minU(I a, I b) { return _mm256_min_epu32(a, b); }
+  static I maxU(I a, I b) { return _mm256_max_epu32(a, b); }
+
+  static F loadHalf(const uint16_t* p) { return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))); }
+  static void storeHalf(uint16_t* p, F v) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+  }
+
+  static F loadBf16(const uint16_t* p) {
+    __m256i wide = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+    return _mm256_castsi256_ps(_mm256_slli_epi32(wide, 16));
+  }
+  static void storeBf16(uint16_t* p, F v) {
+    __m256i bits = _mm256_castps_si256(v);
+    __m256i lsb = _mm256_and_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(1));
+    __m256i rounded = _mm256_srli_epi32(_mm256_add_epi32(bits, _mm256_add_epi32(lsb, _mm256_set1_epi32(0x7fff))), 16);
+    __m256i quiet = _mm256_or_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(0x40));
+    __m256i nan = _mm256_castps_si256(_mm256_cmp_ps(v, v, _CMP_UNORD_Q));
+    __m256i halves = _mm256_blendv_epi8(rounded, quiet, nan);
+    // the 16-bit halves of the lanes, packed within each 128-bit half and then across them
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(halves, halves), 0x08);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm256_castsi256_si128(packed));
+  }
+};
+
+constexpr HostReduceKernels avx2Kernels = makeHostReduceKernels<Avx2Vector>("avx2");
+
+}  // namespace
+
+const HostReduceKernels* hostReduceKernelsAvx2() { return &avx2Kernels; }
+
+}  // namespace mscclpp
+
+#else
+
+#include "host_reduce_kernels.hpp"
+
+namespace mscclpp {
+
+const HostReduceKernels* hostReduceKernelsAvx2() { return nullptr; }
+
+}  // namespace mscclpp
+
+#endif
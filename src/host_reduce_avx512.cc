@@ -0,0 +1,76 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// Built with -mavx512f on x86-64, see CMakeLists.txt. No C++ library header may be included here, see
+// host_reduce_simd.hpp.
+
+#if defined(__AVX512F__)
+#include <immintrin.h>
+
+#include "host_reduce_simd.hpp"
+
+namespace mscclpp {
+namespace {
+
+struct Avx512Vector {
+  static constexpr size_t Width = 16;
+  using F = __m512;
+  using I = __m512i;
+
+  static F loadF(const float* p) { return _mm512_loadu_ps(p); }
+  static void storeF(float* p, F v) { _mm512_storeu_ps(p, v); }
+  static I loadI(const void* p) { return _mm512_loadu_si512(p); }
+  static void storeI(void* p, I v) { _mm512_storeu_si512(p, v); }
+
+  static F addF(F a, F b) { return _mm512_add_ps(a, b); }
+  static F mulF(F a, F b) { return _mm512_mul_ps(a, b); }
+  static F minF(F a, F b) { return _mm512_min_ps(a, b); }
+  static F maxF(F a, F b) { return _mm512_max_ps(a, b); }
+  static I addI(I a, I b) { return _mm512_add_epi32(a, b); }
+  static I mulI(I a, I b) { return _mm512_mullo_epi32(a, b); }
+  static I minI(I a, I b) { return _mm512_min_epi32(a, b); }
+  static I maxI(I a, I b) { return _mm512_max_epi32(a, b); }
+  static I minU(I a, I b) { return _mm512_min_epu32(a, b); }
+  static I maxU(I a, I b) { return _mm512_max_epu32(a, b); }
+
+  static F loadHalf(const uint16_t* p) {
+    return _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+  }
+  static void storeHalf(uint16_t* p, F v) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), _mm512_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+  }
+
+  static F loadBf16(const uint16_t* p) {
+    __m512i wide = _mm512_cvtepu16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+    return _mm512_castsi512_ps(_mm512_slli_epi32(wide, 16));
+  }
+  static void storeBf16(uint16_t* p, F v) {
+    __m512i bits = _mm512_castps_si512(v);
+    __m512i lsb = _mm512_and_si512(_mm512_srli_epi32(bits, 16), _mm512_set1_epi32(1));
+    __m512i rounded = _mm512_srli_epi32(_mm512_add_epi32(bits, _mm512_add_epi32(lsb, _mm512_set1_epi32(0x7fff))), 16);
+    __m512i quiet = _mm512_or_si512(_mm512_srli_epi32(bits, 16), _mm512_set1_epi32(0x40));
+    __mmask16 nan = _mm512_cmp_ps_mask(v, v, _CMP_UNORD_Q);
+    __m512i halves = _mm512_mask_blend_epi32(nan, rounded, quiet);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), _mm512_cvtepi32_epi16(halves));
+  }
+};
+
+constexpr HostReduceKernels avx512Kernels = makeHostReduceKernels<Avx512Vector>("avx512");
+
+}  // namespace
+
+const HostReduceKernels* hostReduceKernelsAvx512() { return &avx512Kernels; }
+
+}  // namespace mscclpp
+
+#else
+
+#include "host_reduce_kernels.hpp"
+
+namespace mscclpp {
+
+const HostReduceKernels* hostReduceKernelsAvx512() { return nullptr; }
+
+}  // namespace mscclpp
+
+#endif
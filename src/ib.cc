@@ -6,6 +6,7 @@
 #include <malloc.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cstring>
 #include <fstream>
 #include <mscclpp/core.hpp>
@@ -16,6 +17,7 @@
 #include "api.h"
 #include "context.hpp"
 #include "debug.h"
+#include "ib_mr_cache.hpp"
 #if defined(USE_IBVERBS)
 #include "ibverbs_wrapper.hpp"
 #endif  // defined(USE_IBVERBS)
@@ -36,45 +38,42 @@ static bool checkNvPeerMemLoaded() {
 
 namespace mscclpp {
 
-#if defined(USE_IBVERBS)
+IbMr::IbMr(ibv_mr* mr, uint32_t lkey, uint32_t rkey, void* buff, std::size_t size)
+    : mr(mr), lkey(lkey), rkey(rkey), buff(buff), size(size) {}
 
-IbMr::IbMr(ibv_pd* pd, void* buff, std::size_t size) : buff(buff) {
-  if (size == 0) {
-    throw std::invalid_argument("invalid size: " + std::to_string(size));
-  }
-  static __thread uintptr_t pageSize = 0;
-  if (pageSize == 0) {
-    pageSize = sysconf(_SC_PAGESIZE);
-  }
-  uintptr_t addr = reinterpret_cast<uintptr_t>(buff) & -pageSize;
-  std::size_t pages = (size + (reinterpret_cast<uintptr_t>(buff) - addr) + pageSize - 1) / pageSize;
-  this->mr = IBVerbs::ibv_reg_mr2(pd, reinterpret_cast<void*>(addr), pages * pageSize,
-                                  IBV_ACCESS_LOCAL_WRITE | IBV_ACCESS_REMOTE_WRITE | IBV_ACCESS_REMOTE_READ |
-                                      IBV_ACCESS_RELAXED_ORDERING | IBV_ACCESS_REMOTE_ATOMIC);
-  if (this->mr == nullptr) {
-    std::stringstream err;
-    err << "ibv_reg_mr failed (errno " << errno << ")";
-    throw mscclpp::IbError(err.str(), errno);
-  }
-  this->size = pages * pageSize;
-}
-
-IbMr::~IbMr() { IBVerbs::ibv_dereg_mr(this->mr); }
+IbMr::~IbMr() = default;
 
 IbMrInfo IbMr::getInfo() const {
   IbMrInfo info;
   info.addr = reinterpret_cast<uint64_t>(this->buff);
-  info.rkey = this->mr->rkey;
+  info.rkey = this->rkey;
   return info;
 }
 
 const void* IbMr::getBuff() const { return this->buff; }
 
-uint32_t IbMr::getLkey() const { return this->mr->lkey; }
+uint32_t IbMr::getLkey() const { return this->lkey; }
+
+void IbQp::setSignalInterval(int interval) {
+  if (interval < 0 || interval > this->maxSendWr) {
+    throw mscclpp::Error("invalid signal interval: " + std::to_string(interval), ErrorCode::InvalidUsage);
+  }
+  this->signalInterval = interval;
+}
+
+#if defined(USE_IBVERBS)
 
 IbQp::IbQp(ibv_context* ctx, ibv_pd* pd, int port, int maxCqSize, int maxCqPollNum, int maxSendWr, int maxRecvWr,
            int maxWrPerSend)
-    : numSignaledPostedItems(0), numSignaledStagedItems(0), maxCqPollNum(maxCqPollNum), maxWrPerSend(maxWrPerSend) {
+    : numSignaledPostedItems(0),
+      numSignaledStagedItems(0),
+      numUnsignaledItems(0),
+      numPostedWrs(0),
+      signalInterval(0),
+      lastCompletedWrId(0),
+      maxCqPollNum(maxCqPollNum),
+      maxSendWr(maxSendWr),
+      maxWrPerSend(maxWrPerSend) {
   this->cq = IBVerbs::ibv_create_cq(ctx, maxCqSize, nullptr, nullptr, 0);
   if (this->cq == nullptr) {
     std::stringstream err;
@@ -201,13 +200,23 @@ void IbQp::rts() {
   }
 }
 
-IbQp::WrInfo IbQp::getNewWrInfo() {
+IbQp::WrInfo IbQp::getNewWrInfo(bool& signaled) {
   if (this->wrn >= this->maxWrPerSend) {
     std::stringstream err;
     err << "too many outstanding work requests. limit is " << this->maxWrPerSend;
     throw mscclpp::Error(err.str(), ErrorCode::InvalidUsage);
   }
   int wrn = this->wrn;
+  if (!signaled && this->signalInterval > 0 && this->numUnsignaledItems + 1 >= this->signalInterval) {
+    signaled = true;
+  }
+  if (signaled) {
+    this->signaledWrSpans.push_back(this->numUnsignaledItems + 1);
+    this->numUnsignaledItems = 0;
+    this->numSignaledStagedItems++;
+  } else {
+    this->numUnsignaledItems++;
+  }
 
   ibv_send_wr* wr_ = &this->wrs->data()[wrn];
   ibv_sge* sge_ = &this->sges->data()[wrn];
@@ -223,7 +232,7 @@ IbQp::WrInfo IbQp::getNewWrInfo() {
 
 void IbQp::stageSend(const IbMr* mr, const IbMrInfo& info, uint32_t size, uint64_t wrId, uint64_t srcOffset,
                      uint64_t dstOffset, bool signaled) {
-  auto wrInfo = this->getNewWrInfo();
+  auto wrInfo = this->getNewWrInfo(signaled);
   wrInfo.wr->wr_id = wrId;
   wrInfo.wr->opcode = IBV_WR_RDMA_WRITE;
   wrInfo.wr->send_flags = signaled ? IBV_SEND_SIGNALED : 0;
@@ -232,12 +241,11 @@ void IbQp::stageSend(const IbMr* mr, const IbMrInfo& info, uint32_t size, uint64
   wrInfo.sge->addr = (uint64_t)(mr->getBuff()) + srcOffset;
   wrInfo.sge->length = size;
   wrInfo.sge->lkey = mr->getLkey();
-  if (signaled) (this->numSignaledStagedItems)++;
 }
 
 void IbQp::stageAtomicAdd(const IbMr* mr, const IbMrInfo& info, uint64_t wrId, uint64_t dstOffset, uint64_t addVal,
                           bool signaled) {
-  auto wrInfo = this->getNewWrInfo();
+  auto wrInfo = this->getNewWrInfo(signaled);
   wrInfo.wr->wr_id = wrId;
   wrInfo.wr->opcode = IBV_WR_ATOMIC_FETCH_AND_ADD;
   wrInfo.wr->send_flags = signaled ? IBV_SEND_SIGNALED : 0;
@@ -247,12 +255,11 @@ void IbQp::stageAtomicAdd(const IbMr* mr, const IbMrInfo& info, uint64_t wrId, u
   wrInfo.sge->addr = (uint64_t)(mr->getBuff());
   wrInfo.sge->length = sizeof(uint64_t);  // atomic op is always on uint64_t
   wrInfo.sge->lkey = mr->getLkey();
-  if (signaled) (this->numSignaledStagedItems)++;
 }
 
 void IbQp::stageSendWithImm(const IbMr* mr, const IbMrInfo& info, uint32_t size, uint64_t wrId, uint64_t srcOffset,
                             uint64_t dstOffset, bool signaled, unsigned int immData) {
-  auto wrInfo = this->getNewWrInfo();
+  auto wrInfo = this->getNewWrInfo(signaled);
   wrInfo.wr->wr_id = wrId;
   wrInfo.wr->opcode = IBV_WR_RDMA_WRITE_WITH_IMM;
   wrInfo.wr->send_flags = signaled ? IBV_SEND_SIGNALED : 0;
@@ -262,13 +269,44 @@ void IbQp::stageSendWithImm(const IbMr* mr, const IbMrInfo& info, uint32_t size,
   wrInfo.sge->addr = (uint64_t)(mr->getBuff()) + srcOffset;
   wrInfo.sge->length = size;
   wrInfo.sge->lkey = mr->getLkey();
-  if (signaled) (this->numSignaledStagedItems)++;
+}
+
+void IbQp::stageSignal(uint64_t wrId) {
+  bool signaled = true;
+  auto wrInfo = this->getNewWrInfo(signaled);
+  wrInfo.wr->wr_id = wrId;
+  wrInfo.wr->opcode = IBV_WR_RDMA_WRITE;
+  wrInfo.wr->send_flags = IBV_SEND_SIGNALED;
+  // the remote address and key of a zero-length RDMA write are not checked
+  wrInfo.wr->wr.rdma.remote_addr = 0;
+  wrInfo.wr->wr.rdma.rkey = 0;
+  wrInfo.wr->num_sge = 0;
+}
+
+void IbQp::reclaim(int numWrs, int numSignaled) {
+  // Polls completions until the send queue has room for numWrs more work requests and the CQ for numSignaled more
+  // completions. Only signaled work requests complete, so there is nothing to wait for once none is outstanding.
+  while ((this->numPostedWrs + numWrs > this->maxSendWr ||
+          this->numSignaledPostedItems + numSignaled + 4 > this->cq->cqe) &&
+         this->numSignaledPostedItems > 0) {
+    int wcNum = this->pollCq();
+    if (wcNum < 0) {
+      throw mscclpp::IbError("pollCq failed: error no " + std::to_string(errno), errno);
+    }
+    for (int i = 0; i < wcNum; ++i) {
+      int status = this->getWcStatus(i);
+      if (status != static_cast<int>(WsStatus::Success)) {
+        throw mscclpp::IbError("a work item failed: status " + std::to_string(status), status);
+      }
+    }
+  }
 }
 
 void IbQp::postSend() {
   if (this->wrn == 0) {
     return;
   }
+  this->reclaim(this->wrn, this->numSignaledStagedItems);
   struct ibv_send_wr* bad_wr;
   int ret = IBVerbs::ibv_post_send(this->qp, this->wrs->data(), &bad_wr);
   if (ret != 0) {
@@ -276,6 +314,7 @@ void IbQp::postSend() {
     err << "ibv_post_send failed (errno " << errno << ")";
     throw mscclpp::IbError(err.str(), errno);
   }
+  this->numPostedWrs += this->wrn;
   this->wrn = 0;
   this->numSignaledPostedItems += this->numSignaledStagedItems;
   this->numSignaledStagedItems = 0;
@@ -289,6 +328,17 @@ int IbQp::pollCq() {
   int wcNum = IBVerbs::ibv_poll_cq(this->cq, this->maxCqPollNum, this->wcs->data());
   if (wcNum > 0) {
     this->numSignaledPostedItems -= wcNum;
+    // completions arrive in posting order, and each one frees the slots of the work requests up to its own
+    for (int i = 0; i < wcNum && !this->signaledWrSpans.empty(); ++i) {
+      this->numPostedWrs -= this->signaledWrSpans.front();
+      this->signaledWrSpans.pop_front();
+    }
+    for (int i = 0; i < wcNum; ++i) {
+      const ibv_wc& wc = (*this->wcs)[i];
+      if (wc.status == IBV_WC_SUCCESS) {
+        this->lastCompletedWrId = std::max<uint64_t>(this->lastCompletedWrId, wc.wr_id);
+      }
+    }
   }
   return wcNum;
 }
@@ -299,7 +349,8 @@ int IbQp::getNumCqItems() const { return this->numSignaledPostedItems; }
 
 IbCtx::IbCtx(const std::string& devName) : devName(devName) {
 #if !defined(__HIP_PLATFORM_AMD__)
-  if (!checkNvPeerMemLoaded()) {
+  // a software stand-in for the verbs library works on host memory only
+  if (!IBVerbs::isReplaced() && !checkNvPeerMemLoaded()) {
     throw mscclpp::Error("nvidia_peermem kernel module is not loaded", ErrorCode::InternalError);
   }
 #endif  // !defined(__HIP_PLATFORM_AMD__)
@@ -323,10 +374,33 @@ IbCtx::IbCtx(const std::string& devName) : devName(devName) {
     err << "ibv_alloc_pd failed (errno " << errno << ")";
     throw mscclpp::IbError(err.str(), errno);
   }
+
+  std::size_t maxPinnedBytes = SIZE_MAX;
+  if (const char* env = std::getenv("MSCCLPP_IB_MR_CACHE_BYTES")) {
+    try {
+      maxPinnedBytes = std::stoull(env);
+    } catch (const std::exception&) {
+      throw mscclpp::Error("invalid MSCCLPP_IB_MR_CACHE_BYTES: " + std::string(env), ErrorCode::InvalidUsage);
+    }
+  }
+  ibv_pd* pd = this->pd;
+  auto reg = [pd](void* addr, std::size_t size) {
+    ibv_mr* mr = IBVerbs::ibv_reg_mr2(pd, addr, size,
+                                      IBV_ACCESS_LOCAL_WRITE | IBV_ACCESS_REMOTE_WRITE | IBV_ACCESS_REMOTE_READ |
+                                          IBV_ACCESS_RELAXED_ORDERING | IBV_ACCESS_REMOTE_ATOMIC);
+    if (mr == nullptr) {
+      std::stringstream err;
+      err << "ibv_reg_mr failed (errno " << errno << ")";
+      throw mscclpp::IbError(err.str(), errno);
+    }
+    return IbMrRegistration{mr, mr->lkey, mr->rkey};
+  };
+  auto dereg = [](ibv_mr* mr) { IBVerbs::ibv_dereg_mr(mr); };
+  this->mrCache = std::make_shared<IbMrCache>(reg, dereg, maxPinnedBytes);
 }
 
 IbCtx::~IbCtx() {
-  this->mrs.clear();
+  this->mrCache->close();
   this->qps.clear();
   if (this->pd != nullptr) {
     IBVerbs::ibv_dealloc_pd(this->pd);
@@ -376,10 +450,7 @@ IbQp* IbCtx::createQp(int maxCqSize, int maxCqPollNum, int maxSendWr, int maxRec
   return qps.back().get();
 }
 
-const IbMr* IbCtx::registerMr(void* buff, std::size_t size) {
-  mrs.emplace_back(new IbMr(this->pd, buff, size));
-  return mrs.back().get();
-}
+const IbMr* IbCtx::registerMr(void* buff, std::size_t size) { return this->mrCache->acquire(buff, size); }
 
 MSCCLPP_API_CPP int getIBDeviceCount() {
   int num;
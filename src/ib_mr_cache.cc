@@ -0,0 +1,205 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "ib_mr_cache.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <mscclpp/errors.hpp>
+#include <string>
+
+#include "debug.h"
+
+namespace mscclpp {
+
+namespace {
+
+bool lessThan(uintptr_t begin, const void* ptr, uintptr_t otherBegin, const void* otherPtr) {
+  return begin < otherBegin || (begin == otherBegin && ptr < otherPtr);
+}
+
+}  // namespace
+
+IbMrCache::IbMrCache(RegisterFn reg, DeregisterFn dereg, std::size_t maxPinnedBytes)
+    : reg_(std::move(reg)),
+      dereg_(std::move(dereg)),
+      maxPinnedBytes_(maxPinnedBytes),
+      closed_(false),
+      seed_(0x9e3779b9),
+      root_(nullptr),
+      stats_() {}
+
+IbMrCache::~IbMrCache() { close(); }
+
+const IbMr* IbMrCache::acquire(void* buff, std::size_t size) {
+  if (size == 0) {
+    throw std::invalid_argument("invalid size: " + std::to_string(size));
+  }
+  static uintptr_t pageSize = sysconf(_SC_PAGESIZE);
+  uintptr_t begin = reinterpret_cast<uintptr_t>(buff) & -pageSize;
+  uintptr_t end = (reinterpret_cast<uintptr_t>(buff) + size + pageSize - 1) & -pageSize;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (closed_) {
+    throw Error("memory registration cache is closed", ErrorCode::InvalidUsage);
+  }
+  Entry* entry = findCovering(root_, begin, end);
+  if (entry != nullptr) {
+    stats_.hits++;
+    entry->refs++;
+  } else {
+    stats_.misses++;
+    IbMrRegistration reg;
+    try {
+      reg = reg_(reinterpret_cast<void*>(begin), end - begin);
+    } catch (const IbError&) {
+      if (idle_.empty()) throw;
+      // unused registrations may pin the pages that the driver runs short of
+      evictIdle(0);
+      reg = reg_(reinterpret_cast<void*>(begin), end - begin);
+    }
+    entry = new Entry{begin, end, reg, 1, nullptr, nullptr, 0, end};
+    insert(entry);
+    stats_.registrations++;
+    stats_.pinnedBytes += end - begin;
+    evictIdle(maxPinnedBytes_);
+  }
+  std::unique_ptr<IbMr> mr(new IbMr(entry->reg.mr, entry->reg.lkey, entry->reg.rkey, buff, size));
+  const IbMr* ptr = mr.get();
+  mrs_.emplace(ptr, std::make_pair(std::move(mr), entry));
+  return ptr;
+}
+
+void IbMrCache::release(const IbMr* mr) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = mrs_.find(mr);
+  if (it == mrs_.end()) {
+    throw Error("memory region is not from this cache", ErrorCode::InvalidUsage);
+  }
+  Entry* entry = it->second.second;
+  mrs_.erase(it);
+  if (closed_) return;
+  if (--entry->refs == 0) {
+    erase(entry);
+    idle_.push_front(entry);
+    evictIdle(maxPinnedBytes_);
+  }
+}
+
+void IbMrCache::close() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (closed_) return;
+  closed_ = true;
+  while (root_ != nullptr) {
+    Entry* entry = root_;
+    erase(entry);
+    deregister(entry);
+  }
+  for (Entry* entry : idle_) {
+    deregister(entry);
+  }
+  idle_.clear();
+}
+
+void IbMrCache::setMaxPinnedBytes(std::size_t maxPinnedBytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  maxPinnedBytes_ = maxPinnedBytes;
+  evictIdle(maxPinnedBytes_);
+}
+
+IbMrCacheStats IbMrCache::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+void IbMrCache::update(Entry* node) {
+  node->maxEnd = node->end;
+  if (node->left != nullptr) node->maxEnd = std::max(node->maxEnd, node->left->maxEnd);
+  if (node->right != nullptr) node->maxEnd = std::max(node->maxEnd, node->right->maxEnd);
+}
+
+IbMrCache::Entry* IbMrCache::merge(Entry* left, Entry* right) {
+  if (left == nullptr) return right;
+  if (right == nullptr) return left;
+  if (left->priority > right->priority) {
+    left->right = merge(left->right, right);
+    update(left);
+    return left;
+  }
+  right->left = merge(left, right->left);
+  update(right);
+  return right;
+}
+
+void IbMrCache::split(Entry* node, const Entry* key, Entry*& left, Entry*& right) {
+  if (node == nullptr) {
+    left = right = nullptr;
+  } else if (lessThan(node->begin, node, key->begin, key)) {
+    split(node->right, key, node->right, right);
+    left = node;
+    update(left);
+  } else {
+    split(node->left, key, left, node->left);
+    right = node;
+    update(right);
+  }
+}
+
+IbMrCache::Entry* IbMrCache::findCovering(Entry* node, uintptr_t begin, uintptr_t end) {
+  // No range of a subtree covers [begin, end) if the largest end in it is before end.
+  if (node == nullptr || node->maxEnd < end) return nullptr;
+  Entry* found = findCovering(node->left, begin, end);
+  if (found != nullptr) return found;
+  // The ranges of this node and its right subtree start at or after this one.
+  if (node->begin > begin) return nullptr;
+  if (node->end >= end) return node;
+  return findCovering(node->right, begin, end);
+}
+
+void IbMrCache::insert(Entry* entry) {
+  seed_ = seed_ * 1664525 + 1013904223;
+  entry->priority = seed_;
+  Entry* left;
+  Entry* right;
+  split(root_, entry, left, right);
+  root_ = merge(merge(left, entry), right);
+}
+
+IbMrCache::Entry* IbMrCache::remove(Entry* node, const Entry* entry) {
+  if (node == nullptr) {
+    throw Error("memory registration is not cached", ErrorCode::InternalError);
+  }
+  if (node == entry) return merge(node->left, node->right);
+  if (lessThan(entry->begin, entry, node->begin, node)) {
+    node->left = remove(node->left, entry);
+  } else {
+    node->right = remove(node->right, entry);
+  }
+  update(node);
+  return node;
+}
+
+void IbMrCache::erase(Entry* entry) { root_ = remove(root_, entry); }
+
+void IbMrCache::deregister(Entry* entry) {
+  stats_.registrations--;
+  stats_.pinnedBytes -= entry->end - entry->begin;
+  try {
+    dereg_(entry->reg.mr);
+  } catch (const std::exception& e) {
+    WARN("failed to deregister memory at %p: %s", reinterpret_cast<void*>(entry->begin), e.what());
+  }
+  delete entry;
+}
+
+void IbMrCache::evictIdle(std::size_t maxPinnedBytes) {
+  while (stats_.pinnedBytes > maxPinnedBytes && !idle_.empty()) {
+    Entry* entry = idle_.back();
+    idle_.pop_back();
+    deregister(entry);
+    stats_.evictions++;
+  }
+}
+
+}  // namespace mscclpp
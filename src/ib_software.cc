@@ -0,0 +1,513 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "ib_software.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mscclpp/errors.hpp>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "debug.h"
+#if defined(USE_IBVERBS)
+#include "ibverbs_wrapper.hpp"
+#endif  // defined(USE_IBVERBS)
+
+namespace mscclpp {
+
+#if defined(USE_IBVERBS)
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Deadlines closer than this are waited for by spinning, because sleeps are not that precise.
+constexpr auto SoftwareIbSpinThreshold = std::chrono::microseconds(50);
+
+struct SoftwareQp;
+
+// The ibv_cq is the first member, so that the ibv_cq that the verbs see can be cast back.
+struct SoftwareCq {
+  ibv_cq cq;
+  std::deque<ibv_wc> wcs;
+  // The QP of each completion and the number of send queue slots it frees
+  std::deque<std::pair<SoftwareQp*, int>> spans;
+};
+
+struct SoftwareQp {
+  ibv_qp qp;
+  int device;
+  int maxSendWr;
+  int outstanding;
+  int unsignaled;
+  bool error;
+  Clock::time_point busyUntil;
+};
+
+struct WorkRequest {
+  SoftwareQp* qp;
+  uint64_t wrId;
+  ibv_wr_opcode opcode;
+  bool signaled;
+  uint64_t localAddr;
+  uint32_t length;
+  uint32_t lkey;
+  uint64_t remoteAddr;
+  uint32_t rkey;
+  uint64_t addVal;
+};
+
+class SoftwareBackend {
+ public:
+  SoftwareBackend(const SoftwareIbConfig& config);
+  ~SoftwareBackend();
+
+  int postSend(ibv_qp* qp, ibv_send_wr* wr, ibv_send_wr** badWr);
+  int pollCq(ibv_cq* cq, int numEntries, ibv_wc* wc);
+  void removeQp(SoftwareQp* qp);
+
+  const SoftwareIbConfig config;
+  std::vector<ibv_device> devices;
+  std::vector<ibv_device*> deviceList;
+  std::vector<ibv_context> contexts;
+  std::vector<ibv_pd> pds;
+
+  std::mutex mutex;
+  std::vector<SoftwareIbStats> stats;
+  std::unordered_map<uint32_t, ibv_mr*> mrs;
+  uint32_t nextKey;
+  uint32_t nextQpNum;
+
+ private:
+  bool checkMr(uint32_t key, uint64_t addr, uint64_t length) const;
+  void execute(const WorkRequest& wr);
+  void progress();
+
+  // Work requests that wait for their deadlines. Deadlines do not decrease within a QP, so the work requests of a QP
+  // stay in order.
+  std::multimap<Clock::time_point, WorkRequest> pending;
+  std::condition_variable cv;
+  std::thread progressThread;
+  bool stopping;
+};
+
+std::unique_ptr<SoftwareBackend> backend;
+
+int deviceIndex(ibv_context* ctx) { return static_cast<int>(ctx - backend->contexts.data()); }
+
+int softwarePostSend(ibv_qp* qp, ibv_send_wr* wr, ibv_send_wr** badWr) { return backend->postSend(qp, wr, badWr); }
+
+int softwarePollCq(ibv_cq* cq, int numEntries, ibv_wc* wc) { return backend->pollCq(cq, numEntries, wc); }
+
+SoftwareBackend::SoftwareBackend(const SoftwareIbConfig& config)
+    : config(config),
+      devices(config.numDevices),
+      deviceList(config.numDevices + 1, nullptr),
+      contexts(config.numDevices),
+      pds(config.numDevices),
+      stats(config.numDevices),
+      nextKey(0),
+      nextQpNum(0),
+      stopping(false) {
+  for (int i = 0; i < config.numDevices; ++i) {
+    std::memset(&devices[i], 0, sizeof(ibv_device));
+    std::memset(&contexts[i], 0, sizeof(ibv_context));
+    std::memset(&pds[i], 0, sizeof(ibv_pd));
+    std::memset(&stats[i], 0, sizeof(SoftwareIbStats));
+    std::snprintf(devices[i].name, sizeof(devices[i].name), "soft%d", i);
+    devices[i].node_type = IBV_NODE_CA;
+    devices[i].transport_type = IBV_TRANSPORT_IB;
+    deviceList[i] = &devices[i];
+    contexts[i].device = &devices[i];
+    contexts[i].ops.post_send = softwarePostSend;
+    contexts[i].ops.poll_cq = softwarePollCq;
+    pds[i].context = &contexts[i];
+  }
+  if (config.latencyUs > 0 || config.bandwidthGBps > 0) {
+    progressThread = std::thread([this] { progress(); });
+  }
+}
+
+SoftwareBackend::~SoftwareBackend() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  cv.notify_all();
+  if (progressThread.joinable()) {
+    progressThread.join();
+  }
+}
+
+bool SoftwareBackend::checkMr(uint32_t key, uint64_t addr, uint64_t length) const {
+  auto it = mrs.find(key);
+  if (it == mrs.end()) {
+    return false;
+  }
+  uint64_t begin = reinterpret_cast<uint64_t>(it->second->addr);
+  return addr >= begin && addr + length <= begin + it->second->length;
+}
+
+int SoftwareBackend::postSend(ibv_qp* qp, ibv_send_wr* wr, ibv_send_wr** badWr) {
+  auto sqp = reinterpret_cast<SoftwareQp*>(qp);
+  std::unique_lock<std::mutex> lock(mutex);
+  SoftwareIbStats& stat = stats[sqp->device];
+  int count = 0;
+  for (ibv_send_wr* w = wr; w != nullptr; w = w->next) {
+    if (w->num_sge > 1) {
+      *badWr = w;
+      return EINVAL;
+    }
+    ++count;
+  }
+  if (sqp->outstanding + count > sqp->maxSendWr) {
+    stat.sendQueueOverflows++;
+    *badWr = wr;
+    return ENOMEM;
+  }
+  stat.doorbells++;
+  bool executeNow = config.latencyUs <= 0 && config.bandwidthGBps <= 0;
+  Clock::time_point now = Clock::now();
+  for (ibv_send_wr* w = wr; w != nullptr; w = w->next) {
+    WorkRequest item;
+    item.qp = sqp;
+    item.wrId = w->wr_id;
+    item.opcode = w->opcode;
+    item.signaled = (w->send_flags & IBV_SEND_SIGNALED) != 0;
+    item.localAddr = w->num_sge > 0 ? w->sg_list->addr : 0;
+    item.length = w->num_sge > 0 ? w->sg_list->length : 0;
+    item.lkey = w->num_sge > 0 ? w->sg_list->lkey : 0;
+    if (w->opcode == IBV_WR_ATOMIC_FETCH_AND_ADD) {
+      item.remoteAddr = w->wr.atomic.remote_addr;
+      item.rkey = w->wr.atomic.rkey;
+      item.addVal = w->wr.atomic.compare_add;
+    } else {
+      item.remoteAddr = w->wr.rdma.remote_addr;
+      item.rkey = w->wr.rdma.rkey;
+      item.addVal = 0;
+    }
+    stat.workRequests++;
+    sqp->outstanding++;
+    if (executeNow) {
+      execute(item);
+      continue;
+    }
+    Clock::time_point start = std::max(now, sqp->busyUntil);
+    if (config.bandwidthGBps > 0) {
+      start += std::chrono::nanoseconds(static_cast<int64_t>(item.length / config.bandwidthGBps));
+    }
+    sqp->busyUntil = start;
+    pending.emplace(start + std::chrono::nanoseconds(static_cast<int64_t>(config.latencyUs * 1e3)), item);
+  }
+  lock.unlock();
+  if (!executeNow) {
+    cv.notify_one();
+  }
+  return 0;
+}
+
+// Must be called with the mutex held.
+void SoftwareBackend::execute(const WorkRequest& wr) {
+  SoftwareQp* qp = wr.qp;
+  SoftwareIbStats& stat = stats[qp->device];
+  ibv_wc_status status = IBV_WC_SUCCESS;
+  if (qp->error) {
+    // like an HCA, a QP in the error state flushes the rest of its work requests
+    status = IBV_WC_WR_FLUSH_ERR;
+  } else if (wr.opcode == IBV_WR_RDMA_WRITE || wr.opcode == IBV_WR_RDMA_WRITE_WITH_IMM) {
+    if (wr.length > 0) {
+      if (!checkMr(wr.lkey, wr.localAddr, wr.length)) {
+        status = IBV_WC_LOC_PROT_ERR;
+      } else if (!checkMr(wr.rkey, wr.remoteAddr, wr.length)) {
+        status = IBV_WC_REM_ACCESS_ERR;
+      } else {
+        std::memcpy(reinterpret_cast<void*>(wr.remoteAddr), reinterpret_cast<void*>(wr.localAddr), wr.length);
+        stat.bytes += wr.length;
+      }
+    }
+  } else if (wr.opcode == IBV_WR_ATOMIC_FETCH_AND_ADD) {
+    if (!checkMr(wr.lkey, wr.localAddr, sizeof(uint64_t))) {
+      status = IBV_WC_LOC_PROT_ERR;
+    } else if (!checkMr(wr.rkey, wr.remoteAddr, sizeof(uint64_t)) || wr.remoteAddr % sizeof(uint64_t) != 0) {
+      status = IBV_WC_REM_ACCESS_ERR;
+    } else {
+      uint64_t old = __atomic_fetch_add(reinterpret_cast<uint64_t*>(wr.remoteAddr), wr.addVal, __ATOMIC_SEQ_CST);
+      *reinterpret_cast<uint64_t*>(wr.localAddr) = old;
+    }
+  } else {
+    status = IBV_WC_REM_INV_REQ_ERR;
+  }
+  if (status != IBV_WC_SUCCESS) {
+    qp->error = true;
+  }
+
+  qp->unsignaled++;
+  // failed work requests complete even if they are not signaled
+  if (!wr.signaled && status == IBV_WC_SUCCESS) {
+    return;
+  }
+  auto cq = reinterpret_cast<SoftwareCq*>(qp->qp.send_cq);
+  ibv_wc wc;
+  std::memset(&wc, 0, sizeof(wc));
+  wc.wr_id = wr.wrId;
+  wc.status = status;
+  wc.opcode = wr.opcode == IBV_WR_ATOMIC_FETCH_AND_ADD ? IBV_WC_FETCH_ADD : IBV_WC_RDMA_WRITE;
+  wc.byte_len = wr.length;
+  wc.qp_num = qp->qp.qp_num;
+  cq->wcs.push_back(wc);
+  cq->spans.emplace_back(qp, qp->unsignaled);
+  qp->unsignaled = 0;
+  stat.completions++;
+  if (static_cast<int>(cq->wcs.size()) > cq->cq.cqe) {
+    stat.cqOverruns++;
+  }
+}
+
+void SoftwareBackend::progress() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (!stopping) {
+    if (pending.empty()) {
+      cv.wait(lock);
+      continue;
+    }
+    auto it = pending.begin();
+    Clock::time_point deadline = it->first;
+    Clock::time_point now = Clock::now();
+    if (deadline > now + SoftwareIbSpinThreshold) {
+      cv.wait_until(lock, deadline - SoftwareIbSpinThreshold);
+      continue;
+    }
+    if (deadline > now) {
+      lock.unlock();
+      while (Clock::now() < deadline) {
+        std::this_thread::yield();
+      }
+      lock.lock();
+      continue;
+    }
+    execute(it->second);
+    pending.erase(it);
+  }
+}
+
+int SoftwareBackend::pollCq(ibv_cq* cq, int numEntries, ibv_wc* wc) {
+  auto scq = reinterpret_cast<SoftwareCq*>(cq);
+  std::lock_guard<std::mutex> lock(mutex);
+  stats[deviceIndex(cq->context)].polls++;
+  int n = 0;
+  for (; n < numEntries && !scq->wcs.empty(); ++n) {
+    wc[n] = scq->wcs.front();
+    scq->wcs.pop_front();
+    auto span = scq->spans.front();
+    scq->spans.pop_front();
+    if (span.first != nullptr) {
+      span.first->outstanding -= span.second;
+    }
+  }
+  return n;
+}
+
+void SoftwareBackend::removeQp(SoftwareQp* qp) {
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto it = pending.begin(); it != pending.end();) {
+    it = it->second.qp == qp ? pending.erase(it) : std::next(it);
+  }
+  // completions that are still in the CQ must not refer to the QP anymore
+  for (auto& span : reinterpret_cast<SoftwareCq*>(qp->qp.send_cq)->spans) {
+    if (span.first == qp) span.first = nullptr;
+  }
+}
+
+ibv_device** softwareGetDeviceList(int* num) {
+  *num = backend->config.numDevices;
+  return backend->deviceList.data();
+}
+
+void softwareFreeDeviceList(ibv_device**) {}
+
+ibv_context* softwareOpenDevice(ibv_device* device) {
+  return &backend->contexts[device - backend->devices.data()];
+}
+
+int softwareCloseDevice(ibv_context*) { return 0; }
+
+ibv_pd* softwareAllocPd(ibv_context* ctx) { return &backend->pds[deviceIndex(ctx)]; }
+
+int softwareDeallocPd(ibv_pd*) { return 0; }
+
+int softwareQueryDevice(ibv_context*, ibv_device_attr* attr) {
+  std::memset(attr, 0, sizeof(*attr));
+  attr->phys_port_cnt = 1;
+  return 0;
+}
+
+int softwareQueryPort(ibv_context* ctx, uint8_t port, ibv_port_attr* attr) {
+  if (port != 1) {
+    errno = EINVAL;
+    return -1;
+  }
+  std::memset(attr, 0, sizeof(*attr));
+  attr->state = IBV_PORT_ACTIVE;
+  attr->link_layer = IBV_LINK_LAYER_INFINIBAND;
+  attr->max_mtu = IBV_MTU_4096;
+  attr->active_mtu = IBV_MTU_4096;
+  attr->lid = deviceIndex(ctx) + 1;
+  return 0;
+}
+
+int softwareQueryGid(ibv_context* ctx, uint8_t, int, ibv_gid* gid) {
+  std::memset(gid, 0, sizeof(*gid));
+  gid->global.interface_id = deviceIndex(ctx) + 1;
+  return 0;
+}
+
+ibv_cq* softwareCreateCq(ibv_context* ctx, int cqe, void* cqContext, ibv_comp_channel* channel, int) {
+  auto cq = new SoftwareCq();
+  std::memset(&cq->cq, 0, sizeof(ibv_cq));
+  cq->cq.context = ctx;
+  cq->cq.channel = channel;
+  cq->cq.cq_context = cqContext;
+  cq->cq.cqe = cqe;
+  return &cq->cq;
+}
+
+int softwareDestroyCq(ibv_cq* cq) {
+  delete reinterpret_cast<SoftwareCq*>(cq);
+  return 0;
+}
+
+ibv_qp* softwareCreateQp(ibv_pd* pd, ibv_qp_init_attr* attr) {
+  if (attr->qp_type != IBV_QPT_RC) {
+    errno = EINVAL;
+    return nullptr;
+  }
+  auto qp = new SoftwareQp();
+  std::memset(&qp->qp, 0, sizeof(ibv_qp));
+  qp->qp.context = pd->context;
+  qp->qp.pd = pd;
+  qp->qp.send_cq = attr->send_cq;
+  qp->qp.recv_cq = attr->recv_cq;
+  qp->qp.qp_type = attr->qp_type;
+  qp->qp.state = IBV_QPS_RESET;
+  qp->device = deviceIndex(pd->context);
+  qp->maxSendWr = attr->cap.max_send_wr;
+  qp->outstanding = 0;
+  qp->unsignaled = 0;
+  qp->error = false;
+  std::lock_guard<std::mutex> lock(backend->mutex);
+  qp->qp.qp_num = ++backend->nextQpNum;
+  return &qp->qp;
+}
+
+int softwareDestroyQp(ibv_qp* qp) {
+  auto sqp = reinterpret_cast<SoftwareQp*>(qp);
+  backend->removeQp(sqp);
+  delete sqp;
+  return 0;
+}
+
+int softwareModifyQp(ibv_qp* qp, ibv_qp_attr* attr, int attrMask) {
+  if (attrMask & IBV_QP_STATE) {
+    qp->state = attr->qp_state;
+  }
+  return 0;
+}
+
+ibv_mr* softwareRegMr(ibv_pd* pd, void* addr, size_t length, int) {
+  auto mr = new ibv_mr();
+  std::memset(mr, 0, sizeof(ibv_mr));
+  mr->context = pd->context;
+  mr->pd = pd;
+  mr->addr = addr;
+  mr->length = length;
+  std::lock_guard<std::mutex> lock(backend->mutex);
+  mr->lkey = mr->rkey = ++backend->nextKey;
+  backend->mrs[mr->lkey] = mr;
+  return mr;
+}
+
+ibv_mr* softwareRegMrIova2(ibv_pd* pd, void* addr, size_t length, uint64_t, unsigned int access) {
+  return softwareRegMr(pd, addr, length, access);
+}
+
+int softwareDeregMr(ibv_mr* mr) {
+  {
+    std::lock_guard<std::mutex> lock(backend->mutex);
+    backend->mrs.erase(mr->lkey);
+  }
+  delete mr;
+  return 0;
+}
+
+}  // namespace
+
+void SoftwareIb::install(const SoftwareIbConfig& config) {
+  if (config.numDevices <= 0 || config.latencyUs < 0 || config.bandwidthGBps < 0) {
+    throw Error("Invalid software IB config", ErrorCode::InvalidUsage);
+  }
+  backend = std::make_unique<SoftwareBackend>(config);
+  IBVerbs::setFunctions({softwareGetDeviceList, softwareFreeDeviceList, softwareAllocPd, softwareDeallocPd,
+                         softwareOpenDevice, softwareCloseDevice, softwareQueryDevice, softwareCreateCq,
+                         softwareCreateQp, softwareDestroyCq, softwareDestroyQp, softwareRegMr, softwareDeregMr,
+                         softwareQueryGid, softwareModifyQp, softwareQueryPort, softwareRegMrIova2});
+  INFO(MSCCLPP_NET, "Software IB backend installed with %d devices, latency %f us, bandwidth %f GB/s",
+       config.numDevices, config.latencyUs, config.bandwidthGBps);
+}
+
+void SoftwareIb::uninstall() {
+  IBVerbs::resetFunctions();
+  backend.reset();
+}
+
+SoftwareIbStats SoftwareIb::stats(int index) {
+  if (!backend || index < 0 || index >= backend->config.numDevices) {
+    throw Error("No software IB device " + std::to_string(index), ErrorCode::InvalidUsage);
+  }
+  std::lock_guard<std::mutex> lock(backend->mutex);
+  return backend->stats[index];
+}
+
+#else  // !defined(USE_IBVERBS)
+
+void SoftwareIb::install(const SoftwareIbConfig&) {
+  throw Error("The software IB backend needs a build with IB verbs", ErrorCode::InvalidUsage);
+}
+
+void SoftwareIb::uninstall() {}
+
+SoftwareIbStats SoftwareIb::stats(int) {
+  throw Error("The software IB backend needs a build with IB verbs", ErrorCode::InvalidUsage);
+}
+
+#endif  // !defined(USE_IBVERBS)
+
+SoftwareIbConfig SoftwareIb::configFromEnv() {
+  SoftwareIbConfig config;
+  auto get = [](const char* name, double value) {
+    const char* env = getenv(name);
+    if (env == nullptr) {
+      return value;
+    }
+    try {
+      return std::stod(env);
+    } catch (const std::exception&) {
+      throw Error(std::string("Invalid ") + name + ": " + env, ErrorCode::InvalidUsage);
+    }
+  };
+  config.numDevices = static_cast<int>(get("MSCCLPP_SOFTWARE_IB_DEVICES", config.numDevices));
+  config.latencyUs = get("MSCCLPP_SOFTWARE_IB_LATENCY_US", config.latencyUs);
+  config.bandwidthGBps = get("MSCCLPP_SOFTWARE_IB_BANDWIDTH_GBPS", config.bandwidthGBps);
+  return config;
+}
+
+}  // namespace mscclpp
@@ -4,8 +4,13 @@
 #ifndef MSCCLPP_CONNECTION_HPP_
 #define MSCCLPP_CONNECTION_HPP_
 
+#include <condition_variable>
+#include <deque>
+#include <exception>
 #include <mscclpp/core.hpp>
 #include <mscclpp/gpu.hpp>
+#include <mutex>
+#include <thread>
 
 #include "communicator.hpp"
 #include "context.hpp"
@@ -17,10 +22,27 @@ namespace mscclpp {
 
 class CudaIpcConnection : public Connection {
   cudaStream_t stream_;
+  // Events recorded on the stream after the requests that may not be complete yet, in order. The first one belongs to
+  // request firstRequest_. The stream completes them in order.
+  std::deque<cudaEvent_t> requestEvents_;
+  uint64_t firstRequest_;
+  std::vector<cudaEvent_t> freeEvents_;
+
+  // Returns a request that completes with the transfers issued on the stream so far.
+  Request record();
+
+  // Recycles the events of the requests that are complete.
+  void progress();
+
+ protected:
+  bool testRequest(uint64_t id) override;
+  void waitRequest(uint64_t id, int64_t timeoutUsec) override;
 
  public:
   CudaIpcConnection(Endpoint localEndpoint, Endpoint remoteEndpoint, cudaStream_t stream);
 
+  ~CudaIpcConnection();
+
   Transport transport() override;
 
   Transport remoteTransport() override;
@@ -30,6 +52,10 @@ class CudaIpcConnection : public Connection {
   void updateAndSync(RegisteredMemory dst, uint64_t dstOffset, uint64_t* src, uint64_t newValue) override;
 
   void flush(int64_t timeoutUsec) override;
+
+  Request writeAsync(RegisteredMemory dst, uint64_t dstOffset, RegisteredMemory src, uint64_t srcOffset,
+                     uint64_t size) override;
+  Request updateAndSyncAsync(RegisteredMemory dst, uint64_t dstOffset, uint64_t* src, uint64_t newValue) override;
 };
 
 class IBConnection : public Connection {
@@ -39,10 +65,112 @@ class IBConnection : public Connection {
   std::unique_ptr<uint64_t> dummyAtomicSource_;  // not used anywhere but IB needs a source
   RegisteredMemory dummyAtomicSourceMem_;
   mscclpp::TransportInfo dstTransportInfo_;
+  bool batching_;
+  // The id of the latest request. Every work request carries it as its wr_id, so the completion of a work request
+  // tells that all requests up to its wr_id are complete.
+  uint64_t lastRequest_;
+
+  // Posts the staged work requests, unless a batch defers them to endBatch().
+  void post();
+
+  void stageWrite(RegisteredMemory dst, uint64_t dstOffset, RegisteredMemory src, uint64_t srcOffset, uint64_t size,
+                  bool signaled);
+  void stageUpdate(RegisteredMemory dst, uint64_t dstOffset, uint64_t* src, uint64_t newValue, bool signaled);
+
+  // Polls the CQ once and throws if a work request failed. Returns the number of completions.
+  int poll();
+
+ protected:
+  bool testRequest(uint64_t id) override;
 
  public:
   IBConnection(Endpoint localEndpoint, Endpoint remoteEndpoint, Context& context);
 
+  /// Connects @p qp, a QP of the NIC of @p transport, to the remote QP described by @p remoteQpInfo.
+  IBConnection(Transport transport, Transport remoteTransport, IbQp* qp, const IbQpInfo& remoteQpInfo,
+               Context& context);
+
+  Transport transport() override;
+
+  Transport remoteTransport() override;
+
+  void write(RegisteredMemory dst, uint64_t dstOffset, RegisteredMemory src, uint64_t srcOffset,
+             uint64_t size) override;
+  void updateAndSync(RegisteredMemory dst, uint64_t dstOffset, uint64_t* src, uint64_t newValue) override;
+
+  void flush(int64_t timeoutUsec) override;
+
+  Request writeAsync(RegisteredMemory dst, uint64_t dstOffset, RegisteredMemory src, uint64_t srcOffset,
+                     uint64_t size) override;
+  Request updateAndSyncAsync(RegisteredMemory dst, uint64_t dstOffset, uint64_t* src, uint64_t newValue) override;
+
+  /// Starts a batch: later writes and atomics are only staged, and endBatch() posts all of them with a single doorbell.
+  /// Calling it again within a batch has no effect.
+  void beginBatch();
+
+  /// Ends the batch and posts the work requests staged since beginBatch().
+  void endBatch();
+};
+
+/// An IB connection over several NICs, one IBConnection per rail. Writes of at least a threshold are split evenly
+/// across the rails; smaller ones and all updateAndSync values go over the rail of the endpoint transport. Before an
+/// updateAndSync, the other rails that carried data since the last one are flushed, so the value lands after all
+/// data written before it.
+class MultiRailIBConnection : public Connection {
+  std::vector<std::unique_ptr<Connection>> rails_;
+  // Whether each rail carried a write since the last updateAndSync. The first rail orders its writes itself.
+  std::vector<bool> pending_;
+  uint64_t threshold_;
+  // The requests of the rails that make up each request that may not be complete yet, in order. The first one is
+  // request firstRequest_.
+  std::deque<std::vector<Request>> requests_;
+  uint64_t firstRequest_;
+
+  // Waits for the writes of the rails other than the first since the last updateAndSync.
+  void fence();
+
+  // Drops the requests that are complete.
+  void progress();
+
+  Request push(std::vector<Request> railRequests);
+
+ protected:
+  bool testRequest(uint64_t id) override;
+
+ public:
+  MultiRailIBConnection(Endpoint localEndpoint, Endpoint remoteEndpoint, Context& context);
+
+  Transport transport() override;
+
+  Transport remoteTransport() override;
+
+  void write(RegisteredMemory dst, uint64_t dstOffset, RegisteredMemory src, uint64_t srcOffset,
+             uint64_t size) override;
+  void updateAndSync(RegisteredMemory dst, uint64_t dstOffset, uint64_t* src, uint64_t newValue) override;
+
+  void flush(int64_t timeoutUsec) override;
+
+  Request writeAsync(RegisteredMemory dst, uint64_t dstOffset, RegisteredMemory src, uint64_t srcOffset,
+                     uint64_t size) override;
+  Request updateAndSyncAsync(RegisteredMemory dst, uint64_t dstOffset, uint64_t* src, uint64_t newValue) override;
+
+  /// Starts a batch on every rail. See IBConnection::beginBatch().
+  void beginBatch();
+
+  /// Ends the batch on every rail, which posts the work requests of each rail with a single doorbell.
+  void endBatch();
+
+  /// Returns the number of rails.
+  int numRails() const;
+};
+
+/// A connection between processes of the same host through host shared memory. Writes copy into the mapping of the
+/// destination and updateAndSync stores the value with release semantics, so both are complete when they return.
+/// Destinations must be allocated by allocSharedShm() or allocUniqueShm(); sources may be any host memory.
+class SharedMemoryConnection : public Connection {
+ public:
+  SharedMemoryConnection(Endpoint localEndpoint, Endpoint remoteEndpoint);
+
   Transport transport() override;
 
   Transport remoteTransport() override;
@@ -52,21 +180,97 @@ class IBConnection : public Connection {
   void updateAndSync(RegisteredMemory dst, uint64_t dstOffset, uint64_t* src, uint64_t newValue) override;
 
   void flush(int64_t timeoutUsec) override;
+
+  Request writeAsync(RegisteredMemory dst, uint64_t dstOffset, RegisteredMemory src, uint64_t srcOffset,
+                     uint64_t size) override;
+  Request updateAndSyncAsync(RegisteredMemory dst, uint64_t dstOffset, uint64_t* src, uint64_t newValue) override;
+};
+
+/// The copy step of the Ethernet data path. It owns pinned host staging buffers and copies between them and device
+/// memory asynchronously, so that the copy into one buffer overlaps the socket transfer of another. Host memory is
+/// sent and received in place and never goes through a copier.
+class StagingCopier {
+ public:
+  virtual ~StagingCopier() = default;
+
+  /// Returns the staging buffer at @p index.
+  virtual char* buffer(int index) = 0;
+
+  /// Starts copying @p size bytes from @p src to @p dst, where one of them is in the staging buffer at @p index.
+  virtual void copyAsync(void* dst, const void* src, uint64_t size, int index) = 0;
+
+  /// Waits until the last copy started on the staging buffer at @p index completes.
+  virtual void wait(int index) = 0;
 };
 
 class EthernetConnection : public Connection {
-  std::unique_ptr<Socket> sendSocket_;
-  std::unique_ptr<Socket> recvSocket_;
-  std::thread threadRecvMessages_;
+  // A chunk of a write that waits for a sender thread. Staged chunks are read from a staging buffer after its copy
+  // completes. Host memory is read in place, and updateAndSync values are carried in the item itself.
+  struct SendItem {
+    char* dstPtr;
+    uint64_t size;
+    const char* data;
+    int buffer;  // index of the staging buffer, or -1 if the data is not staged
+    uint64_t value;
+    uint32_t flags;
+    uint64_t seq;
+  };
+
+  // One socket that sends to the peer, with its sender and acknowledgement threads. Every chunk carries a sequence
+  // number of its stream. The receiver acknowledges the highest one whose data has landed, and acknowledgements are
+  // cumulative.
+  struct SendStream {
+    std::unique_ptr<Socket> socket;
+    std::thread threadSendMessages;
+    std::thread threadRecvAcks;
+    std::deque<SendItem> queue;
+    uint64_t lastSeq = 0;
+    uint64_t ackedSeq = 0;
+    // Sends with MSG_ZEROCOPY issued and completed by the kernel
+    uint64_t zeroCopySends = 0;
+    uint64_t zeroCopyCompleted = 0;
+  };
+
+  // One socket that receives from the peer, with its receiver thread and staging buffers.
+  struct RecvStream {
+    std::unique_ptr<Socket> socket;
+    std::thread threadRecvMessages;
+    // Created on the first transfer to device memory.
+    std::unique_ptr<StagingCopier> copier;
+    // How many fence markers this stream has passed, with every message before them landed.
+    uint64_t markers = 0;
+  };
+
+  std::vector<std::unique_ptr<SendStream>> sendStreams_;
+  std::vector<std::unique_ptr<RecvStream>> recvStreams_;
   volatile uint32_t* abortFlag_;
-  const uint64_t sendBufferSize_;
-  const uint64_t recvBufferSize_;
-  std::vector<char> sendBuffer_;
-  std::vector<char> recvBuffer_;
+  const int numStagingBuffers_;
+  const uint64_t stagingBufferSize_;
+  const uint64_t stripeSize_;
+  uint64_t zeroCopyThreshold_;
+  // Created on the first transfer from device memory and shared by the send streams.
+  std::unique_ptr<StagingCopier> sendCopier_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<int> freeSendBuffers_;
+  // The send stream that takes the next stripe
+  size_t nextStream_;
+  bool stopSending_;
+  std::exception_ptr sendError_;
+
+  // Guards the markers of the receive streams
+  std::mutex recvMutex_;
+  std::condition_variable recvCv_;
+  bool recvClosed_;
+
+  // The last sequence numbers of the send streams when each request that may not be complete yet was queued, in
+  // order. The first one is request firstRequest_. Guarded by mutex_.
+  std::deque<std::vector<uint64_t>> requestSeqs_;
+  uint64_t firstRequest_;
 
  public:
-  EthernetConnection(Endpoint localEndpoint, Endpoint remoteEndpoint, uint64_t sendBufferSize = 256 * 1024 * 1024,
-                     uint64_t recvBufferSize = 256 * 1024 * 1024);
+  EthernetConnection(Endpoint localEndpoint, Endpoint remoteEndpoint);
 
   ~EthernetConnection();
 
@@ -80,10 +284,31 @@ class EthernetConnection : public Connection {
 
   void flush(int64_t timeoutUsec) override;
 
+  Request writeAsync(RegisteredMemory dst, uint64_t dstOffset, RegisteredMemory src, uint64_t srcOffset,
+                     uint64_t size) override;
+  Request updateAndSyncAsync(RegisteredMemory dst, uint64_t dstOffset, uint64_t* src, uint64_t newValue) override;
+
+ protected:
+  bool testRequest(uint64_t id) override;
+  void waitRequest(uint64_t id, int64_t timeoutUsec) override;
+
  private:
-  void recvMessages();
+  int acquireSendBuffer();
+
+  // Returns a request that completes with the messages queued so far.
+  Request record();
+
+  // Returns true if the receiver acknowledged the messages up to seqs on every stream. Must be called with mutex_ held.
+  bool acked(const std::vector<uint64_t>& seqs) const;
+
+  // Must be called with mutex_ held.
+  void enqueue(SendStream& stream, const SendItem& item);
+
+  void sendMessages(SendStream& stream);
+
+  void recvMessages(RecvStream& stream);
 
-  void sendMessage();
+  void recvAcks(SendStream& stream);
 };
 
 }  // namespace mscclpp
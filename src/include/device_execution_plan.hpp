@@ -0,0 +1,43 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#ifndef MSCCLPP_DEVICE_EXECUTION_PLAN_HPP_
+#define MSCCLPP_DEVICE_EXECUTION_PLAN_HPP_
+
+#include <vector>
+
+#include "execution_common.hpp"
+
+namespace mscclpp {
+
+// The channels and operations of one threadblock, before they are encoded for executionKernel.
+struct ThreadblockExecutionPlan {
+  std::vector<DeviceHandle<SmChannel>> smChannels;
+  std::vector<DeviceHandle<ProxyChannel>> proxyChannels;
+  std::vector<DeviceHandle<NvlsConnection::DeviceMulticastPointer>> nvlsChannels;
+  std::vector<Operation> operations;
+};
+
+// The plans of all threadblocks of one rank in the layout of DeviceExecutionPlan, ready to be copied to the GPU.
+struct EncodedExecutionPlans {
+  // A table of the byte offsets of the threadblock plans, padded to 16 bytes, followed by the plans.
+  std::vector<char> data;
+  int nThreadblocks = 0;
+  // The size of the largest threadblock plan, that is, the shared memory that executionKernel needs for it.
+  size_t maxPlanSize = 0;
+};
+
+// Returns the size of the DeviceOperation record of `op`.
+size_t getDeviceOperationSize(const Operation& op);
+
+// Encodes the plans of the threadblocks of one rank. Throws an ExecutorError if a threadblock has more operations or
+// channels than the plan header can count, or if its plan is larger than MAX_DEVICE_EXECUTION_PLAN_SIZE.
+EncodedExecutionPlans encodeDeviceExecutionPlans(const std::vector<ThreadblockExecutionPlan>& threadblocks);
+
+// Decodes the plan of one threadblock. The operations compare equal byte for byte to the encoded ones if those were
+// zero-initialized, as lowerExecutionPlan() and readBinaryExecutionPlan() create them.
+ThreadblockExecutionPlan decodeDeviceExecutionPlan(const EncodedExecutionPlans& plans, int threadblock);
+
+}  // namespace mscclpp
+
+#endif  // MSCCLPP_DEVICE_EXECUTION_PLAN_HPP_
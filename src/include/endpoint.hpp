@@ -25,12 +25,23 @@ struct Endpoint::Impl {
   bool ibLocal_;
   IbQp* ibQp_;
   IbQpInfo ibQpInfo_;
+  // The rails of a multi-rail connection other than transport_, in transport order, with one QP each. Serialized.
+  std::vector<Transport> ibRailTransports_;
+  std::vector<IbQp*> ibRailQps_;
+  std::vector<IbQpInfo> ibRailQpInfos_;
+  uint64_t ibMultiRailThreshold_;
 
   // The following are only used for Ethernet and are undefined for other transports.
   std::unique_ptr<Socket> socket_;
   SocketAddress socketAddress_;
   volatile uint32_t* abortFlag_;
   char netIfName_[MAX_IF_NAME_SIZE + 1];
+  int ethernetNumStagingBuffers_;
+  int ethernetStagingBufferSize_;
+  int ethernetZeroCopyThreshold_;
+  int ethernetStripeSize_;
+  // Serialized, since the receiving end accepts one socket per stream of the sending end.
+  int ethernetNumStreams_;
 };
 
 }  // namespace mscclpp
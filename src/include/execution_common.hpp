@@ -10,9 +10,10 @@
 
 namespace mscclpp {
 
-constexpr int MAX_CHANNEL = 16;
 constexpr int MAX_CHANNEL_PER_OPERATION = 8;
-constexpr int MAX_OPERATION = 64;
+// The largest plan of one threadblock. executionKernel copies it into dynamic shared memory, and this leaves room for
+// the NPKit event buffer within the 48 KiB that a kernel gets without opting in to more.
+constexpr size_t MAX_DEVICE_EXECUTION_PLAN_SIZE = 44 * 1024;
 
 enum class BufferType : uint8_t {
   NONE,
@@ -52,12 +53,6 @@ enum class OperationType : uint8_t {
   MULTI_LOAD_REDUCE_STORE,
 };
 
-struct Channels {
-  mscclpp::DeviceHandle<mscclpp::SmChannel> smChannels[MAX_CHANNEL];
-  mscclpp::DeviceHandle<mscclpp::ProxyChannel> proxyChannels[MAX_CHANNEL];
-  mscclpp::DeviceHandle<mscclpp::NvlsConnection::DeviceMulticastPointer> nvlsChannels[MAX_CHANNEL];
-};
-
 struct Operation {
   OperationType type;
   ChannelType channelType;
@@ -65,6 +60,13 @@ struct Operation {
   BufferType dstBufferType;
   uint8_t nInputs;
   uint8_t nOutputs;
+  // Offsets and size are stored in chunk units and converted to bytes by ChunkLayout::resolve when the kernel starts.
+  // The fields below tell which of them refer to chunks. The offsets buffer types also select the constant offset
+  // (NONE if the offsets are unused).
+  BufferType inputOffsetsBufferType;
+  BufferType outputOffsetsBufferType;
+  bool hasSrcOffset;
+  bool hasDstOffset;
   union {
     // For ops which require reading from multiple remote sources
     uint8_t inputChannelIndexes[MAX_CHANNEL_PER_OPERATION];
@@ -90,18 +92,165 @@ struct Operation {
       uint32_t outputOffsets[MAX_CHANNEL_PER_OPERATION];
       uint32_t srcOffset;
       uint32_t dstOffset;
+      // number of chunks before ChunkLayout::resolve, bytes after
+      uint32_t size;
+    };
+  };
+};
+
+// An Operation as executionKernel reads it: a fixed head followed by only the offsets and channel indexes that the
+// operation has, so that most operations take 28 to 40 bytes instead of 104. The arrays follow the head in this order,
+// and the record is padded to 4 bytes:
+//   uint32_t inputOffsets[nOffsets];
+//   uint32_t outputOffsets[nOffsets];
+//   uint8_t inputChannelIndexes[nIndexes];
+//   uint8_t outputChannelIndexes[nIndexes];
+// Like in Operation, the first input and output channel index double as the buffer types of local inputs and
+// outputs and as the NVLS channel indexes.
+struct DeviceOperation {
+  OperationType type;
+  ChannelType channelType;
+  BufferType srcBufferType;
+  BufferType dstBufferType;
+  uint8_t nInputs;
+  uint8_t nOutputs;
+  BufferType inputOffsetsBufferType;
+  BufferType outputOffsetsBufferType;
+  bool hasSrcOffset;
+  bool hasDstOffset;
+  // max(nInputs, nOutputs), since some operations index the input offsets by output and the other way around
+  uint8_t nOffsets;
+  // max(nInputs, nOutputs, 1)
+  uint8_t nIndexes;
+  union {
+    // For Barrier operation
+    struct {
+      uint32_t deviceSyncerIndex;
+      uint32_t nThreadBlocks;
+    };
+    struct {
+      uint32_t srcOffset;
+      uint32_t dstOffset;
+      // number of chunks before ChunkLayout::resolve, bytes after
       uint32_t size;
     };
   };
+
+  static MSCCLPP_HOST_DEVICE_INLINE uint32_t recordSize(uint8_t nOffsets, uint8_t nIndexes) {
+    return (sizeof(DeviceOperation) + 2 * nOffsets * sizeof(uint32_t) + 2 * nIndexes + 3) / 4 * 4;
+  }
+  MSCCLPP_HOST_DEVICE_INLINE uint32_t recordSize() const { return recordSize(nOffsets, nIndexes); }
+  MSCCLPP_HOST_DEVICE_INLINE uint32_t* inputOffsets() { return reinterpret_cast<uint32_t*>(this + 1); }
+  MSCCLPP_HOST_DEVICE_INLINE uint32_t* outputOffsets() { return inputOffsets() + nOffsets; }
+  MSCCLPP_HOST_DEVICE_INLINE uint8_t* inputChannelIndexes() {
+    return reinterpret_cast<uint8_t*>(outputOffsets() + nOffsets);
+  }
+  MSCCLPP_HOST_DEVICE_INLINE uint8_t* outputChannelIndexes() { return inputChannelIndexes() + nIndexes; }
+  MSCCLPP_HOST_DEVICE_INLINE BufferType inputBufferType() { return static_cast<BufferType>(inputChannelIndexes()[0]); }
+  MSCCLPP_HOST_DEVICE_INLINE uint8_t nvlsInputIndex() { return inputChannelIndexes()[0]; }
+  MSCCLPP_HOST_DEVICE_INLINE uint8_t nvlsOutputIndex() { return outputChannelIndexes()[0]; }
 };
 
-// total size = 2304 + 6400 + 4 + 12(padding) = 8720 bytes
+// The plan of one threadblock. This header is followed by the device handles of the channels of the threadblock, a
+// table of the byte offsets of its operations from the header, and the DeviceOperation records. The handle arrays and
+// the table start 16-byte aligned. The executor uploads the plans of all threadblocks of a rank in one buffer that
+// starts with a table of the byte offsets of the plans (see encodeDeviceExecutionPlans), and each block copies only
+// its own plan into shared memory.
 struct __attribute__((aligned(16))) DeviceExecutionPlan {
-  uint8_t nSmChannels;                  // 1 bytes
-  uint8_t nProxyChannels;               // 1 bytes
-  uint16_t nOperations;                 // 2 bytes
-  Channels channels;                    // 2304 bytes
-  Operation operations[MAX_OPERATION];  // 64 * 100 = 6400 bytes
+  // bytes of the whole plan, a multiple of 16
+  uint32_t size;
+  uint16_t nOperations;
+  uint8_t nSmChannels;
+  uint8_t nProxyChannels;
+  uint8_t nNvlsChannels;
+
+  static MSCCLPP_HOST_DEVICE_INLINE size_t alignUp(size_t bytes) { return (bytes + 15) / 16 * 16; }
+
+  MSCCLPP_HOST_DEVICE_INLINE DeviceHandle<SmChannel>* smChannels() {
+    return reinterpret_cast<DeviceHandle<SmChannel>*>(reinterpret_cast<char*>(this) + sizeof(DeviceExecutionPlan));
+  }
+  MSCCLPP_HOST_DEVICE_INLINE DeviceHandle<ProxyChannel>* proxyChannels() {
+    return reinterpret_cast<DeviceHandle<ProxyChannel>*>(reinterpret_cast<char*>(smChannels()) +
+                                                         alignUp(nSmChannels * sizeof(DeviceHandle<SmChannel>)));
+  }
+  MSCCLPP_HOST_DEVICE_INLINE DeviceHandle<NvlsConnection::DeviceMulticastPointer>* nvlsChannels() {
+    return reinterpret_cast<DeviceHandle<NvlsConnection::DeviceMulticastPointer>*>(
+        reinterpret_cast<char*>(proxyChannels()) + alignUp(nProxyChannels * sizeof(DeviceHandle<ProxyChannel>)));
+  }
+  MSCCLPP_HOST_DEVICE_INLINE uint32_t* operationOffsets() {
+    return reinterpret_cast<uint32_t*>(
+        reinterpret_cast<char*>(nvlsChannels()) +
+        alignUp(nNvlsChannels * sizeof(DeviceHandle<NvlsConnection::DeviceMulticastPointer>)));
+  }
+  MSCCLPP_HOST_DEVICE_INLINE DeviceOperation& operation(int i) {
+    return *reinterpret_cast<DeviceOperation*>(reinterpret_cast<char*>(this) + operationOffsets()[i]);
+  }
+};
+
+// Maps chunk indexes to byte offsets on one rank for one message size. The host computes it for every launch
+// (see CompiledExecutionPlan::getChunkLayout), which lets a single device plan serve all message sizes of a plan.
+struct ChunkLayout {
+  uint32_t nelemsPerGroup;
+  uint32_t nChunksPerGroup;
+  uint32_t minNelems;
+  uint32_t remainder;
+  uint32_t alignment;
+  uint32_t constSrcOffset;
+  uint32_t constDstOffset;
+
+  MSCCLPP_HOST_DEVICE_INLINE uint32_t getOffset(uint32_t chunkIndex) const {
+    uint32_t groupIdx = chunkIndex / nChunksPerGroup;
+    uint32_t chunkIndexInGroup = chunkIndex % nChunksPerGroup;
+    uint32_t offset = groupIdx * nelemsPerGroup + chunkIndexInGroup * minNelems +
+                      (chunkIndexInGroup % nelemsPerGroup < remainder ? chunkIndexInGroup % nelemsPerGroup : remainder);
+    return offset * alignment;
+  }
+
+  MSCCLPP_HOST_DEVICE_INLINE uint32_t getConstOffset(BufferType type) const {
+    if (type == BufferType::INPUT) return constSrcOffset;
+    if (type == BufferType::OUTPUT) return constDstOffset;
+    return 0;
+  }
+
+  // Converts the chunk-unit offsets and size of `op` into bytes. The size is the first non-zero size of the chunks the
+  // operation refers to; the host checks that the referenced chunks agree before launching.
+  MSCCLPP_HOST_DEVICE_INLINE void resolve(Operation& op) const { resolve(op, op.inputOffsets, op.outputOffsets); }
+  MSCCLPP_HOST_DEVICE_INLINE void resolve(DeviceOperation& op) const {
+    resolve(op, op.inputOffsets(), op.outputOffsets());
+  }
+
+ private:
+  template <typename Op>
+  MSCCLPP_HOST_DEVICE_INLINE void resolve(Op& op, uint32_t* inputOffsets, uint32_t* outputOffsets) const {
+    const uint32_t nChunks = op.size;
+    uint32_t size = 0;
+    auto resolveOffset = [&](uint32_t chunkIndex) {
+      uint32_t offset = getOffset(chunkIndex);
+      if (size == 0 && nChunks != 0) {
+        size = getOffset(chunkIndex + nChunks) - offset;
+      }
+      return offset;
+    };
+    if (op.inputOffsetsBufferType != BufferType::NONE) {
+      for (int i = 0; i < op.nInputs; i++) {
+        inputOffsets[i] = resolveOffset(inputOffsets[i]) + getConstOffset(op.inputOffsetsBufferType);
+      }
+    }
+    if (op.outputOffsetsBufferType != BufferType::NONE) {
+      for (int i = 0; i < op.nOutputs; i++) {
+        outputOffsets[i] = resolveOffset(outputOffsets[i]) + getConstOffset(op.outputOffsetsBufferType);
+      }
+    }
+    if (op.hasSrcOffset) {
+      op.srcOffset = resolveOffset(op.srcOffset);
+    }
+    if (op.hasDstOffset) {
+      op.dstOffset = resolveOffset(op.dstOffset);
+    }
+    if (nChunks != 0) {
+      op.size = size;
+    }
+  }
 };
 
 }  // namespace mscclpp
@@ -0,0 +1,61 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#ifndef MSCCLPP_EXECUTION_INTERPRETER_HPP_
+#define MSCCLPP_EXECUTION_INTERPRETER_HPP_
+
+#include <cstdint>
+#include <memory>
+#include <mscclpp/executor.hpp>
+#include <vector>
+
+#include "execution_plan.hpp"
+
+namespace mscclpp {
+
+// Counters of one ExecutionInterpreter::run(), summed over all ranks and threadblocks.
+struct InterpreterStats {
+  // Indexed by OperationType. The time includes waiting for signals, barriers and packets.
+  std::vector<uint64_t> opCounts;
+  std::vector<uint64_t> opNanoseconds;
+  // Bytes that crossed channels, that is, were written to or read from the buffers of another rank.
+  uint64_t remoteBytes = 0;
+  int64_t elapsedUs = 0;
+};
+
+// Runs an execution plan on the host, as executionKernel would on the GPUs of all ranks. Every threadblock of every
+// rank is a thread, the buffers of all ranks are host memory in this process, and the channels and semaphores between
+// ranks are plain memory copies and atomic counters. Packets carry their flags as on the GPU, so LL plans synchronize
+// through them as well. LL8 and LL16 packets have the same layout in memory, so runs do not depend on the packet type.
+//
+// The operations compute what the kernel computes, in the same order for every element, so results are bit-exact for
+// all data types that the kernel supports. The only exception is MULTI_LOAD_REDUCE_STORE, whose hardware reduction
+// order is unspecified; it is summed in the order of the ranks of the NVLS group here. Every access is checked against
+// the size of its buffer, and a plan that waits for a signal or packet that never arrives times out instead of
+// hanging.
+class ExecutionInterpreter {
+ public:
+  // Resolves the operations of `plan` for the given message sizes, which throws if the plan does not support them,
+  // and allocates the scratch buffer of every rank.
+  ExecutionInterpreter(const CompiledExecutionPlan& plan, size_t inputSize, size_t outputSize);
+  ~ExecutionInterpreter();
+
+  // The number of ranks of the plan. They are numbered from 0.
+  int nRanks() const;
+
+  // Runs the plan once on all ranks. `inputs` and `outputs` hold the buffers of each rank, of inputSize and outputSize
+  // bytes; for an in-place plan, the output of a rank may be its input. Like consecutive launches of the kernel, each
+  // run uses a new packet flag and the other half of the scratch buffers. Throws an ExecutorError for an access out of
+  // bounds or an operation that the kernel does not implement, and a Timeout if a rank waits for more than
+  // `timeoutUsec`.
+  InterpreterStats run(const std::vector<void*>& inputs, const std::vector<void*>& outputs, DataType dataType,
+                       int64_t timeoutUsec = 10000000);
+
+ private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace mscclpp
+
+#endif  // MSCCLPP_EXECUTION_INTERPRETER_HPP_
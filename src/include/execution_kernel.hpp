@@ -464,7 +464,7 @@ MSCCLPP_DEVICE_INLINE void handleMultiLoadReduceStore(T* dst, T* src, uint32_t d
 
 template <typename T, typename PacketType = LL16Packet>
 __global__ void executionKernel([[maybe_unused]] int rank /*for debug*/, T* input, T* output, T* scratch,
-                                size_t scratchSize, DeviceExecutionPlan* plan, uint32_t flag
+                                size_t scratchSize, char* plans, ChunkLayout chunkLayout, uint32_t flag
 #if defined(ENABLE_NPKIT)
                                 ,
                                 NpKitEventCollectContext* npKitEventCollectContexts, uint64_t* cpuTimestamp) {
@@ -474,8 +474,11 @@ __global__ void executionKernel([[maybe_unused]] int rank /*for debug*/, T* inpu
   extern __shared__ int4 sharedMem[];
   int bid = blockIdx.x;
   int tid = threadIdx.x;
+  // the buffer starts with the offsets of the plans of all threadblocks
+  DeviceExecutionPlan* localPlan = (DeviceExecutionPlan*)(plans + ((uint32_t*)plans)[bid]);
+  const uint32_t planSize = localPlan->size;
 #if defined(ENABLE_NPKIT)
-  NpKitEvent* event_buffer = (NpKitEvent*)((char*)sharedMem + sizeof(DeviceExecutionPlan));
+  NpKitEvent* event_buffer = (NpKitEvent*)((char*)sharedMem + planSize);
   uint64_t event_buffer_head = 0;
 #if defined(ENABLE_NPKIT_EVENT_EXECUTOR_INIT_ENTRY) && defined(ENABLE_NPKIT_EVENT_EXECUTOR_INIT_EXIT)
   uint64_t npkit_timestamp_entry = 0;
@@ -484,18 +487,20 @@ __global__ void executionKernel([[maybe_unused]] int rank /*for debug*/, T* inpu
   }
 #endif
 #endif
-  DeviceExecutionPlan* localPlan = plan + bid;
-  for (size_t i = tid; i < sizeof(DeviceExecutionPlan) / sizeof(int4); i += blockDim.x) {
+  for (size_t i = tid; i < planSize / sizeof(int4); i += blockDim.x) {
     sharedMem[i] = ((int4*)localPlan)[i];
   }
   __syncshm();
   localPlan = (DeviceExecutionPlan*)sharedMem;
   int nOperations = localPlan->nOperations;
-  Operation* operations = localPlan->operations;
-  DeviceHandle<SmChannel>* smChannels = localPlan->channels.smChannels;
-  DeviceHandle<ProxyChannel>* proxyChannels = localPlan->channels.proxyChannels;
-  [[maybe_unused]] DeviceHandle<NvlsConnection::DeviceMulticastPointer>* nvlsChannels =
-      localPlan->channels.nvlsChannels;
+  // convert chunk-unit offsets and sizes into bytes for this launch
+  for (int i = tid; i < nOperations; i += blockDim.x) {
+    chunkLayout.resolve(localPlan->operation(i));
+  }
+  __syncshm();
+  DeviceHandle<SmChannel>* smChannels = localPlan->smChannels();
+  DeviceHandle<ProxyChannel>* proxyChannels = localPlan->proxyChannels();
+  [[maybe_unused]] DeviceHandle<NvlsConnection::DeviceMulticastPointer>* nvlsChannels = localPlan->nvlsChannels();
 
 #if defined(ENABLE_NPKIT) && defined(ENABLE_NPKIT_EVENT_TIME_SYNC_CPU)
 #if defined(MSCCLPP_DEVICE_HIP)
@@ -520,7 +525,7 @@ __global__ void executionKernel([[maybe_unused]] int rank /*for debug*/, T* inpu
 #endif
 
   for (int i = 0; i < nOperations; i++) {
-    Operation& op = operations[i];
+    DeviceOperation& op = localPlan->operation(i);
 
 #if defined(ENABLE_NPKIT) && defined(ENABLE_NPKIT_EVENT_EXECUTOR_OP_BASE_ENTRY)
     NpKit::CollectGpuEventShm(NPKIT_EVENT_EXECUTOR_OP_BASE_ENTRY + (int)op.type, op.size, 0, NPKIT_GET_GPU_TIMESTAMP(),
@@ -534,22 +539,22 @@ __global__ void executionKernel([[maybe_unused]] int rank /*for debug*/, T* inpu
       int syncStateIndex = op.deviceSyncerIndex;
       deviceSyncers[syncStateIndex].sync(nThreadBlocks);
     } else if (op.type == OperationType::SIGNAL) {
-      handleSignal(smChannels, proxyChannels, op.outputChannelIndexes, op.nOutputs, op.channelType);
+      handleSignal(smChannels, proxyChannels, op.outputChannelIndexes(), op.nOutputs, op.channelType);
     } else if (op.type == OperationType::WAIT) {
-      handleWait(smChannels, proxyChannels, op.inputChannelIndexes, op.nInputs, op.channelType);
+      handleWait(smChannels, proxyChannels, op.inputChannelIndexes(), op.nInputs, op.channelType);
     } else if (op.type == OperationType::FLUSH) {
-      handleFlush(proxyChannels, op.outputChannelIndexes, op.nOutputs);
+      handleFlush(proxyChannels, op.outputChannelIndexes(), op.nOutputs);
     } else if (op.type == OperationType::PUT) {
-      handlePut(smChannels, proxyChannels, op.outputChannelIndexes, op.outputOffsets, op.inputOffsets, op.nOutputs,
-                op.size, op.channelType);
+      handlePut(smChannels, proxyChannels, op.outputChannelIndexes(), op.outputOffsets(), op.inputOffsets(),
+                op.nOutputs, op.size, op.channelType);
     } else if (op.type == OperationType::PUT_WITH_SIGNAL) {
-      handlePut<true>(smChannels, proxyChannels, op.outputChannelIndexes, op.outputOffsets, op.inputOffsets,
+      handlePut<true>(smChannels, proxyChannels, op.outputChannelIndexes(), op.outputOffsets(), op.inputOffsets(),
                       op.nOutputs, op.size, op.channelType);
     } else if (op.type == OperationType::PUT_WITH_SIGNAL_AND_FLUSH) {
-      handlePut<false, true>(smChannels, proxyChannels, op.outputChannelIndexes, op.outputOffsets, op.inputOffsets,
-                             op.nOutputs, op.size, op.channelType);
+      handlePut<false, true>(smChannels, proxyChannels, op.outputChannelIndexes(), op.outputOffsets(),
+                             op.inputOffsets(), op.nOutputs, op.size, op.channelType);
     } else if (op.type == OperationType::GET) {
-      handleGet(smChannels, op.inputChannelIndexes, op.outputOffsets, op.inputOffsets, op.nInputs, op.size);
+      handleGet(smChannels, op.inputChannelIndexes(), op.outputOffsets(), op.inputOffsets(), op.nInputs, op.size);
     } else if (op.type == OperationType::COPY) {
       T* dst = getBuffer(input, output, scratch, op.dstBufferType);
       T* src = getBuffer(input, output, scratch, op.srcBufferType);
@@ -557,31 +562,31 @@ __global__ void executionKernel([[maybe_unused]] int rank /*for debug*/, T* inpu
     } else if (op.type == OperationType::READ_REDUCE_COPY_SEND) {
       T* dst = getBuffer(input, output, scratch, op.dstBufferType);
       T* src = getBuffer(input, output, scratch, op.srcBufferType);
-      handleReadReduceCopySend(dst, op.dstOffset, src, op.srcOffset, smChannels, op.outputChannelIndexes,
-                               op.inputChannelIndexes, op.outputOffsets, op.inputOffsets, op.nOutputs, op.nInputs,
-                               op.size);
+      handleReadReduceCopySend(dst, op.dstOffset, src, op.srcOffset, smChannels, op.outputChannelIndexes(),
+                               op.inputChannelIndexes(), op.outputOffsets(), op.inputOffsets(), op.nOutputs,
+                               op.nInputs, op.size);
     } else if (op.type == OperationType::READ_REDUCE_COPY) {
       T* dst = getBuffer(input, output, scratch, op.dstBufferType);
       T* src = getBuffer(input, output, scratch, op.srcBufferType);
 
-      handleReadReduceCopySend(dst, op.dstOffset, src, op.srcOffset, smChannels, op.outputChannelIndexes,
-                               op.inputChannelIndexes, op.outputOffsets, op.inputOffsets, op.nOutputs, op.nInputs,
-                               op.size, false);
+      handleReadReduceCopySend(dst, op.dstOffset, src, op.srcOffset, smChannels, op.outputChannelIndexes(),
+                               op.inputChannelIndexes(), op.outputOffsets(), op.inputOffsets(), op.nOutputs,
+                               op.nInputs, op.size, false);
     } else if (op.type == OperationType::PUT_PACKET) {
-      handlePutPacket<PacketType>(scratchSize, smChannels, proxyChannels, op.outputChannelIndexes, op.outputOffsets,
-                                  op.inputOffsets, op.nOutputs, op.size, op.channelType, flag);
+      handlePutPacket<PacketType>(scratchSize, smChannels, proxyChannels, op.outputChannelIndexes(),
+                                  op.outputOffsets(), op.inputOffsets(), op.nOutputs, op.size, op.channelType, flag);
     } else if (op.type == OperationType::REDUCE_SEND_PACKET) {
       T* dst = getBuffer(input, output, scratch, op.dstBufferType);
       T* src = getBuffer(input, output, scratch, op.srcBufferType);
-      handleReduceSendPacket<T, PacketType>(dst, op.dstOffset, src, op.srcOffset, scratch, scratchSize, op.inputOffsets,
-                                            op.nInputs, smChannels, op.outputChannelIndexes, op.outputOffsets,
-                                            op.nOutputs, op.size, flag);
+      handleReduceSendPacket<T, PacketType>(dst, op.dstOffset, src, op.srcOffset, scratch, scratchSize,
+                                            op.inputOffsets(), op.nInputs, smChannels, op.outputChannelIndexes(),
+                                            op.outputOffsets(), op.nOutputs, op.size, flag);
     } else if (op.type == OperationType::REDUCE_PACKET) {
       T* dst = getBuffer(input, output, scratch, op.dstBufferType);
       T* src = getBuffer(input, output, scratch, op.srcBufferType);
       handleReduceSendPacket<T, PacketType, false>(dst, op.dstOffset, src, op.srcOffset, scratch, scratchSize,
-                                                   op.inputOffsets, op.nInputs, smChannels, op.outputChannelIndexes,
-                                                   op.outputOffsets, op.nOutputs, op.size, flag);
+                                                   op.inputOffsets(), op.nInputs, smChannels, op.outputChannelIndexes(),
+                                                   op.outputOffsets(), op.nOutputs, op.size, flag);
     } else if (op.type == OperationType::COPY_PACKET) {
       T* dst = getBuffer(input, output, scratch, op.dstBufferType);
       T* src = getBuffer(input, output, scratch, op.srcBufferType);
@@ -593,14 +598,14 @@ __global__ void executionKernel([[maybe_unused]] int rank /*for debug*/, T* inpu
     } else if (op.type == OperationType::REDUCE_SEND) {
       T* dst = getBuffer(input, output, scratch, op.dstBufferType);
       T* src = getBuffer(input, output, scratch, op.srcBufferType);
-      T* tmp = getBuffer(input, output, scratch, op.inputBufferType);
-      handleReduceSend(dst, op.dstOffset, src, op.srcOffset, tmp, op.inputOffsets, smChannels, op.outputChannelIndexes,
-                       op.outputOffsets, op.nOutputs, op.size);
+      T* tmp = getBuffer(input, output, scratch, op.inputBufferType());
+      handleReduceSend(dst, op.dstOffset, src, op.srcOffset, tmp, op.inputOffsets(), smChannels,
+                       op.outputChannelIndexes(), op.outputOffsets(), op.nOutputs, op.size);
     }
 #if defined(__CUDA_ARCH__) && __CUDA_ARCH__ >= 900
     else if (op.type == OperationType::MULTI_LOAD_REDUCE_STORE) {
-      T* dst = (T*)(nvlsChannels[op.nvlsOutputIndex].mcPtr);
-      T* src = (T*)(nvlsChannels[op.nvlsInputIndex].mcPtr);
+      T* dst = (T*)(nvlsChannels[op.nvlsOutputIndex()].mcPtr);
+      T* src = (T*)(nvlsChannels[op.nvlsInputIndex()].mcPtr);
       handleMultiLoadReduceStore(dst, src, op.dstOffset, op.srcOffset, op.size);
     }
 #endif
@@ -622,12 +627,12 @@ class ExecutionKernel {
 #if defined(MSCCLPP_DEVICE_HIP)
   template <typename PacketType>
   static void launchKernel(int rank, int nthreadblocks, int nthreads, void* src, void* dst, void* scratch,
-                           size_t scratchSize, DataType dataType, DeviceExecutionPlan* plan, size_t sharedMemSize,
-                           cudaStream_t stream, uint32_t flag = 0) {
+                           size_t scratchSize, DataType dataType, char* plans, ChunkLayout chunkLayout,
+                           size_t sharedMemSize, cudaStream_t stream, uint32_t flag = 0) {
     switch (dataType) {
       case DataType::INT32:
         executionKernel<int32_t, PacketType><<<nthreadblocks, nthreads, sharedMemSize, stream>>>(
-            rank, (int32_t*)src, (int32_t*)dst, (int32_t*)scratch, scratchSize, plan, flag
+            rank, (int32_t*)src, (int32_t*)dst, (int32_t*)scratch, scratchSize, plans, chunkLayout, flag
 #if defined(ENABLE_NPKIT)
             ,
             NpKit::GetGpuEventCollectContexts(), NpKit::GetCpuTimestamp());
@@ -637,7 +642,7 @@ class ExecutionKernel {
         break;
       case DataType::UINT32:
         executionKernel<uint32_t, PacketType><<<nthreadblocks, nthreads, sharedMemSize, stream>>>(
-            rank, (uint32_t*)src, (uint32_t*)dst, (uint32_t*)scratch, scratchSize, plan, flag
+            rank, (uint32_t*)src, (uint32_t*)dst, (uint32_t*)scratch, scratchSize, plans, chunkLayout, flag
 #if defined(ENABLE_NPKIT)
             ,
             NpKit::GetGpuEventCollectContexts(), NpKit::GetCpuTimestamp());
@@ -647,7 +652,7 @@ class ExecutionKernel {
         break;
       case DataType::FLOAT16:
         executionKernel<half, PacketType><<<nthreadblocks, nthreads, sharedMemSize, stream>>>(
-            rank, (half*)src, (half*)dst, (half*)scratch, scratchSize, plan, flag
+            rank, (half*)src, (half*)dst, (half*)scratch, scratchSize, plans, chunkLayout, flag
 #if defined(ENABLE_NPKIT)
             ,
             NpKit::GetGpuEventCollectContexts(), NpKit::GetCpuTimestamp());
@@ -657,7 +662,7 @@ class ExecutionKernel {
         break;
       case DataType::FLOAT32:
         executionKernel<float, PacketType><<<nthreadblocks, nthreads, sharedMemSize, stream>>>(
-            rank, (float*)src, (float*)dst, (float*)scratch, scratchSize, plan, flag
+            rank, (float*)src, (float*)dst, (float*)scratch, scratchSize, plans, chunkLayout, flag
 #if defined(ENABLE_NPKIT)
             ,
             NpKit::GetGpuEventCollectContexts(), NpKit::GetCpuTimestamp());
@@ -667,7 +672,7 @@ class ExecutionKernel {
         break;
       case DataType::BFLOAT16:
         executionKernel<__bfloat16, PacketType><<<nthreadblocks, nthreads, sharedMemSize, stream>>>(
-            rank, (__bfloat16*)src, (__bfloat16*)dst, (__bfloat16*)scratch, scratchSize, plan, flag
+            rank, (__bfloat16*)src, (__bfloat16*)dst, (__bfloat16*)scratch, scratchSize, plans, chunkLayout, flag
 #if defined(ENABLE_NPKIT)
             ,
             NpKit::GetGpuEventCollectContexts(), NpKit::GetCpuTimestamp());
@@ -680,8 +685,8 @@ class ExecutionKernel {
 #else   // !defined(MSCCLPP_DEVICE_HIP)
   template <typename PacketType>
   static void launchKernel(int rank, int nthreadblocks, int nthreads, void* src, void* dst, void* scratch,
-                           size_t scratchSize, DataType dataType, DeviceExecutionPlan* plan, size_t sharedMemSize,
-                           cudaStream_t stream, uint32_t flag = 0);
+                           size_t scratchSize, DataType dataType, char* plans, ChunkLayout chunkLayout,
+                           size_t sharedMemSize, cudaStream_t stream, uint32_t flag = 0);
 #endif  // !defined(MSCCLPP_DEVICE_HIP)
 };
 }  // namespace mscclpp
@@ -4,6 +4,8 @@
 #ifndef MSCCLPP_EXECUTOR_PLAN_HPP_
 #define MSCCLPP_EXECUTOR_PLAN_HPP_
 
+#include <limits>
+#include <memory>
 #include <mscclpp/core.hpp>
 #include <mscclpp/executor.hpp>
 #include <nlohmann/json.hpp>
@@ -60,7 +62,80 @@ struct ChannelInfo {
   std::vector<int> connectedPeers;
 };
 
-struct ExecutionPlan::Impl {
+// The part of an execution plan that does not depend on the message size. It is lowered from the JSON plan by
+// lowerExecutionPlan() or read back from a binary plan written by writeBinaryExecutionPlan().
+struct CompiledExecutionPlan {
+  std::string name;
+  std::string collective;
+  bool isUsingPacket = false;
+  bool isInPlace = false;
+  int nThreadsPerBlock = 1024;
+  size_t minMessageSize = 0;
+  size_t maxMessageSize = std::numeric_limits<uint64_t>::max();
+  int priority = 0;
+  std::unordered_map<int, std::vector<ChannelInfo>> channelInfos;
+  std::unordered_map<int, std::vector<ChannelInfo>> channelInfosByDstRank;
+  std::unordered_map<std::pair<int, ChannelType>, std::unordered_map<int, int>> channelCountMap;
+  // for nvls channels
+  std::unordered_map<int, std::vector<NvlsInfo>> nvlsInfos;
+  // threadblockChannelMap[rank][threadblock] = [channelIndex, channelKey]
+  std::unordered_map<int, std::vector<std::vector<std::pair<int, ChannelKey>>>> threadblockSMChannelMap;
+  std::unordered_map<int, std::vector<std::vector<std::pair<int, ChannelKey>>>> threadblockProxyChannelMap;
+  std::unordered_map<int, std::vector<std::vector<std::pair<int, ChannelKey>>>> threadblockNvlsChannelMap;
+  std::unordered_map<int, uint32_t> inputChunks;
+  std::unordered_map<int, uint32_t> outputChunks;
+  std::unordered_map<int, uint32_t> scratchChunks;
+  std::unordered_map<int, uint32_t> chunkGroups;
+  // operationTemplates[rank][threadblock] = [operations], with offsets and sizes in chunk units
+  std::unordered_map<int, std::vector<std::vector<Operation>>> operationTemplates;
+
+  // Returns the layout that maps chunk indexes of `rank` to byte offsets for the given message sizes.
+  ChunkLayout getChunkLayout(int rank, size_t inputSize, size_t outputSize, size_t constSrcOffset,
+                             size_t constDstOffset, uint32_t alignment = 16) const;
+  // Converts the chunk-unit offsets and size of `op` into bytes. Unlike ChunkLayout::resolve, this checks that all
+  // chunks referenced by the operation have the same size.
+  Operation resolveOperation(int rank, const Operation& op, size_t inputSize, size_t outputSize, size_t constSrcOffset,
+                             size_t constDstOffset) const;
+  size_t getOffset(int rank, size_t inputSize, size_t outputSize, uint32_t chunkIndex, uint32_t alignment = 16) const;
+  size_t getNChunkSize(int rank, size_t inputSize, size_t outputSize, uint32_t nChunks,
+                       const std::vector<uint32_t> offsets) const;
+  size_t getScratchBufferSize(int rank, size_t inputSize, size_t outputSize) const;
+  // Returns the input and output sizes for a message of `messageSize` bytes. The message size is the input size, as for
+  // the collectives of the NCCL API, rounded down to a multiple of `alignment` as getOffset() needs. The output size
+  // follows from the chunks of rank 0, e.g., it is nRanks times the input size for allgather.
+  std::pair<size_t, size_t> getBufferSizes(size_t messageSize, uint32_t alignment = 16) const;
+
+ private:
+  std::pair<size_t, uint32_t> getSizeAndChunksForRank(int rank, size_t inputSize, size_t outputSize) const;
+};
+
+// Returns the name of an operation type, such as "READ_REDUCE_COPY_SEND".
+std::string operationTypeToString(OperationType type);
+
+// Returns "input", "output", "scratch" or "none".
+std::string bufferTypeToString(BufferType type);
+
+// Returns "SM", "proxy", "NVLS" or "none".
+std::string channelTypeToString(ChannelType type);
+
+// Lowers a parsed JSON execution plan into its size-independent form.
+CompiledExecutionPlan lowerExecutionPlan(const nlohmann::json& obj);
+
+// Returns true if the file starts with the magic of the binary plan format.
+bool isBinaryExecutionPlan(const std::string& path);
+
+// Writes `plan` in the binary plan format.
+void writeBinaryExecutionPlan(const CompiledExecutionPlan& plan, const std::string& path);
+
+// Maps a binary plan into memory and reads it back. If `metadataOnly` is true, only the fields before the channel
+// tables (name, collective, protocol, message size range, ...) are filled.
+CompiledExecutionPlan readBinaryExecutionPlan(const std::string& path, bool metadataOnly = false);
+
+// Loads a plan from either the JSON or the binary format. JSON plans go through fuseOperationsFromEnv(), and binary
+// plans are written from plans loaded this way.
+CompiledExecutionPlan loadCompiledExecutionPlan(const std::string& path);
+
+struct ExecutionPlan::Impl : public CompiledExecutionPlan {
  public:
   Impl(const std::string planPath);
   ~Impl() = default;
@@ -72,7 +147,6 @@ struct ExecutionPlan::Impl {
   std::vector<NvlsInfo> getNvlsInfos(int rank, size_t sendBuffserSize = 0, size_t recvBufferSize = 0) const;
   std::vector<int> getConnectedPeers(int rank) const;
   std::vector<BufferType> getConnectedBufferTypes(int rank) const;
-  size_t getScratchBufferSize(int rank, size_t inputSize, size_t outputSize) const;
   size_t getMaxScratchBufferSize(int rank) const;
   std::vector<Operation> getOperations(int rank, int threadblock) const;
   int getThreadblockCount(int rank) const;
@@ -80,50 +154,22 @@ struct ExecutionPlan::Impl {
 
   void loadExecutionPlan(size_t inputSize, size_t outputSize, size_t contsSrcOffset, size_t constDstOffset);
   void lightLoadExecutionPlan(size_t inputSize, size_t outputSize, size_t contsSrcOffset, size_t constDstOffset);
-  void setupChannels(const nlohmann::json& gpus);
-  void setupOperations(const nlohmann::json& gpus, size_t contsSrcOffset, size_t constDstOffset);
+  void setupOperations(size_t contsSrcOffset, size_t constDstOffset);
 
   void reset();
   void operationsReset();
 
-  std::string name;
-  std::string collective;
   const std::string planPath;
-  bool isUsingPacket;
   // operations for [rank][threadblock] = [operations]
   std::unordered_map<int, std::vector<std::vector<Operation>>> operations;
-  std::unordered_map<int, std::vector<ChannelInfo>> channelInfos;
-  std::unordered_map<int, std::vector<ChannelInfo>> channelInfosByDstRank;
-  std::unordered_map<std::pair<int, ChannelType>, std::unordered_map<int, int>> channelCountMap;
-  // for nvls channels
-  std::unordered_map<int, std::vector<NvlsInfo>> nvlsInfos;
-  // threadblockChannelMap[rank][threadblock] = [channelIndex, channelKey]
-  std::unordered_map<int, std::vector<std::vector<std::pair<int, ChannelKey>>>> threadblockSMChannelMap;
-  std::unordered_map<int, std::vector<std::vector<std::pair<int, ChannelKey>>>> threadblockProxyChannelMap;
-  std::unordered_map<int, std::vector<std::vector<std::pair<int, ChannelKey>>>> threadblockNvlsChannelMap;
-  std::unordered_map<int, uint32_t> inputChunks;
-  std::unordered_map<int, uint32_t> outputChunks;
-  std::unordered_map<int, uint32_t> scratchChunks;
-  std::unordered_map<int, uint32_t> chunkGroups;
   size_t inputSize;
   size_t outputSize;
-  int nThreadsPerBlock;
-  size_t minMessageSize;
-  size_t maxMessageSize;
-  bool isInPlace;
 
  private:
-  std::pair<size_t, uint32_t> getSizeAndChunksForRank(int rank, size_t inputSize, size_t outputSize) const;
-  size_t getOffset(int rank, size_t inputSize, size_t outputSize, uint32_t chunkIndex, uint32_t alignment = 16) const;
-  size_t getNChunkSize(int rank, size_t inputSize, size_t outputSize, uint32_t nChunks,
-                       const std::vector<uint32_t> offsets) const;
   size_t getUpperBoundChunkSize(int rank, size_t inputSize, size_t outputSize) const;
 
-  // helper functions to setup the channels
-  void parseChannels(
-      const nlohmann::json& gpu, std::vector<ChannelInfo>& channelInfos, std::vector<NvlsInfo>& nvlsInfos,
-      std::map<std::tuple<int, BufferType, BufferType, ChannelType>, std::vector<int>>& chanConnectedPeersMap,
-      int rank);
+  // The size-independent plan, loaded from planPath by the first loadExecutionPlan() and reused by the later ones.
+  std::shared_ptr<const CompiledExecutionPlan> compiledPlan;
 };
 
 }  // namespace mscclpp
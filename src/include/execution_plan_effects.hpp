@@ -0,0 +1,87 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#ifndef MSCCLPP_EXECUTION_PLAN_EFFECTS_HPP_
+#define MSCCLPP_EXECUTION_PLAN_EFFECTS_HPP_
+
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "execution_plan.hpp"
+
+namespace mscclpp {
+
+// An SM or proxy channel of a rank.
+struct PlanChannel {
+  int peer;
+  BufferType srcBufferType;
+  BufferType dstBufferType;
+  // The index of the channel among the channels of its type from its rank to the peer. The executor pairs it with the
+  // channel of the peer that has the same index, and their semaphores signal each other.
+  int pairIndex;
+};
+
+// A semaphore, by the rank that waits on it, the rank that signals it, the channel type and the pair index.
+using SemaphoreKey = std::tuple<int, int, ChannelType, int>;
+
+struct MemoryAccess {
+  // the rank that owns the buffer
+  int rank;
+  BufferType bufferType;
+  uint64_t begin;
+  uint64_t end;
+  bool write;
+  // Packets hold data and flags, so `begin` and `end` are twice the offset and the end of the data. A packet is read
+  // only once its flag shows that the write completed.
+  bool packet;
+  // the index of the channel in PlanEffects::channels() of the operation's rank and channel type, or -1 if the access
+  // does not go through an SM or proxy channel
+  int channel;
+};
+
+// The memory accesses and semaphore operations of one operation.
+struct OperationEffects {
+  std::vector<MemoryAccess> accesses;
+  std::vector<SemaphoreKey> signals;
+  std::vector<SemaphoreKey> waits;
+  // the proxy channels that the operation flushes, by index in PlanEffects::channels()
+  std::vector<int> flushes;
+};
+
+// Thrown by PlanEffects::getEffects() for an operation that the executor cannot run.
+struct MalformedOperation {
+  std::string message;
+};
+
+// What the operations of a plan do, as ThreadblockRunner of ExecutionInterpreter runs them. The plan is referenced and
+// must outlive this object.
+class PlanEffects {
+ public:
+  // The ranks of `plan` must be numbered from 0.
+  explicit PlanEffects(const CompiledExecutionPlan& plan);
+
+  int nRanks() const { return nRanks_; }
+
+  // The SM or proxy channels of `rank` in the order of the executor, which the threadblock channel maps index. A
+  // channel to a rank that is not a peer in the plan is kept with a pair index of 0.
+  const std::vector<PlanChannel>& channels(int rank, ChannelType type) const;
+
+  // Returns the effects of operation `op` of `threadblock` of `rank`. The offsets and sizes of the accesses are only
+  // meaningful if `op` is resolved. Throws MalformedOperation if executionKernel cannot run the operation.
+  OperationEffects getEffects(int rank, int threadblock, const Operation& op) const;
+
+ private:
+  int getChannel(int rank, int threadblock, ChannelType type, int index) const;
+  const NvlsInfo& getNvlsChannel(int rank, int threadblock, int index) const;
+
+  const CompiledExecutionPlan& plan_;
+  int nRanks_;
+  // [rank] = channels
+  std::vector<std::vector<PlanChannel>> smChannels_;
+  std::vector<std::vector<PlanChannel>> proxyChannels_;
+};
+
+}  // namespace mscclpp
+
+#endif  // MSCCLPP_EXECUTION_PLAN_EFFECTS_HPP_
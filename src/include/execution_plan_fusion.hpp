@@ -0,0 +1,52 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#ifndef MSCCLPP_EXECUTION_PLAN_FUSION_HPP_
+#define MSCCLPP_EXECUTION_PLAN_FUSION_HPP_
+
+#include <cstdint>
+#include <vector>
+
+#include "execution_plan.hpp"
+
+namespace mscclpp {
+
+// What fuseOperations() did to a plan, summed over all ranks and threadblocks.
+struct FusionStats {
+  // Indexed by OperationType.
+  std::vector<uint64_t> opCountsBefore;
+  std::vector<uint64_t> opCountsAfter;
+  // PUT and SIGNAL into PUT_WITH_SIGNAL, and PUT_WITH_SIGNAL and FLUSH into PUT_WITH_SIGNAL_AND_FLUSH
+  uint64_t signalsFused = 0;
+  // REDUCE and PUT into REDUCE_SEND
+  uint64_t reducesFused = 0;
+  // operations of the same type on contiguous chunks, or SIGNALs and WAITs on different channels, merged into one
+  uint64_t operationsMerged = 0;
+  // NOPs that sync nothing: at the start or end of a threadblock, next to another NOP or next to a BARRIER
+  uint64_t nopsRemoved = 0;
+};
+
+// Merges adjacent operations of each threadblock that executionKernel can run as one, so that it dispatches and
+// synchronizes fewer operations. Works on the chunk-unit operation templates, between lowering and resolving:
+//   - a proxy PUT followed by a SIGNAL on the same channels becomes a PUT_WITH_SIGNAL, and a proxy PUT_WITH_SIGNAL
+//     followed by a FLUSH of the same channels a PUT_WITH_SIGNAL_AND_FLUSH. SM channels are left alone, because their
+//     PUT_WITH_SIGNAL does not signal.
+//   - a REDUCE followed by an SM PUT of its result to as many peers as it has inputs, optionally with a NOP in
+//     between, becomes a REDUCE_SEND.
+//   - two data operations that differ only in their offsets, where every offset of the second one is where the same
+//     offset of the first one ends, become one operation over both ranges, unless the second one accesses bytes that
+//     the first one writes or the other way around. SIGNALs or WAITs on different channels of the same type are
+//     merged as well.
+//   - NOPs that do not order anything are removed.
+// Running the pass again does not change the result. The result computes the same as the original plan, except that
+// executionKernel skips a standalone REDUCE but runs the REDUCE_SEND that it is fused into.
+FusionStats fuseOperations(CompiledExecutionPlan& plan);
+
+// Runs fuseOperations() on `plan` as loadCompiledExecutionPlan() does for JSON plans. MSCCLPP_EXECUTOR_FUSION=0 in the
+// environment turns the pass off, and MSCCLPP_EXECUTOR_FUSION_DUMP=1 prints the operation counts of each plan before
+// and after it to stdout.
+void fuseOperationsFromEnv(CompiledExecutionPlan& plan);
+
+}  // namespace mscclpp
+
+#endif  // MSCCLPP_EXECUTION_PLAN_FUSION_HPP_
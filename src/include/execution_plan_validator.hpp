@@ -0,0 +1,30 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#ifndef MSCCLPP_EXECUTION_PLAN_VALIDATOR_HPP_
+#define MSCCLPP_EXECUTION_PLAN_VALIDATOR_HPP_
+
+#include <mscclpp/executor.hpp>
+#include <string>
+#include <vector>
+
+#include "execution_plan.hpp"
+
+namespace mscclpp {
+
+// Checks `plan` without running it, as validateExecutionPlan(planPath, messageSizes) does.
+//
+// Semaphores pair up like the executor builds them: the k-th channel of a type from rank r to rank p signals the
+// semaphore that the k-th channel of the type from p to r waits on. Operations are ordered by program order within a
+// threadblock, by BARRIER within a rank, and from a signal to the waits that cannot complete without it. Packet reads
+// are ordered after the packet writes to the same bytes by their flags. Proxy transfers are taken to complete in
+// program order, as in ExecutionInterpreter.
+std::vector<PlanIssue> validateExecutionPlan(const CompiledExecutionPlan& plan,
+                                             const std::vector<size_t>& messageSizes = {});
+
+// Returns the name of an issue type, such as "OutOfBounds".
+std::string planIssueTypeToString(PlanIssueType type);
+
+}  // namespace mscclpp
+
+#endif  // MSCCLPP_EXECUTION_PLAN_VALIDATOR_HPP_
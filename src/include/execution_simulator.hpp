@@ -0,0 +1,139 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#ifndef MSCCLPP_EXECUTION_SIMULATOR_HPP_
+#define MSCCLPP_EXECUTION_SIMULATOR_HPP_
+
+#include <array>
+#include <cstdint>
+#include <mscclpp/executor.hpp>
+#include <string>
+#include <vector>
+
+#include "execution_plan.hpp"
+
+namespace mscclpp {
+
+// The kinds of links that the simulator accounts traffic to.
+enum class LinkType {
+  // the device memory of a rank, for the accesses of a rank to its own buffers
+  Memory,
+  NVLink,
+  PCIe,
+  // InfiniBand, for all traffic between ranks on different nodes
+  IB,
+  // NVLink SHARP multimem accesses of MULTI_LOAD_REDUCE_STORE
+  NVLS,
+};
+
+constexpr int NumLinkTypes = 5;
+
+// Returns "memory", "NVLink", "PCIe", "IB" or "NVLS".
+std::string linkTypeToString(LinkType type);
+
+struct LinkParameters {
+  // in GB/s, per direction and rank
+  double bandwidth;
+  double latencyUs;
+};
+
+// The links of a rank. Each rank has one egress and one ingress of each link type, which its transfers share equally.
+// The defaults are in the range of an 8-GPU A100 or H100 node with one 200 Gb/s NIC per GPU.
+struct LinkModel {
+  LinkParameters memory = {1500.0, 0.0};
+  LinkParameters nvlink = {240.0, 0.8};
+  LinkParameters pcie = {24.0, 1.5};
+  LinkParameters ib = {24.0, 3.0};
+  LinkParameters nvls = {240.0, 1.0};
+  // whether the ranks of a node talk over PCIe instead of NVLink
+  bool pcieWithinNode = false;
+
+  const LinkParameters& get(LinkType type) const;
+};
+
+struct SimulationOptions {
+  LinkModel links;
+  // Ranks r and p are on the same node if r / nRanksPerNode == p / nRanksPerNode.
+  int nRanksPerNode = 8;
+  PacketType packetType = PacketType::LL16;
+  // The bytes per second, in GB/s, that one threadblock reads plus writes. An operation that a threadblock runs moves
+  // its data no faster than this, however idle the links are.
+  double threadblockBandwidth = 50.0;
+  // LL8 packets carry 4 bytes per 8-byte access instead of 8 per 16, which makes threadblocks this much slower on them.
+  double ll8Efficiency = 0.5;
+  // from the launch of the kernel until its threadblocks start
+  double launchUs = 4.0;
+  // the time a threadblock spends on every operation besides moving data, such as reading it and its channels
+  double operationUs = 0.05;
+  // from a threadblock pushing a request to the proxy until the proxy posts it
+  double proxyUs = 2.0;
+  // from the last threadblock arriving at a BARRIER until all leave it
+  double barrierUs = 0.5;
+};
+
+// When and how one operation ran.
+struct SimulatedOperation {
+  int rank;
+  int threadblock;
+  // the index of the operation in its threadblock
+  int index;
+  OperationType type;
+  // when the threadblock reaches the operation
+  double startUs;
+  // how long the threadblock waits for semaphores, barriers, packets and proxy flushes
+  double waitUs;
+  // when the threadblock moves on to the next operation
+  double endUs;
+  // When the transfers and signals of the operation have landed. For the proxy, this is after endUs.
+  double completeUs;
+  // the bytes that the operation moves over each link type, indexed by LinkType, with packets counted with their flags
+  std::array<uint64_t, NumLinkTypes> bytes;
+  // The fraction of the bandwidth of each link type that the operation used while it moved data, that is, the bytes
+  // over the time from its first transfer starting to its last finishing times the bandwidth.
+  std::array<double, NumLinkTypes> utilization;
+};
+
+struct SimulationResult {
+  // from the launch until the last operation completes
+  double latencyUs;
+  // the operations of all ranks, by rank, threadblock and index
+  std::vector<SimulatedOperation> operations;
+  // Indexes into `operations` from the first to the last operation of the longest chain of operations that each
+  // waited for the previous one, either in program order or through a semaphore, barrier, packet or flush.
+  std::vector<int> criticalPath;
+  // the bytes over each link type, summed over all ranks
+  std::array<uint64_t, NumLinkTypes> bytes;
+  // the fraction of the bandwidth of each link type of all ranks that the plan uses over its latency
+  std::array<double, NumLinkTypes> utilization;
+};
+
+// Replays `plan` for a message of the given sizes on all ranks and threadblocks with an analytical cost model, and
+// predicts when each operation runs.
+//
+// The model is a discrete-event simulation in which transfers are flows that share the links they cross, each
+// progressing at the rate of its most contended link. Operations that a threadblock runs are also limited to the
+// bandwidth of a threadblock, and the threadblock moves on once their data has landed. Requests to the proxy run in
+// order per channel in the background: a transfer starts once the previous one on the channel finished, and a signal
+// lands after the transfers before it. A packet is read once the operations that write it have completed, so the
+// pipelining of LL protocols within one operation is not modeled. Throws an ExecutorError if the plan cannot run, e.g.
+// because it deadlocks.
+SimulationResult simulateExecutionPlan(const CompiledExecutionPlan& plan, size_t inputSize, size_t outputSize,
+                                       const SimulationOptions& options = {});
+
+// The messages sizes [minMessageSize, maxMessageSize) for which plan `plan` is the fastest.
+struct PlanSizeRange {
+  int plan;
+  size_t minMessageSize;
+  size_t maxMessageSize;
+};
+
+// Derives the message size ranges of plans from their latencies, where latencies[plan][i] is the latency of the plan
+// at messageSizes[i] and messageSizes is ascending. Each range starts at the first size at which its plan is the
+// fastest; the first range starts at 0 and the last one ends at the maximum of uint64_t, like the message size range
+// of a plan that declares none. A plan that cannot run a size can be given an infinite latency for it.
+std::vector<PlanSizeRange> derivePlanSizeRanges(const std::vector<size_t>& messageSizes,
+                                                const std::vector<std::vector<double>>& latencies);
+
+}  // namespace mscclpp
+
+#endif  // MSCCLPP_EXECUTION_SIMULATOR_HPP_
@@ -0,0 +1,43 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#ifndef MSCCLPP_HOST_REDUCE_KERNELS_HPP_
+#define MSCCLPP_HOST_REDUCE_KERNELS_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace mscclpp {
+
+// Indices of the operations in HostReduceKernels, in the order of ReduceOp.
+constexpr int HostReduceSum = 0;
+constexpr int HostReduceProd = 1;
+constexpr int HostReduceMin = 2;
+constexpr int HostReduceMax = 3;
+constexpr int HostReduceNumOps = 4;
+
+// The single-threaded kernels of one instruction set. A binary kernel computes out[i] = op(a[i], b[i]), where out may
+// be a or b. FLOAT16 and BFLOAT16 are converted to and from FLOAT32 with round to nearest even.
+struct HostReduceKernels {
+  const char* isa;
+  void (*f32[HostReduceNumOps])(float* out, const float* a, const float* b, size_t n);
+  void (*i32[HostReduceNumOps])(int32_t* out, const int32_t* a, const int32_t* b, size_t n);
+  void (*u32[HostReduceNumOps])(uint32_t* out, const uint32_t* a, const uint32_t* b, size_t n);
+  void (*halfToFloat)(float* out, const uint16_t* in, size_t n);
+  void (*floatToHalf)(uint16_t* out, const float* in, size_t n);
+  void (*bf16ToFloat)(float* out, const uint16_t* in, size_t n);
+  void (*floatToBf16)(uint16_t* out, const float* in, size_t n);
+};
+
+// The kernels of each instruction set, or nullptr if the library is built without them. They may only be called if
+// the CPU supports the instruction set.
+const HostReduceKernels* hostReduceKernelsScalar();
+const HostReduceKernels* hostReduceKernelsAvx2();
+const HostReduceKernels* hostReduceKernelsAvx512();
+
+// The kernels of the widest instruction set that both the library and the CPU support.
+const HostReduceKernels* hostReduceKernels();
+
+}  // namespace mscclpp
+
+#endif  // MSCCLPP_HOST_REDUCE_KERNELS_HPP_
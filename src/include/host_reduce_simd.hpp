@@ -0,0 +1,207 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#ifndef MSCCLPP_HOST_REDUCE_SIMD_HPP_
+#define MSCCLPP_HOST_REDUCE_SIMD_HPP_
+
+// The kernels of HostReduceKernels, written once against the vector type of an instruction set. Each translation unit
+// that includes this header is built with the flags of its own instruction set. The anonymous namespace keeps their
+// instantiations apart, so that the linker never picks code of a wider instruction set for a narrower one. For the
+// same reason, those translation units must not include C++ library headers with inline functions.
+
+#include "host_reduce_kernels.hpp"
+
+namespace mscclpp {
+namespace {
+
+inline uint32_t floatBits(float value) {
+  uint32_t bits;
+  __builtin_memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+inline float bitsFloat(uint32_t bits) {
+  float value;
+  __builtin_memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+inline float halfToFloatScalar(uint16_t half) {
+  const uint32_t shiftedExp = 0x7c00u << 13;
+  uint32_t bits = (half & 0x7fffu) << 13;
+  uint32_t exp = bits & shiftedExp;
+  bits += (127 - 15) << 23;
+  if (exp == shiftedExp) {
+    // Inf or NaN, quieted like the hardware conversions do
+    bits += (128 - 16) << 23;
+    if (half & 0x3ffu) bits |= 0x400000u;
+  } else if (exp == 0) {
+    // zero or subnormal, normalized by the FPU
+    bits += 1 << 23;
+    bits = floatBits(bitsFloat(bits) - bitsFloat(113u << 23));
+  }
+  return bitsFloat(bits | ((half & 0x8000u) << 16));
+}
+
+inline uint16_t floatToHalfScalar(float value) {
+  uint32_t bits = floatBits(value);
+  uint32_t sign = bits & 0x80000000u;
+  bits ^= sign;
+  uint32_t half;
+  if (bits >= (127u + 16) << 23) {
+    // too large for a half: Inf, or a quiet NaN
+    half = bits > 0x7f800000u ? 0x7e00 : 0x7c00;
+  } else if (bits < 113u << 23) {
+    // a subnormal half: adding a magic number lets the FPU round the mantissa to nearest even
+    const uint32_t magic = ((127 - 15) + (23 - 10) + 1) << 23;
+    half = floatBits(bitsFloat(bits) + bitsFloat(magic)) - magic;
+  } else {
+    uint32_t mantissaOdd = (bits >> 13) & 1;
+    bits += ((uint32_t)(15 - 127) << 23) + 0xfff + mantissaOdd;
+    half = bits >> 13;
+  }
+  return static_cast<uint16_t>(half | (sign >> 16));
+}
+
+inline float bf16ToFloatScalar(uint16_t bf16) { return bitsFloat(uint32_t(bf16) << 16); }
+
+inline uint16_t floatToBf16Scalar(float value) {
+  uint32_t bits = floatBits(value);
+  if (value != value) {
+    return static_cast<uint16_t>((bits >> 16) | 0x40);
+  }
+  return static_cast<uint16_t>((bits + 0x7fff + ((bits >> 16) & 1)) >> 16);
+}
+
+// MIN and MAX keep the first operand unless the second one compares less or greater, like the SIMD instructions with
+// their operands swapped.
+template <int Op>
+float applyScalar(float a, float b) {
+  if constexpr (Op == HostReduceSum) return a + b;
+  if constexpr (Op == HostReduceProd) return a * b;
+  if constexpr (Op == HostReduceMin) return b < a ? b : a;
+  if constexpr (Op == HostReduceMax) return b > a ? b : a;
+}
+
+template <int Op>
+int32_t applyScalar(int32_t a, int32_t b) {
+  // sums and products wrap around, which the unsigned arithmetic defines
+  if constexpr (Op == HostReduceSum) return static_cast<int32_t>(uint32_t(a) + uint32_t(b));
+  if constexpr (Op == HostReduceProd) return static_cast<int32_t>(uint32_t(a) * uint32_t(b));
+  if constexpr (Op == HostReduceMin) return b < a ? b : a;
+  if constexpr (Op == HostReduceMax) return b > a ? b : a;
+}
+
+template <int Op>
+uint32_t applyScalar(uint32_t a, uint32_t b) {
+  if constexpr (Op == HostReduceSum) return a + b;
+  if constexpr (Op == HostReduceProd) return a * b;
+  if constexpr (Op == HostReduceMin) return b < a ? b : a;
+  if constexpr (Op == HostReduceMax) return b > a ? b : a;
+}
+
+// V is the vector type of an instruction set, with Width lanes of 32 bits. It provides loads and stores of FLOAT32,
+// 32-bit integers, FLOAT16 and BFLOAT16, and the element-wise operations on them.
+template <class V, int Op>
+typename V::F applyF(typename V::F a, typename V::F b) {
+  if constexpr (Op == HostReduceSum) return V::addF(a, b);
+  if constexpr (Op == HostReduceProd) return V::mulF(a, b);
+  if constexpr (Op == HostReduceMin) return V::minF(b, a);
+  if constexpr (Op == HostReduceMax) return V::maxF(b, a);
+}
+
+template <class V, int Op, bool Signed>
+typename V::I applyI(typename V::I a, typename V::I b) {
+  if constexpr (Op == HostReduceSum) return V::addI(a, b);
+  if constexpr (Op == HostReduceProd) return V::mulI(a, b);
+  if constexpr (Op == HostReduceMin) return Signed ? V::minI(a, b) : V::minU(a, b);
+  if constexpr (Op == HostReduceMax) return Signed ? V::maxI(a, b) : V::maxU(a, b);
+}
+
+template <class V, int Op>
+void reduceF32(float* out, const float* a, const float* b, size_t n) {
+  size_t i = 0;
+  for (; i + V::Width <= n; i += V::Width) {
+    V::storeF(out + i, applyF<V, Op>(V::loadF(a + i), V::loadF(b + i)));
+  }
+  for (; i < n; ++i) {
+    out[i] = applyScalar<Op>(a[i], b[i]);
+  }
+}
+
+template <class V, int Op, class T>
+void reduceInt(T* out, const T* a, const T* b, size_t n) {
+  size_t i = 0;
+  for (; i + V::Width <= n; i += V::Width) {
+    V::storeI(out + i, applyI<V, Op, (T(-1) < T(0))>(V::loadI(a + i), V::loadI(b + i)));
+  }
+  for (; i < n; ++i) {
+    out[i] = applyScalar<Op>(a[i], b[i]);
+  }
+}
+
+template <class V>
+void halfToFloat(float* out, const uint16_t* in, size_t n) {
+  size_t i = 0;
+  for (; i + V::Width <= n; i += V::Width) {
+    V::storeF(out + i, V::loadHalf(in + i));
+  }
+  for (; i < n; ++i) {
+    out[i] = halfToFloatScalar(in[i]);
+  }
+}
+
+template <class V>
+void floatToHalf(uint16_t* out, const float* in, size_t n) {
+  size_t i = 0;
+  for (; i + V::Width <= n; i += V::Width) {
+    V::storeHalf(out + i, V::loadF(in + i));
+  }
+  for (; i < n; ++i) {
+    out[i] = floatToHalfScalar(in[i]);
+  }
+}
+
+template <class V>
+void bf16ToFloat(float* out, const uint16_t* in, size_t n) {
+  size_t i = 0;
+  for (; i + V::Width <= n; i += V::Width) {
+    V::storeF(out + i, V::loadBf16(in + i));
+  }
+  for (; i < n; ++i) {
+    out[i] = bf16ToFloatScalar(in[i]);
+  }
+}
+
+template <class V>
+void floatToBf16(uint16_t* out, const float* in, size_t n) {
+  size_t i = 0;
+  for (; i + V::Width <= n; i += V::Width) {
+    V::storeBf16(out + i, V::loadF(in + i));
+  }
+  for (; i < n; ++i) {
+    out[i] = floatToBf16Scalar(in[i]);
+  }
+}
+
+template <class V>
+constexpr HostReduceKernels makeHostReduceKernels(const char* isa) {
+  return HostReduceKernels{
+      isa,
+      {reduceF32<V, HostReduceSum>, reduceF32<V, HostReduceProd>, reduceF32<V, HostReduceMin>,
+       reduceF32<V, HostReduceMax>},
+      {reduceInt<V, HostReduceSum, int32_t>, reduceInt<V, HostReduceProd, int32_t>,
+       reduceInt<V, HostReduceMin, int32_t>, reduceInt<V, HostReduceMax, int32_t>},
+      {reduceInt<V, HostReduceSum, uint32_t>, reduceInt<V, HostReduceProd, uint32_t>,
+       reduceInt<V, HostReduceMin, uint32_t>, reduceInt<V, HostReduceMax, uint32_t>},
+      halfToFloat<V>,
+      floatToHalf<V>,
+      bf16ToFloat<V>,
+      floatToBf16<V>,
+  };
+}
+
+}  // namespace
+}  // namespace mscclpp
+
+#endif  // MSCCLPP_HOST_REDUCE_SIMD_HPP_
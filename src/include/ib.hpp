@@ -4,6 +4,7 @@
 #ifndef MSCCLPP_IB_HPP_
 #define MSCCLPP_IB_HPP_
 
+#include <deque>
 #include <list>
 #include <memory>
 #include <mscclpp/core.hpp>
@@ -21,11 +22,14 @@ struct ibv_sge;
 
 namespace mscclpp {
 
+class IbMrCache;
+
 struct IbMrInfo {
   uint64_t addr;
   uint32_t rkey;
 };
 
+// A registered buffer. It may share its registration with other buffers within the same pages, see IbMrCache.
 class IbMr {
  public:
   virtual ~IbMr();
@@ -35,13 +39,15 @@ class IbMr {
   virtual uint32_t getLkey() const;
 
  private:
-  IbMr(ibv_pd* pd, void* buff, std::size_t size);
+  IbMr(ibv_mr* mr, uint32_t lkey, uint32_t rkey, void* buff, std::size_t size);
 
   ibv_mr* mr;
+  uint32_t lkey;
+  uint32_t rkey;
   void* buff;
   std::size_t size;
 
-  friend class IbCtx;
+  friend class IbMrCache;
 };
 
 // QP info to be shared with the remote peer
@@ -77,10 +83,23 @@ class IbQp {
                                 [[maybe_unused]] uint32_t size, [[maybe_unused]] uint64_t wrId,
                                 [[maybe_unused]] uint64_t srcOffset, [[maybe_unused]] uint64_t dstOffset,
                                 [[maybe_unused]] bool signaled, [[maybe_unused]] unsigned int immData);
+  /// Stages a signaled RDMA write of zero bytes. It completes after all earlier work requests did, so its completion
+  /// covers unsignaled work requests that were posted before it.
+  virtual void stageSignal(uint64_t wrId);
   virtual void postSend();
   virtual int pollCq();
 
   IbQpInfo& getInfo() { return this->info; }
+  /// Returns true if no more work requests can be staged before the next postSend().
+  bool isStagingFull() const { return this->wrn >= this->maxWrPerSend; }
+  /// Moderates the completions of work requests that are staged unsignaled: every @p interval-th of them is signaled
+  /// anyway, so that the send queue slots of the others are reclaimed when its completion is polled. 0 disables it.
+  void setSignalInterval(int interval);
+  /// Returns true if unsignaled work requests were staged since the last signaled one, which a flush cannot wait for.
+  bool hasUnsignaledTail() const { return this->numUnsignaledItems > 0; }
+  /// Returns the largest wr_id of the successful completions polled so far. Completions arrive in posting order, so if
+  /// wr_ids never decrease, all work requests posted up to one with this wr_id are complete.
+  uint64_t getLastCompletedWrId() const { return this->lastCompletedWrId; }
   virtual int getWcStatus([[maybe_unused]] int idx) const;
   virtual int getNumCqItems() const;
 
@@ -92,7 +111,8 @@ class IbQp {
 
   IbQp(ibv_context* ctx, ibv_pd* pd, int port, int maxCqSize, int maxCqPollNum, int maxSendWr, int maxRecvWr,
        int maxWrPerSend);
-  WrInfo getNewWrInfo();
+  WrInfo getNewWrInfo(bool& signaled);
+  void reclaim(int numWrs, int numSignaled);
 
   IbQpInfo info;
 
@@ -104,8 +124,17 @@ class IbQp {
   int wrn;
   int numSignaledPostedItems;
   int numSignaledStagedItems;
+  // Work requests staged since the last signaled one
+  int numUnsignaledItems;
+  // Posted work requests whose send queue slots are not reclaimed yet, and the number of them that the completion of
+  // each outstanding signaled work request reclaims, in posting order
+  int numPostedWrs;
+  std::deque<int> signaledWrSpans;
+  int signalInterval;
+  uint64_t lastCompletedWrId;
 
   const int maxCqPollNum;
+  const int maxSendWr;
   const int maxWrPerSend;
 
   friend class IbCtx;
@@ -119,6 +148,9 @@ class IbCtx {
 
   IbQp* createQp(int maxCqSize, int maxCqPollNum, int maxSendWr, int maxRecvWr, int maxWrPerSend, int port = -1);
   const IbMr* registerMr(void* buff, std::size_t size);
+  // Returns the cache that registerMr() registers through. MSCCLPP_IB_MR_CACHE_BYTES sets its budget, which is
+  // unlimited by default, so that memory stays registered until the context is destroyed.
+  std::shared_ptr<IbMrCache> getMrCache() const { return this->mrCache; }
 #else
   IbCtx([[maybe_unused]] const std::string& devName) {}
   ~IbCtx() {}
@@ -128,6 +160,7 @@ class IbCtx {
     return nullptr;
   }
   const IbMr* registerMr([[maybe_unused]] void* buff, [[maybe_unused]] std::size_t size) { return nullptr; }
+  std::shared_ptr<IbMrCache> getMrCache() const { return nullptr; }
 #endif
 
   const std::string& getDevName() const { return this->devName; };
@@ -140,7 +173,8 @@ class IbCtx {
   ibv_context* ctx;
   ibv_pd* pd;
   std::list<std::unique_ptr<IbQp>> qps;
-  std::list<std::unique_ptr<IbMr>> mrs;
+  // Shared with the RegisteredMemory that release their IbMrs to it, which may outlive this context
+  std::shared_ptr<IbMrCache> mrCache;
 };
 
 }  // namespace mscclpp
@@ -0,0 +1,106 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#ifndef MSCCLPP_IB_MR_CACHE_HPP_
+#define MSCCLPP_IB_MR_CACHE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "ib.hpp"
+
+namespace mscclpp {
+
+// A registration made by the verbs layer.
+struct IbMrRegistration {
+  ibv_mr* mr;
+  uint32_t lkey;
+  uint32_t rkey;
+};
+
+// Counters of an IbMrCache.
+struct IbMrCacheStats {
+  // Buffers that lay within a cached registration, and those that needed a new one
+  uint64_t hits;
+  uint64_t misses;
+  // Registrations without references deregistered to stay within the budget
+  uint64_t evictions;
+  // Registrations and the bytes they pin, with references or not
+  uint64_t registrations;
+  uint64_t pinnedBytes;
+};
+
+// Caches the memory registrations of an IbCtx in an interval tree of their page-aligned address ranges, so that a
+// buffer within a range that is registered already shares its registration instead of pinning its pages again. Each
+// IbMr returned by acquire() holds a reference to its registration until release(). A registration without
+// references is never shared again, since the memory may have been freed and its address reused, but it stays
+// registered for peers that may still write into it until the cache pins more bytes than its budget. Then the least
+// recently released are deregistered first.
+class IbMrCache {
+ public:
+  using RegisterFn = std::function<IbMrRegistration(void* addr, std::size_t size)>;
+  using DeregisterFn = std::function<void(ibv_mr* mr)>;
+
+  // Registers with @p reg and deregisters with @p dereg. @p reg throws if the registration fails.
+  IbMrCache(RegisterFn reg, DeregisterFn dereg, std::size_t maxPinnedBytes = SIZE_MAX);
+  ~IbMrCache();
+
+  // Returns an IbMr of @p size bytes at @p buff, registering its pages unless a cached registration covers them.
+  const IbMr* acquire(void* buff, std::size_t size);
+
+  // Drops the reference of @p mr to its registration and frees it.
+  void release(const IbMr* mr);
+
+  // Deregisters all registrations. IbMrs acquired before may still be released, but not used.
+  void close();
+
+  void setMaxPinnedBytes(std::size_t maxPinnedBytes);
+
+  IbMrCacheStats stats() const;
+
+ private:
+  // A registration, and while it has references, a node of the interval tree: a treap ordered by start address, where
+  // each node also holds the largest end address in its subtree.
+  struct Entry {
+    uintptr_t begin;
+    uintptr_t end;
+    IbMrRegistration reg;
+    int refs;
+    Entry* left;
+    Entry* right;
+    uint32_t priority;
+    uintptr_t maxEnd;
+  };
+
+  static void update(Entry* node);
+  static Entry* merge(Entry* left, Entry* right);
+  // Splits @p node into the nodes ordered before @p key and the others.
+  static void split(Entry* node, const Entry* key, Entry*& left, Entry*& right);
+  static Entry* remove(Entry* node, const Entry* entry);
+  static Entry* findCovering(Entry* node, uintptr_t begin, uintptr_t end);
+  void insert(Entry* entry);
+  void erase(Entry* entry);
+  void deregister(Entry* entry);
+  void evictIdle(std::size_t maxPinnedBytes);
+
+  RegisterFn reg_;
+  DeregisterFn dereg_;
+  std::size_t maxPinnedBytes_;
+  bool closed_;
+  uint32_t seed_;
+  Entry* root_;
+  // Registrations without references, most recently released first
+  std::list<Entry*> idle_;
+  std::unordered_map<const IbMr*, std::pair<std::unique_ptr<IbMr>, Entry*>> mrs_;
+  IbMrCacheStats stats_;
+  mutable std::mutex mutex_;
+};
+
+}  // namespace mscclpp
+
+#endif  // MSCCLPP_IB_MR_CACHE_HPP_
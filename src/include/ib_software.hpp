@@ -0,0 +1,62 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#ifndef MSCCLPP_IB_SOFTWARE_HPP_
+#define MSCCLPP_IB_SOFTWARE_HPP_
+
+#include <cstdint>
+
+namespace mscclpp {
+
+// Configures the software verbs backend.
+struct SoftwareIbConfig {
+  // Number of devices, named soft0, soft1, ... They map to Transport::IB0, IB1, ... in this order.
+  int numDevices = 1;
+  // Time in microseconds from the end of the transfer of a work request to its execution at the remote side.
+  double latencyUs = 0;
+  // Bandwidth in GB/s of each QP. The work requests of a QP are transferred one after another. 0 means unlimited.
+  double bandwidthGBps = 0;
+};
+
+// Counters of a software device since the backend was installed.
+struct SoftwareIbStats {
+  // Calls of ibv_post_send, i.e. doorbells
+  uint64_t doorbells;
+  uint64_t workRequests;
+  // Bytes written by RDMA writes
+  uint64_t bytes;
+  // Completions generated, including those of failed work requests
+  uint64_t completions;
+  // Calls of ibv_poll_cq
+  uint64_t polls;
+  // Posts rejected because the send queue was full, and completions that did not fit into their CQ
+  uint64_t sendQueueOverflows;
+  uint64_t cqOverruns;
+};
+
+// An in-process software implementation of the verbs that IbCtx and IbQp use, for testing and profiling without an
+// HCA. RDMA writes and fetch-and-adds execute on host memory of this process, and only signaled work requests
+// complete, as on an HCA. Work requests execute in order per QP, after the transfer time that the bandwidth allows
+// plus the latency. With neither, they execute within ibv_post_send. Receive queues are not supported, so the
+// immediate data of writes with immediate is dropped.
+//
+// Setting MSCCLPP_IB_BACKEND=software installs it instead of libibverbs, configured by MSCCLPP_SOFTWARE_IB_DEVICES,
+// MSCCLPP_SOFTWARE_IB_LATENCY_US and MSCCLPP_SOFTWARE_IB_BANDWIDTH_GBPS.
+class SoftwareIb {
+ public:
+  // Makes IBVerbs call the software backend. It must be installed before any IB context is created.
+  static void install(const SoftwareIbConfig& config = SoftwareIbConfig());
+
+  // Makes IBVerbs load libibverbs again. All IB contexts must be destroyed before.
+  static void uninstall();
+
+  // Returns the configuration given by the environment variables.
+  static SoftwareIbConfig configFromEnv();
+
+  // Returns the counters of the device at @p index.
+  static SoftwareIbStats stats(int index);
+};
+
+}  // namespace mscclpp
+
+#endif  // MSCCLPP_IB_SOFTWARE_HPP_
@@ -9,6 +9,9 @@
 
 #include <iostream>
 #include <mscclpp/errors.hpp>
+#include <string>
+
+#include "ib_software.hpp"
 
 namespace mscclpp {
 
@@ -17,6 +20,11 @@ struct IBVerbs {
   // Static method to initialize the library
   static void initialize() {
     initialized = true;
+    const char* backend = getenv("MSCCLPP_IB_BACKEND");
+    if (backend != nullptr && std::string(backend) == "software") {
+      SoftwareIb::install(SoftwareIb::configFromEnv());
+      return;
+    }
     handle = dlopen("libibverbs.so", RTLD_NOW);
     if (!handle) {
       throw mscclpp::IbError("Failed to load libibverbs: " + std::string(dlerror()), errno);
@@ -52,6 +60,84 @@ struct IBVerbs {
   }
 
  public:
+  // Types of the function pointers
+  typedef struct ibv_device** (*ibv_get_device_list_t)(int*);
+  typedef void (*ibv_free_device_list_t)(struct ibv_device**);
+  typedef struct ibv_pd* (*ibv_alloc_pd_t)(struct ibv_context*);
+  typedef int (*ibv_dealloc_pd_t)(struct ibv_pd*);
+  typedef struct ibv_context* (*ibv_open_device_t)(struct ibv_device*);
+  typedef int (*ibv_close_device_t)(struct ibv_context*);
+  typedef int (*ibv_query_device_t)(struct ibv_context*, struct ibv_device_attr*);
+  typedef struct ibv_cq* (*ibv_create_cq_t)(struct ibv_context*, int, void*, struct ibv_comp_channel*, int);
+  typedef struct ibv_qp* (*ibv_create_qp_t)(struct ibv_pd*, struct ibv_qp_init_attr*);
+  typedef int (*ibv_destroy_cq_t)(struct ibv_cq*);
+  typedef int (*ibv_destroy_qp_t)(struct ibv_qp*);
+  typedef struct ibv_mr* (*ibv_reg_mr_t)(struct ibv_pd*, void*, size_t, int);
+  typedef int (*ibv_dereg_mr_t)(struct ibv_mr*);
+  typedef int (*ibv_query_gid_t)(struct ibv_context*, uint8_t, int, union ibv_gid*);
+  typedef int (*ibv_modify_qp_t)(struct ibv_qp*, struct ibv_qp_attr*, int);
+  typedef int (*ibv_query_port_t)(struct ibv_context*, uint8_t, struct ibv_port_attr*);
+  typedef struct ibv_mr* (*ibv_reg_mr_iova2_t)(struct ibv_pd* pd, void* addr, size_t length, uint64_t iova,
+                                               unsigned int access);
+
+  // The functions of libibverbs that IBVerbs calls. Posting and polling are not among them: like the inline functions
+  // of libibverbs, they go through the ops of the ibv_context that owns the QP or CQ.
+  struct Functions {
+    ibv_get_device_list_t getDeviceList;
+    ibv_free_device_list_t freeDeviceList;
+    ibv_alloc_pd_t allocPd;
+    ibv_dealloc_pd_t deallocPd;
+    ibv_open_device_t openDevice;
+    ibv_close_device_t closeDevice;
+    ibv_query_device_t queryDevice;
+    ibv_create_cq_t createCq;
+    ibv_create_qp_t createQp;
+    ibv_destroy_cq_t destroyCq;
+    ibv_destroy_qp_t destroyQp;
+    ibv_reg_mr_t regMr;
+    ibv_dereg_mr_t deregMr;
+    ibv_query_gid_t queryGid;
+    ibv_modify_qp_t modifyQp;
+    ibv_query_port_t queryPort;
+    ibv_reg_mr_iova2_t regMrIova2;
+  };
+
+  // Static method to use the given functions instead of loading libibverbs, e.g. those of a software stand-in for an
+  // HCA. It must be called before any IB context is created.
+  static void setFunctions(const Functions& functions) {
+    cleanup();
+    ibv_get_device_list_lib = functions.getDeviceList;
+    ibv_free_device_list_lib = functions.freeDeviceList;
+    ibv_alloc_pd_lib = functions.allocPd;
+    ibv_dealloc_pd_lib = functions.deallocPd;
+    ibv_open_device_lib = functions.openDevice;
+    ibv_close_device_lib = functions.closeDevice;
+    ibv_query_device_lib = functions.queryDevice;
+    ibv_create_cq_lib = functions.createCq;
+    ibv_create_qp_lib = functions.createQp;
+    ibv_destroy_cq_lib = functions.destroyCq;
+    ibv_destroy_qp_lib = functions.destroyQp;
+    ibv_reg_mr_lib = functions.regMr;
+    ibv_dereg_mr_lib = functions.deregMr;
+    ibv_query_gid_lib = functions.queryGid;
+    ibv_modify_qp_lib = functions.modifyQp;
+    ibv_query_port_lib = functions.queryPort;
+    ibv_reg_mr_iova2_lib = functions.regMrIova2;
+    initialized = true;
+    replaced = true;
+  }
+
+  // Static method to load libibverbs again on the next call after setFunctions()
+  static void resetFunctions() {
+    cleanup();
+    ibv_get_device_list_lib = nullptr;
+    initialized = false;
+    replaced = false;
+  }
+
+  // Static method to tell whether the functions were set with setFunctions()
+  static bool isReplaced() { return replaced; }
+
   // Static method to get the device list
   static struct ibv_device** ibv_get_device_list(int* num_devices) {
     if (!initialized) initialize();
@@ -226,27 +312,7 @@ struct IBVerbs {
   // Handle for the dynamic library
   static inline void* handle = nullptr;
 
-  // Function pointers
-  typedef struct ibv_device** (*ibv_get_device_list_t)(int*);
-  typedef void (*ibv_free_device_list_t)(struct ibv_device**);
-  typedef struct ibv_pd* (*ibv_alloc_pd_t)(struct ibv_context*);
-  typedef int (*ibv_dealloc_pd_t)(struct ibv_pd*);
-  typedef struct ibv_context* (*ibv_open_device_t)(struct ibv_device*);
-  typedef int (*ibv_close_device_t)(struct ibv_context*);
-  typedef int (*ibv_query_device_t)(struct ibv_context*, struct ibv_device_attr*);
-  typedef struct ibv_cq* (*ibv_create_cq_t)(struct ibv_context*, int, void*, struct ibv_comp_channel*, int);
-  typedef struct ibv_qp* (*ibv_create_qp_t)(struct ibv_pd*, struct ibv_qp_init_attr*);
-  typedef int (*ibv_destroy_cq_t)(struct ibv_cq*);
-  typedef int (*ibv_destroy_qp_t)(struct ibv_qp*);
-  typedef struct ibv_mr* (*ibv_reg_mr_t)(struct ibv_pd*, void*, size_t, int);
-  typedef int (*ibv_dereg_mr_t)(struct ibv_mr*);
-  typedef int (*ibv_query_gid_t)(struct ibv_context*, uint8_t, int, union ibv_gid*);
-  typedef int (*ibv_modify_qp_t)(struct ibv_qp*, struct ibv_qp_attr*, int);
-  typedef int (*ibv_query_port_t)(struct ibv_context*, uint8_t, struct ibv_port_attr*);
-  typedef struct ibv_mr* (*ibv_reg_mr_iova2_t)(struct ibv_pd* pd, void* addr, size_t length, uint64_t iova,
-                                               unsigned int access);
-
-  static inline ibv_get_device_list_t ibv_get_device_list_lib;
+  static inline ibv_get_device_list_t ibv_get_device_list_lib = nullptr;
   static inline ibv_free_device_list_t ibv_free_device_list_lib = nullptr;
   static inline ibv_alloc_pd_t ibv_alloc_pd_lib = nullptr;
   static inline ibv_dealloc_pd_t ibv_dealloc_pd_lib = nullptr;
@@ -265,6 +331,7 @@ struct IBVerbs {
   static inline ibv_reg_mr_iova2_t ibv_reg_mr_iova2_lib = nullptr;
 
   static inline bool initialized = false;
+  static inline bool replaced = false;
 };
 
 }  // namespace mscclpp
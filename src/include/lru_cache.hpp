@@ -0,0 +1,136 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#ifndef MSCCLPP_LRU_CACHE_HPP_
+#define MSCCLPP_LRU_CACHE_HPP_
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <unordered_map>
+
+namespace mscclpp {
+
+// A least-recently-used cache bounded by a number of entries and by a total number of bytes. Each entry carries the
+// number of bytes it accounts for, given on insertion. A limit of zero means unlimited. The entry inserted last is
+// never evicted, even if it alone exceeds the byte limit, so a reference returned by insert() stays valid until the
+// next call that modifies the cache.
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class LruCache {
+ public:
+  struct Entry {
+    Key key;
+    Value value;
+    size_t bytes;
+    uint64_t hits;
+  };
+  using EvictHandler = std::function<void(const Key&, Value&)>;
+  using const_iterator = typename std::list<Entry>::const_iterator;
+
+  LruCache(size_t maxEntries = 0, size_t maxBytes = 0, EvictHandler onEvict = nullptr)
+      : maxEntries_(maxEntries), maxBytes_(maxBytes), onEvict_(std::move(onEvict)) {}
+
+  // Returns the cached value and marks it as the most recently used, or nullptr if the key is not cached.
+  Value* find(const Key& key) {
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+      misses_++;
+      return nullptr;
+    }
+    entries_.splice(entries_.begin(), entries_, it->second);
+    it->second->hits++;
+    hits_++;
+    return &it->second->value;
+  }
+
+  // Inserts a value that is not cached yet as the most recently used entry, then evicts least recently used entries
+  // until the cache fits its limits again.
+  Value& insert(const Key& key, Value&& value, size_t bytes) {
+    entries_.push_front(Entry{key, std::move(value), bytes, 0});
+    index_[key] = entries_.begin();
+    bytes_ += bytes;
+    trim();
+    return entries_.front().value;
+  }
+
+  bool erase(const Key& key) {
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+      return false;
+    }
+    evict(it->second);
+    return true;
+  }
+
+  template <typename Predicate>
+  size_t eraseIf(Predicate pred) {
+    size_t count = 0;
+    for (auto it = entries_.begin(); it != entries_.end();) {
+      auto next = std::next(it);
+      if (pred(it->key, it->value)) {
+        evict(it);
+        count++;
+      }
+      it = next;
+    }
+    return count;
+  }
+
+  void clear() {
+    while (!entries_.empty()) {
+      evict(std::prev(entries_.end()));
+    }
+  }
+
+  void setLimits(size_t maxEntries, size_t maxBytes) {
+    maxEntries_ = maxEntries;
+    maxBytes_ = maxBytes;
+    trim();
+  }
+
+  size_t maxEntries() const { return maxEntries_; }
+  size_t maxBytes() const { return maxBytes_; }
+  size_t size() const { return entries_.size(); }
+  size_t bytes() const { return bytes_; }
+  uint64_t hits() const { return hits_; }
+  uint64_t misses() const { return misses_; }
+  uint64_t evictions() const { return evictions_; }
+
+  // Iterates from the most recently used entry to the least recently used one.
+  const_iterator begin() const { return entries_.begin(); }
+  const_iterator end() const { return entries_.end(); }
+
+ private:
+  void trim() {
+    while (entries_.size() > 1 && ((maxEntries_ > 0 && entries_.size() > maxEntries_) ||
+                                   (maxBytes_ > 0 && bytes_ > maxBytes_))) {
+      evict(std::prev(entries_.end()));
+    }
+  }
+
+  void evict(typename std::list<Entry>::iterator it) {
+    // Unlink the entry first so the cache is consistent even if the handler throws.
+    Entry entry = std::move(*it);
+    index_.erase(entry.key);
+    entries_.erase(it);
+    bytes_ -= entry.bytes;
+    evictions_++;
+    if (onEvict_) {
+      onEvict_(entry.key, entry.value);
+    }
+  }
+
+  size_t maxEntries_;
+  size_t maxBytes_;
+  EvictHandler onEvict_;
+  std::list<Entry> entries_;
+  std::unordered_map<Key, typename std::list<Entry>::iterator, Hash> index_;
+  size_t bytes_ = 0;
+  uint64_t hits_ = 0;
+  uint64_t misses_ = 0;
+  uint64_t evictions_ = 0;
+};
+
+}  // namespace mscclpp
+
+#endif  // MSCCLPP_LRU_CACHE_HPP_
@@ -31,6 +31,18 @@ struct TransportInfo {
       char shareableHandle[64];
       size_t offsetFromBase;
     };
+    struct {
+      // The memory file of the ShmRegion that holds the memory, as a descriptor of process shmPid, or -1 if the memory
+      // is not in shared memory
+      int shmPid;
+      // The PID namespace that shmPid is in, see getPidNamespace()
+      uint64_t shmPidNamespace;
+      int shmFd;
+      // The inode of the memory file, which tells it from a later file with the same descriptor
+      uint64_t shmInode;
+      size_t shmRegionSize;
+      size_t shmOffsetFromBase;
+    };
   };
 };
 
@@ -46,6 +58,11 @@ struct RegisteredMemory::Impl {
   bool isCuMemMapAlloc;
   TransportFlags transports;
   std::vector<TransportInfo> transportInfos;
+  // The IB registrations of local memory, released on destruction
+  std::vector<std::pair<std::shared_ptr<IbMrCache>, const IbMr*>> ibMrs;
+  // The shared memory region of another process that this maps, if any
+  void* shmMappedBase = nullptr;
+  size_t shmMappedSize = 0;
 
   Impl(void* data, size_t size, TransportFlags transports, Context::Impl& contextImpl);
   /// Constructs a RegisteredMemory::Impl from a vector of data. The constructor should only be used for the remote
@@ -0,0 +1,38 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#ifndef MSCCLPP_SHM_HPP_
+#define MSCCLPP_SHM_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace mscclpp {
+
+// A region of host memory of this process that other processes can map, allocated by detail::shmCalloc. It is backed
+// by an anonymous memory file, which peers open through /proc/<pid>/fd/<fd> while the region exists. Once the region
+// is freed, the descriptor may name another file, so peers check the inode of what they open.
+struct ShmRegion {
+  void* base;
+  size_t size;
+  int fd;
+  uint64_t inode;
+};
+
+// Finds the region that holds all of [ptr, ptr + size). Returns false if there is none.
+bool findShmRegion(const void* ptr, size_t size, ShmRegion& region);
+
+// Returns an ID of the PID namespace of this process, or 0 if it is unknown. A process can only find the memory files
+// of processes in its own PID namespace.
+uint64_t getPidNamespace();
+
+// Maps the region of @p size bytes that process @p pid of PID namespace @p pidNamespace holds as file descriptor @p fd
+// with inode @p inode. Throws if the region has been freed since.
+void* mapPeerShm(int pid, uint64_t pidNamespace, int fd, uint64_t inode, size_t size);
+
+// Unmaps a region mapped by mapPeerShm().
+void unmapPeerShm(void* base, size_t size);
+
+}  // namespace mscclpp
+
+#endif  // MSCCLPP_SHM_HPP_
@@ -11,6 +11,7 @@
 #include <poll.h>
 #include <stddef.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 
 namespace mscclpp {
 
@@ -19,6 +20,9 @@ namespace mscclpp {
 #define SLEEP_INT 1000  // connection retry sleep interval in usec
 #define SOCKET_NAME_MAXLEN (NI_MAXHOST + NI_MAXSERV)
 #define MSCCLPP_SOCKET_MAGIC 0x564ab9f2fc4b9d6cULL
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
 
 /* Common socket address storage structure for IPv4/IPv6 */
 union SocketAddress {
@@ -66,10 +70,25 @@ class Socket {
   void bind();
   void bindAndListen();
   void connect(int64_t timeout = -1);
+  // Accept a connection on `listenSocket`. An async socket returns without waiting, in which case accept() is called
+  // again until the state is SocketStateReady. If it returns to SocketStateAccepting, the connection was not a peer
+  // and has been closed.
   void accept(const Socket* listenSocket, int64_t timeout = -1);
   void send(void* ptr, int size);
   void recv(void* ptr, int size);
   void recvUntilEnd(void* ptr, int size, int* closed);
+  // Transfer as many bytes as possible without blocking and return how many were transferred.
+  int trySend(const void* ptr, int size);
+  int tryRecv(void* ptr, int size);
+  // Send all bytes of the iovecs with one sendmsg() call when the socket buffer has room. The iovecs are consumed.
+  // Returns how many sendmsg() calls carried MSG_ZEROCOPY, each of which completes separately.
+  int sendv(struct iovec* iov, int iovcnt, int flags = 0);
+  // Receive at least one byte into the iovecs with one readv() call. Returns 0 if the peer closed the connection.
+  ssize_t recvv(const struct iovec* iov, int iovcnt);
+  // Allow sendv() with MSG_ZEROCOPY. Returns false if the kernel does not support it.
+  bool enableZeroCopy();
+  // Read the pending MSG_ZEROCOPY completions without blocking and return how many sends they cover.
+  int recvZeroCopyCompletions();
   void close();
 
   int getFd() const { return fd_; }
@@ -91,6 +110,8 @@ class Socket {
   void pollConnect();
   void finalizeConnect();
   void progressState();
+  // Wait until the socket is ready for `events`, or for a short timeout so that the caller can check the abort flag.
+  void pollReady(short events);
 
   void socketProgressOpt(int op, void* ptr, int size, int* offset, int block, int* closed);
   void socketProgress(int op, void* ptr, int size, int* offset);
@@ -105,6 +126,11 @@ class Socket {
   enum SocketState state_;
   uint64_t magic_;
   enum SocketType type_;
+  // What finalizeAccept() has received of the magic and the type that the peer sends after connecting
+  uint64_t acceptMagic_;
+  int acceptMagicOffset_;
+  enum SocketType acceptType_;
+  int acceptTypeOffset_;
 
   union SocketAddress addr_;
   int salen_;
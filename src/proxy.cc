@@ -2,11 +2,20 @@
 // Licensed under the MIT license.
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
 #include <mscclpp/core.hpp>
 #include <mscclpp/gpu_utils.hpp>
 #include <mscclpp/proxy.hpp>
 #include <mscclpp/utils.hpp>
+#include <mutex>
 #include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 #include "api.h"
 
@@ -18,17 +27,134 @@ const int ProxyStopCheckPeriod = 1000;
 // As long as the FIFO size is large enough, having a stale tail is not a problem.
 const int ProxyFlushPeriod = 4;
 
+// A batch handler gets at most this many triggers at once.
+const int ProxyMaxBatchSize = 64;
+
+static ProxyWaitConfig getDefaultWaitConfig() {
+  ProxyWaitConfig config;
+  const char* env = getenv("MSCCLPP_PROXY_WAIT_POLICY");
+  if (env == nullptr || strcmp(env, "spin") == 0) {
+    config.policy = ProxyWaitPolicy::Spin;
+  } else if (strcmp(env, "backoff") == 0) {
+    config.policy = ProxyWaitPolicy::Backoff;
+  } else if (strcmp(env, "park") == 0) {
+    config.policy = ProxyWaitPolicy::Park;
+  } else {
+    throw Error(std::string("Invalid MSCCLPP_PROXY_WAIT_POLICY: ") + env, ErrorCode::InvalidUsage);
+  }
+  return config;
+}
+
+static inline void cpuPause() {
+#if defined(__x86_64__) || defined(__i386__)
+  _mm_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+// The state of the proxy thread while its FIFO stays empty
+struct ProxyIdleState {
+  int emptyPolls = 0;
+  std::chrono::steady_clock::time_point idleStart;
+  std::chrono::steady_clock::time_point parkStart;
+  std::chrono::microseconds parkTime{0};
+};
+
 struct Proxy::Impl {
   ProxyHandler handler;
+  ProxyBatchHandler batchHandler;
   std::function<void()> threadInit;
   Fifo fifo;
   std::thread service;
   std::atomic_bool running;
 
+  ProxyWaitConfig waitConfig;
+  std::mutex parkMutex;
+  std::condition_variable parkCv;
+  std::atomic_bool parked;
+  bool wakeupRequested;
+  std::atomic<uint64_t> idleNs;
+  std::atomic<uint64_t> wakeups;
+  std::atomic<uint64_t> totalWakeupLatencyNs;
+  std::atomic<uint64_t> maxWakeupLatencyNs;
+
   Impl(ProxyHandler handler, std::function<void()> threadInit, size_t fifoSize)
-      : handler(handler), threadInit(threadInit), fifo(fifoSize), running(false) {}
+      : handler(handler), threadInit(threadInit), fifo(fifoSize), running(false) {
+    initWait();
+  }
+
+  Impl(ProxyBatchHandler batchHandler, std::function<void()> threadInit, size_t fifoSize)
+      : batchHandler(batchHandler), threadInit(threadInit), fifo(fifoSize), running(false) {
+    initWait();
+  }
+
+  void initWait() {
+    waitConfig = getDefaultWaitConfig();
+    parked = false;
+    wakeupRequested = false;
+    idleNs = 0;
+    wakeups = 0;
+    totalWakeupLatencyNs = 0;
+    maxWakeupLatencyNs = 0;
+  }
+
+  void run();
+  void runBatched();
+
+  // Waits after a poll that found no trigger. Returns false if the proxy was stopped meanwhile.
+  bool waitIdle(ProxyIdleState& idle);
+  // Ends an idle period after a poll that found triggers.
+  void endIdle(ProxyIdleState& idle);
 };
 
+bool Proxy::Impl::waitIdle(ProxyIdleState& idle) {
+  if (idle.emptyPolls++ == 0) {
+    idle.idleStart = std::chrono::steady_clock::now();
+  }
+  if (waitConfig.policy == ProxyWaitPolicy::Spin) {
+    return true;
+  }
+  if (idle.emptyPolls <= waitConfig.spinCount) {
+    cpuPause();
+    return true;
+  }
+  if (!running) {
+    return false;
+  }
+  if (waitConfig.policy == ProxyWaitPolicy::Backoff ||
+      idle.emptyPolls <= waitConfig.spinCount + waitConfig.yieldCount) {
+    std::this_thread::yield();
+    return true;
+  }
+
+  // Parking for twice as long as the last time, up to maxParkUs
+  idle.parkTime = std::min(std::max(idle.parkTime * 2, std::chrono::microseconds(1)),
+                           std::chrono::microseconds(waitConfig.maxParkUs));
+  idle.parkStart = std::chrono::steady_clock::now();
+  std::unique_lock<std::mutex> lock(parkMutex);
+  parked.store(true, std::memory_order_release);
+  parkCv.wait_for(lock, idle.parkTime, [this] { return wakeupRequested || !running; });
+  wakeupRequested = false;
+  parked.store(false, std::memory_order_relaxed);
+  return running;
+}
+
+void Proxy::Impl::endIdle(ProxyIdleState& idle) {
+  auto now = std::chrono::steady_clock::now();
+  idleNs.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(now - idle.idleStart).count(),
+                   std::memory_order_relaxed);
+  if (idle.parkTime.count() > 0) {
+    uint64_t latency = std::chrono::duration_cast<std::chrono::nanoseconds>(now - idle.parkStart).count();
+    wakeups.fetch_add(1, std::memory_order_relaxed);
+    totalWakeupLatencyNs.fetch_add(latency, std::memory_order_relaxed);
+    if (latency > maxWakeupLatencyNs.load(std::memory_order_relaxed)) {
+      maxWakeupLatencyNs.store(latency, std::memory_order_relaxed);
+    }
+  }
+  idle = ProxyIdleState();
+}
+
 MSCCLPP_API_CPP Proxy::Proxy(ProxyHandler handler, std::function<void()> threadInit, size_t fifoSize) {
   pimpl = std::make_unique<Impl>(handler, threadInit, fifoSize);
 }
@@ -37,6 +163,14 @@ MSCCLPP_API_CPP Proxy::Proxy(ProxyHandler handler, size_t fifoSize)
     : Proxy(
           handler, [] {}, fifoSize) {}
 
+MSCCLPP_API_CPP Proxy::Proxy(ProxyBatchHandler handler, std::function<void()> threadInit, size_t fifoSize) {
+  pimpl = std::make_unique<Impl>(handler, threadInit, fifoSize);
+}
+
+MSCCLPP_API_CPP Proxy::Proxy(ProxyBatchHandler handler, size_t fifoSize)
+    : Proxy(
+          handler, [] {}, fifoSize) {}
+
 MSCCLPP_API_CPP Proxy::~Proxy() {
   if (pimpl) {
     stop();
@@ -53,47 +187,14 @@ MSCCLPP_API_CPP void Proxy::start() {
 
     pimpl->threadInit();
 
-    ProxyHandler handler = this->pimpl->handler;
-    Fifo& fifo = this->pimpl->fifo;
-    std::atomic_bool& running = this->pimpl->running;
-    ProxyTrigger trigger;
-
-    int flushPeriod = std::min(fifo.size(), ProxyFlushPeriod);
-
-    int runCnt = ProxyStopCheckPeriod;
-    uint64_t flushCnt = 0;
-    for (;;) {
-      if (runCnt-- == 0) {
-        runCnt = ProxyStopCheckPeriod;
-        if (!running) {
-          break;
-        }
-      }
-      // Poll to see if we are ready to send anything
-      trigger = fifo.poll();
-      if (trigger.fst == 0 || trigger.snd == 0) {  // TODO: this check is a potential pitfall for custom triggers
-        continue;                                  // there is one in progress
-      }
-      trigger.snd ^= ((uint64_t)1 << (uint64_t)63);  // this is where the last bit of snd is reverted.
-
-      ProxyHandlerResult result = handler(trigger);
-
-      // Send completion: reset only the high 64 bits
-      fifo.pop();
-      // Flush the tail to device memory. This is either triggered every flushPeriod to make sure that the fifo can make
-      // progress even if there is no request mscclppSync. However, mscclppSync type is for flush request.
-      if ((++flushCnt % flushPeriod) == 0 || result == ProxyHandlerResult::FlushFifoTailAndContinue) {
-        // TODO: relocate this check: || (trigger.fields.type & mscclppSync)
-        fifo.flushTail();
-      }
-
-      if (result == ProxyHandlerResult::Stop) {
-        break;
-      }
+    if (pimpl->batchHandler) {
+      pimpl->runBatched();
+    } else {
+      pimpl->run();
     }
 
     // make sure the tail is flushed before we shut the proxy
-    fifo.flushTail(/*sync=*/true);
+    pimpl->fifo.flushTail(/*sync=*/true);
     // TODO: do these need to run?
     // bool isP2pProxy = (proxyState->ibContext == nullptr);
     // if (isP2pProxy) {
@@ -103,8 +204,103 @@ MSCCLPP_API_CPP void Proxy::start() {
   });
 }
 
+void Proxy::Impl::run() {
+  ProxyTrigger trigger;
+  ProxyIdleState idle;
+
+  int flushPeriod = std::min(fifo.size(), ProxyFlushPeriod);
+
+  int runCnt = ProxyStopCheckPeriod;
+  uint64_t flushCnt = 0;
+  for (;;) {
+    if (runCnt-- == 0) {
+      runCnt = ProxyStopCheckPeriod;
+      if (!running) {
+        break;
+      }
+    }
+    // Poll to see if we are ready to send anything
+    trigger = fifo.poll();
+    if (trigger.fst == 0 || trigger.snd == 0) {  // TODO: this check is a potential pitfall for custom triggers
+      if (!waitIdle(idle)) {                     // there is one in progress
+        break;
+      }
+      continue;
+    }
+    if (idle.emptyPolls > 0) {
+      endIdle(idle);
+    }
+    trigger.snd ^= ((uint64_t)1 << (uint64_t)63);  // this is where the last bit of snd is reverted.
+
+    ProxyHandlerResult result = handler(trigger);
+
+    // Send completion: reset only the high 64 bits
+    fifo.pop();
+    // Flush the tail to device memory. This is either triggered every flushPeriod to make sure that the fifo can make
+    // progress even if there is no request mscclppSync. However, mscclppSync type is for flush request.
+    if ((++flushCnt % flushPeriod) == 0 || result == ProxyHandlerResult::FlushFifoTailAndContinue) {
+      // TODO: relocate this check: || (trigger.fields.type & mscclppSync)
+      fifo.flushTail();
+    }
+
+    if (result == ProxyHandlerResult::Stop) {
+      break;
+    }
+  }
+}
+
+void Proxy::Impl::runBatched() {
+  std::vector<ProxyTrigger> triggers(std::min(fifo.size(), ProxyMaxBatchSize));
+  ProxyIdleState idle;
+
+  int flushPeriod = std::min(fifo.size(), ProxyFlushPeriod);
+
+  int runCnt = ProxyStopCheckPeriod;
+  int unflushedCnt = 0;
+  for (;;) {
+    if (runCnt-- == 0) {
+      runCnt = ProxyStopCheckPeriod;
+      if (!running) {
+        break;
+      }
+    }
+    // Drain every trigger that is ready
+    int count = fifo.pollBatch(triggers.data(), triggers.size());
+    if (count == 0) {
+      if (!waitIdle(idle)) {
+        break;
+      }
+      continue;
+    }
+    if (idle.emptyPolls > 0) {
+      endIdle(idle);
+    }
+    for (int i = 0; i < count; ++i) {
+      triggers[i].snd ^= ((uint64_t)1 << (uint64_t)63);  // revert the last bit of snd, as for a single trigger
+    }
+
+    ProxyHandlerResult result = batchHandler(triggers.data(), count);
+
+    fifo.popBatch(count);
+    // The tail is flushed at least once per flushPeriod triggers, as in the unbatched loop
+    unflushedCnt += count;
+    if (unflushedCnt >= flushPeriod || result == ProxyHandlerResult::FlushFifoTailAndContinue) {
+      fifo.flushTail();
+      unflushedCnt = 0;
+    }
+
+    if (result == ProxyHandlerResult::Stop) {
+      break;
+    }
+  }
+}
+
 MSCCLPP_API_CPP void Proxy::stop() {
-  pimpl->running = false;
+  {
+    std::lock_guard<std::mutex> lock(pimpl->parkMutex);
+    pimpl->running = false;
+  }
+  pimpl->parkCv.notify_all();
   if (pimpl->service.joinable()) {
     pimpl->service.join();
   }
@@ -112,4 +308,31 @@ MSCCLPP_API_CPP void Proxy::stop() {
 
 MSCCLPP_API_CPP Fifo& Proxy::fifo() { return pimpl->fifo; }
 
+MSCCLPP_API_CPP void Proxy::setWaitConfig(const ProxyWaitConfig& config) {
+  if (config.spinCount < 0 || config.yieldCount < 0 || config.maxParkUs <= 0) {
+    throw Error("Invalid proxy wait config", ErrorCode::InvalidUsage);
+  }
+  pimpl->waitConfig = config;
+}
+
+MSCCLPP_API_CPP void Proxy::wakeup() {
+  if (!pimpl->parked.load(std::memory_order_acquire)) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(pimpl->parkMutex);
+    pimpl->wakeupRequested = true;
+  }
+  pimpl->parkCv.notify_one();
+}
+
+MSCCLPP_API_CPP ProxyWaitStats Proxy::waitStats() const {
+  ProxyWaitStats stats;
+  stats.idleNs = pimpl->idleNs.load(std::memory_order_relaxed);
+  stats.wakeups = pimpl->wakeups.load(std::memory_order_relaxed);
+  stats.totalWakeupLatencyNs = pimpl->totalWakeupLatencyNs.load(std::memory_order_relaxed);
+  stats.maxWakeupLatencyNs = pimpl->maxWakeupLatencyNs.load(std::memory_order_relaxed);
+  return stats;
+}
+
 }  // namespace mscclpp
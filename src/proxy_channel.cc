@@ -1,14 +1,41 @@
 // Copyright (c) Microsoft Corporation.
 // Licensed under the MIT license.
 
+#include <algorithm>
 #include <mscclpp/numa.hpp>
 #include <mscclpp/proxy_channel.hpp>
 
 #include "api.h"
+#include "connection.hpp"
 #include "debug.h"
 
 namespace mscclpp {
 
+namespace {
+
+// Starts a batch on a connection that stages its work requests. Returns false for the other connections.
+bool beginBatch(Connection* connection) {
+  if (auto ib = dynamic_cast<IBConnection*>(connection)) {
+    ib->beginBatch();
+    return true;
+  }
+  if (auto multiRail = dynamic_cast<MultiRailIBConnection*>(connection)) {
+    multiRail->beginBatch();
+    return true;
+  }
+  return false;
+}
+
+void endBatch(Connection* connection) {
+  if (auto ib = dynamic_cast<IBConnection*>(connection)) {
+    ib->endBatch();
+  } else if (auto multiRail = dynamic_cast<MultiRailIBConnection*>(connection)) {
+    multiRail->endBatch();
+  }
+}
+
+}  // namespace
+
 MSCCLPP_API_CPP BaseProxyChannel::BaseProxyChannel(SemaphoreId semaphoreId,
                                                    std::shared_ptr<Host2DeviceSemaphore> semaphore,
                                                    std::shared_ptr<Proxy> proxy)
@@ -18,9 +45,15 @@ MSCCLPP_API_CPP ProxyChannel::ProxyChannel(SemaphoreId semaphoreId, std::shared_
                                            std::shared_ptr<Proxy> proxy, MemoryId dst, MemoryId src)
     : BaseProxyChannel(semaphoreId, semaphore, proxy), dst_(dst), src_(src) {}
 
-MSCCLPP_API_CPP ProxyService::ProxyService(size_t fifoSize)
-    : proxy_(std::make_shared<Proxy>([&](ProxyTrigger triggerRaw) { return handleTrigger(triggerRaw); },
-                                     [&]() { bindThread(); }, fifoSize)) {
+MSCCLPP_API_CPP ProxyService::ProxyService(size_t fifoSize, int numProxies) {
+  if (numProxies <= 0) {
+    throw Error("ProxyService needs at least one proxy", ErrorCode::InvalidUsage);
+  }
+  for (int i = 0; i < numProxies; ++i) {
+    proxies_.push_back(std::make_shared<Proxy>(
+        [&](const ProxyTrigger* triggers, int count) { return handleTriggerBatch(triggers, count); },
+        [&]() { bindThread(); }, fifoSize));
+  }
   int cudaDevice;
   MSCCLPP_CUDATHROW(cudaGetDevice(&cudaDevice));
   deviceNumaNode = getDeviceNumaNode(cudaDevice);
@@ -28,12 +61,18 @@ MSCCLPP_API_CPP ProxyService::ProxyService(size_t fifoSize)
 
 MSCCLPP_API_CPP SemaphoreId ProxyService::buildAndAddSemaphore(Communicator& communicator,
                                                                std::shared_ptr<Connection> connection) {
-  semaphores_.push_back(std::make_shared<Host2DeviceSemaphore>(communicator, connection));
-  return semaphores_.size() - 1;
+  return addSemaphore(std::make_shared<Host2DeviceSemaphore>(communicator, connection));
 }
 
 MSCCLPP_API_CPP SemaphoreId ProxyService::addSemaphore(std::shared_ptr<Host2DeviceSemaphore> semaphore) {
+  // Connections are dealt to the proxies in turn. A connection is only ever used by the thread of its proxy.
+  auto it = connectionProxies_.find(semaphore->connection().get());
+  if (it == connectionProxies_.end()) {
+    int proxy = connectionProxies_.size() % proxies_.size();
+    it = connectionProxies_.emplace(semaphore->connection().get(), proxy).first;
+  }
   semaphores_.push_back(semaphore);
+  semaphoreProxies_.push_back(it->second);
   return semaphores_.size() - 1;
 }
 
@@ -47,16 +86,24 @@ MSCCLPP_API_CPP std::shared_ptr<Host2DeviceSemaphore> ProxyService::semaphore(Se
 }
 
 MSCCLPP_API_CPP BaseProxyChannel ProxyService::baseProxyChannel(SemaphoreId id) {
-  return BaseProxyChannel(id, semaphores_[id], proxy_);
+  return BaseProxyChannel(id, semaphores_[id], proxies_[semaphoreProxies_[id]]);
 }
 
 MSCCLPP_API_CPP ProxyChannel ProxyService::proxyChannel(SemaphoreId id, MemoryId dst, MemoryId src) {
-  return ProxyChannel(id, semaphores_[id], proxy_, dst, src);
+  return ProxyChannel(id, semaphores_[id], proxies_[semaphoreProxies_[id]], dst, src);
 }
 
-MSCCLPP_API_CPP void ProxyService::startProxy() { proxy_->start(); }
+MSCCLPP_API_CPP void ProxyService::startProxy() {
+  for (auto& proxy : proxies_) {
+    proxy->start();
+  }
+}
 
-MSCCLPP_API_CPP void ProxyService::stopProxy() { proxy_->stop(); }
+MSCCLPP_API_CPP void ProxyService::stopProxy() {
+  for (auto& proxy : proxies_) {
+    proxy->stop();
+  }
+}
 
 MSCCLPP_API_CPP void ProxyService::bindThread() {
   if (deviceNumaNode >= 0) {
@@ -90,6 +137,37 @@ ProxyHandlerResult ProxyService::handleTrigger(ProxyTrigger triggerRaw) {
   return result;
 }
 
+ProxyHandlerResult ProxyService::handleTriggerBatch(const ProxyTrigger* triggers, int count) {
+  // The RDMA writes and atomics of the whole batch are only staged on their IB connections, and each connection then
+  // posts them with a single doorbell. A sync trigger still flushes its connection right away.
+  std::vector<Connection*> batched;
+  auto endBatches = [&batched]() {
+    for (Connection* connection : batched) {
+      endBatch(connection);
+    }
+  };
+  auto result = ProxyHandlerResult::Continue;
+  try {
+    for (int i = 0; i < count && result != ProxyHandlerResult::Stop; ++i) {
+      const ChannelTrigger* trigger = reinterpret_cast<const ChannelTrigger*>(&triggers[i]);
+      Connection* connection = semaphores_[trigger->fields.chanId]->connection().get();
+      if (std::find(batched.begin(), batched.end(), connection) == batched.end() && beginBatch(connection)) {
+        batched.push_back(connection);
+      }
+      auto triggerResult = handleTrigger(triggers[i]);
+      if (triggerResult != ProxyHandlerResult::Continue) {
+        result = triggerResult;
+      }
+    }
+  } catch (...) {
+    // post what the triggers before the failing one staged, and leave no connection in a batch
+    endBatches();
+    throw;
+  }
+  endBatches();
+  return result;
+}
+
 MSCCLPP_API_CPP BaseProxyChannel::DeviceHandle BaseProxyChannel::deviceHandle() const {
   return BaseProxyChannel::DeviceHandle(semaphoreId_, semaphore_->deviceHandle(), proxy_->fifo().deviceHandle());
 }
@@ -3,12 +3,16 @@
 
 #include "registered_memory.hpp"
 
+#include <unistd.h>
+
 #include <algorithm>
 #include <mscclpp/gpu_utils.hpp>
 
 #include "api.h"
 #include "context.hpp"
 #include "debug.h"
+#include "ib_mr_cache.hpp"
+#include "shm.hpp"
 #include "utils_internal.hpp"
 
 #define MSCCLPP_CULOG_WARN(cmd)                             \
@@ -106,11 +110,33 @@ RegisteredMemory::Impl::Impl(void* data, size_t size, TransportFlags transports,
     }
     this->transportInfos.push_back(transportInfo);
   }
+  if (transports.has(Transport::SharedMemory)) {
+    TransportInfo transportInfo;
+    transportInfo.transport = Transport::SharedMemory;
+    ShmRegion region;
+    if (findShmRegion(data, size, region)) {
+      transportInfo.shmPid = getpid();
+      transportInfo.shmPidNamespace = getPidNamespace();
+      transportInfo.shmFd = region.fd;
+      transportInfo.shmInode = region.inode;
+      transportInfo.shmRegionSize = region.size;
+      transportInfo.shmOffsetFromBase = static_cast<char*>(data) - static_cast<char*>(region.base);
+    } else {
+      // still good as the source of writes
+      transportInfo.shmPid = -1;
+      transportInfo.shmPidNamespace = 0;
+      transportInfo.shmFd = -1;
+      transportInfo.shmInode = 0;
+    }
+    this->transportInfos.push_back(transportInfo);
+  }
   if ((transports & AllIBTransports).any()) {
     auto addIb = [&](Transport ibTransport) {
       TransportInfo transportInfo;
       transportInfo.transport = ibTransport;
-      const IbMr* mr = contextImpl.getIbContext(ibTransport)->registerMr(data, size);
+      auto mrCache = contextImpl.getIbContext(ibTransport)->getMrCache();
+      const IbMr* mr = mrCache->acquire(data, size);
+      this->ibMrs.emplace_back(mrCache, mr);
       transportInfo.ibMr = mr;
       transportInfo.ibLocal = true;
       transportInfo.ibMrInfo = mr->getInfo();
@@ -171,6 +197,16 @@ MSCCLPP_API_CPP std::vector<char> RegisteredMemory::serialize() {
       }
     } else if (AllIBTransports.has(entry.transport)) {
       std::copy_n(reinterpret_cast<char*>(&entry.ibMrInfo), sizeof(entry.ibMrInfo), std::back_inserter(result));
+    } else if (entry.transport == Transport::SharedMemory) {
+      std::copy_n(reinterpret_cast<char*>(&entry.shmPid), sizeof(entry.shmPid), std::back_inserter(result));
+      std::copy_n(reinterpret_cast<char*>(&entry.shmPidNamespace), sizeof(entry.shmPidNamespace),
+                  std::back_inserter(result));
+      std::copy_n(reinterpret_cast<char*>(&entry.shmFd), sizeof(entry.shmFd), std::back_inserter(result));
+      std::copy_n(reinterpret_cast<char*>(&entry.shmInode), sizeof(entry.shmInode), std::back_inserter(result));
+      std::copy_n(reinterpret_cast<char*>(&entry.shmRegionSize), sizeof(entry.shmRegionSize),
+                  std::back_inserter(result));
+      std::copy_n(reinterpret_cast<char*>(&entry.shmOffsetFromBase), sizeof(entry.shmOffsetFromBase),
+                  std::back_inserter(result));
     } else {
       throw mscclpp::Error("Unknown transport", ErrorCode::InternalError);
     }
@@ -221,6 +257,20 @@ RegisteredMemory::Impl::Impl(const std::vector<char>& serialization) {
       std::copy_n(it, sizeof(transportInfo.ibMrInfo), reinterpret_cast<char*>(&transportInfo.ibMrInfo));
       it += sizeof(transportInfo.ibMrInfo);
       transportInfo.ibLocal = false;
+    } else if (transportInfo.transport == Transport::SharedMemory) {
+      std::copy_n(it, sizeof(transportInfo.shmPid), reinterpret_cast<char*>(&transportInfo.shmPid));
+      it += sizeof(transportInfo.shmPid);
+      std::copy_n(it, sizeof(transportInfo.shmPidNamespace), reinterpret_cast<char*>(&transportInfo.shmPidNamespace));
+      it += sizeof(transportInfo.shmPidNamespace);
+      std::copy_n(it, sizeof(transportInfo.shmFd), reinterpret_cast<char*>(&transportInfo.shmFd));
+      it += sizeof(transportInfo.shmFd);
+      std::copy_n(it, sizeof(transportInfo.shmInode), reinterpret_cast<char*>(&transportInfo.shmInode));
+      it += sizeof(transportInfo.shmInode);
+      std::copy_n(it, sizeof(transportInfo.shmRegionSize), reinterpret_cast<char*>(&transportInfo.shmRegionSize));
+      it += sizeof(transportInfo.shmRegionSize);
+      std::copy_n(it, sizeof(transportInfo.shmOffsetFromBase),
+                  reinterpret_cast<char*>(&transportInfo.shmOffsetFromBase));
+      it += sizeof(transportInfo.shmOffsetFromBase);
     } else {
       throw mscclpp::Error("Unknown transport", ErrorCode::InternalError);
     }
@@ -251,6 +301,15 @@ RegisteredMemory::Impl::Impl(const std::vector<char>& serialization) {
       this->data = static_cast<char*>(base) + entry.cudaIpcOffsetFromBase;
     }
     INFO(MSCCLPP_P2P, "Opened CUDA IPC handle at pointer %p", this->data);
+  } else if (transports.has(Transport::SharedMemory) && getHostHash() == this->hostHash &&
+             getTransportInfo(Transport::SharedMemory).shmFd >= 0) {
+    // The memory is in shared memory of another process of this machine, so we map its memory file
+    auto entry = getTransportInfo(Transport::SharedMemory);
+    this->shmMappedBase =
+        mapPeerShm(entry.shmPid, entry.shmPidNamespace, entry.shmFd, entry.shmInode, entry.shmRegionSize);
+    this->shmMappedSize = entry.shmRegionSize;
+    this->data = static_cast<char*>(this->shmMappedBase) + entry.shmOffsetFromBase;
+    INFO(MSCCLPP_P2P, "Mapped shared memory of process %d at pointer %p", entry.shmPid, this->data);
   } else {
     // No valid data pointer can be set
     this->data = nullptr;
@@ -258,6 +317,13 @@ RegisteredMemory::Impl::Impl(const std::vector<char>& serialization) {
 }
 
 RegisteredMemory::Impl::~Impl() {
+  for (auto& [mrCache, mr] : ibMrs) {
+    mrCache->release(mr);
+  }
+  if (shmMappedBase != nullptr) {
+    unmapPeerShm(shmMappedBase, shmMappedSize);
+    data = nullptr;
+  }
   // Close the CUDA IPC handle if it was opened during deserialization
   if (data && transports.has(Transport::CudaIpc) && getHostHash() == this->hostHash && getPidHash() != this->pidHash) {
     void* base = static_cast<char*>(data) - getTransportInfo(Transport::CudaIpc).cudaIpcOffsetFromBase;
@@ -44,9 +44,21 @@ MSCCLPP_API_CPP Host2DeviceSemaphore::DeviceHandle Host2DeviceSemaphore::deviceH
   return device;
 }
 
+// A peer connected by Transport::SharedMemory writes the inbound semaphore ID directly, so it has to be in shared
+// memory. Other transports write it through their own registration of ordinary host memory.
+static std::unique_ptr<uint64_t, HostOrShmDeleter<uint64_t>> allocHostInboundSemaphoreId(Transport transport) {
+  if (transport == Transport::SharedMemory) {
+    return std::unique_ptr<uint64_t, HostOrShmDeleter<uint64_t>>(allocUniqueShm<uint64_t>().release(),
+                                                                 HostOrShmDeleter<uint64_t>{true});
+  }
+  return std::unique_ptr<uint64_t, HostOrShmDeleter<uint64_t>>(new uint64_t(0));
+}
+
+// The expected inbound semaphore ID is only read locally.
 MSCCLPP_API_CPP Host2HostSemaphore::Host2HostSemaphore(Communicator& communicator,
                                                        std::shared_ptr<Connection> connection)
-    : BaseSemaphore(std::make_unique<uint64_t>(), std::make_unique<uint64_t>(), std::make_unique<uint64_t>()),
+    : BaseSemaphore(allocHostInboundSemaphoreId(connection->transport()), std::make_unique<uint64_t>(),
+                    std::make_unique<uint64_t>()),
       connection_(connection) {
   INFO(MSCCLPP_INIT, "Creating a Host2Host semaphore for %s transport from %d to %d",
        connection->getTransportName().c_str(), communicator.bootstrap()->getRank(),
@@ -0,0 +1,149 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "shm.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <map>
+#include <mscclpp/core.hpp>
+#include <mscclpp/errors.hpp>
+#include <mutex>
+#include <string>
+
+#include "api.h"
+#include "debug.h"
+
+namespace mscclpp {
+
+namespace {
+
+std::mutex& regionsMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+// Regions of this process by their base address
+std::map<uintptr_t, ShmRegion>& regions() {
+  static std::map<uintptr_t, ShmRegion> regions;
+  return regions;
+}
+
+}  // namespace
+
+namespace detail {
+
+MSCCLPP_API_CPP void* shmCalloc(size_t bytes) {
+  if (bytes == 0) {
+    throw Error("shared memory must not be empty", ErrorCode::InvalidUsage);
+  }
+  size_t pageSize = sysconf(_SC_PAGESIZE);
+  size_t size = (bytes + pageSize - 1) / pageSize * pageSize;
+  int fd = memfd_create("mscclpp_shm", MFD_CLOEXEC);
+  if (fd < 0) {
+    throw SysError("memfd_create failed", errno);
+  }
+  if (ftruncate(fd, size) != 0) {
+    int err = errno;
+    close(fd);
+    throw SysError("ftruncate of shared memory failed", err);
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    int err = errno;
+    close(fd);
+    throw SysError("fstat of shared memory failed", err);
+  }
+  // a new memory file reads as zeros
+  void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED) {
+    int err = errno;
+    close(fd);
+    throw SysError("mmap of shared memory failed", err);
+  }
+  std::lock_guard<std::mutex> lock(regionsMutex());
+  regions()[reinterpret_cast<uintptr_t>(base)] = ShmRegion{base, size, fd, static_cast<uint64_t>(st.st_ino)};
+  INFO(MSCCLPP_ALLOC, "Allocated %zu bytes of shared memory at %p", size, base);
+  return base;
+}
+
+MSCCLPP_API_CPP void shmFree(void* ptr) {
+  if (ptr == nullptr) return;
+  ShmRegion region;
+  {
+    std::lock_guard<std::mutex> lock(regionsMutex());
+    auto it = regions().find(reinterpret_cast<uintptr_t>(ptr));
+    if (it == regions().end()) {
+      WARN("Freeing %p, which is not shared memory", ptr);
+      return;
+    }
+    region = it->second;
+    regions().erase(it);
+  }
+  munmap(region.base, region.size);
+  close(region.fd);
+}
+
+}  // namespace detail
+
+bool findShmRegion(const void* ptr, size_t size, ShmRegion& region) {
+  uintptr_t begin = reinterpret_cast<uintptr_t>(ptr);
+  std::lock_guard<std::mutex> lock(regionsMutex());
+  auto it = regions().upper_bound(begin);
+  if (it == regions().begin()) return false;
+  --it;
+  if (begin + size > it->first + it->second.size) return false;
+  region = it->second;
+  return true;
+}
+
+uint64_t getPidNamespace() {
+  // namespaces are identified by the inode of their /proc entry
+  static const uint64_t pidNamespace = []() -> uint64_t {
+    struct stat st;
+    if (stat("/proc/self/ns/pid", &st) != 0) return 0;
+    return st.st_ino;
+  }();
+  return pidNamespace;
+}
+
+void* mapPeerShm(int pid, uint64_t pidNamespace, int fd, uint64_t inode, size_t size) {
+  // the PID would name another process, or none, here
+  if (pidNamespace != 0 && getPidNamespace() != 0 && pidNamespace != getPidNamespace()) {
+    throw Error("cannot map shared memory of process " + std::to_string(pid) +
+                    ", which is in another PID namespace. Transport::SharedMemory needs both processes in the same "
+                    "PID namespace, e.g. containers that share the PID namespace of the host",
+                ErrorCode::InvalidUsage);
+  }
+  std::string path = "/proc/" + std::to_string(pid) + "/fd/" + std::to_string(fd);
+  int peerFd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+  if (peerFd < 0) {
+    throw SysError("failed to open shared memory of process " + std::to_string(pid), errno);
+  }
+  // the process closes the descriptor when it frees the region, and may reuse it for another file
+  struct stat st;
+  if (fstat(peerFd, &st) != 0 || static_cast<uint64_t>(st.st_ino) != inode || static_cast<size_t>(st.st_size) != size) {
+    close(peerFd);
+    throw Error("shared memory of process " + std::to_string(pid) + " has been freed", ErrorCode::InvalidUsage);
+  }
+  void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, peerFd, 0);
+  int err = errno;
+  // the mapping keeps the memory alive
+  close(peerFd);
+  if (base == MAP_FAILED) {
+    throw SysError("mmap of shared memory of process " + std::to_string(pid) + " failed", err);
+  }
+  return base;
+}
+
+void unmapPeerShm(void* base, size_t size) {
+  if (munmap(base, size) != 0) {
+    WARN("Failed to unmap shared memory at %p: errno %d", base, errno);
+  }
+}
+
+}  // namespace mscclpp
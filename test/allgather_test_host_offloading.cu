@@ -15,6 +15,7 @@
 #include <stdlib.h>
 #include <unistd.h>
 
+#include <deque>
 #include <iostream>
 #include <string>
 #include <unordered_map>
@@ -87,6 +88,8 @@ class MyProxyService {
   std::vector<std::shared_ptr<mscclpp::Host2DeviceSemaphore>> deviceSemaphores1_;
   std::vector<std::shared_ptr<mscclpp::Host2DeviceSemaphore>> deviceSemaphores2_;
   std::vector<std::shared_ptr<mscclpp::Connection>> connections_;
+  // Writes to each peer that may still be in flight, oldest first
+  std::vector<std::deque<mscclpp::Request>> inflight_;
   mscclpp::Proxy proxy_;
   int deviceNumaNode_;
 
@@ -95,6 +98,7 @@ class MyProxyService {
       : dataSize_(dataSize),
         remoteMemories_(world_size),
         connections_(world_size),
+        inflight_(world_size),
         proxy_([&](mscclpp::ProxyTrigger triggerRaw) { return handleTrigger(triggerRaw); }, [&]() { bindThread(); }) {
     int cudaDevice;
     MSCCLPP_CUDATHROW(cudaGetDevice(&cudaDevice));
@@ -155,23 +159,24 @@ class MyProxyService {
   }
 
   mscclpp::ProxyHandlerResult handleTrigger(mscclpp::ProxyTrigger triggerRaw) {
-    static int flusher = 0;
+    const size_t maxInflight = 64;
     if (triggerRaw.fst > 0) {
       int dataSizePerRank = dataSize_ / world_size;
       for (int r = 1; r < world_size; ++r) {
         int nghr = (rank + r) % world_size;
-        connections_[nghr]->write(remoteMemories_[nghr], rank * dataSizePerRank, localMemory_, rank * dataSizePerRank,
-                                  dataSizePerRank);
+        inflight_[nghr].push_back(connections_[nghr]->writeAsync(remoteMemories_[nghr], rank * dataSizePerRank,
+                                                                 localMemory_, rank * dataSizePerRank,
+                                                                 dataSizePerRank));
         if (triggerRaw.fst == 1)
           deviceSemaphores1_[nghr]->signal();
         else
           deviceSemaphores2_[nghr]->signal();
-        if ((flusher % 64) == 0 && mscclpp::AllIBTransports.has(connections_[nghr]->transport())) {
-          // if we are using IB transport, we need a flush every once in a while
-          connections_[nghr]->flush();
+        if (inflight_[nghr].size() > maxInflight) {
+          // waiting for the oldest write alone bounds what is in flight, while the later ones keep going
+          inflight_[nghr].front().wait();
+          inflight_[nghr].pop_front();
         }
       }
-      flusher++;
     }
     return mscclpp::ProxyHandlerResult::FlushFifoTailAndContinue;
   }
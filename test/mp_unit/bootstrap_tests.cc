@@ -57,6 +57,76 @@ TEST_F(BootstrapTest, WithId) {
   bootstrapTestAll(bootstrap);
 }
 
+TEST_F(BootstrapTest, LogDepthCollectives) {
+  // The log-depth algorithms are only selected automatically for many ranks.
+  setenv("MSCCLPP_BOOTSTRAP_ALGO", "logdepth", 1);
+  auto bootstrap = std::make_shared<mscclpp::TcpBootstrap>(gEnv->rank, gEnv->worldSize);
+  unsetenv("MSCCLPP_BOOTSTRAP_ALGO");
+  mscclpp::UniqueId id;
+  if (bootstrap->getRank() == 0) id = bootstrap->createUniqueId();
+  MPI_Bcast(&id, sizeof(id), MPI_BYTE, 0, MPI_COMM_WORLD);
+  bootstrap->initialize(id);
+  bootstrapTestAll(bootstrap);
+  // slices of several ints check the offsets of the staging buffer
+  std::vector<int> data(bootstrap->getNranks() * 3, 0);
+  for (int i = 0; i < 3; ++i) data[bootstrap->getRank() * 3 + i] = bootstrap->getRank() * 3 + i;
+  bootstrap->allGather(data.data(), 3 * sizeof(int));
+  for (int i = 0; i < bootstrap->getNranks() * 3; ++i) {
+    EXPECT_EQ(data[i], i);
+  }
+}
+
+TEST_F(BootstrapTest, NonblockingSendRecv) {
+  auto bootstrap = std::make_shared<mscclpp::TcpBootstrap>(gEnv->rank, gEnv->worldSize);
+  mscclpp::UniqueId id;
+  if (bootstrap->getRank() == 0) id = bootstrap->createUniqueId();
+  MPI_Bcast(&id, sizeof(id), MPI_BYTE, 0, MPI_COMM_WORLD);
+  bootstrap->initialize(id);
+  int rank = bootstrap->getRank();
+  int nRanks = bootstrap->getNranks();
+
+  // Large messages to every peer are sent before any of them is received, which needs the progress thread to drain
+  // the sockets.
+  const int count = 1 << 20;
+  for (int i = 0; i < nRanks; i++) {
+    if (i == rank) continue;
+    std::vector<int> msg(count, rank * nRanks + i);
+    bootstrap->send(msg.data(), count * sizeof(int), i, 0);
+  }
+
+  const int nTags = 4;
+  std::vector<int> sendMsgs(nTags);
+  std::vector<int> recvMsgs(nRanks * nTags, -1);
+  std::vector<std::future<void>> futures;
+  for (int t = 0; t < nTags; t++) {
+    sendMsgs[t] = rank * nTags + t;
+  }
+  for (int i = 0; i < nRanks; i++) {
+    if (i == rank) continue;
+    // post the receives in the opposite order of the sends
+    for (int t = nTags - 1; t >= 0; t--) {
+      futures.push_back(bootstrap->irecv(&recvMsgs[i * nTags + t], sizeof(int), i, t + 1));
+    }
+    for (int t = 0; t < nTags; t++) {
+      futures.push_back(bootstrap->isend(&sendMsgs[t], sizeof(int), i, t + 1));
+    }
+  }
+  for (auto& future : futures) {
+    future.get();
+  }
+
+  for (int i = 0; i < nRanks; i++) {
+    if (i == rank) continue;
+    for (int t = 0; t < nTags; t++) {
+      EXPECT_EQ(recvMsgs[i * nTags + t], i * nTags + t);
+    }
+    std::vector<int> msg(count);
+    bootstrap->recv(msg.data(), count * sizeof(int), i, 0);
+    EXPECT_EQ(msg.front(), i * nRanks + rank);
+    EXPECT_EQ(msg.back(), i * nRanks + rank);
+  }
+}
+
 TEST_F(BootstrapTest, WithIpPortPair) {
   auto bootstrap = std::make_shared<mscclpp::TcpBootstrap>(gEnv->rank, gEnv->worldSize);
   bootstrap->initialize(gEnv->args["ip_port"]);
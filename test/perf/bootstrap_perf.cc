@@ -0,0 +1,116 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// Measures TcpBootstrap initialization, allGather and barrier with the ring and the log-depth algorithms. All ranks
+// are forked processes on localhost.
+//
+// Usage: bootstrap_perf [-n iterations] [-s sliceBytes] nRanks [nRanks ...]
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <mscclpp/core.hpp>
+#include <vector>
+
+namespace {
+
+double nowUs() {
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void runRank(int rank, int nRanks, const mscclpp::UniqueId& id, int iterations, int sliceBytes, const char* algo) {
+  double start = nowUs();
+  auto bootstrap = std::make_shared<mscclpp::TcpBootstrap>(rank, nRanks);
+  bootstrap->initialize(id);
+  double initUs = nowUs() - start;
+
+  std::vector<char> data(static_cast<size_t>(nRanks) * sliceBytes);
+  for (int i = 0; i < sliceBytes; i++) {
+    data[static_cast<size_t>(rank) * sliceBytes + i] = static_cast<char>(rank + i);
+  }
+  // the first calls open the peer sockets
+  bootstrap->allGather(data.data(), sliceBytes);
+  bootstrap->barrier();
+  for (int r = 0; r < nRanks; r++) {
+    for (int i = 0; i < sliceBytes; i++) {
+      if (data[static_cast<size_t>(r) * sliceBytes + i] != static_cast<char>(r + i)) {
+        std::cerr << "rank " << rank << ": wrong data from rank " << r << std::endl;
+        std::exit(1);
+      }
+    }
+  }
+
+  start = nowUs();
+  for (int i = 0; i < iterations; i++) {
+    bootstrap->allGather(data.data(), sliceBytes);
+  }
+  double allGatherUs = (nowUs() - start) / iterations;
+
+  start = nowUs();
+  for (int i = 0; i < iterations; i++) {
+    bootstrap->barrier();
+  }
+  double barrierUs = (nowUs() - start) / iterations;
+
+  if (rank == 0) {
+    std::cout << std::left << std::setw(10) << algo << std::right << std::setw(8) << nRanks << std::fixed
+              << std::setprecision(1) << std::setw(14) << initUs / 1000 << std::setw(16) << allGatherUs
+              << std::setw(14) << barrierUs << std::endl;
+  }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  int iterations = 20;
+  int sliceBytes = 64;
+  std::vector<int> rankCounts;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      iterations = std::stoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      sliceBytes = std::stoi(argv[++i]);
+    } else {
+      rankCounts.push_back(std::stoi(argv[i]));
+    }
+  }
+  if (rankCounts.empty() || iterations <= 0 || sliceBytes <= 0) {
+    std::cerr << "Usage: " << argv[0] << " [-n iterations] [-s sliceBytes] nRanks [nRanks ...]" << std::endl;
+    return 1;
+  }
+
+  std::cout << std::left << std::setw(10) << "algo" << std::right << std::setw(8) << "ranks" << std::setw(14)
+            << "init(ms)" << std::setw(16) << "allGather(us)" << std::setw(14) << "barrier(us)" << std::endl;
+  for (int nRanks : rankCounts) {
+    for (const char* algo : {"ring", "logdepth"}) {
+      setenv("MSCCLPP_BOOTSTRAP_ALGO", algo, 1);
+      mscclpp::UniqueId id = mscclpp::TcpBootstrap::createUniqueId();
+      std::vector<pid_t> children;
+      for (int rank = 0; rank < nRanks; rank++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+          runRank(rank, nRanks, id, iterations, sliceBytes, algo);
+          std::cout.flush();
+          _exit(0);
+        }
+        children.push_back(pid);
+      }
+      int failures = 0;
+      for (pid_t pid : children) {
+        int status;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) failures++;
+      }
+      if (failures > 0) {
+        std::cerr << failures << " of " << nRanks << " ranks failed with " << algo << std::endl;
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,157 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// Measures the throughput of EthernetConnection over loopback. Both ends of the connection live in this process. Each
+// write is followed by updateAndSync on a host flag, and the clock stops when the flag of the last write lands. Host
+// buffers are sent in place, so no GPU is needed unless -d asks for device buffers, which go through the staging
+// buffers. -z sends host writes of at least the given size with MSG_ZEROCOPY. -m stripes the writes over several
+// sockets, e.g. run with -m 1, 2, 4 and 8 to compare stream counts. -S runs the same loop over a shared memory
+// connection instead, into host buffers allocated with allocUniqueShm, for comparison with loopback TCP.
+//
+// Usage: ethernet_perf [-n iterations] [-b stagingBuffers] [-s stagingBufferBytes] [-z zeroCopyBytes]
+//                      [-m streams] [-t stripeBytes] [-d | -S] [minBytes [maxBytes]]
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <mscclpp/core.hpp>
+#include <mscclpp/gpu_utils.hpp>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Loopback {
+  mscclpp::Context senderContext;
+  mscclpp::Context receiverContext;
+  std::shared_ptr<mscclpp::Connection> sender;
+  std::shared_ptr<mscclpp::Connection> receiver;
+
+  Loopback(const mscclpp::EndpointConfig& config) {
+    auto senderEndpoint = senderContext.createEndpoint(config);
+    auto receiverEndpoint = receiverContext.createEndpoint(config);
+    // each side accepts the connection of the other while it connects
+    std::thread t([&] { receiver = receiverContext.connect(receiverEndpoint, senderEndpoint); });
+    sender = senderContext.connect(senderEndpoint, receiverEndpoint);
+    t.join();
+  }
+};
+
+void waitFlag(const uint64_t* flag, uint64_t value) {
+  while (reinterpret_cast<const std::atomic<uint64_t>*>(flag)->load(std::memory_order_acquire) < value) {
+    std::this_thread::yield();
+  }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  int iterations = 20;
+  bool useDevice = false;
+  size_t minBytes = 8;
+  size_t maxBytes = 64 << 20;
+  mscclpp::EndpointConfig config(mscclpp::Transport::Ethernet);
+  std::vector<size_t> bounds;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      iterations = std::stoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+      config.ethernetNumStagingBuffers = std::stoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      config.ethernetStagingBufferSize = std::stoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "-z") == 0 && i + 1 < argc) {
+      config.ethernetZeroCopyThreshold = std::stoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+      config.ethernetNumStreams = std::stoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+      config.ethernetStripeSize = std::stoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "-d") == 0) {
+      useDevice = true;
+    } else if (std::strcmp(argv[i], "-S") == 0) {
+      config.transport = mscclpp::Transport::SharedMemory;
+    } else {
+      bounds.push_back(std::stoull(argv[i]));
+    }
+  }
+  if (bounds.size() > 0) minBytes = bounds[0];
+  if (bounds.size() > 1) maxBytes = bounds[1];
+  bool useShm = config.transport == mscclpp::Transport::SharedMemory;
+  if (bounds.size() > 2 || iterations <= 0 || minBytes == 0 || minBytes > maxBytes || (useDevice && useShm)) {
+    std::cerr << "Usage: " << argv[0]
+              << " [-n iterations] [-b stagingBuffers] [-s stagingBufferBytes] [-z zeroCopyBytes] [-m streams]"
+              << " [-t stripeBytes] [-d | -S] [minBytes [maxBytes]]" << std::endl;
+    return 1;
+  }
+
+  Loopback loopback(config);
+  std::vector<char> hostSrc(maxBytes);
+  std::vector<char> hostDst(maxBytes);
+  mscclpp::UniqueCudaPtr<char> deviceSrc;
+  mscclpp::UniqueCudaPtr<char> deviceDst;
+  std::unique_ptr<char, mscclpp::ShmDeleter<char>> shmDst;
+  std::unique_ptr<uint64_t, mscclpp::ShmDeleter<uint64_t>> shmFlag;
+  for (size_t i = 0; i < maxBytes; i++) {
+    hostSrc[i] = static_cast<char>(i * 7 + 1);
+  }
+  char* srcPtr = hostSrc.data();
+  char* dstPtr = hostDst.data();
+  if (useDevice) {
+    deviceSrc = mscclpp::allocUniqueCuda<char>(maxBytes);
+    deviceDst = mscclpp::allocUniqueCuda<char>(maxBytes);
+    mscclpp::memcpyCuda<char>(deviceSrc.get(), hostSrc.data(), maxBytes, cudaMemcpyHostToDevice);
+    srcPtr = deviceSrc.get();
+    dstPtr = deviceDst.get();
+  }
+  uint64_t hostFlag = 0;
+  uint64_t* flag = &hostFlag;
+  if (useShm) {
+    shmDst = mscclpp::allocUniqueShm<char>(maxBytes);
+    shmFlag = mscclpp::allocUniqueShm<uint64_t>();
+    dstPtr = shmDst.get();
+    flag = shmFlag.get();
+  }
+  uint64_t counter = 0;
+  auto src = loopback.senderContext.registerMemory(srcPtr, maxBytes, config.transport);
+  auto dst = loopback.receiverContext.registerMemory(dstPtr, maxBytes, config.transport);
+  auto flagMem = loopback.receiverContext.registerMemory(flag, sizeof(uint64_t), config.transport);
+
+  std::cout << "transport: " << mscclpp::TransportNames[static_cast<int>(config.transport)]
+            << ", memory: " << (useDevice ? "device" : "host")
+            << ", staging buffers: " << config.ethernetNumStagingBuffers << " x " << config.ethernetStagingBufferSize
+            << " bytes, zero-copy threshold: " << config.ethernetZeroCopyThreshold << " bytes" << std::endl;
+  std::cout << "streams: " << config.ethernetNumStreams << ", stripe: " << config.ethernetStripeSize << " bytes"
+            << std::endl;
+  std::cout << std::setw(12) << "bytes" << std::setw(14) << "latency(us)" << std::setw(14) << "GB/s" << std::endl;
+  for (size_t bytes = minBytes; bytes <= maxBytes; bytes *= 2) {
+    // the first write checks the data and warms up the connection
+    loopback.sender->write(dst, 0, src, 0, bytes);
+    loopback.sender->updateAndSync(flagMem, 0, &counter, counter + 1);
+    waitFlag(flag, counter);
+    std::vector<char> check(bytes);
+    if (useDevice) {
+      mscclpp::memcpyCuda<char>(check.data(), dstPtr, bytes, cudaMemcpyDeviceToHost);
+    } else {
+      std::memcpy(check.data(), dstPtr, bytes);
+    }
+    if (std::memcmp(check.data(), hostSrc.data(), bytes) != 0) {
+      std::cerr << "Wrong data received for " << bytes << " bytes" << std::endl;
+      return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+      loopback.sender->write(dst, 0, src, 0, bytes);
+      loopback.sender->updateAndSync(flagMem, 0, &counter, counter + 1);
+    }
+    waitFlag(flag, counter);
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    loopback.sender->flush();
+
+    std::cout << std::setw(12) << bytes << std::fixed << std::setprecision(2) << std::setw(14) << us / iterations
+              << std::setw(14) << bytes * iterations / us / 1e3 << std::endl;
+    if (bytes > maxBytes / 2) break;
+  }
+  return 0;
+}
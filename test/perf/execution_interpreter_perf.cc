@@ -0,0 +1,79 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// Runs execution plans with the CPU reference interpreter and prints where the time goes, per operation type. The
+// time of an operation type is summed over all threadblocks of all ranks and includes waiting, so it shows which
+// operations a plan spends its time in rather than how long the plan takes on a GPU.
+//
+// Usage: execution_interpreter_perf [-n iterations] [-s bytes] plan.json [plan.json ...]
+
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <mscclpp/executor.hpp>
+
+#include "execution_interpreter.hpp"
+
+int main(int argc, char* argv[]) {
+  int iterations = 10;
+  size_t bytes = 1 << 20;
+  std::vector<std::string> plans;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      iterations = std::stoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      bytes = std::stoul(argv[++i]);
+    } else {
+      plans.push_back(argv[i]);
+    }
+  }
+  if (plans.empty() || iterations <= 0 || bytes == 0) {
+    std::cerr << "Usage: " << argv[0] << " [-n iterations] [-s bytes] plan.json [plan.json ...]" << std::endl;
+    return 1;
+  }
+
+  for (const auto& planPath : plans) {
+    mscclpp::CompiledExecutionPlan plan = mscclpp::loadCompiledExecutionPlan(planPath);
+    mscclpp::ExecutionInterpreter interpreter(plan, bytes, bytes);
+    std::vector<std::vector<float>> inputs(interpreter.nRanks(), std::vector<float>(bytes / sizeof(float), 1.0f));
+    std::vector<std::vector<float>> outputs = inputs;
+    std::vector<void*> inputPtrs, outputPtrs;
+    for (int rank = 0; rank < interpreter.nRanks(); rank++) {
+      inputPtrs.push_back(inputs[rank].data());
+      outputPtrs.push_back(plan.isInPlace ? inputs[rank].data() : outputs[rank].data());
+    }
+
+    mscclpp::InterpreterStats total;
+    for (int i = 0; i < iterations; i++) {
+      mscclpp::InterpreterStats stats = interpreter.run(inputPtrs, outputPtrs, mscclpp::DataType::FLOAT32);
+      if (i == 0) {
+        total = stats;
+        continue;
+      }
+      for (size_t type = 0; type < stats.opCounts.size(); type++) {
+        total.opCounts[type] += stats.opCounts[type];
+        total.opNanoseconds[type] += stats.opNanoseconds[type];
+      }
+      total.remoteBytes += stats.remoteBytes;
+      total.elapsedUs += stats.elapsedUs;
+    }
+
+    std::cout << std::filesystem::path(planPath).filename().string() << ": " << interpreter.nRanks() << " ranks, "
+              << bytes << " bytes, " << std::fixed << std::setprecision(1) << double(total.elapsedUs) / iterations
+              << " us and " << total.remoteBytes / iterations << " remote bytes per run" << std::endl;
+    std::cout << std::left << std::setw(28) << "  operation" << std::right << std::setw(10) << "count" << std::setw(14)
+              << "total(us)" << std::setw(10) << "share" << std::endl;
+    uint64_t allNanoseconds = 0;
+    for (uint64_t ns : total.opNanoseconds) allNanoseconds += ns;
+    for (size_t type = 0; type < total.opCounts.size(); type++) {
+      if (total.opCounts[type] == 0) continue;
+      std::cout << "  " << std::left << std::setw(26)
+                << mscclpp::operationTypeToString(static_cast<mscclpp::OperationType>(type)) << std::right
+                << std::setw(10) << total.opCounts[type] / iterations << std::setw(14)
+                << total.opNanoseconds[type] / 1e3 / iterations << std::setw(9)
+                << (allNanoseconds ? 100.0 * total.opNanoseconds[type] / allNanoseconds : 0.0) << "%" << std::endl;
+    }
+  }
+  return 0;
+}
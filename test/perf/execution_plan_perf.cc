@@ -0,0 +1,110 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// Measures the time to load an execution plan from JSON and from the binary plan format, and reports the size of the
+// device plans that the executor uploads, summed over all ranks, against the fixed layout that preceded them.
+//
+// Usage: execution_plan_perf [-n iterations] plan.json [plan.json ...]
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <mscclpp/executor.hpp>
+
+#include "device_execution_plan.hpp"
+#include "execution_plan.hpp"
+
+namespace {
+
+template <typename F>
+double measureUs(int iterations, F&& func) {
+  // warm up the page cache
+  func();
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    func();
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::micro>(end - start).count() / iterations;
+}
+
+// The size of one threadblock plan in the fixed layout, which had room for 16 channels of each type and 64 operations.
+constexpr size_t FixedDevicePlanSize = 8976;
+
+void reportDevicePlanSizes(const std::vector<std::string>& plans) {
+  std::cout << std::endl
+            << std::left << std::setw(32) << "plan" << std::right << std::setw(14) << "threadblocks" << std::setw(12)
+            << "operations" << std::setw(12) << "fixed(B)" << std::setw(12) << "compact(B)" << std::setw(14)
+            << "max shmem(B)" << std::endl;
+  for (const auto& planPath : plans) {
+    mscclpp::CompiledExecutionPlan plan = mscclpp::loadCompiledExecutionPlan(planPath);
+    size_t nThreadblocks = 0, nOperations = 0, compactSize = 0, maxPlanSize = 0;
+    for (const auto& [rank, threadblocks] : plan.operationTemplates) {
+      std::vector<mscclpp::ThreadblockExecutionPlan> threadblockPlans;
+      for (size_t tb = 0; tb < threadblocks.size(); tb++) {
+        mscclpp::ThreadblockExecutionPlan threadblockPlan;
+        // only the number of channels matters for the size
+        threadblockPlan.smChannels.resize(plan.threadblockSMChannelMap.at(rank).at(tb).size());
+        threadblockPlan.proxyChannels.resize(plan.threadblockProxyChannelMap.at(rank).at(tb).size());
+        threadblockPlan.nvlsChannels.resize(plan.threadblockNvlsChannelMap.at(rank).at(tb).size());
+        threadblockPlan.operations = threadblocks[tb];
+        nOperations += threadblocks[tb].size();
+        threadblockPlans.push_back(std::move(threadblockPlan));
+      }
+      mscclpp::EncodedExecutionPlans encoded = mscclpp::encodeDeviceExecutionPlans(threadblockPlans);
+      nThreadblocks += encoded.nThreadblocks;
+      compactSize += encoded.data.size();
+      maxPlanSize = std::max(maxPlanSize, encoded.maxPlanSize);
+    }
+    std::cout << std::left << std::setw(32) << std::filesystem::path(planPath).filename().string() << std::right
+              << std::setw(14) << nThreadblocks << std::setw(12) << nOperations << std::setw(12)
+              << nThreadblocks * FixedDevicePlanSize << std::setw(12) << compactSize << std::setw(14) << maxPlanSize
+              << std::endl;
+  }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  int iterations = 100;
+  std::vector<std::string> plans;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      iterations = std::stoi(argv[++i]);
+    } else {
+      plans.push_back(argv[i]);
+    }
+  }
+  if (plans.empty() || iterations <= 0) {
+    std::cerr << "Usage: " << argv[0] << " [-n iterations] plan.json [plan.json ...]" << std::endl;
+    return 1;
+  }
+
+  std::filesystem::path tmpDir =
+      std::filesystem::temp_directory_path() / ("mscclpp_plan_perf_" + std::to_string(getpid()));
+  std::filesystem::create_directories(tmpDir);
+
+  std::cout << std::left << std::setw(32) << "plan" << std::right << std::setw(12) << "json(B)" << std::setw(12)
+            << "binary(B)" << std::setw(14) << "json(us)" << std::setw(14) << "binary(us)" << std::setw(10)
+            << "speedup" << std::endl;
+  for (const auto& planPath : plans) {
+    std::filesystem::path binaryPath = tmpDir / (std::filesystem::path(planPath).stem().string() + ".bin");
+    mscclpp::compileExecutionPlan(planPath, binaryPath.string());
+
+    double jsonUs = measureUs(iterations, [&]() { mscclpp::loadCompiledExecutionPlan(planPath); });
+    double binaryUs = measureUs(iterations, [&]() { mscclpp::readBinaryExecutionPlan(binaryPath.string()); });
+
+    std::cout << std::left << std::setw(32) << std::filesystem::path(planPath).filename().string() << std::right
+              << std::setw(12) << std::filesystem::file_size(planPath) << std::setw(12)
+              << std::filesystem::file_size(binaryPath) << std::fixed << std::setprecision(2) << std::setw(14)
+              << jsonUs << std::setw(14) << binaryUs << std::setw(9) << jsonUs / binaryUs << "x" << std::endl;
+  }
+  std::filesystem::remove_all(tmpDir);
+  reportDevicePlanSizes(plans);
+  return 0;
+}
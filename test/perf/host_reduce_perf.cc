@@ -0,0 +1,175 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// Measures the bandwidth of the host reduction kernels. The first table runs each instruction set single-threaded on
+// two inputs that fit in the caches, for every data type and operation. The second one runs hostReduce() on buffers
+// of growing size with the given numbers of inputs and threads. The bandwidth counts the bytes of all inputs and of
+// the output once. Thread count 0 lets hostReduce() pick the number of threads; by default both 1 and 0 run.
+//
+// Usage: host_reduce_perf [-i inputs] [-t threads] [-m maxMegabytes] [-r milliseconds]
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <mscclpp/host_reduce.hpp>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "host_reduce_kernels.hpp"
+
+namespace {
+
+struct Options {
+  int inputs = 2;
+  std::vector<int> threads;
+  size_t maxBytes = 64 << 20;
+  int durationMs = 200;
+};
+
+// Repeats fn for about durationMs and returns the seconds of one call.
+double timeIt(int durationMs, const std::function<void()>& fn) {
+  fn();
+  int iters = 1;
+  while (true) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iters; ++i) fn();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (seconds * 1e3 >= durationMs) return seconds / iters;
+    iters = seconds > 0 ? std::max<int>(iters * 2, iters * durationMs / (seconds * 1e3) * 1.2) : iters * 2;
+  }
+}
+
+std::vector<const mscclpp::HostReduceKernels*> availableKernels() {
+  std::vector<const mscclpp::HostReduceKernels*> kernels = {mscclpp::hostReduceKernelsScalar()};
+#if defined(__x86_64__)
+  __builtin_cpu_init();
+  if (mscclpp::hostReduceKernelsAvx2() != nullptr && __builtin_cpu_supports("avx2")) {
+    kernels.push_back(mscclpp::hostReduceKernelsAvx2());
+  }
+  if (mscclpp::hostReduceKernelsAvx512() != nullptr && __builtin_cpu_supports("avx512f")) {
+    kernels.push_back(mscclpp::hostReduceKernelsAvx512());
+  }
+#endif
+  return kernels;
+}
+
+const char* opName(int op) {
+  const char* names[] = {"sum", "prod", "min", "max"};
+  return names[op];
+}
+
+// A 16-bit reduction as hostReduce() does it: both inputs converted to FLOAT32, reduced and converted back.
+void reduce16(const mscclpp::HostReduceKernels& k, bool bf16, int op, uint16_t* out, const uint16_t* a,
+              const uint16_t* b, float* fa, float* fb, size_t n) {
+  (bf16 ? k.bf16ToFloat : k.halfToFloat)(fa, a, n);
+  (bf16 ? k.bf16ToFloat : k.halfToFloat)(fb, b, n);
+  k.f32[op](fa, fa, fb, n);
+  (bf16 ? k.floatToBf16 : k.floatToHalf)(out, fa, n);
+}
+
+void runKernels(const Options& options) {
+  // 2048 elements, the block size of hostReduce()
+  const size_t n = 2048;
+  std::vector<uint32_t> a(n, 0x3f800000u), b(n, 0x3f800001u), out(n);
+  std::vector<float> fa(n), fb(n);
+  std::vector<uint16_t> ha(n, 0x3c00), hb(n, 0x3c01), hout(n);
+  std::vector<const mscclpp::HostReduceKernels*> kernels = availableKernels();
+
+  std::cout << "single-threaded kernels on " << n << " elements, GB/s" << std::endl;
+  std::cout << std::setw(10) << "type" << std::setw(6) << "op";
+  for (auto k : kernels) std::cout << std::setw(10) << k->isa;
+  std::cout << std::endl;
+  const char* types[] = {"float32", "int32", "uint32", "float16", "bfloat16"};
+  for (int type = 0; type < 5; ++type) {
+    for (int op = 0; op < mscclpp::HostReduceNumOps; ++op) {
+      std::cout << std::setw(10) << types[type] << std::setw(6) << opName(op);
+      for (auto k : kernels) {
+        std::function<void()> fn;
+        size_t bytes = 3 * n * (type < 3 ? 4 : 2);
+        if (type == 0) {
+          auto pa = reinterpret_cast<float*>(a.data()), pb = reinterpret_cast<float*>(b.data());
+          auto po = reinterpret_cast<float*>(out.data());
+          fn = [&, k, op, pa, pb, po] { k->f32[op](po, pa, pb, n); };
+        } else if (type == 1) {
+          auto pa = reinterpret_cast<int32_t*>(a.data()), pb = reinterpret_cast<int32_t*>(b.data());
+          auto po = reinterpret_cast<int32_t*>(out.data());
+          fn = [&, k, op, pa, pb, po] { k->i32[op](po, pa, pb, n); };
+        } else if (type == 2) {
+          fn = [&, k, op] { k->u32[op](out.data(), a.data(), b.data(), n); };
+        } else {
+          bool bf16 = type == 4;
+          fn = [&, k, op, bf16] { reduce16(*k, bf16, op, hout.data(), ha.data(), hb.data(), fa.data(), fb.data(), n); };
+        }
+        double seconds = timeIt(options.durationMs / 4, fn);
+        std::cout << std::fixed << std::setprecision(2) << std::setw(10) << bytes / seconds / 1e9;
+      }
+      std::cout << std::endl;
+    }
+  }
+}
+
+void runBuffers(const Options& options) {
+  std::cout << std::endl
+            << "hostReduce() sum of " << options.inputs << " inputs with " << mscclpp::hostReduceIsa() << ", GB/s"
+            << std::endl;
+  std::cout << std::setw(10) << "bytes" << std::setw(10) << "type";
+  for (int t : options.threads) std::cout << std::setw(10) << (t == 0 ? std::string("auto") : std::to_string(t) + "t");
+  std::cout << std::endl;
+  size_t maxCount = options.maxBytes / 4;
+  std::vector<std::vector<float>> inputs(options.inputs, std::vector<float>(maxCount, 1.0f));
+  std::vector<float> dst(maxCount);
+  std::vector<const void*> srcs;
+  for (auto& input : inputs) srcs.push_back(input.data());
+  const std::pair<const char*, mscclpp::DataType> types[] = {{"float32", mscclpp::DataType::FLOAT32},
+                                                             {"bfloat16", mscclpp::DataType::BFLOAT16}};
+  for (size_t bytes = 64 << 10; bytes <= options.maxBytes; bytes *= 4) {
+    for (const auto& type : types) {
+      size_t elementSize = type.second == mscclpp::DataType::FLOAT32 ? 4 : 2;
+      size_t count = bytes / elementSize;
+      std::cout << std::setw(10) << bytes << std::setw(10) << type.first;
+      for (int t : options.threads) {
+        double seconds = timeIt(options.durationMs, [&] {
+          mscclpp::hostReduce(dst.data(), srcs, count, type.second, mscclpp::ReduceOp::SUM, t);
+        });
+        std::cout << std::fixed << std::setprecision(2) << std::setw(10)
+                  << bytes * (options.inputs + 1) / seconds / 1e9;
+      }
+      std::cout << std::endl;
+    }
+  }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+      options.inputs = std::stoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+      options.threads.push_back(std::stoi(argv[++i]));
+    } else if (std::strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+      options.maxBytes = std::stoul(argv[++i]) << 20;
+    } else if (std::strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+      options.durationMs = std::stoi(argv[++i]);
+    } else {
+      std::cerr << "Usage: " << argv[0] << " [-i inputs] [-t threads] [-m maxMegabytes] [-r milliseconds]"
+                << std::endl;
+      return 1;
+    }
+  }
+  if (options.inputs < 2 || options.durationMs <= 0 || options.maxBytes == 0 ||
+      std::any_of(options.threads.begin(), options.threads.end(), [](int t) { return t < 0; })) {
+    std::cerr << "Need at least 2 inputs, 1 MiB of buffer, non-negative thread counts and a positive duration"
+              << std::endl;
+    return 1;
+  }
+  if (options.threads.empty()) options.threads = {1, 0};
+  runKernels(options);
+  runBuffers(options);
+  return 0;
+}
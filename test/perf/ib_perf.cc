@@ -0,0 +1,126 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// Measures IBConnection on the software verbs backend, so no HCA is needed. Both ends of the connection live in this
+// process, and the backend models the latency and bandwidth given by -l and -w. Each write is followed by updateAndSync
+// on a host flag, and the clock stops when the flag of the last write lands. The doorbells and completions per write
+// show what the connection costs the NIC, e.g. run with -s 1 and -s 16 to compare signal intervals. With -r, writes of
+// at least 1 MiB are striped across that many rails, each a software device with the bandwidth given by -w.
+//
+// Usage: ib_perf [-n iterations] [-l latencyMicroseconds] [-w bandwidthGBps] [-s signalInterval] [-r rails]
+//                [minBytes [maxBytes]]
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <mscclpp/core.hpp>
+#include <thread>
+#include <vector>
+
+#include "ib_software.hpp"
+
+namespace {
+
+void waitFlag(const uint64_t* flag, uint64_t value) {
+  while (reinterpret_cast<const std::atomic<uint64_t>*>(flag)->load(std::memory_order_acquire) < value) {
+    std::this_thread::yield();
+  }
+}
+
+// Sums the counters of the rails.
+mscclpp::SoftwareIbStats totalStats(int numRails) {
+  mscclpp::SoftwareIbStats total = {};
+  for (int i = 0; i < numRails; i++) {
+    auto stats = mscclpp::SoftwareIb::stats(i);
+    total.doorbells += stats.doorbells;
+    total.completions += stats.completions;
+  }
+  return total;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  int iterations = 100;
+  size_t minBytes = 8;
+  size_t maxBytes = 16 << 20;
+  mscclpp::SoftwareIbConfig ibConfig;
+  mscclpp::EndpointConfig config(mscclpp::Transport::IB0);
+  std::vector<size_t> bounds;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      iterations = std::stoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+      ibConfig.latencyUs = std::stod(argv[++i]);
+    } else if (std::strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+      ibConfig.bandwidthGBps = std::stod(argv[++i]);
+    } else if (std::strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      config.ibSignalInterval = std::stoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+      ibConfig.numDevices = std::stoi(argv[++i]);
+    } else {
+      bounds.push_back(std::stoull(argv[i]));
+    }
+  }
+  if (bounds.size() > 0) minBytes = bounds[0];
+  if (bounds.size() > 1) maxBytes = bounds[1];
+  if (bounds.size() > 2 || iterations <= 0 || minBytes == 0 || minBytes > maxBytes || ibConfig.numDevices < 1 ||
+      ibConfig.numDevices > 8) {
+    std::cerr << "Usage: " << argv[0]
+              << " [-n iterations] [-l latencyMicroseconds] [-w bandwidthGBps] [-s signalInterval] [-r rails]"
+              << " [minBytes [maxBytes]]" << std::endl;
+    return 1;
+  }
+  mscclpp::TransportFlags rails;
+  for (int i = 0; i < ibConfig.numDevices; i++) {
+    rails |= static_cast<mscclpp::Transport>(static_cast<int>(mscclpp::Transport::IB0) + i);
+  }
+  config.ibRails = rails;
+
+  mscclpp::SoftwareIb::install(ibConfig);
+  {
+    mscclpp::Context senderContext;
+    mscclpp::Context receiverContext;
+    auto senderEndpoint = senderContext.createEndpoint(config);
+    auto receiverEndpoint = receiverContext.createEndpoint(config);
+    auto sender = senderContext.connect(senderEndpoint, receiverEndpoint);
+
+    std::vector<char> src(maxBytes, 1);
+    std::vector<char> dst(maxBytes, 0);
+    uint64_t flag = 0;
+    uint64_t counter = 0;
+    auto srcMem = senderContext.registerMemory(src.data(), maxBytes, rails);
+    auto dstMem = mscclpp::RegisteredMemory::deserialize(
+        receiverContext.registerMemory(dst.data(), maxBytes, rails).serialize());
+    auto flagMem = mscclpp::RegisteredMemory::deserialize(
+        receiverContext.registerMemory(&flag, sizeof(flag), mscclpp::Transport::IB0).serialize());
+
+    std::cout << "latency: " << ibConfig.latencyUs << " us, bandwidth: " << ibConfig.bandwidthGBps
+              << " GB/s, signal interval: " << config.ibSignalInterval << ", rails: " << ibConfig.numDevices
+              << std::endl;
+    std::cout << std::setw(12) << "bytes" << std::setw(14) << "latency(us)" << std::setw(14) << "GB/s"
+              << std::setw(14) << "doorbells/op" << std::setw(16) << "completions/op" << std::endl;
+    for (size_t bytes = minBytes; bytes <= maxBytes; bytes *= 2) {
+      auto before = totalStats(ibConfig.numDevices);
+      auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < iterations; i++) {
+        sender->write(dstMem, 0, srcMem, 0, bytes);
+        sender->updateAndSync(flagMem, 0, &counter, counter + 1);
+      }
+      waitFlag(&flag, counter);
+      double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+      sender->flush();
+      auto after = totalStats(ibConfig.numDevices);
+
+      std::cout << std::setw(12) << bytes << std::fixed << std::setprecision(2) << std::setw(14) << us / iterations
+                << std::setw(14) << bytes * iterations / us / 1e3 << std::setw(14)
+                << double(after.doorbells - before.doorbells) / iterations << std::setw(16)
+                << double(after.completions - before.completions) / iterations << std::endl;
+      if (bytes > maxBytes / 2) break;
+    }
+  }
+  mscclpp::SoftwareIb::uninstall();
+  return 0;
+}
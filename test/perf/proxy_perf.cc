@@ -0,0 +1,177 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// Measures how many triggers per second proxies drain, one trigger at a time and in batches, with one or more proxy
+// threads. No kernel runs: CPU threads play the part of device threads and write triggers straight into the host
+// trigger rings of the FIFOs, following the protocol of FifoDeviceHandle::push(). Each producer writes for one mock
+// connection, and the connections are dealt to the proxies in turn, as ProxyService does. A mock connection stands in
+// for a transport that pays a fixed cost per doorbell, which is once per trigger in the single mode and once per batch
+// in the batched mode.
+//
+// Usage: proxy_perf [-p producers] [-n triggersPerProducer] [-f fifoSize] [-w doorbellNanoseconds]
+//                   [-c connections] [-t maxProxies]
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mscclpp/proxy.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Options {
+  int producers = 8;
+  int triggersPerProducer = 1 << 16;
+  int fifoSize = mscclpp::DEFAULT_FIFO_SIZE;
+  int doorbellNs = 200;
+  int connections = 8;
+  int maxProxies = 4;
+};
+
+void spinFor(int ns) {
+  auto end = std::chrono::steady_clock::now() + std::chrono::nanoseconds(ns);
+  while (std::chrono::steady_clock::now() < end) {
+  }
+}
+
+// Posts the work of the triggers it is given with one doorbell.
+class MockConnection {
+ public:
+  MockConnection(int doorbellNs) : doorbellNs_(doorbellNs), posted_(0) {}
+
+  void post(int count) {
+    spinFor(doorbellNs_);
+    posted_ += count;
+  }
+
+ private:
+  int doorbellNs_;
+  uint64_t posted_;
+};
+
+// A proxy with its FIFO and the counters that the producers of its connections share.
+struct Lane {
+  std::shared_ptr<mscclpp::Proxy> proxy;
+  std::atomic<uint64_t> head{0};
+  std::atomic<uint64_t> handled{0};
+};
+
+// Pushes triggers like FifoDeviceHandle::push(), which holds a slot until the proxy has handled the trigger one lap
+// earlier and cleared the slot. The count of handled triggers stands in for the tail.
+void produce(mscclpp::FifoDeviceHandle fifo, Lane& lane, uint64_t connection, int count) {
+  for (int i = 0; i < count; ++i) {
+    uint64_t slot = lane.head.fetch_add(1, std::memory_order_relaxed);
+    while (slot >= lane.handled.load(std::memory_order_acquire) + fifo.size) {
+      std::this_thread::yield();
+    }
+    mscclpp::ProxyTrigger* ptr = &fifo.triggers[slot % fifo.size];
+    auto fst = reinterpret_cast<std::atomic<uint64_t>*>(&ptr->fst);
+    while (fst->load(std::memory_order_acquire) != 0) {
+      std::this_thread::yield();
+    }
+    ptr->snd = connection ^ ((uint64_t)1 << (uint64_t)63);
+    fst->store(slot + 1, std::memory_order_release);
+  }
+}
+
+double run(const Options& options, int numProxies, bool batched) {
+  std::vector<MockConnection> connections(options.connections, MockConnection(options.doorbellNs));
+  std::vector<std::unique_ptr<Lane>> lanes;
+  for (int i = 0; i < numProxies; ++i) {
+    auto lane = std::make_unique<Lane>();
+    Lane* l = lane.get();
+    if (batched) {
+      // the triggers of a batch are grouped by connection, and each connection rings its doorbell once
+      lane->proxy = std::make_shared<mscclpp::Proxy>(
+          [&connections, l](const mscclpp::ProxyTrigger* triggers, int count) {
+            for (int begin = 0, end = 1; begin < count; begin = end++) {
+              while (end < count && triggers[end].snd == triggers[begin].snd) ++end;
+              connections[triggers[begin].snd].post(end - begin);
+            }
+            l->handled.fetch_add(count, std::memory_order_release);
+            return mscclpp::ProxyHandlerResult::Continue;
+          },
+          options.fifoSize);
+    } else {
+      lane->proxy = std::make_shared<mscclpp::Proxy>(
+          [&connections, l](mscclpp::ProxyTrigger trigger) {
+            connections[trigger.snd].post(1);
+            l->handled.fetch_add(1, std::memory_order_release);
+            return mscclpp::ProxyHandlerResult::Continue;
+          },
+          options.fifoSize);
+    }
+    lanes.push_back(std::move(lane));
+  }
+  for (auto& lane : lanes) {
+    lane->proxy->start();
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> producers;
+  for (int i = 0; i < options.producers; ++i) {
+    int connection = i % options.connections;
+    Lane& lane = *lanes[connection % numProxies];
+    producers.emplace_back(produce, lane.proxy->fifo().deviceHandle(), std::ref(lane), connection,
+                           options.triggersPerProducer);
+  }
+  for (auto& t : producers) {
+    t.join();
+  }
+  for (auto& lane : lanes) {
+    while (lane->handled.load(std::memory_order_acquire) < lane->head.load(std::memory_order_relaxed)) {
+      std::this_thread::yield();
+    }
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  for (auto& lane : lanes) {
+    lane->proxy->stop();
+  }
+  return uint64_t(options.producers) * options.triggersPerProducer / seconds;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+      options.producers = std::stoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      options.triggersPerProducer = std::stoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+      options.fifoSize = std::stoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+      options.doorbellNs = std::stoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+      options.connections = std::stoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+      options.maxProxies = std::stoi(argv[++i]);
+    } else {
+      std::cerr << "Usage: " << argv[0] << " [-p producers] [-n triggersPerProducer] [-f fifoSize]"
+                << " [-w doorbellNanoseconds] [-c connections] [-t maxProxies]" << std::endl;
+      return 1;
+    }
+  }
+  // a producer holds at most one slot, so a FIFO must have room for all producers, even if they share one proxy
+  if (options.producers <= 0 || options.producers > options.fifoSize || options.triggersPerProducer <= 0 ||
+      options.connections <= 0 || options.maxProxies <= 0) {
+    std::cerr << "Need between 1 and fifoSize producers and positive counts of everything else" << std::endl;
+    return 1;
+  }
+
+  std::cout << "producers: " << options.producers << ", triggers: " << options.triggersPerProducer
+            << " per producer, connections: " << options.connections << ", fifo size: " << options.fifoSize
+            << ", doorbell: " << options.doorbellNs << " ns" << std::endl;
+  std::cout << std::setw(8) << "proxies" << std::setw(18) << "single/s" << std::setw(18) << "batched/s" << std::endl;
+  for (int numProxies = 1; numProxies <= options.maxProxies; numProxies *= 2) {
+    std::cout << std::setw(8) << numProxies << std::fixed << std::setprecision(0) << std::setw(18)
+              << run(options, numProxies, false) << std::setw(18) << run(options, numProxies, true) << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,177 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// Measures the trigger latency and the CPU usage of a proxy thread under each wait policy. A CPU thread plays the part
+// of a device thread: it pushes one trigger into the host trigger ring of the FIFO, following the protocol of
+// FifoDeviceHandle::push(), waits until the handler has seen it, and then stays quiet for a gap before the next
+// trigger. The gap lets the proxy thread go idle, so the latency includes the time it needs to notice a trigger after
+// spinning, backing off or parking. With -k the producer also calls Proxy::wakeup() after each push, as a host thread
+// could. The CPU usage is the CPU time of the proxy thread over the wall time of the run, once with triggers and once
+// while no trigger arrives at all.
+//
+// Usage: proxy_wait_perf [-n triggers] [-g gapMicroseconds] [-i idleMilliseconds] [-s spinCount] [-y yieldCount]
+//                        [-m maxParkMicroseconds] [-k]
+
+#include <pthread.h>
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <mscclpp/proxy.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Options {
+  int triggers = 2000;
+  int gapUs = 200;
+  int idleMs = 500;
+  mscclpp::ProxyWaitConfig config;
+  bool wakeup = false;
+};
+
+struct Result {
+  double medianUs;
+  double p99Us;
+  double busyCpu;
+  double idleCpu;
+  mscclpp::ProxyWaitStats stats;
+};
+
+double threadCpuSeconds(clockid_t clock) {
+  struct timespec ts;
+  clock_gettime(clock, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void sleepFor(int us) {
+  // a sleep, not a spin, so the proxy thread has the core to itself on small machines
+  std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void push(mscclpp::FifoDeviceHandle fifo, uint64_t slot) {
+  mscclpp::ProxyTrigger* ptr = &fifo.triggers[slot % fifo.size];
+  auto fst = reinterpret_cast<std::atomic<uint64_t>*>(&ptr->fst);
+  while (fst->load(std::memory_order_acquire) != 0) {
+    std::this_thread::yield();
+  }
+  ptr->snd = (uint64_t)1 << (uint64_t)63;
+  fst->store(slot + 1, std::memory_order_release);
+}
+
+Result run(const Options& options, mscclpp::ProxyWaitPolicy policy) {
+  std::atomic<uint64_t> handled{0};
+  std::atomic<clockid_t> proxyClock{0};
+  std::atomic_bool ready{false};
+  mscclpp::Proxy proxy(
+      [&handled](mscclpp::ProxyTrigger) {
+        handled.fetch_add(1, std::memory_order_release);
+        return mscclpp::ProxyHandlerResult::Continue;
+      },
+      [&proxyClock, &ready] {
+        clockid_t clock;
+        pthread_getcpuclockid(pthread_self(), &clock);
+        proxyClock = clock;
+        ready = true;
+      });
+  mscclpp::ProxyWaitConfig config = options.config;
+  config.policy = policy;
+  proxy.setWaitConfig(config);
+  proxy.start();
+  while (!ready) {
+    std::this_thread::yield();
+  }
+  mscclpp::FifoDeviceHandle fifo = proxy.fifo().deviceHandle();
+  Result result;
+
+  // no triggers at all
+  double cpuStart = threadCpuSeconds(proxyClock);
+  auto wallStart = std::chrono::steady_clock::now();
+  std::this_thread::sleep_for(std::chrono::milliseconds(options.idleMs));
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+  result.idleCpu = (threadCpuSeconds(proxyClock) - cpuStart) / wall;
+
+  // one trigger after another, with a gap in between
+  std::vector<double> latencies;
+  latencies.reserve(options.triggers);
+  cpuStart = threadCpuSeconds(proxyClock);
+  wallStart = std::chrono::steady_clock::now();
+  for (int i = 0; i < options.triggers; ++i) {
+    sleepFor(options.gapUs);
+    auto start = std::chrono::steady_clock::now();
+    push(fifo, i);
+    if (options.wakeup) {
+      proxy.wakeup();
+    }
+    while (handled.load(std::memory_order_acquire) <= (uint64_t)i) {
+      std::this_thread::yield();
+    }
+    latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+  }
+  wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+  result.busyCpu = (threadCpuSeconds(proxyClock) - cpuStart) / wall;
+  result.stats = proxy.waitStats();
+  proxy.stop();
+
+  std::sort(latencies.begin(), latencies.end());
+  result.medianUs = latencies[latencies.size() / 2];
+  result.p99Us = latencies[std::min(latencies.size() - 1, latencies.size() * 99 / 100)];
+  return result;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      options.triggers = std::stoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "-g") == 0 && i + 1 < argc) {
+      options.gapUs = std::stoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+      options.idleMs = std::stoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      options.config.spinCount = std::stoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "-y") == 0 && i + 1 < argc) {
+      options.config.yieldCount = std::stoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+      options.config.maxParkUs = std::stoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "-k") == 0) {
+      options.wakeup = true;
+    } else {
+      std::cerr << "Usage: " << argv[0] << " [-n triggers] [-g gapMicroseconds] [-i idleMilliseconds] [-s spinCount]"
+                << " [-y yieldCount] [-m maxParkMicroseconds] [-k]" << std::endl;
+      return 1;
+    }
+  }
+  if (options.triggers <= 0 || options.gapUs < 0 || options.idleMs <= 0) {
+    std::cerr << "Need a positive count of triggers and idle time, and a non-negative gap" << std::endl;
+    return 1;
+  }
+
+  std::cout << "triggers: " << options.triggers << ", gap: " << options.gapUs << " us, spin: "
+            << options.config.spinCount << ", yield: " << options.config.yieldCount
+            << ", max park: " << options.config.maxParkUs << " us, wakeup: " << (options.wakeup ? "yes" : "no")
+            << std::endl;
+  std::cout << std::setw(8) << "policy" << std::setw(12) << "p50(us)" << std::setw(12) << "p99(us)" << std::setw(10)
+            << "cpu" << std::setw(10) << "idle cpu" << std::setw(10) << "wakeups" << std::setw(14) << "wakeup(us)"
+            << std::setw(14) << "max(us)" << std::endl;
+  const std::pair<const char*, mscclpp::ProxyWaitPolicy> policies[] = {{"spin", mscclpp::ProxyWaitPolicy::Spin},
+                                                                       {"backoff", mscclpp::ProxyWaitPolicy::Backoff},
+                                                                       {"park", mscclpp::ProxyWaitPolicy::Park}};
+  for (const auto& policy : policies) {
+    Result r = run(options, policy.second);
+    double wakeupUs = r.stats.wakeups ? r.stats.totalWakeupLatencyNs / 1e3 / r.stats.wakeups : 0;
+    std::cout << std::setw(8) << policy.first << std::fixed << std::setprecision(2) << std::setw(12) << r.medianUs
+              << std::setw(12) << r.p99Us << std::setw(9) << r.busyCpu * 100 << "%" << std::setw(9) << r.idleCpu * 100
+              << "%" << std::setw(10) << r.stats.wakeups << std::setw(14) << wakeupUs << std::setw(14)
+              << r.stats.maxWakeupLatencyNs / 1e3 << std::endl;
+  }
+  return 0;
+}
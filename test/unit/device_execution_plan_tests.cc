@@ -0,0 +1,154 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <mscclpp/errors.hpp>
+
+#include "device_execution_plan.hpp"
+#include "execution_plan.hpp"
+#include "execution_test_utils.hpp"
+
+namespace {
+// Fills a device handle with bytes derived from `seed`, so that misplaced handles do not compare equal.
+template <typename Handle>
+Handle makeHandle(int seed) {
+  Handle handle;
+  std::memset(static_cast<void*>(&handle), seed & 0xff, sizeof(handle));
+  return handle;
+}
+
+// The threadblock plans of one rank, with fake channel handles.
+std::vector<mscclpp::ThreadblockExecutionPlan> getThreadblockPlans(const mscclpp::CompiledExecutionPlan& plan,
+                                                                   int rank) {
+  std::vector<mscclpp::ThreadblockExecutionPlan> threadblocks;
+  const auto& operations = plan.operationTemplates.at(rank);
+  for (size_t tb = 0; tb < operations.size(); tb++) {
+    mscclpp::ThreadblockExecutionPlan threadblock;
+    int seed = tb * 16;
+    for (size_t i = 0; i < plan.threadblockSMChannelMap.at(rank).at(tb).size(); i++) {
+      threadblock.smChannels.push_back(makeHandle<mscclpp::DeviceHandle<mscclpp::SmChannel>>(++seed));
+    }
+    for (size_t i = 0; i < plan.threadblockProxyChannelMap.at(rank).at(tb).size(); i++) {
+      threadblock.proxyChannels.push_back(makeHandle<mscclpp::DeviceHandle<mscclpp::ProxyChannel>>(++seed));
+    }
+    for (size_t i = 0; i < plan.threadblockNvlsChannelMap.at(rank).at(tb).size(); i++) {
+      threadblock.nvlsChannels.push_back(
+          makeHandle<mscclpp::DeviceHandle<mscclpp::NvlsConnection::DeviceMulticastPointer>>(++seed));
+    }
+    threadblock.operations = operations[tb];
+    threadblocks.push_back(std::move(threadblock));
+  }
+  return threadblocks;
+}
+
+template <typename T>
+void expectBytesEq(const std::vector<T>& a, const std::vector<T>& b) {
+  ASSERT_EQ(a.size(), b.size());
+  for (size_t i = 0; i < a.size(); i++) {
+    EXPECT_EQ(std::memcmp(&a[i], &b[i], sizeof(T)), 0) << "element " << i;
+  }
+}
+
+mscclpp::Operation makeCopy(uint32_t srcOffset, uint32_t dstOffset) {
+  mscclpp::Operation op;
+  std::memset(&op, 0, sizeof(op));
+  op.type = mscclpp::OperationType::COPY;
+  op.srcBufferType = mscclpp::BufferType::INPUT;
+  op.dstBufferType = mscclpp::BufferType::OUTPUT;
+  op.srcOffset = srcOffset;
+  op.dstOffset = dstOffset;
+  op.hasSrcOffset = true;
+  op.hasDstOffset = true;
+  op.size = 1;
+  return op;
+}
+}  // namespace
+
+TEST(DeviceExecutionPlanTest, RoundTripShippedPlans) {
+  for (const auto& jsonPath : getJsonPlans()) {
+    SCOPED_TRACE(jsonPath.filename().string());
+    mscclpp::CompiledExecutionPlan plan = mscclpp::loadCompiledExecutionPlan(jsonPath.string());
+    for (const auto& [rank, _] : plan.operationTemplates) {
+      std::vector<mscclpp::ThreadblockExecutionPlan> threadblocks = getThreadblockPlans(plan, rank);
+      mscclpp::EncodedExecutionPlans encoded = mscclpp::encodeDeviceExecutionPlans(threadblocks);
+      ASSERT_EQ(encoded.nThreadblocks, static_cast<int>(threadblocks.size()));
+      EXPECT_EQ(encoded.maxPlanSize % 16, 0u);
+      for (size_t tb = 0; tb < threadblocks.size(); tb++) {
+        mscclpp::ThreadblockExecutionPlan decoded = mscclpp::decodeDeviceExecutionPlan(encoded, tb);
+        expectBytesEq(decoded.smChannels, threadblocks[tb].smChannels);
+        expectBytesEq(decoded.proxyChannels, threadblocks[tb].proxyChannels);
+        expectBytesEq(decoded.nvlsChannels, threadblocks[tb].nvlsChannels);
+        expectBytesEq(decoded.operations, threadblocks[tb].operations);
+      }
+    }
+  }
+}
+
+TEST(DeviceExecutionPlanTest, ResolveMatchesOperation) {
+  const size_t inputSize = 3 << 20, outputSize = 3 << 20;
+  for (const auto& jsonPath : getJsonPlans()) {
+    SCOPED_TRACE(jsonPath.filename().string());
+    mscclpp::CompiledExecutionPlan plan = mscclpp::loadCompiledExecutionPlan(jsonPath.string());
+    for (const auto& [rank, _] : plan.operationTemplates) {
+      std::vector<mscclpp::ThreadblockExecutionPlan> threadblocks = getThreadblockPlans(plan, rank);
+      mscclpp::EncodedExecutionPlans encoded = mscclpp::encodeDeviceExecutionPlans(threadblocks);
+      mscclpp::ChunkLayout layout = plan.getChunkLayout(rank, inputSize, outputSize, 64, 128);
+      for (size_t tb = 0; tb < threadblocks.size(); tb++) {
+        // resolve in place, as executionKernel does
+        auto* devicePlan = reinterpret_cast<mscclpp::DeviceExecutionPlan*>(
+            encoded.data.data() + reinterpret_cast<uint32_t*>(encoded.data.data())[tb]);
+        for (int i = 0; i < devicePlan->nOperations; i++) {
+          layout.resolve(devicePlan->operation(i));
+        }
+        mscclpp::ThreadblockExecutionPlan resolved = mscclpp::decodeDeviceExecutionPlan(encoded, tb);
+        std::vector<mscclpp::Operation> expected;
+        for (const mscclpp::Operation& op : threadblocks[tb].operations) {
+          expected.push_back(plan.resolveOperation(rank, op, inputSize, outputSize, 64, 128));
+        }
+        expectBytesEq(resolved.operations, expected);
+      }
+    }
+  }
+}
+
+TEST(DeviceExecutionPlanTest, SmallerThanFixedLayout) {
+  // the size of the fixed DeviceExecutionPlan that held 16 channels of each type and 64 operations
+  const size_t fixedPlanSize = 8976;
+  for (const auto& jsonPath : getJsonPlans()) {
+    mscclpp::CompiledExecutionPlan plan = mscclpp::loadCompiledExecutionPlan(jsonPath.string());
+    for (const auto& [rank, _] : plan.operationTemplates) {
+      mscclpp::EncodedExecutionPlans encoded = mscclpp::encodeDeviceExecutionPlans(getThreadblockPlans(plan, rank));
+      EXPECT_LT(encoded.maxPlanSize, fixedPlanSize / 4) << jsonPath.filename();
+      EXPECT_LT(encoded.data.size(), encoded.nThreadblocks * fixedPlanSize / 4) << jsonPath.filename();
+    }
+  }
+}
+
+TEST(DeviceExecutionPlanTest, ManyOperations) {
+  mscclpp::ThreadblockExecutionPlan threadblock;
+  for (uint32_t i = 0; i < 1000; i++) {
+    threadblock.operations.push_back(makeCopy(i, i + 1));
+  }
+  mscclpp::EncodedExecutionPlans encoded = mscclpp::encodeDeviceExecutionPlans({threadblock});
+  mscclpp::ThreadblockExecutionPlan decoded = mscclpp::decodeDeviceExecutionPlan(encoded, 0);
+  expectBytesEq(decoded.operations, threadblock.operations);
+
+  // about 2000 copies do not fit in the shared memory of a block
+  for (uint32_t i = 1000; i < 2000; i++) {
+    threadblock.operations.push_back(makeCopy(i, i + 1));
+  }
+  try {
+    mscclpp::encodeDeviceExecutionPlans({threadblock});
+    FAIL() << "expected the plan to be too large";
+  } catch (const mscclpp::Error& e) {
+    EXPECT_EQ(e.getErrorCode(), mscclpp::ErrorCode::ExecutorError);
+  }
+}
+
+TEST(DeviceExecutionPlanTest, DecodeOutOfRange) {
+  mscclpp::EncodedExecutionPlans encoded = mscclpp::encodeDeviceExecutionPlans({});
+  EXPECT_EQ(encoded.nThreadblocks, 0);
+  EXPECT_THROW(mscclpp::decodeDeviceExecutionPlan(encoded, 0), mscclpp::Error);
+}
@@ -0,0 +1,155 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <mscclpp/core.hpp>
+#include <numeric>
+#include <thread>
+
+// Connects two contexts of this process over loopback Ethernet and writes between host buffers, which need no GPU.
+class EthernetConnectionTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    mscclpp::EndpointConfig config(mscclpp::Transport::Ethernet);
+    // small staging buffers split the writes below into many messages
+    config.ethernetStagingBufferSize = 4096;
+    connect(config);
+  }
+
+  void connect(const mscclpp::EndpointConfig& config) {
+    auto senderEndpoint = senderContext.createEndpoint(config);
+    auto receiverEndpoint = receiverContext.createEndpoint(config);
+    std::thread t([&] { receiver = receiverContext.connect(receiverEndpoint, senderEndpoint); });
+    sender = senderContext.connect(senderEndpoint, receiverEndpoint);
+    t.join();
+  }
+
+  mscclpp::Context senderContext;
+  mscclpp::Context receiverContext;
+  std::shared_ptr<mscclpp::Connection> sender;
+  std::shared_ptr<mscclpp::Connection> receiver;
+};
+
+TEST_F(EthernetConnectionTest, FlushWaitsForRemoteWrites) {
+  const size_t count = 1 << 16;
+  std::vector<int> src(count);
+  std::vector<int> dst(count, -1);
+  uint64_t flag = 0;
+  uint64_t counter = 0;
+  auto srcMem = senderContext.registerMemory(src.data(), count * sizeof(int), mscclpp::Transport::Ethernet);
+  auto dstMem = receiverContext.registerMemory(dst.data(), count * sizeof(int), mscclpp::Transport::Ethernet);
+  auto flagMem = receiverContext.registerMemory(&flag, sizeof(flag), mscclpp::Transport::Ethernet);
+
+  for (int iter = 0; iter < 8; iter++) {
+    std::iota(src.begin(), src.end(), iter * 10);
+    sender->write(dstMem, 0, srcMem, 0, count * sizeof(int));
+    sender->updateAndSync(flagMem, 0, &counter, counter + 1);
+    sender->flush();
+    // everything written before the flush has landed, in order
+    EXPECT_EQ(flag, counter);
+    EXPECT_EQ(dst.front(), iter * 10);
+    EXPECT_EQ(dst.back(), iter * 10 + int(count) - 1);
+  }
+}
+
+TEST_F(EthernetConnectionTest, WritesLandInOrder) {
+  const size_t count = 1024;
+  std::vector<uint64_t> src(count);
+  std::vector<uint64_t> dst(count, 0);
+  auto srcMem = senderContext.registerMemory(src.data(), count * sizeof(uint64_t), mscclpp::Transport::Ethernet);
+  auto dstMem = receiverContext.registerMemory(dst.data(), count * sizeof(uint64_t), mscclpp::Transport::Ethernet);
+
+  // later writes to the same element overwrite earlier ones
+  for (size_t i = 0; i < count; i++) {
+    src[i] = i + 1;
+    sender->write(dstMem, 0, srcMem, i * sizeof(uint64_t), sizeof(uint64_t));
+    sender->write(dstMem, i * sizeof(uint64_t), srcMem, i * sizeof(uint64_t), sizeof(uint64_t));
+    sender->flush();
+  }
+  EXPECT_EQ(dst[0], count);
+  for (size_t i = 1; i < count; i++) {
+    EXPECT_EQ(dst[i], i + 1);
+  }
+}
+
+TEST_F(EthernetConnectionTest, RequestsCompleteWhenAcknowledged) {
+  const size_t count = 1 << 16;
+  std::vector<int> src(count);
+  std::vector<int> dst(count, -1);
+  uint64_t flag = 0;
+  uint64_t counter = 0;
+  auto srcMem = senderContext.registerMemory(src.data(), count * sizeof(int), mscclpp::Transport::Ethernet);
+  auto dstMem = receiverContext.registerMemory(dst.data(), count * sizeof(int), mscclpp::Transport::Ethernet);
+  auto flagMem = receiverContext.registerMemory(&flag, sizeof(flag), mscclpp::Transport::Ethernet);
+
+  for (int iter = 0; iter < 8; iter++) {
+    std::iota(src.begin(), src.end(), iter * 10);
+    std::vector<mscclpp::Request> requests;
+    requests.push_back(sender->writeAsync(dstMem, 0, srcMem, 0, count * sizeof(int)));
+    requests.push_back(sender->updateAndSyncAsync(flagMem, 0, &counter, counter + 1));
+    requests[1].wait();
+    EXPECT_EQ(flag, counter);
+    EXPECT_EQ(dst.back(), iter * 10 + int(count) - 1);
+    // the write was queued before the value, so it is complete as well
+    EXPECT_TRUE(requests[0].test());
+    EXPECT_LT(mscclpp::waitAny(requests), 2);
+  }
+}
+
+TEST_F(EthernetConnectionTest, FlushTimeout) {
+  const size_t bytes = 64 << 20;
+  std::vector<char> src(bytes, 1);
+  std::vector<char> dst(bytes, 0);
+  auto srcMem = senderContext.registerMemory(src.data(), bytes, mscclpp::Transport::Ethernet);
+  auto dstMem = receiverContext.registerMemory(dst.data(), bytes, mscclpp::Transport::Ethernet);
+
+  sender->write(dstMem, 0, srcMem, 0, bytes);
+  try {
+    sender->flush(0);
+    FAIL() << "flush did not time out";
+  } catch (const mscclpp::Error& e) {
+    EXPECT_EQ(e.getErrorCode(), mscclpp::ErrorCode::Timeout);
+  }
+  sender->flush();
+  EXPECT_EQ(dst.back(), 1);
+  // nothing is outstanding, so even a zero timeout succeeds
+  EXPECT_NO_THROW(sender->flush(0));
+}
+
+// Stripes the writes over several sockets in each direction, in stripes smaller than a staging buffer.
+class EthernetStripedConnectionTest : public EthernetConnectionTest {
+ protected:
+  void SetUp() override {
+    mscclpp::EndpointConfig config(mscclpp::Transport::Ethernet);
+    config.ethernetNumStreams = 4;
+    config.ethernetStripeSize = 1000;
+    connect(config);
+  }
+};
+
+TEST_F(EthernetStripedConnectionTest, UpdateAndSyncFollowsWrites) {
+  const size_t count = 1 << 16;
+  std::vector<int> src(count);
+  std::vector<int> dst(count, -1);
+  uint64_t flag = 0;
+  uint64_t counter = 0;
+  auto srcMem = senderContext.registerMemory(src.data(), count * sizeof(int), mscclpp::Transport::Ethernet);
+  auto dstMem = receiverContext.registerMemory(dst.data(), count * sizeof(int), mscclpp::Transport::Ethernet);
+  auto flagMem = receiverContext.registerMemory(&flag, sizeof(flag), mscclpp::Transport::Ethernet);
+
+  for (int iter = 0; iter < 16; iter++) {
+    std::iota(src.begin(), src.end(), iter * 10);
+    sender->write(dstMem, 0, srcMem, 0, count * sizeof(int));
+    sender->updateAndSync(flagMem, 0, &counter, counter + 1);
+    // the stripes land in any order, but all of them before the flag
+    while (reinterpret_cast<std::atomic<uint64_t>*>(&flag)->load(std::memory_order_acquire) < counter) {
+      std::this_thread::yield();
+    }
+    for (size_t i = 0; i < count; i++) {
+      ASSERT_EQ(dst[i], iter * 10 + int(i));
+    }
+  }
+  sender->flush();
+}
@@ -0,0 +1,159 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstring>
+#include <mscclpp/errors.hpp>
+#include <mscclpp/host_reduce.hpp>
+
+#include "execution_interpreter.hpp"
+#include "execution_test_utils.hpp"
+
+namespace {
+// Small integers, so that FLOAT32 sums are exact in any order.
+std::vector<std::vector<int32_t>> makeInputs(int nRanks, size_t count, int seed) {
+  std::vector<std::vector<int32_t>> inputs(nRanks, std::vector<int32_t>(count));
+  for (int rank = 0; rank < nRanks; rank++) {
+    for (size_t i = 0; i < count; i++) {
+      inputs[rank][i] = static_cast<int32_t>((i * 7 + rank * 131 + seed * 17) % 1000) - 500;
+    }
+  }
+  return inputs;
+}
+
+std::vector<void*> pointers(std::vector<std::vector<int32_t>>& buffers) {
+  std::vector<void*> ptrs;
+  for (auto& buffer : buffers) ptrs.push_back(buffer.data());
+  return ptrs;
+}
+
+// Replaces each value by the bits of the same value as FLOAT32.
+void toFloat(std::vector<int32_t>& values) {
+  for (auto& v : values) {
+    float f = static_cast<float>(v);
+    std::memcpy(&v, &f, sizeof(f));
+  }
+}
+
+void checkAllreduce(const std::string& name, mscclpp::DataType dataType) {
+  const size_t bytes = 1 << 20;
+  const size_t count = bytes / sizeof(int32_t);
+  mscclpp::CompiledExecutionPlan plan = loadPlan(name);
+  mscclpp::ExecutionInterpreter interpreter(plan, bytes, bytes);
+  const int nRanks = interpreter.nRanks();
+  // consecutive runs use both halves of the scratch buffer
+  for (int iter = 0; iter < 3; iter++) {
+    std::vector<std::vector<int32_t>> buffers = makeInputs(nRanks, count, iter);
+    std::vector<int32_t> expected(count, 0);
+    for (int rank = 0; rank < nRanks; rank++) {
+      for (size_t i = 0; i < count; i++) expected[i] += buffers[rank][i];
+    }
+    if (dataType == mscclpp::DataType::FLOAT32) {
+      toFloat(expected);
+      for (auto& buffer : buffers) toFloat(buffer);
+    }
+    std::vector<void*> ptrs = pointers(buffers);
+    mscclpp::InterpreterStats stats = interpreter.run(ptrs, ptrs, dataType);
+    EXPECT_GT(stats.remoteBytes, 0u);
+    for (int rank = 0; rank < nRanks; rank++) {
+      ASSERT_EQ(buffers[rank], expected) << name << " rank " << rank << " run " << iter;
+    }
+  }
+}
+}  // namespace
+
+TEST(ExecutionInterpreterTest, Allreduce) {
+  for (const char* name : {"allreduce.json", "allreduce_packet.json", "allreduce_nvls.json"}) {
+    checkAllreduce(name, mscclpp::DataType::INT32);
+    checkAllreduce(name, mscclpp::DataType::FLOAT32);
+  }
+}
+
+TEST(ExecutionInterpreterTest, Sendrecv) {
+  const size_t bytes = 256 << 10;
+  const size_t count = bytes / sizeof(int32_t);
+  for (const char* name : {"sendrecv.json", "sendrecv_packet.json"}) {
+    mscclpp::ExecutionInterpreter interpreter(loadPlan(name), bytes, bytes);
+    ASSERT_EQ(interpreter.nRanks(), 2);
+    for (int iter = 0; iter < 2; iter++) {
+      std::vector<std::vector<int32_t>> inputs = makeInputs(2, count, iter);
+      std::vector<std::vector<int32_t>> outputs(2, std::vector<int32_t>(count, 0));
+      interpreter.run(pointers(inputs), pointers(outputs), mscclpp::DataType::INT32);
+      EXPECT_EQ(outputs[0], inputs[1]) << name;
+      EXPECT_EQ(outputs[1], inputs[0]) << name;
+    }
+  }
+}
+
+TEST(ExecutionInterpreterTest, HalfPrecisionRoundsEachAddition) {
+  const size_t bytes = 64 << 10;
+  const size_t count = bytes / sizeof(uint16_t);
+  mscclpp::ExecutionInterpreter interpreter(loadPlan("allreduce.json"), bytes, bytes);
+  std::vector<std::vector<uint16_t>> buffers(2, std::vector<uint16_t>(count));
+  for (size_t i = 0; i < count; i++) {
+    buffers[0][i] = static_cast<uint16_t>(0x3c00 + i % 0x400);
+    buffers[1][i] = static_cast<uint16_t>(0x1000 + i * 3 % 0x7000);
+  }
+  std::vector<uint16_t> expected(count);
+  std::vector<const void*> srcs = {buffers[0].data(), buffers[1].data()};
+  mscclpp::hostReduce(expected.data(), srcs, count, mscclpp::DataType::FLOAT16, mscclpp::ReduceOp::SUM);
+  std::vector<void*> ptrs = {buffers[0].data(), buffers[1].data()};
+  interpreter.run(ptrs, ptrs, mscclpp::DataType::FLOAT16);
+  EXPECT_EQ(buffers[0], expected);
+  EXPECT_EQ(buffers[1], expected);
+}
+
+TEST(ExecutionInterpreterTest, UnmatchedWaitTimesOut) {
+  const size_t bytes = 64 << 10;
+  mscclpp::CompiledExecutionPlan plan = loadPlan("allreduce.json");
+  for (auto& ops : plan.operationTemplates.at(0)) {
+    ops.erase(std::remove_if(ops.begin(), ops.end(),
+                             [](const mscclpp::Operation& op) { return op.type == mscclpp::OperationType::SIGNAL; }),
+              ops.end());
+  }
+  mscclpp::ExecutionInterpreter interpreter(plan, bytes, bytes);
+  std::vector<std::vector<int32_t>> buffers(2, std::vector<int32_t>(bytes / sizeof(int32_t)));
+  std::vector<void*> ptrs = pointers(buffers);
+  try {
+    interpreter.run(ptrs, ptrs, mscclpp::DataType::INT32, 100000);
+    FAIL() << "expected a timeout";
+  } catch (const mscclpp::Error& e) {
+    EXPECT_EQ(e.getErrorCode(), mscclpp::ErrorCode::Timeout);
+    EXPECT_NE(std::string(e.what()).find("(WAIT): timed out"), std::string::npos) << e.what();
+  }
+}
+
+TEST(ExecutionInterpreterTest, OutOfBounds) {
+  const size_t bytes = 64 << 10;
+  mscclpp::CompiledExecutionPlan plan = loadPlan("sendrecv.json");
+  bool moved = false;
+  for (auto& ops : plan.operationTemplates.at(1)) {
+    for (auto& op : ops) {
+      if (op.type == mscclpp::OperationType::COPY) {
+        // one chunk past the end of the output buffer
+        op.dstOffset = 1;
+        moved = true;
+      }
+    }
+  }
+  ASSERT_TRUE(moved);
+  mscclpp::ExecutionInterpreter interpreter(plan, bytes, bytes);
+  std::vector<std::vector<int32_t>> inputs(2, std::vector<int32_t>(bytes / sizeof(int32_t)));
+  std::vector<std::vector<int32_t>> outputs = inputs;
+  try {
+    interpreter.run(pointers(inputs), pointers(outputs), mscclpp::DataType::INT32);
+    FAIL() << "expected an out of bounds access";
+  } catch (const mscclpp::Error& e) {
+    EXPECT_EQ(e.getErrorCode(), mscclpp::ErrorCode::ExecutorError);
+    EXPECT_NE(std::string(e.what()).find("output buffer of rank 1"), std::string::npos) << e.what();
+  }
+}
+
+TEST(ExecutionInterpreterTest, WrongNumberOfBuffers) {
+  mscclpp::ExecutionInterpreter interpreter(loadPlan("allreduce.json"), 1 << 16, 1 << 16);
+  std::vector<int32_t> buffer(1 << 14);
+  std::vector<void*> ptrs = {buffer.data()};
+  EXPECT_THROW(interpreter.run(ptrs, ptrs, mscclpp::DataType::INT32), mscclpp::Error);
+}
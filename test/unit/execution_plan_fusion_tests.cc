@@ -0,0 +1,321 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <nlohmann/json.hpp>
+
+#include "execution_interpreter.hpp"
+#include "execution_plan_fusion.hpp"
+#include "execution_test_utils.hpp"
+
+using json = nlohmann::json;
+
+namespace {
+json loadJson(const std::string& name) {
+  std::ifstream file(getExecutionFilesPath() / name);
+  return json::parse(file);
+}
+
+json proxyOp(const std::string& name, uint32_t srcOff, uint32_t dstOff, uint32_t cnt) {
+  return {{"name", name},
+          {"o_buff", {{"src", "i"}, {"dst", "s"}}},
+          {"o_cids", {{{"id", 0}, {"off", dstOff}}}},
+          {"srcs", {{{"buff", "i"}, {"off", srcOff}}}},
+          {"ctype", "proxy"},
+          {"cnt", cnt}};
+}
+
+json channelOp(const std::string& name, int channel, const std::string& ctype = "proxy") {
+  bool wait = name == "wait";
+  return {{"name", name},
+          {wait ? "i_buff" : "o_buff", {{"src", "i"}, {"dst", "s"}}},
+          {wait ? "i_cids" : "o_cids", {{{"id", channel}, {"off", 0}}}},
+          {"ctype", ctype}};
+}
+
+json copyOp(const std::string& srcBuff, uint32_t srcOff, const std::string& dstBuff, uint32_t dstOff, uint32_t cnt) {
+  return {{"name", "copy"}, {"srcbuff", srcBuff}, {"srcoff", srcOff}, {"dstbuff", dstBuff},
+          {"dstoff", dstOff}, {"ctype", "none"},  {"cnt", cnt}};
+}
+
+json nop() { return {{"name", "nop"}}; }
+
+// sendrecv.json with two chunks per rank, two proxy channels to the peer and `ops` on both ranks. Every rank sends
+// its input to chunks 2 and 3 of the scratch buffer of the peer.
+json makeSendrecv(const json& ops) {
+  json plan = loadJson("sendrecv.json");
+  for (auto& gpu : plan["gpus"]) {
+    int peer = 1 - gpu["id"].get<int>();
+    gpu["inputChunks"] = 2;
+    gpu["outputChunks"] = 2;
+    gpu["scratchChunks"] = 4;
+    gpu["channels"][0]["connectedTo"] = {peer, peer};
+    gpu["threadblocks"][0]["channels"][0]["cids"] = {0, 1};
+    gpu["threadblocks"][0]["ops"] = ops;
+  }
+  return plan;
+}
+
+std::vector<mscclpp::OperationType> getTypes(const std::vector<mscclpp::Operation>& ops) {
+  std::vector<mscclpp::OperationType> types;
+  for (const auto& op : ops) types.push_back(op.type);
+  return types;
+}
+
+void expectSameOperations(const mscclpp::CompiledExecutionPlan& a, const mscclpp::CompiledExecutionPlan& b) {
+  ASSERT_EQ(a.operationTemplates.size(), b.operationTemplates.size());
+  for (const auto& [rank, threadblocks] : a.operationTemplates) {
+    ASSERT_EQ(threadblocks.size(), b.operationTemplates.at(rank).size());
+    for (size_t tb = 0; tb < threadblocks.size(); tb++) {
+      const auto& ops = threadblocks[tb];
+      const auto& expected = b.operationTemplates.at(rank)[tb];
+      ASSERT_EQ(getTypes(ops), getTypes(expected)) << "rank " << rank << " threadblock " << tb;
+      for (size_t i = 0; i < ops.size(); i++) {
+        EXPECT_EQ(std::memcmp(&ops[i], &expected[i], sizeof(mscclpp::Operation)), 0)
+            << "rank " << rank << " threadblock " << tb << " operation " << i;
+      }
+    }
+  }
+}
+
+// Runs a 2-rank sendrecv plan and returns the outputs.
+std::vector<std::vector<int32_t>> runSendrecv(const mscclpp::CompiledExecutionPlan& plan) {
+  const size_t count = 1 << 16;
+  std::vector<std::vector<int32_t>> inputs(2, std::vector<int32_t>(count));
+  std::vector<std::vector<int32_t>> outputs(2, std::vector<int32_t>(count, 0));
+  for (int rank = 0; rank < 2; rank++) {
+    for (size_t i = 0; i < count; i++) inputs[rank][i] = static_cast<int32_t>(i * 3 + rank * 1000);
+  }
+  mscclpp::ExecutionInterpreter interpreter(plan, count * sizeof(int32_t), count * sizeof(int32_t));
+  interpreter.run({inputs[0].data(), inputs[1].data()}, {outputs[0].data(), outputs[1].data()},
+                  mscclpp::DataType::INT32);
+  EXPECT_EQ(outputs[0], inputs[1]);
+  EXPECT_EQ(outputs[1], inputs[0]);
+  return outputs;
+}
+}  // namespace
+
+TEST(ExecutionPlanFusionTest, ShippedPlans) {
+  for (const auto& jsonPath : getJsonPlans()) {
+    std::ifstream file(jsonPath);
+    mscclpp::CompiledExecutionPlan plan = mscclpp::lowerExecutionPlan(json::parse(file));
+    mscclpp::CompiledExecutionPlan fused = plan;
+    mscclpp::FusionStats stats = mscclpp::fuseOperations(fused);
+    // the plans in the tree have nothing to fuse
+    EXPECT_EQ(stats.opCountsBefore, stats.opCountsAfter) << jsonPath.filename();
+    expectSameOperations(fused, plan);
+  }
+}
+
+TEST(ExecutionPlanFusionTest, PutSignalFlushAndContiguousRanges) {
+  json unfused = makeSendrecv({proxyOp("put", 0, 2, 1), proxyOp("put", 1, 3, 1), channelOp("signal", 0),
+                               channelOp("flush", 0), channelOp("wait", 0), nop(), copyOp("s", 2, "o", 0, 1),
+                               copyOp("s", 3, "o", 1, 1), nop()});
+  json reference = makeSendrecv({proxyOp("pwsf", 0, 2, 2), channelOp("wait", 0), nop(), copyOp("s", 2, "o", 0, 2)});
+  mscclpp::CompiledExecutionPlan plan = mscclpp::lowerExecutionPlan(unfused);
+  mscclpp::CompiledExecutionPlan fused = plan;
+  mscclpp::FusionStats stats = mscclpp::fuseOperations(fused);
+  expectSameOperations(fused, mscclpp::lowerExecutionPlan(reference));
+  EXPECT_EQ(stats.signalsFused, 4u);
+  EXPECT_EQ(stats.operationsMerged, 4u);
+  EXPECT_EQ(stats.nopsRemoved, 2u);
+  EXPECT_EQ(stats.reducesFused, 0u);
+  size_t copy = static_cast<size_t>(mscclpp::OperationType::COPY);
+  EXPECT_EQ(stats.opCountsBefore[copy], 4u);
+  EXPECT_EQ(stats.opCountsAfter[copy], 2u);
+
+  // both move the same bytes
+  EXPECT_EQ(runSendrecv(fused), runSendrecv(plan));
+
+  // fusing again changes nothing
+  mscclpp::CompiledExecutionPlan again = fused;
+  stats = mscclpp::fuseOperations(again);
+  EXPECT_EQ(stats.opCountsBefore, stats.opCountsAfter);
+  expectSameOperations(again, fused);
+}
+
+TEST(ExecutionPlanFusionTest, Channels) {
+  json puts = proxyOp("put", 0, 2, 2);
+  puts["o_cids"].push_back({{"id", 1}, {"off", 2}});
+  puts["srcs"].push_back({{"buff", "i"}, {"off", 0}});
+  json ops = {puts, channelOp("signal", 1), channelOp("signal", 0), channelOp("wait", 0), channelOp("wait", 1),
+              channelOp("flush", 0), channelOp("flush", 0)};
+  mscclpp::CompiledExecutionPlan plan = mscclpp::lowerExecutionPlan(makeSendrecv(ops));
+  mscclpp::FusionStats stats = mscclpp::fuseOperations(plan);
+  const auto& fused = plan.operationTemplates.at(0)[0];
+  // the SIGNALs merge first and then cover the channels of the PUT, but two threads must not flush the same channel
+  ASSERT_EQ(getTypes(fused), (std::vector<mscclpp::OperationType>{
+                                 mscclpp::OperationType::PUT_WITH_SIGNAL, mscclpp::OperationType::WAIT,
+                                 mscclpp::OperationType::FLUSH, mscclpp::OperationType::FLUSH}));
+  EXPECT_EQ(fused[1].nInputs, 2);
+  EXPECT_EQ(stats.signalsFused, 2u);
+  EXPECT_EQ(stats.operationsMerged, 4u);
+}
+
+TEST(ExecutionPlanFusionTest, ReduceSend) {
+  json reduce = {{"name", "re"},
+                 {"srcs", {{{"buff", "i"}, {"off", 4}}}},
+                 {"srcbuff", "i"},
+                 {"srcoff", 0},
+                 {"dstbuff", "i"},
+                 {"dstoff", 0},
+                 {"ctype", "none"},
+                 {"cnt", 1}};
+  json put = {{"name", "put"},
+              {"o_buff", {{"src", "i"}, {"dst", "i"}}},
+              {"o_cids", {{{"id", 0}, {"off", 0}}}},
+              {"srcs", {{{"buff", "i"}, {"off", 0}}}},
+              {"ctype", "sm"},
+              {"cnt", 1}};
+  json reduceSend = reduce;
+  reduceSend["name"] = "rs";
+  reduceSend["ctype"] = "sm";
+  reduceSend["o_buff"] = put["o_buff"];
+  reduceSend["o_cids"] = put["o_cids"];
+  auto lower = [](const json& ops) {
+    json plan = loadJson("allreduce.json");
+    plan["gpus"][0]["threadblocks"][0]["ops"] = ops;
+    return mscclpp::lowerExecutionPlan(plan);
+  };
+
+  mscclpp::CompiledExecutionPlan plan = lower({reduce, nop(), put});
+  mscclpp::FusionStats stats = mscclpp::fuseOperations(plan);
+  EXPECT_EQ(stats.reducesFused, 1u);
+  expectSameOperations(plan, lower(json::array({reduceSend})));
+
+  // the PUT sends other bytes than the REDUCE wrote
+  json otherPut = put;
+  otherPut["srcs"][0]["off"] = 1;
+  plan = lower({reduce, nop(), otherPut});
+  stats = mscclpp::fuseOperations(plan);
+  EXPECT_EQ(stats.reducesFused, 0u);
+  EXPECT_EQ(plan.operationTemplates.at(0)[0].size(), 3u);
+
+  // SM channels ignore the signal of PUT_WITH_SIGNAL
+  json signal = {{"name", "signal"}, {"o_buff", put["o_buff"]}, {"o_cids", put["o_cids"]}, {"ctype", "sm"}};
+  plan = lower({put, signal});
+  stats = mscclpp::fuseOperations(plan);
+  EXPECT_EQ(stats.signalsFused, 0u);
+  EXPECT_EQ(plan.operationTemplates.at(0)[0].size(), 2u);
+}
+
+// executionKernel skips a standalone REDUCE, so the interpreter rejects it, but runs the REDUCE_SEND that it is
+// fused into. Fusion makes such a plan reduce on the GPU where it did not before.
+TEST(ExecutionPlanFusionTest, ReduceSendRunsTheReduce) {
+  // every rank sums its two input chunks into scratch chunk 0, puts the sum to scratch chunk 1 of the peer and copies
+  // what the peer put there to its output
+  json plan = loadJson("sendrecv.json");
+  for (auto& gpu : plan["gpus"]) {
+    int peer = 1 - gpu["id"].get<int>();
+    gpu["inputChunks"] = 2;
+    gpu["outputChunks"] = 1;
+    gpu["scratchChunks"] = 2;
+    gpu["channels"] = {{{"srcbuff", "s"}, {"dstbuff", "s"}, {"type", "sm"}, {"connectedTo", {peer}}}};
+    gpu["threadblocks"][0]["channels"] = {{{"src", "s"}, {"dst", "s"}, {"ctype", "sm"}, {"cids", {0}}}};
+    gpu["threadblocks"][0]["ops"] = {{{"name", "re"},
+                                      {"srcs", {{{"buff", "i"}, {"off", 1}}}},
+                                      {"srcbuff", "i"},
+                                      {"srcoff", 0},
+                                      {"dstbuff", "s"},
+                                      {"dstoff", 0},
+                                      {"ctype", "none"},
+                                      {"cnt", 1}},
+                                     {{"name", "put"},
+                                      {"o_buff", {{"src", "s"}, {"dst", "s"}}},
+                                      {"o_cids", {{{"id", 0}, {"off", 1}}}},
+                                      {"srcs", {{{"buff", "s"}, {"off", 0}}}},
+                                      {"ctype", "sm"},
+                                      {"cnt", 1}},
+                                     {{"name", "signal"},
+                                      {"o_buff", {{"src", "s"}, {"dst", "s"}}},
+                                      {"o_cids", {{{"id", 0}, {"off", 0}}}},
+                                      {"ctype", "sm"}},
+                                     {{"name", "wait"},
+                                      {"i_buff", {{"src", "s"}, {"dst", "s"}}},
+                                      {"i_cids", {{{"id", 0}, {"off", 0}}}},
+                                      {"ctype", "sm"}},
+                                     copyOp("s", 1, "o", 0, 1)};
+  }
+  const size_t count = 1024;
+  std::vector<std::vector<int32_t>> inputs(2, std::vector<int32_t>(2 * count));
+  std::vector<std::vector<int32_t>> outputs(2, std::vector<int32_t>(count, 0));
+  for (int rank = 0; rank < 2; rank++) {
+    for (size_t i = 0; i < 2 * count; i++) inputs[rank][i] = static_cast<int32_t>(i * 3 + rank * 1000);
+  }
+  auto run = [&](const mscclpp::CompiledExecutionPlan& compiled) {
+    mscclpp::ExecutionInterpreter interpreter(compiled, 2 * count * sizeof(int32_t), count * sizeof(int32_t));
+    interpreter.run({inputs[0].data(), inputs[1].data()}, {outputs[0].data(), outputs[1].data()},
+                    mscclpp::DataType::INT32);
+  };
+
+  mscclpp::CompiledExecutionPlan compiled = mscclpp::lowerExecutionPlan(plan);
+  EXPECT_THROW(run(compiled), mscclpp::Error);
+
+  mscclpp::FusionStats stats = mscclpp::fuseOperations(compiled);
+  EXPECT_EQ(stats.reducesFused, 2u);
+  run(compiled);
+  for (int rank = 0; rank < 2; rank++) {
+    const auto& peerInput = inputs[1 - rank];
+    for (size_t i = 0; i < count; i++) {
+      ASSERT_EQ(outputs[rank][i], peerInput[i] + peerInput[count + i]) << "rank " << rank << " element " << i;
+    }
+  }
+}
+
+TEST(ExecutionPlanFusionTest, OverlappingRanges) {
+  // each copy reads what the one before it wrote, so the threads of a merged copy would race
+  json ops = {copyOp("s", 0, "s", 1, 1), copyOp("s", 1, "s", 2, 1), nop(), copyOp("s", 0, "s", 2, 1),
+              copyOp("s", 1, "s", 3, 1)};
+  mscclpp::CompiledExecutionPlan plan = mscclpp::lowerExecutionPlan(makeSendrecv(ops));
+  mscclpp::FusionStats stats = mscclpp::fuseOperations(plan);
+  const auto& fused = plan.operationTemplates.at(0)[0];
+  ASSERT_EQ(fused.size(), 4u);
+  EXPECT_EQ(fused[0].size, 1u);
+  EXPECT_EQ(fused[3].size, 2u);
+  EXPECT_EQ(stats.operationsMerged, 2u);
+
+  // the input and output of an in-place plan overlap
+  json inPlace = makeSendrecv({copyOp("i", 0, "o", 0, 1), copyOp("i", 1, "o", 1, 1)});
+  inPlace["inplace"] = true;
+  plan = mscclpp::lowerExecutionPlan(inPlace);
+  EXPECT_EQ(mscclpp::fuseOperations(plan).operationsMerged, 0u);
+  inPlace["inplace"] = false;
+  plan = mscclpp::lowerExecutionPlan(inPlace);
+  EXPECT_EQ(mscclpp::fuseOperations(plan).operationsMerged, 2u);
+}
+
+TEST(ExecutionPlanFusionTest, Nops) {
+  json barrier = {{"name", "barrier"}, {"barrier_id", 0}, {"nthread_blocks", 1}};
+  json ops = {nop(), copyOp("i", 0, "o", 0, 1), nop(), nop(), barrier, nop(), copyOp("i", 1, "o", 1, 1), nop()};
+  mscclpp::CompiledExecutionPlan plan = mscclpp::lowerExecutionPlan(makeSendrecv(ops));
+  mscclpp::FusionStats stats = mscclpp::fuseOperations(plan);
+  EXPECT_EQ(getTypes(plan.operationTemplates.at(1)[0]),
+            (std::vector<mscclpp::OperationType>{mscclpp::OperationType::COPY, mscclpp::OperationType::BARRIER,
+                                                 mscclpp::OperationType::COPY}));
+  EXPECT_EQ(stats.nopsRemoved, 10u);
+  EXPECT_EQ(stats.operationsMerged, 0u);
+}
+
+TEST(ExecutionPlanFusionTest, Environment) {
+  json ops = {proxyOp("put", 0, 2, 2), channelOp("signal", 0), nop()};
+  mscclpp::CompiledExecutionPlan plan = mscclpp::lowerExecutionPlan(makeSendrecv(ops));
+
+  setenv("MSCCLPP_EXECUTOR_FUSION", "0", 1);
+  mscclpp::CompiledExecutionPlan unchanged = plan;
+  mscclpp::fuseOperationsFromEnv(unchanged);
+  expectSameOperations(unchanged, plan);
+  unsetenv("MSCCLPP_EXECUTOR_FUSION");
+
+  setenv("MSCCLPP_EXECUTOR_FUSION_DUMP", "1", 1);
+  testing::internal::CaptureStdout();
+  mscclpp::fuseOperationsFromEnv(plan);
+  std::string dump = testing::internal::GetCapturedStdout();
+  unsetenv("MSCCLPP_EXECUTOR_FUSION_DUMP");
+  EXPECT_NE(dump.find("fused plan send_recv: 6 -> 2 operations"), std::string::npos) << dump;
+  EXPECT_NE(dump.find("PUT_WITH_SIGNAL"), std::string::npos) << dump;
+  EXPECT_EQ(plan.operationTemplates.at(0)[0].size(), 1u);
+}
@@ -0,0 +1,179 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mscclpp/executor.hpp>
+
+#include "execution_plan.hpp"
+#include "execution_test_utils.hpp"
+
+namespace {
+void expectChannelInfosEq(const std::unordered_map<int, std::vector<mscclpp::ChannelInfo>>& a,
+                          const std::unordered_map<int, std::vector<mscclpp::ChannelInfo>>& b) {
+  ASSERT_EQ(a.size(), b.size());
+  for (const auto& [rank, infos] : a) {
+    ASSERT_EQ(infos.size(), b.at(rank).size());
+    for (size_t i = 0; i < infos.size(); i++) {
+      EXPECT_EQ(infos[i].srcBufferType, b.at(rank)[i].srcBufferType);
+      EXPECT_EQ(infos[i].dstBufferType, b.at(rank)[i].dstBufferType);
+      EXPECT_EQ(infos[i].channelType, b.at(rank)[i].channelType);
+      EXPECT_EQ(infos[i].connectedPeers, b.at(rank)[i].connectedPeers);
+    }
+  }
+}
+
+void expectThreadblockChannelMapEq(
+    const std::unordered_map<int, std::vector<std::vector<std::pair<int, mscclpp::ChannelKey>>>>& a,
+    const std::unordered_map<int, std::vector<std::vector<std::pair<int, mscclpp::ChannelKey>>>>& b) {
+  ASSERT_EQ(a.size(), b.size());
+  for (const auto& [rank, threadblocks] : a) {
+    ASSERT_EQ(threadblocks.size(), b.at(rank).size());
+    for (size_t tb = 0; tb < threadblocks.size(); tb++) {
+      EXPECT_EQ(threadblocks[tb], b.at(rank)[tb]);
+    }
+  }
+}
+
+void expectCompiledPlanEq(const mscclpp::CompiledExecutionPlan& a, const mscclpp::CompiledExecutionPlan& b) {
+  EXPECT_EQ(a.name, b.name);
+  EXPECT_EQ(a.collective, b.collective);
+  EXPECT_EQ(a.isUsingPacket, b.isUsingPacket);
+  EXPECT_EQ(a.isInPlace, b.isInPlace);
+  EXPECT_EQ(a.nThreadsPerBlock, b.nThreadsPerBlock);
+  EXPECT_EQ(a.minMessageSize, b.minMessageSize);
+  EXPECT_EQ(a.maxMessageSize, b.maxMessageSize);
+  EXPECT_EQ(a.priority, b.priority);
+  EXPECT_EQ(a.inputChunks, b.inputChunks);
+  EXPECT_EQ(a.outputChunks, b.outputChunks);
+  EXPECT_EQ(a.scratchChunks, b.scratchChunks);
+  EXPECT_EQ(a.chunkGroups, b.chunkGroups);
+  EXPECT_EQ(a.channelCountMap, b.channelCountMap);
+  expectChannelInfosEq(a.channelInfos, b.channelInfos);
+  expectChannelInfosEq(a.channelInfosByDstRank, b.channelInfosByDstRank);
+  ASSERT_EQ(a.nvlsInfos.size(), b.nvlsInfos.size());
+  for (const auto& [rank, infos] : a.nvlsInfos) {
+    ASSERT_EQ(infos.size(), b.nvlsInfos.at(rank).size());
+    for (size_t i = 0; i < infos.size(); i++) {
+      EXPECT_EQ(infos[i].ranks, b.nvlsInfos.at(rank)[i].ranks);
+      EXPECT_EQ(infos[i].bufferSize, b.nvlsInfos.at(rank)[i].bufferSize);
+      EXPECT_EQ(infos[i].bufferType, b.nvlsInfos.at(rank)[i].bufferType);
+    }
+  }
+  expectThreadblockChannelMapEq(a.threadblockSMChannelMap, b.threadblockSMChannelMap);
+  expectThreadblockChannelMapEq(a.threadblockProxyChannelMap, b.threadblockProxyChannelMap);
+  expectThreadblockChannelMapEq(a.threadblockNvlsChannelMap, b.threadblockNvlsChannelMap);
+  ASSERT_EQ(a.operationTemplates.size(), b.operationTemplates.size());
+  for (const auto& [rank, threadblocks] : a.operationTemplates) {
+    ASSERT_EQ(threadblocks.size(), b.operationTemplates.at(rank).size());
+    for (size_t tb = 0; tb < threadblocks.size(); tb++) {
+      const auto& ops = threadblocks[tb];
+      ASSERT_EQ(ops.size(), b.operationTemplates.at(rank)[tb].size());
+      EXPECT_EQ(std::memcmp(ops.data(), b.operationTemplates.at(rank)[tb].data(),
+                            ops.size() * sizeof(mscclpp::Operation)),
+                0)
+          << "rank " << rank << " threadblock " << tb;
+    }
+  }
+}
+}  // namespace
+
+class ExecutionPlanTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    tmpDir_ = std::filesystem::temp_directory_path() / ("mscclpp_plan_test_" + std::to_string(getpid()));
+    std::filesystem::create_directories(tmpDir_);
+  }
+  void TearDown() override { std::filesystem::remove_all(tmpDir_); }
+
+  std::filesystem::path tmpDir_;
+};
+
+TEST_F(ExecutionPlanTest, BinaryRoundTrip) {
+  auto plans = getJsonPlans();
+  ASSERT_FALSE(plans.empty());
+  for (const auto& jsonPath : plans) {
+    SCOPED_TRACE(jsonPath.string());
+    std::filesystem::path binaryPath = tmpDir_ / (jsonPath.stem().string() + ".bin");
+    mscclpp::compileExecutionPlan(jsonPath.string(), binaryPath.string());
+    ASSERT_TRUE(mscclpp::isBinaryExecutionPlan(binaryPath.string()));
+    ASSERT_FALSE(mscclpp::isBinaryExecutionPlan(jsonPath.string()));
+
+    mscclpp::CompiledExecutionPlan fromJson = mscclpp::loadCompiledExecutionPlan(jsonPath.string());
+    mscclpp::CompiledExecutionPlan fromBinary = mscclpp::readBinaryExecutionPlan(binaryPath.string());
+    expectCompiledPlanEq(fromJson, fromBinary);
+
+    mscclpp::ExecutionPlan jsonPlan(jsonPath.string());
+    mscclpp::ExecutionPlan binaryPlan(binaryPath.string());
+    EXPECT_EQ(jsonPlan.name(), binaryPlan.name());
+    EXPECT_EQ(jsonPlan.collective(), binaryPlan.collective());
+    EXPECT_EQ(jsonPlan.minMessageSize(), binaryPlan.minMessageSize());
+    EXPECT_EQ(jsonPlan.maxMessageSize(), binaryPlan.maxMessageSize());
+    EXPECT_EQ(jsonPlan.isInPlace(), binaryPlan.isInPlace());
+  }
+}
+
+TEST_F(ExecutionPlanTest, BinaryRejectsTruncatedFile) {
+  auto plans = getJsonPlans();
+  ASSERT_FALSE(plans.empty());
+  std::filesystem::path binaryPath = tmpDir_ / "plan.bin";
+  mscclpp::compileExecutionPlan(plans[0].string(), binaryPath.string());
+  std::filesystem::resize_file(binaryPath, std::filesystem::file_size(binaryPath) / 2);
+  EXPECT_THROW(mscclpp::readBinaryExecutionPlan(binaryPath.string()), mscclpp::Error);
+}
+
+TEST_F(ExecutionPlanTest, ChunkLayoutMatchesPerSizeOffsets) {
+  const size_t constSrcOffset = 4096;
+  const size_t constDstOffset = 8192;
+  auto plans = getJsonPlans();
+  ASSERT_FALSE(plans.empty());
+  for (const auto& jsonPath : plans) {
+    SCOPED_TRACE(jsonPath.string());
+    mscclpp::CompiledExecutionPlan plan = mscclpp::loadCompiledExecutionPlan(jsonPath.string());
+    for (const auto& [rank, threadblocks] : plan.operationTemplates) {
+      uint32_t nInputChunks = plan.inputChunks.at(rank);
+      uint32_t nOutputChunks = plan.outputChunks.at(rank);
+      uint32_t nGroups = plan.chunkGroups.at(rank);
+      int nCheckedSizes = 0;
+      for (size_t step = 1; step <= 256; step++) {
+        // sizes that are not a multiple of the number of chunks exercise the remainder handling
+        size_t baseSize = step * 16 * nGroups + (step > 128 ? (step - 128) * (size_t(1) << 20) * nGroups : 0);
+        size_t inputSize = nInputChunks != 0 ? baseSize : 0;
+        size_t outputSize = nOutputChunks != 0 ? baseSize : 0;
+        if (nInputChunks != 0 && nOutputChunks != 0) {
+          outputSize = inputSize / nInputChunks * nOutputChunks;
+        }
+        std::vector<std::vector<mscclpp::Operation>> expected;
+        try {
+          for (const auto& ops : threadblocks) {
+            expected.emplace_back();
+            for (const auto& op : ops) {
+              expected.back().push_back(
+                  plan.resolveOperation(rank, op, inputSize, outputSize, constSrcOffset, constDstOffset));
+            }
+          }
+        } catch (const mscclpp::Error&) {
+          // the plan does not support this size
+          continue;
+        }
+        mscclpp::ChunkLayout layout =
+            plan.getChunkLayout(rank, inputSize, outputSize, constSrcOffset, constDstOffset);
+        for (size_t tb = 0; tb < threadblocks.size(); tb++) {
+          for (size_t i = 0; i < threadblocks[tb].size(); i++) {
+            mscclpp::Operation op = threadblocks[tb][i];
+            layout.resolve(op);
+            EXPECT_EQ(std::memcmp(&op, &expected[tb][i], sizeof(op)), 0)
+                << "rank " << rank << " threadblock " << tb << " operation " << i << " input size " << inputSize
+                << " output size " << outputSize;
+          }
+        }
+        nCheckedSizes++;
+      }
+      EXPECT_GT(nCheckedSizes, 0) << "rank " << rank;
+    }
+  }
+}
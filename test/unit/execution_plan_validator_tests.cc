@@ -0,0 +1,173 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+#include "execution_plan_validator.hpp"
+#include "execution_test_utils.hpp"
+
+namespace {
+std::string toString(const std::vector<mscclpp::PlanIssue>& issues) {
+  std::string str;
+  for (const auto& issue : issues) {
+    str += mscclpp::planIssueTypeToString(issue.type) + ": " + issue.message + "\n";
+  }
+  return str;
+}
+
+const mscclpp::PlanIssue* findIssue(const std::vector<mscclpp::PlanIssue>& issues, mscclpp::PlanIssueType type) {
+  auto it =
+      std::find_if(issues.begin(), issues.end(), [&](const mscclpp::PlanIssue& issue) { return issue.type == type; });
+  return it == issues.end() ? nullptr : &*it;
+}
+
+// Removes the first operation of `type` from every threadblock of `rank`.
+void removeFirst(mscclpp::CompiledExecutionPlan& plan, int rank, mscclpp::OperationType type) {
+  for (auto& ops : plan.operationTemplates.at(rank)) {
+    auto it = std::find_if(ops.begin(), ops.end(), [&](const mscclpp::Operation& op) { return op.type == type; });
+    if (it != ops.end()) ops.erase(it);
+  }
+}
+}  // namespace
+
+TEST(ExecutionPlanValidatorTest, ShippedPlansAreValid) {
+  for (const auto& jsonPath : getJsonPlans()) {
+    std::vector<mscclpp::PlanIssue> issues = mscclpp::validateExecutionPlan(jsonPath.string(), {1 << 16, 3 << 20});
+    EXPECT_TRUE(issues.empty()) << jsonPath.filename() << "\n" << toString(issues);
+  }
+}
+
+TEST(ExecutionPlanValidatorTest, MissingSignal) {
+  mscclpp::CompiledExecutionPlan plan = loadPlan("allreduce.json");
+  removeFirst(plan, 0, mscclpp::OperationType::SIGNAL);
+  std::vector<mscclpp::PlanIssue> issues = mscclpp::validateExecutionPlan(plan);
+  const mscclpp::PlanIssue* unbalanced = findIssue(issues, mscclpp::PlanIssueType::UnbalancedSemaphore);
+  ASSERT_NE(unbalanced, nullptr) << toString(issues);
+  EXPECT_NE(unbalanced->message.find("from rank 0 to rank 1"), std::string::npos) << unbalanced->message;
+  const mscclpp::PlanIssue* deadlock = findIssue(issues, mscclpp::PlanIssueType::Deadlock);
+  ASSERT_NE(deadlock, nullptr) << toString(issues);
+  EXPECT_EQ(deadlock->rank, 1);
+  EXPECT_EQ(plan.operationTemplates.at(1)[deadlock->threadblock][deadlock->operation].type,
+            mscclpp::OperationType::WAIT);
+}
+
+TEST(ExecutionPlanValidatorTest, WaitCycle) {
+  // both ranks wait before they signal
+  mscclpp::CompiledExecutionPlan plan = loadPlan("allreduce.json");
+  for (auto& [rank, threadblocks] : plan.operationTemplates) {
+    for (auto& ops : threadblocks) {
+      ASSERT_EQ(ops[0].type, mscclpp::OperationType::SIGNAL);
+      ASSERT_EQ(ops[1].type, mscclpp::OperationType::WAIT);
+      std::swap(ops[0], ops[1]);
+    }
+  }
+  std::vector<mscclpp::PlanIssue> issues = mscclpp::validateExecutionPlan(plan);
+  EXPECT_EQ(findIssue(issues, mscclpp::PlanIssueType::UnbalancedSemaphore), nullptr) << toString(issues);
+  EXPECT_NE(findIssue(issues, mscclpp::PlanIssueType::Deadlock), nullptr) << toString(issues);
+}
+
+TEST(ExecutionPlanValidatorTest, Race) {
+  // Rank 0 puts without a signal, and rank 1 copies out what it receives without waiting. The semaphores stay balanced,
+  // so only the race is left.
+  mscclpp::CompiledExecutionPlan plan = loadPlan("sendrecv.json");
+  for (auto& ops : plan.operationTemplates.at(0)) {
+    for (auto& op : ops) {
+      if (op.type == mscclpp::OperationType::PUT_WITH_SIGNAL_AND_FLUSH) op.type = mscclpp::OperationType::PUT;
+    }
+  }
+  removeFirst(plan, 1, mscclpp::OperationType::WAIT);
+  std::vector<mscclpp::PlanIssue> issues = mscclpp::validateExecutionPlan(plan);
+  ASSERT_FALSE(issues.empty());
+  for (const auto& issue : issues) {
+    EXPECT_EQ(issue.type, mscclpp::PlanIssueType::Race) << issue.message;
+  }
+  EXPECT_EQ(issues[0].rank, 0);
+  EXPECT_NE(issues[0].message.find("(PUT): writes"), std::string::npos) << issues[0].message;
+  EXPECT_NE(issues[0].message.find("with no barrier or semaphore in between"), std::string::npos) << issues[0].message;
+}
+
+TEST(ExecutionPlanValidatorTest, BarrierOrdersThreadblocks) {
+  // threadblock 1 copies the chunk that threadblock 0 receives
+  mscclpp::CompiledExecutionPlan plan = loadPlan("sendrecv.json");
+  auto& threadblocks = plan.operationTemplates.at(1);
+  ASSERT_EQ(threadblocks.size(), 1u);
+  auto copy = std::find_if(threadblocks[0].begin(), threadblocks[0].end(),
+                           [](const mscclpp::Operation& op) { return op.type == mscclpp::OperationType::COPY; });
+  ASSERT_NE(copy, threadblocks[0].end());
+  mscclpp::Operation extra = *copy;
+  threadblocks.push_back({extra});
+  plan.threadblockSMChannelMap.at(1).emplace_back();
+  plan.threadblockProxyChannelMap.at(1).emplace_back();
+  plan.threadblockNvlsChannelMap.at(1).emplace_back();
+  std::vector<mscclpp::PlanIssue> issues = mscclpp::validateExecutionPlan(plan);
+  const mscclpp::PlanIssue* race = findIssue(issues, mscclpp::PlanIssueType::Race);
+  ASSERT_NE(race, nullptr) << toString(issues);
+  EXPECT_EQ(race->rank, 1);
+
+  // a barrier of both threadblocks, after the copy of threadblock 0 and before the one of threadblock 1
+  mscclpp::Operation barrier = {};
+  barrier.type = mscclpp::OperationType::BARRIER;
+  barrier.deviceSyncerIndex = 0;
+  barrier.nThreadBlocks = 2;
+  threadblocks[0].push_back(barrier);
+  threadblocks[1].insert(threadblocks[1].begin(), barrier);
+  issues = mscclpp::validateExecutionPlan(plan);
+  EXPECT_TRUE(issues.empty()) << toString(issues);
+}
+
+TEST(ExecutionPlanValidatorTest, OutOfBounds) {
+  mscclpp::CompiledExecutionPlan plan = loadPlan("sendrecv.json");
+  for (auto& ops : plan.operationTemplates.at(1)) {
+    for (auto& op : ops) {
+      // one chunk past the end of the output buffer
+      if (op.type == mscclpp::OperationType::COPY) op.dstOffset = 1;
+    }
+  }
+  std::vector<mscclpp::PlanIssue> issues = mscclpp::validateExecutionPlan(plan, {1 << 20});
+  const mscclpp::PlanIssue* outOfBounds = findIssue(issues, mscclpp::PlanIssueType::OutOfBounds);
+  ASSERT_NE(outOfBounds, nullptr) << toString(issues);
+  EXPECT_EQ(outOfBounds->rank, 1);
+  EXPECT_NE(outOfBounds->message.find("out of the output buffer of rank 1"), std::string::npos) << outOfBounds->message;
+}
+
+TEST(ExecutionPlanValidatorTest, DeclaredMessageSizes) {
+  mscclpp::CompiledExecutionPlan plan = loadPlan("allreduce.json");
+  // too small to give every chunk 16 bytes
+  plan.minMessageSize = 16;
+  plan.maxMessageSize = 1 << 20;
+  std::vector<mscclpp::PlanIssue> issues = mscclpp::validateExecutionPlan(plan);
+  const mscclpp::PlanIssue* outOfBounds = findIssue(issues, mscclpp::PlanIssueType::OutOfBounds);
+  ASSERT_NE(outOfBounds, nullptr) << toString(issues);
+  EXPECT_NE(outOfBounds->message.find("at message size 16,"), std::string::npos) << outOfBounds->message;
+
+  plan.minMessageSize = 1 << 16;
+  issues = mscclpp::validateExecutionPlan(plan);
+  EXPECT_TRUE(issues.empty()) << toString(issues);
+}
+
+TEST(ExecutionPlanValidatorTest, UnpairedChannel) {
+  mscclpp::CompiledExecutionPlan plan = loadPlan("sendrecv.json");
+  mscclpp::ChannelInfo info = plan.channelInfos.at(0).front();
+  info.connectedPeers = {1};
+  plan.channelInfos.at(0).push_back(info);
+  std::vector<mscclpp::PlanIssue> issues = mscclpp::validateExecutionPlan(plan);
+  ASSERT_EQ(issues.size(), 1u) << toString(issues);
+  EXPECT_EQ(issues[0].type, mscclpp::PlanIssueType::UnpairedChannel);
+  EXPECT_EQ(issues[0].rank, 0);
+}
+
+TEST(ExecutionPlanValidatorTest, Malformed) {
+  mscclpp::CompiledExecutionPlan plan = loadPlan("allreduce.json");
+  auto& op = plan.operationTemplates.at(0)[0][0];
+  ASSERT_EQ(op.type, mscclpp::OperationType::SIGNAL);
+  op.outputChannelIndexes[0] = 100;
+  std::vector<mscclpp::PlanIssue> issues = mscclpp::validateExecutionPlan(plan);
+  const mscclpp::PlanIssue* malformed = findIssue(issues, mscclpp::PlanIssueType::Malformed);
+  ASSERT_NE(malformed, nullptr) << toString(issues);
+  EXPECT_EQ(malformed->rank, 0);
+  EXPECT_EQ(malformed->threadblock, 0);
+  EXPECT_EQ(malformed->operation, 0);
+  EXPECT_NE(malformed->message.find("has no SM channel 100"), std::string::npos) << malformed->message;
+}
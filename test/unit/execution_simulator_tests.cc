@@ -0,0 +1,123 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include <gtest/gtest.h>
+
+#include <limits>
+#include <mscclpp/errors.hpp>
+
+#include "execution_simulator.hpp"
+#include "execution_test_utils.hpp"
+
+namespace {
+mscclpp::SimulationResult simulate(const mscclpp::CompiledExecutionPlan& plan, size_t messageSize,
+                                   const mscclpp::SimulationOptions& options = {}) {
+  auto [inputSize, outputSize] = plan.getBufferSizes(messageSize);
+  return mscclpp::simulateExecutionPlan(plan, inputSize, outputSize, options);
+}
+
+double getBytes(const mscclpp::SimulationResult& result, mscclpp::LinkType type) {
+  return result.bytes[static_cast<int>(type)];
+}
+}  // namespace
+
+TEST(ExecutionSimulatorTest, ShippedPlans) {
+  for (const auto& jsonPath : getJsonPlans()) {
+    mscclpp::CompiledExecutionPlan plan = mscclpp::loadCompiledExecutionPlan(jsonPath.string());
+    size_t nOperations = 0;
+    for (const auto& [rank, threadblocks] : plan.operationTemplates) {
+      for (const auto& ops : threadblocks) nOperations += ops.size();
+    }
+    mscclpp::SimulationResult small = simulate(plan, 1 << 16);
+    mscclpp::SimulationResult large = simulate(plan, 1 << 24);
+    EXPECT_EQ(small.operations.size(), nOperations) << jsonPath.filename();
+    EXPECT_GT(small.latencyUs, mscclpp::SimulationOptions().launchUs) << jsonPath.filename();
+    EXPECT_GT(large.latencyUs, small.latencyUs) << jsonPath.filename();
+    for (const auto& op : large.operations) {
+      EXPECT_LE(op.startUs + op.waitUs, op.endUs) << jsonPath.filename();
+      EXPECT_LE(op.endUs, op.completeUs) << jsonPath.filename();
+      for (double utilization : op.utilization) {
+        EXPECT_LE(utilization, 1.0 + 1e-6) << jsonPath.filename();
+      }
+    }
+  }
+}
+
+TEST(ExecutionSimulatorTest, CriticalPath) {
+  mscclpp::CompiledExecutionPlan plan = loadPlan("allreduce.json");
+  mscclpp::SimulationResult result = simulate(plan, 1 << 20);
+  ASSERT_FALSE(result.criticalPath.empty());
+  const auto& last = result.operations[result.criticalPath.back()];
+  EXPECT_DOUBLE_EQ(last.completeUs, result.latencyUs);
+  // every threadblock starts with a signal that the other rank waits for
+  EXPECT_EQ(result.operations[result.criticalPath.front()].type, mscclpp::OperationType::SIGNAL);
+  for (size_t i = 1; i < result.criticalPath.size(); i++) {
+    const auto& op = result.operations[result.criticalPath[i]];
+    const auto& previous = result.operations[result.criticalPath[i - 1]];
+    EXPECT_LE(previous.startUs, op.startUs);
+  }
+}
+
+TEST(ExecutionSimulatorTest, PacketsForSmallMessages) {
+  mscclpp::CompiledExecutionPlan plan = loadPlan("allreduce.json");
+  mscclpp::CompiledExecutionPlan packetPlan = loadPlan("allreduce_packet.json");
+  EXPECT_LT(simulate(packetPlan, 1 << 10).latencyUs, simulate(plan, 1 << 10).latencyUs);
+  EXPECT_GT(simulate(packetPlan, 1 << 26).latencyUs, simulate(plan, 1 << 26).latencyUs);
+
+  // packets double the bytes on the links
+  mscclpp::SimulationResult result = simulate(packetPlan, 1 << 20);
+  mscclpp::SimulationOptions ll8;
+  ll8.packetType = mscclpp::PacketType::LL8;
+  mscclpp::SimulationResult ll8Result = simulate(packetPlan, 1 << 20, ll8);
+  EXPECT_EQ(getBytes(result, mscclpp::LinkType::NVLink), getBytes(ll8Result, mscclpp::LinkType::NVLink));
+  EXPECT_GT(ll8Result.latencyUs, result.latencyUs);
+}
+
+TEST(ExecutionSimulatorTest, LinkModel) {
+  mscclpp::CompiledExecutionPlan plan = loadPlan("sendrecv.json");
+  mscclpp::SimulationResult nvlink = simulate(plan, 1 << 24);
+  EXPECT_GT(getBytes(nvlink, mscclpp::LinkType::NVLink), 0);
+  EXPECT_EQ(getBytes(nvlink, mscclpp::LinkType::IB), 0);
+
+  // one rank per node
+  mscclpp::SimulationOptions options;
+  options.nRanksPerNode = 1;
+  mscclpp::SimulationResult ib = simulate(plan, 1 << 24, options);
+  EXPECT_EQ(getBytes(ib, mscclpp::LinkType::NVLink), 0);
+  EXPECT_EQ(getBytes(ib, mscclpp::LinkType::IB), getBytes(nvlink, mscclpp::LinkType::NVLink));
+  EXPECT_GT(ib.latencyUs, nvlink.latencyUs);
+
+  // a large message is bound by the bandwidth of IB
+  double ibBytes = getBytes(ib, mscclpp::LinkType::IB) / plan.operationTemplates.size();
+  EXPECT_GT(ib.latencyUs, ibBytes / (options.links.ib.bandwidth * 1e3));
+  EXPECT_GT(ib.utilization[static_cast<int>(mscclpp::LinkType::IB)], 0.2);
+
+  options.links.ib.bandwidth *= 2;
+  EXPECT_LT(simulate(plan, 1 << 24, options).latencyUs, ib.latencyUs);
+}
+
+TEST(ExecutionSimulatorTest, Deadlock) {
+  mscclpp::CompiledExecutionPlan plan = loadPlan("allreduce.json");
+  for (auto& ops : plan.operationTemplates.at(0)) {
+    ASSERT_EQ(ops[0].type, mscclpp::OperationType::SIGNAL);
+    ops.erase(ops.begin());
+  }
+  EXPECT_THROW(simulate(plan, 1 << 20), mscclpp::Error);
+}
+
+TEST(ExecutionSimulatorTest, DerivePlanSizeRanges) {
+  std::vector<size_t> sizes = {1 << 10, 1 << 12, 1 << 14, 1 << 16};
+  const double never = std::numeric_limits<double>::infinity();
+  std::vector<mscclpp::PlanSizeRange> ranges =
+      mscclpp::derivePlanSizeRanges(sizes, {{5, 6, 9, 20}, {7, 6.5, 8, 10}, {never, 4, never, never}});
+  ASSERT_EQ(ranges.size(), 3u);
+  EXPECT_EQ(ranges[0].plan, 0);
+  EXPECT_EQ(ranges[0].minMessageSize, 0u);
+  EXPECT_EQ(ranges[0].maxMessageSize, 1u << 12);
+  EXPECT_EQ(ranges[1].plan, 2);
+  EXPECT_EQ(ranges[1].minMessageSize, 1u << 12);
+  EXPECT_EQ(ranges[1].maxMessageSize, 1u << 14);
+  EXPECT_EQ(ranges[2].plan, 1);
+  EXPECT_EQ(ranges[2].minMessageSize, 1u << 14);
+  EXPECT_EQ(ranges[2].maxMessageSize, std::numeric_limits<uint64_t>::max());
+}
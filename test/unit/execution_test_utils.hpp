@@ -0,0 +1,45 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#ifndef MSCCLPP_EXECUTION_TEST_UTILS_HPP_
+#define MSCCLPP_EXECUTION_TEST_UTILS_HPP_
+
+#include <unistd.h>
+
+#include <climits>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "execution_plan.hpp"
+
+// Returns the test/execution-files directory of the source tree. The test binary is in <build>/bin, next to the
+// source tree.
+inline std::filesystem::path getExecutionFilesPath() {
+  char result[PATH_MAX];
+  ssize_t count = readlink("/proc/self/exe", result, PATH_MAX);
+  if (count == -1) {
+    throw std::runtime_error("Failed to get executable path");
+  }
+  std::filesystem::path path = std::string(result, count);
+  return path.parent_path().parent_path().parent_path() / "test/execution-files";
+}
+
+// Returns the JSON plans in test/execution-files.
+inline std::vector<std::filesystem::path> getJsonPlans() {
+  std::vector<std::filesystem::path> plans;
+  for (const auto& entry : std::filesystem::directory_iterator(getExecutionFilesPath())) {
+    if (entry.path().extension() == ".json") {
+      plans.push_back(entry.path());
+    }
+  }
+  return plans;
+}
+
+// Loads the plan `name` from test/execution-files.
+inline mscclpp::CompiledExecutionPlan loadPlan(const std::string& name) {
+  return mscclpp::loadCompiledExecutionPlan((getExecutionFilesPath() / name).string());
+}
+
+#endif  // MSCCLPP_EXECUTION_TEST_UTILS_HPP_
@@ -0,0 +1,248 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <mscclpp/errors.hpp>
+#include <mscclpp/host_reduce.hpp>
+#include <random>
+#include <vector>
+
+#include "host_reduce_kernels.hpp"
+
+namespace {
+
+// The kernels of the instruction sets that both the library and this CPU support, besides the scalar ones.
+std::vector<const mscclpp::HostReduceKernels*> simdKernels() {
+  std::vector<const mscclpp::HostReduceKernels*> kernels;
+#if defined(__x86_64__)
+  __builtin_cpu_init();
+  if (mscclpp::hostReduceKernelsAvx2() != nullptr && __builtin_cpu_supports("avx2")) {
+    kernels.push_back(mscclpp::hostReduceKernelsAvx2());
+  }
+  if (mscclpp::hostReduceKernelsAvx512() != nullptr && __builtin_cpu_supports("avx512f")) {
+    kernels.push_back(mscclpp::hostReduceKernelsAvx512());
+  }
+#endif
+  return kernels;
+}
+
+std::vector<uint32_t> randomBits(size_t n, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::vector<uint32_t> bits(n);
+  for (auto& b : bits) b = rng();
+  return bits;
+}
+
+std::vector<float> randomFloats(size_t n, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> dist(-4.0f, 4.0f);
+  std::vector<float> values(n);
+  for (auto& v : values) v = dist(rng);
+  return values;
+}
+
+uint16_t floatToHalf(float value) {
+  uint16_t half;
+  mscclpp::hostReduceKernelsScalar()->floatToHalf(&half, &value, 1);
+  return half;
+}
+
+float halfToFloat(uint16_t half) {
+  float value;
+  mscclpp::hostReduceKernelsScalar()->halfToFloat(&value, &half, 1);
+  return value;
+}
+
+}  // namespace
+
+TEST(HostReduceTest, KernelsMatchScalar) {
+  const mscclpp::HostReduceKernels* scalar = mscclpp::hostReduceKernelsScalar();
+  // lengths around the vector widths, so that the tails are covered as well
+  for (size_t n : {0, 1, 7, 8, 9, 15, 16, 17, 31, 33, 100}) {
+    std::vector<float> a = randomFloats(n, 1);
+    std::vector<float> b = randomFloats(n, 2);
+    if (n > 1) b[1] = std::numeric_limits<float>::quiet_NaN();
+    std::vector<uint32_t> x = randomBits(n, 3);
+    std::vector<uint32_t> y = randomBits(n, 4);
+    for (const mscclpp::HostReduceKernels* kernels : simdKernels()) {
+      for (int op = 0; op < mscclpp::HostReduceNumOps; ++op) {
+        SCOPED_TRACE(std::string(kernels->isa) + " op " + std::to_string(op) + " n " + std::to_string(n));
+        std::vector<float> expectedF(n), actualF(n);
+        scalar->f32[op](expectedF.data(), a.data(), b.data(), n);
+        kernels->f32[op](actualF.data(), a.data(), b.data(), n);
+        EXPECT_EQ(std::memcmp(expectedF.data(), actualF.data(), n * sizeof(float)), 0);
+
+        // the output may be the first input
+        actualF = a;
+        kernels->f32[op](actualF.data(), actualF.data(), b.data(), n);
+        EXPECT_EQ(std::memcmp(expectedF.data(), actualF.data(), n * sizeof(float)), 0);
+
+        std::vector<uint32_t> expectedU(n), actualU(n);
+        scalar->u32[op](expectedU.data(), x.data(), y.data(), n);
+        kernels->u32[op](actualU.data(), x.data(), y.data(), n);
+        EXPECT_EQ(expectedU, actualU);
+
+        auto xi = reinterpret_cast<const int32_t*>(x.data());
+        auto yi = reinterpret_cast<const int32_t*>(y.data());
+        std::vector<int32_t> expectedI(n), actualI(n);
+        scalar->i32[op](expectedI.data(), xi, yi, n);
+        kernels->i32[op](actualI.data(), xi, yi, n);
+        EXPECT_EQ(expectedI, actualI);
+      }
+    }
+  }
+}
+
+TEST(HostReduceTest, ConversionsMatchScalar) {
+  const mscclpp::HostReduceKernels* scalar = mscclpp::hostReduceKernelsScalar();
+  // every 16-bit pattern, and random 32-bit patterns together with the edges of the half range
+  std::vector<uint16_t> halves(1 << 16);
+  for (size_t i = 0; i < halves.size(); ++i) halves[i] = static_cast<uint16_t>(i);
+  std::vector<uint32_t> floatBits = randomBits(1 << 16, 5);
+  for (uint32_t bits : {0x00000000u, 0x80000000u, 0x7f800000u, 0xff800000u, 0x7fc00000u, 0x7f800001u, 0x477ff000u,
+                        0x477fefffu, 0x387fc000u, 0x33000000u, 0x33000001u, 0x7f7fffffu, 0x3f808000u, 0x3f818000u}) {
+    floatBits.push_back(bits);
+  }
+  std::vector<float> floats(floatBits.size());
+  std::memcpy(floats.data(), floatBits.data(), floats.size() * sizeof(float));
+
+  std::vector<float> expectedF(halves.size()), actualF(halves.size());
+  std::vector<uint16_t> expectedH(floats.size()), actualH(floats.size());
+  for (const mscclpp::HostReduceKernels* kernels : simdKernels()) {
+    SCOPED_TRACE(kernels->isa);
+    scalar->halfToFloat(expectedF.data(), halves.data(), halves.size());
+    kernels->halfToFloat(actualF.data(), halves.data(), halves.size());
+    EXPECT_EQ(std::memcmp(expectedF.data(), actualF.data(), actualF.size() * sizeof(float)), 0);
+    scalar->bf16ToFloat(expectedF.data(), halves.data(), halves.size());
+    kernels->bf16ToFloat(actualF.data(), halves.data(), halves.size());
+    EXPECT_EQ(std::memcmp(expectedF.data(), actualF.data(), actualF.size() * sizeof(float)), 0);
+
+    scalar->floatToHalf(expectedH.data(), floats.data(), floats.size());
+    kernels->floatToHalf(actualH.data(), floats.data(), floats.size());
+    for (size_t i = 0; i < floats.size(); ++i) {
+      // the hardware may keep the payload of a NaN
+      if (std::isnan(floats[i])) {
+        EXPECT_TRUE(std::isnan(halfToFloat(actualH[i])));
+      } else {
+        ASSERT_EQ(expectedH[i], actualH[i]) << "float bits " << std::hex << floatBits[i];
+      }
+    }
+    scalar->floatToBf16(expectedH.data(), floats.data(), floats.size());
+    kernels->floatToBf16(actualH.data(), floats.data(), floats.size());
+    EXPECT_EQ(expectedH, actualH);
+  }
+}
+
+TEST(HostReduceTest, ScalarConversions) {
+  EXPECT_EQ(floatToHalf(1.0f), 0x3c00);
+  EXPECT_EQ(floatToHalf(-2.0f), 0xc000);
+  EXPECT_EQ(floatToHalf(65504.0f), 0x7bff);
+  EXPECT_EQ(floatToHalf(65520.0f), 0x7c00);
+  EXPECT_EQ(floatToHalf(std::ldexp(1.0f, -24)), 0x0001);
+  EXPECT_EQ(floatToHalf(std::ldexp(1.0f, -25)), 0x0000);
+  // halfway between 1 and the next half rounds to even
+  EXPECT_EQ(floatToHalf(1.0f + std::ldexp(1.0f, -11)), 0x3c00);
+  EXPECT_EQ(floatToHalf(1.0f + 3 * std::ldexp(1.0f, -11)), 0x3c02);
+  EXPECT_EQ(halfToFloat(0x0001), std::ldexp(1.0f, -24));
+  EXPECT_EQ(halfToFloat(0xfc00), -std::numeric_limits<float>::infinity());
+  EXPECT_TRUE(std::isnan(halfToFloat(0x7e00)));
+  EXPECT_TRUE(std::isnan(halfToFloat(floatToHalf(std::numeric_limits<float>::quiet_NaN()))));
+}
+
+TEST(HostReduceTest, ReducesMultipleInputs) {
+  const size_t count = 1000;
+  std::vector<std::vector<int32_t>> inputs(5, std::vector<int32_t>(count));
+  std::vector<const void*> srcs;
+  for (size_t k = 0; k < inputs.size(); ++k) {
+    for (size_t i = 0; i < count; ++i) inputs[k][i] = static_cast<int32_t>(i * (k + 1)) - 300;
+    srcs.push_back(inputs[k].data());
+  }
+  std::vector<int32_t> dst(count);
+  mscclpp::hostReduce(dst.data(), srcs, count, mscclpp::DataType::INT32, mscclpp::ReduceOp::SUM);
+  for (size_t i = 0; i < count; ++i) ASSERT_EQ(dst[i], static_cast<int32_t>(15 * i) - 1500);
+  mscclpp::hostReduce(dst.data(), srcs, count, mscclpp::DataType::INT32, mscclpp::ReduceOp::MIN);
+  for (size_t i = 0; i < count; ++i) ASSERT_EQ(dst[i], static_cast<int32_t>(i) - 300);
+  mscclpp::hostReduce(dst.data(), srcs, count, mscclpp::DataType::INT32, mscclpp::ReduceOp::MAX);
+  for (size_t i = 0; i < count; ++i) ASSERT_EQ(dst[i], static_cast<int32_t>(5 * i) - 300);
+
+  // unsigned comparisons, and products that wrap around
+  std::vector<uint32_t> a = {1, 0x80000000u, 3}, b = {0xffffffffu, 2, 0x55555556u}, out(3);
+  mscclpp::hostReduce(out.data(), {a.data(), b.data()}, 3, mscclpp::DataType::UINT32, mscclpp::ReduceOp::MAX);
+  EXPECT_EQ(out, (std::vector<uint32_t>{0xffffffffu, 0x80000000u, 0x55555556u}));
+  mscclpp::hostReduce(out.data(), {a.data(), b.data()}, 3, mscclpp::DataType::UINT32, mscclpp::ReduceOp::PROD);
+  EXPECT_EQ(out, (std::vector<uint32_t>{0xffffffffu, 0u, 2u}));
+
+  // a single input is copied
+  std::vector<const void*> single = {b.data()};
+  mscclpp::hostReduce(out.data(), single, 3, mscclpp::DataType::UINT32, mscclpp::ReduceOp::SUM);
+  EXPECT_EQ(out, b);
+}
+
+TEST(HostReduceTest, OutputMayBeAnInput) {
+  const size_t count = 100;
+  std::vector<float> a(count, 1.0f), b(count, 2.0f), c(count, 4.0f);
+  // the output is the last of the inputs, so it must be read before it is written
+  mscclpp::hostReduce(c.data(), {a.data(), b.data(), c.data()}, count, mscclpp::DataType::FLOAT32,
+                      mscclpp::ReduceOp::SUM);
+  EXPECT_EQ(c, std::vector<float>(count, 7.0f));
+  mscclpp::hostReduce(a.data(), b.data(), count, mscclpp::DataType::FLOAT32, mscclpp::ReduceOp::PROD);
+  EXPECT_EQ(a, std::vector<float>(count, 2.0f));
+}
+
+TEST(HostReduceTest, HalfPrecisionRoundsOnce) {
+  // each of the small terms would be lost if every partial sum were rounded to half precision
+  const size_t count = 37;
+  std::vector<uint16_t> one(count, 0x3c00), tiny(count, floatToHalf(std::ldexp(1.0f, -11))), dst(count);
+  mscclpp::hostReduce(dst.data(), {one.data(), tiny.data(), tiny.data()}, count, mscclpp::DataType::FLOAT16,
+                      mscclpp::ReduceOp::SUM);
+  EXPECT_EQ(dst, std::vector<uint16_t>(count, 0x3c01));
+
+  std::vector<uint16_t> bf16One(count, 0x3f80), bf16Tiny(count, 0x3b80);
+  mscclpp::hostReduce(dst.data(), {bf16One.data(), bf16Tiny.data(), bf16Tiny.data()}, count,
+                      mscclpp::DataType::BFLOAT16, mscclpp::ReduceOp::SUM);
+  EXPECT_EQ(dst, std::vector<uint16_t>(count, 0x3f81));
+}
+
+TEST(HostReduceTest, MinMaxIgnoreNanInLaterInputs) {
+  const size_t count = 20;
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  std::vector<float> a(count, 1.0f), b(count, nan), dst(count);
+  mscclpp::hostReduce(dst.data(), {a.data(), b.data()}, count, mscclpp::DataType::FLOAT32, mscclpp::ReduceOp::MIN);
+  EXPECT_EQ(dst, a);
+  mscclpp::hostReduce(dst.data(), {a.data(), b.data()}, count, mscclpp::DataType::FLOAT32, mscclpp::ReduceOp::MAX);
+  EXPECT_EQ(dst, a);
+}
+
+TEST(HostReduceTest, ThreadsMatchSingleThread) {
+  // more than one part per thread, and a count that does not split evenly
+  const size_t count = (3 << 20) + 12345;
+  std::vector<float> a = randomFloats(count, 6), b = randomFloats(count, 7), c = randomFloats(count, 8);
+  std::vector<float> expected(count), actual(count);
+  mscclpp::hostReduce(expected.data(), {a.data(), b.data(), c.data()}, count, mscclpp::DataType::FLOAT32,
+                      mscclpp::ReduceOp::SUM, 1);
+  for (int numThreads : {0, 3, 8}) {
+    std::fill(actual.begin(), actual.end(), 0.0f);
+    mscclpp::hostReduce(actual.data(), {a.data(), b.data(), c.data()}, count, mscclpp::DataType::FLOAT32,
+                        mscclpp::ReduceOp::SUM, numThreads);
+    EXPECT_EQ(std::memcmp(expected.data(), actual.data(), count * sizeof(float)), 0) << numThreads << " threads";
+  }
+}
+
+TEST(HostReduceTest, InvalidArguments) {
+  std::vector<float> a(4);
+  std::vector<const void*> none;
+  EXPECT_THROW(mscclpp::hostReduce(a.data(), none, 4, mscclpp::DataType::FLOAT32, mscclpp::ReduceOp::SUM),
+               mscclpp::Error);
+  EXPECT_THROW(mscclpp::hostReduce(a.data(), a.data(), 4, mscclpp::DataType::FLOAT32, mscclpp::ReduceOp::SUM, -1),
+               mscclpp::Error);
+}
+
+TEST(HostReduceTest, Isa) {
+  std::string isa = mscclpp::hostReduceIsa();
+  EXPECT_TRUE(isa == "avx512" || isa == "avx2" || isa == "scalar") << isa;
+  EXPECT_EQ(isa, mscclpp::hostReduceKernels()->isa);
+}
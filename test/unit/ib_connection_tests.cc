@@ -0,0 +1,309 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#if defined(USE_IBVERBS)
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <mscclpp/core.hpp>
+
+#include "connection.hpp"
+#include "ib_software.hpp"
+
+// Connects two contexts of this process over the software verbs backend, which needs no HCA.
+class IbConnectionTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    unsetenv("MSCCLPP_HCA_DEVICES");
+    mscclpp::SoftwareIb::install();
+  }
+
+  void TearDown() override {
+    connection.reset();
+    senderContext.reset();
+    receiverContext.reset();
+    mscclpp::SoftwareIb::uninstall();
+  }
+
+  void connect(const mscclpp::EndpointConfig& config) {
+    senderContext = std::make_unique<mscclpp::Context>();
+    receiverContext = std::make_unique<mscclpp::Context>();
+    auto senderEndpoint = senderContext->createEndpoint(config);
+    auto receiverEndpoint = receiverContext->createEndpoint(config);
+    connection = senderContext->connect(senderEndpoint, receiverEndpoint);
+  }
+
+  // Registers memory of the receiver and returns it as the sender sees it.
+  mscclpp::RegisteredMemory registerRemote(void* ptr, size_t size,
+                                           mscclpp::TransportFlags transports = mscclpp::Transport::IB0) {
+    auto local = receiverContext->registerMemory(ptr, size, transports);
+    return mscclpp::RegisteredMemory::deserialize(local.serialize());
+  }
+
+  std::unique_ptr<mscclpp::Context> senderContext;
+  std::unique_ptr<mscclpp::Context> receiverContext;
+  std::shared_ptr<mscclpp::Connection> connection;
+};
+
+TEST_F(IbConnectionTest, SignalsOneInEveryInterval) {
+  mscclpp::EndpointConfig config(mscclpp::Transport::IB0);
+  config.ibSignalInterval = 16;
+  connect(config);
+  const int count = 100;
+  std::vector<uint64_t> src(count);
+  std::vector<uint64_t> dst(count, 0);
+  uint64_t flag = 0;
+  uint64_t counter = 0;
+  auto srcMem = senderContext->registerMemory(src.data(), count * sizeof(uint64_t), mscclpp::Transport::IB0);
+  auto dstMem = registerRemote(dst.data(), count * sizeof(uint64_t));
+  auto flagMem = registerRemote(&flag, sizeof(flag));
+
+  for (int i = 0; i < count; ++i) {
+    src[i] = i + 1;
+    connection->write(dstMem, i * sizeof(uint64_t), srcMem, i * sizeof(uint64_t), sizeof(uint64_t));
+  }
+  connection->updateAndSync(flagMem, 0, &counter, 1);
+  connection->flush();
+  EXPECT_EQ(flag, 1);
+  for (int i = 0; i < count; ++i) {
+    EXPECT_EQ(dst[i], i + 1);
+  }
+  // 101 work requests are signaled 6 times, and flush signals the 5 after the last of them with an empty write
+  auto stats = mscclpp::SoftwareIb::stats(0);
+  EXPECT_EQ(stats.workRequests, count + 2);
+  EXPECT_EQ(stats.completions, 7);
+  EXPECT_EQ(stats.bytes, count * sizeof(uint64_t));
+}
+
+TEST_F(IbConnectionTest, ReclaimsSendQueueWithoutFlush) {
+  mscclpp::EndpointConfig config(mscclpp::Transport::IB0);
+  config.ibMaxSendWr = 64;
+  config.ibMaxCqSize = 8;
+  config.ibSignalInterval = 16;
+  connect(config);
+  std::vector<uint64_t> src(1, 42);
+  std::vector<uint64_t> dst(1, 0);
+  auto srcMem = senderContext->registerMemory(src.data(), sizeof(uint64_t), mscclpp::Transport::IB0);
+  auto dstMem = registerRemote(dst.data(), sizeof(uint64_t));
+
+  // many times more work requests than the send queue and the CQ hold
+  for (int i = 0; i < 10000; ++i) {
+    src[0] = i;
+    connection->write(dstMem, 0, srcMem, 0, sizeof(uint64_t));
+  }
+  EXPECT_EQ(dst[0], 9999);
+  connection->flush();
+  auto stats = mscclpp::SoftwareIb::stats(0);
+  EXPECT_EQ(stats.sendQueueOverflows, 0);
+  EXPECT_EQ(stats.cqOverruns, 0);
+}
+
+TEST_F(IbConnectionTest, FlushPollsInBatches) {
+  mscclpp::EndpointConfig config(mscclpp::Transport::IB0);
+  config.ibSignalInterval = 1;
+  config.ibMaxCqPollNum = 16;
+  connect(config);
+  std::vector<uint64_t> src(1, 1);
+  std::vector<uint64_t> dst(1, 0);
+  auto srcMem = senderContext->registerMemory(src.data(), sizeof(uint64_t), mscclpp::Transport::IB0);
+  auto dstMem = registerRemote(dst.data(), sizeof(uint64_t));
+
+  auto ibConnection = std::dynamic_pointer_cast<mscclpp::IBConnection>(connection);
+  ASSERT_NE(ibConnection, nullptr);
+  ibConnection->beginBatch();
+  for (int i = 0; i < 64; ++i) {
+    connection->write(dstMem, 0, srcMem, 0, sizeof(uint64_t));
+  }
+  ibConnection->endBatch();
+  EXPECT_EQ(mscclpp::SoftwareIb::stats(0).doorbells, 1);
+  connection->flush();
+  EXPECT_EQ(mscclpp::SoftwareIb::stats(0).completions, 64);
+  EXPECT_EQ(mscclpp::SoftwareIb::stats(0).polls, 4);
+}
+
+TEST_F(IbConnectionTest, FailedWriteFailsFlush) {
+  connect(mscclpp::EndpointConfig(mscclpp::Transport::IB0));
+  std::vector<uint64_t> src(1, 1);
+  std::vector<uint64_t> dst(1, 0);
+  auto srcMem = senderContext->registerMemory(src.data(), sizeof(uint64_t), mscclpp::Transport::IB0);
+  auto dstMem = registerRemote(dst.data(), sizeof(uint64_t));
+
+  // the memory of the receiver is deregistered with its context
+  receiverContext.reset();
+  connection->write(dstMem, 0, srcMem, 0, sizeof(uint64_t));
+  EXPECT_THROW(connection->flush(), mscclpp::IbError);
+  EXPECT_EQ(dst[0], 0);
+}
+
+class IbConnectionLatencyTest : public IbConnectionTest {
+ protected:
+  void SetUp() override {
+    unsetenv("MSCCLPP_HCA_DEVICES");
+    mscclpp::SoftwareIbConfig config;
+    config.latencyUs = 20000;
+    config.bandwidthGBps = 1;
+    mscclpp::SoftwareIb::install(config);
+  }
+};
+
+TEST_F(IbConnectionLatencyTest, WritesLandAfterLatency) {
+  connect(mscclpp::EndpointConfig(mscclpp::Transport::IB0));
+  const size_t bytes = 1 << 20;
+  std::vector<char> src(bytes, 1);
+  std::vector<char> dst(bytes, 0);
+  uint64_t flag = 0;
+  uint64_t counter = 0;
+  auto srcMem = senderContext->registerMemory(src.data(), bytes, mscclpp::Transport::IB0);
+  auto dstMem = registerRemote(dst.data(), bytes);
+  auto flagMem = registerRemote(&flag, sizeof(flag));
+
+  auto start = std::chrono::steady_clock::now();
+  connection->write(dstMem, 0, srcMem, 0, bytes);
+  connection->updateAndSync(flagMem, 0, &counter, 1);
+  EXPECT_EQ(__atomic_load_n(&flag, __ATOMIC_ACQUIRE), 0);
+  connection->flush();
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  // 1 MiB at 1 GB/s plus the latency
+  EXPECT_GE(elapsed, std::chrono::microseconds(20000 + 1048));
+  EXPECT_EQ(flag, 1);
+  EXPECT_EQ(dst.back(), 1);
+}
+
+TEST_F(IbConnectionLatencyTest, RequestsCompleteWithoutFlush) {
+  connect(mscclpp::EndpointConfig(mscclpp::Transport::IB0));
+  const size_t bytes = 1 << 20;
+  std::vector<char> src(bytes, 1);
+  std::vector<char> dst(bytes, 0);
+  uint64_t flag = 0;
+  uint64_t counter = 0;
+  auto srcMem = senderContext->registerMemory(src.data(), bytes, mscclpp::Transport::IB0);
+  auto dstMem = registerRemote(dst.data(), bytes);
+  auto flagMem = registerRemote(&flag, sizeof(flag));
+
+  auto write = connection->writeAsync(dstMem, 0, srcMem, 0, bytes);
+  connection->updateAndSync(flagMem, 0, &counter, 1);
+  auto update = connection->updateAndSyncAsync(flagMem, 0, &counter, 2);
+  EXPECT_FALSE(write.test());
+  write.wait();
+  EXPECT_EQ(dst.back(), 1);
+  EXPECT_EQ(mscclpp::waitAny({write, update}), 0);
+  update.wait();
+  EXPECT_EQ(flag, 2);
+  EXPECT_TRUE(write.test());
+  EXPECT_TRUE(update.test());
+}
+
+TEST_F(IbConnectionLatencyTest, RequestTimeout) {
+  connect(mscclpp::EndpointConfig(mscclpp::Transport::IB0));
+  std::vector<uint64_t> src(1, 1);
+  std::vector<uint64_t> dst(1, 0);
+  auto srcMem = senderContext->registerMemory(src.data(), sizeof(uint64_t), mscclpp::Transport::IB0);
+  auto dstMem = registerRemote(dst.data(), sizeof(uint64_t));
+
+  auto request = connection->writeAsync(dstMem, 0, srcMem, 0, sizeof(uint64_t));
+  EXPECT_THROW(request.wait(1000), mscclpp::Error);
+  mscclpp::waitAll({request}, -1);
+  EXPECT_EQ(dst[0], 1);
+}
+
+class IbMultiRailTest : public IbConnectionTest {
+ protected:
+  void SetUp() override {
+    unsetenv("MSCCLPP_HCA_DEVICES");
+    mscclpp::SoftwareIbConfig config;
+    config.numDevices = 2;
+    config.latencyUs = 2000;
+    mscclpp::SoftwareIb::install(config);
+  }
+};
+
+TEST_F(IbMultiRailTest, StripesLargeWritesAcrossRails) {
+  mscclpp::EndpointConfig config(mscclpp::Transport::IB0);
+  config.ibRails = mscclpp::Transport::IB0 | mscclpp::Transport::IB1;
+  config.ibMultiRailThreshold = 4096;
+  connect(config);
+  auto multiRail = std::dynamic_pointer_cast<mscclpp::MultiRailIBConnection>(connection);
+  ASSERT_NE(multiRail, nullptr);
+  EXPECT_EQ(multiRail->numRails(), 2);
+
+  const size_t bytes = 1 << 20;
+  auto rails = mscclpp::Transport::IB0 | mscclpp::Transport::IB1;
+  std::vector<char> src(bytes, 1);
+  std::vector<char> dst(bytes, 0);
+  uint64_t flag = 0;
+  uint64_t counter = 0;
+  auto srcMem = senderContext->registerMemory(src.data(), bytes, rails);
+  auto dstMem = registerRemote(dst.data(), bytes, rails);
+  auto flagMem = registerRemote(&flag, sizeof(flag));
+
+  connection->write(dstMem, 0, srcMem, 0, 64);
+  connection->write(dstMem, 0, srcMem, 0, bytes);
+  connection->updateAndSync(flagMem, 0, &counter, 1);
+  // the second rail was flushed before the value was posted on the first one
+  EXPECT_EQ(mscclpp::SoftwareIb::stats(1).bytes, bytes / 2);
+  EXPECT_EQ(dst.back(), 1);
+  connection->flush();
+  EXPECT_EQ(flag, 1);
+  EXPECT_EQ(mscclpp::SoftwareIb::stats(0).bytes, 64 + bytes / 2);
+  EXPECT_EQ(std::count(dst.begin(), dst.end(), 1), bytes);
+}
+
+TEST_F(IbMultiRailTest, RequestsCoverAllRails) {
+  mscclpp::EndpointConfig config(mscclpp::Transport::IB0);
+  config.ibRails = mscclpp::Transport::IB0 | mscclpp::Transport::IB1;
+  config.ibMultiRailThreshold = 4096;
+  connect(config);
+
+  const size_t bytes = 1 << 20;
+  auto rails = mscclpp::Transport::IB0 | mscclpp::Transport::IB1;
+  std::vector<char> src(bytes, 1);
+  std::vector<char> dst(bytes, 0);
+  auto srcMem = senderContext->registerMemory(src.data(), bytes, rails);
+  auto dstMem = registerRemote(dst.data(), bytes, rails);
+
+  auto small = connection->writeAsync(dstMem, 0, srcMem, 0, 64);
+  auto large = connection->writeAsync(dstMem, 0, srcMem, 0, bytes);
+  mscclpp::waitAll({small, large});
+  EXPECT_EQ(std::count(dst.begin(), dst.end(), 1), bytes);
+  EXPECT_EQ(mscclpp::SoftwareIb::stats(1).bytes, bytes / 2);
+}
+
+TEST_F(IbMultiRailTest, BatchesEveryRail) {
+  mscclpp::EndpointConfig config(mscclpp::Transport::IB0);
+  config.ibRails = mscclpp::Transport::IB0 | mscclpp::Transport::IB1;
+  config.ibMultiRailThreshold = 4096;
+  connect(config);
+  auto multiRail = std::dynamic_pointer_cast<mscclpp::MultiRailIBConnection>(connection);
+  ASSERT_NE(multiRail, nullptr);
+
+  const size_t bytes = 1 << 16;
+  auto rails = mscclpp::Transport::IB0 | mscclpp::Transport::IB1;
+  std::vector<char> src(bytes, 1);
+  std::vector<char> dst(bytes, 0);
+  auto srcMem = senderContext->registerMemory(src.data(), bytes, rails);
+  auto dstMem = registerRemote(dst.data(), bytes, rails);
+
+  multiRail->beginBatch();
+  for (int i = 0; i < 8; ++i) {
+    connection->write(dstMem, 0, srcMem, 0, bytes);
+  }
+  multiRail->endBatch();
+  EXPECT_EQ(mscclpp::SoftwareIb::stats(0).doorbells, 1);
+  EXPECT_EQ(mscclpp::SoftwareIb::stats(1).doorbells, 1);
+  connection->flush();
+  EXPECT_EQ(std::count(dst.begin(), dst.end(), 1), bytes);
+}
+
+TEST_F(IbMultiRailTest, RailCountsMustMatch) {
+  mscclpp::Context senderContext;
+  mscclpp::Context receiverContext;
+  mscclpp::EndpointConfig config(mscclpp::Transport::IB0);
+  config.ibRails = mscclpp::Transport::IB0 | mscclpp::Transport::IB1;
+  auto senderEndpoint = senderContext.createEndpoint(config);
+  auto receiverEndpoint = receiverContext.createEndpoint(mscclpp::EndpointConfig(mscclpp::Transport::IB0));
+  EXPECT_THROW(senderContext.connect(senderEndpoint, receiverEndpoint), mscclpp::Error);
+}
+
+#endif  // defined(USE_IBVERBS)
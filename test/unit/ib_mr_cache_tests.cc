@@ -0,0 +1,175 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <mscclpp/errors.hpp>
+#include <random>
+#include <vector>
+
+#include "ib_mr_cache.hpp"
+
+// Registers address ranges that are never touched, with a stand-in for the verbs that counts registrations.
+class IbMrCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    pageSize = sysconf(_SC_PAGESIZE);
+    registrations = 0;
+    deregistrations = 0;
+    failRegistrations = 0;
+  }
+
+  std::unique_ptr<mscclpp::IbMrCache> makeCache(size_t maxPinnedBytes = SIZE_MAX) {
+    auto reg = [this](void* addr, size_t size) {
+      if (failRegistrations > 0) {
+        failRegistrations--;
+        throw mscclpp::IbError("ibv_reg_mr failed", ENOMEM);
+      }
+      registered.emplace_back(reinterpret_cast<uintptr_t>(addr), size);
+      uint32_t key = ++registrations;
+      return mscclpp::IbMrRegistration{reinterpret_cast<ibv_mr*>(uintptr_t(key)), key, key + 1000};
+    };
+    auto dereg = [this](ibv_mr*) { deregistrations++; };
+    return std::make_unique<mscclpp::IbMrCache>(reg, dereg, maxPinnedBytes);
+  }
+
+  void* page(size_t index, size_t offset = 0) { return reinterpret_cast<void*>((index + 1024) * pageSize + offset); }
+
+  size_t pageSize;
+  int registrations;
+  int deregistrations;
+  int failRegistrations;
+  std::vector<std::pair<uintptr_t, size_t>> registered;
+};
+
+TEST_F(IbMrCacheTest, ReusesCoveringRegistration) {
+  auto cache = makeCache();
+  auto whole = cache->acquire(page(0, 16), 3 * pageSize);
+  EXPECT_EQ(registrations, 1);
+  // the pages of the buffer are registered
+  EXPECT_EQ(registered[0].first, reinterpret_cast<uintptr_t>(page(0)));
+  EXPECT_EQ(registered[0].second, 4 * pageSize);
+
+  auto part = cache->acquire(page(2, 100), 64);
+  EXPECT_EQ(registrations, 1);
+  EXPECT_EQ(part->getLkey(), whole->getLkey());
+  EXPECT_EQ(part->getBuff(), page(2, 100));
+  EXPECT_EQ(part->getInfo().addr, reinterpret_cast<uint64_t>(page(2, 100)));
+  EXPECT_EQ(part->getInfo().rkey, whole->getInfo().rkey);
+
+  auto stats = cache->stats();
+  EXPECT_EQ(stats.hits, 1);
+  EXPECT_EQ(stats.misses, 1);
+  EXPECT_EQ(stats.registrations, 1);
+  EXPECT_EQ(stats.pinnedBytes, 4 * pageSize);
+}
+
+TEST_F(IbMrCacheTest, RegistersRangesThatAreNotCovered) {
+  auto cache = makeCache();
+  cache->acquire(page(0), 2 * pageSize);
+  // overlaps the first registration but extends beyond it
+  cache->acquire(page(1), 2 * pageSize);
+  cache->acquire(page(8), pageSize);
+  EXPECT_EQ(registrations, 3);
+  // covered by the second one
+  cache->acquire(page(2), pageSize);
+  EXPECT_EQ(registrations, 3);
+  EXPECT_EQ(cache->stats().hits, 1);
+}
+
+TEST_F(IbMrCacheTest, DeregistersReleasedRegistrationsWithoutBudget) {
+  auto cache = makeCache(0);
+  auto first = cache->acquire(page(0), pageSize);
+  auto second = cache->acquire(page(0), pageSize);
+  cache->release(first);
+  EXPECT_EQ(deregistrations, 0);
+  cache->release(second);
+  EXPECT_EQ(deregistrations, 1);
+  EXPECT_EQ(cache->stats().pinnedBytes, 0);
+
+  cache->acquire(page(0), pageSize);
+  EXPECT_EQ(registrations, 2);
+}
+
+TEST_F(IbMrCacheTest, DoesNotShareReleasedRegistrations) {
+  auto cache = makeCache();
+  cache->release(cache->acquire(page(0), 2 * pageSize));
+  // the memory may have been freed and allocated again since
+  cache->acquire(page(0), pageSize);
+  EXPECT_EQ(registrations, 2);
+  EXPECT_EQ(deregistrations, 0);
+  EXPECT_EQ(cache->stats().pinnedBytes, 3 * pageSize);
+}
+
+TEST_F(IbMrCacheTest, EvictsLeastRecentlyReleasedBeyondBudget) {
+  auto cache = makeCache(3 * pageSize);
+  auto held = cache->acquire(page(0), pageSize);
+  auto first = cache->acquire(page(2), pageSize);
+  auto second = cache->acquire(page(4), pageSize);
+  cache->release(second);
+  cache->release(first);
+  EXPECT_EQ(deregistrations, 0);
+  cache->acquire(page(6), pageSize);
+  EXPECT_EQ(deregistrations, 1);
+  cache->acquire(page(8), pageSize);
+  EXPECT_EQ(deregistrations, 2);
+
+  // registrations with references are never evicted
+  cache->acquire(page(10), pageSize);
+  EXPECT_EQ(deregistrations, 2);
+  auto stats = cache->stats();
+  EXPECT_EQ(stats.evictions, 2);
+  EXPECT_EQ(stats.registrations, 4);
+  EXPECT_EQ(stats.pinnedBytes, 4 * pageSize);
+  EXPECT_EQ(held->getLkey(), 1);
+}
+
+TEST_F(IbMrCacheTest, SettingBudgetEvicts) {
+  auto cache = makeCache();
+  for (int i = 0; i < 4; ++i) {
+    cache->release(cache->acquire(page(2 * i), pageSize));
+  }
+  EXPECT_EQ(deregistrations, 0);
+  cache->setMaxPinnedBytes(pageSize);
+  EXPECT_EQ(deregistrations, 3);
+  EXPECT_EQ(cache->stats().pinnedBytes, pageSize);
+}
+
+TEST_F(IbMrCacheTest, EvictsUnusedRegistrationsWhenRegistrationFails) {
+  auto cache = makeCache(16 * pageSize);
+  cache->release(cache->acquire(page(0), pageSize));
+  failRegistrations = 1;
+  EXPECT_NE(cache->acquire(page(2), pageSize), nullptr);
+  EXPECT_EQ(deregistrations, 1);
+
+  failRegistrations = 1;
+  EXPECT_THROW(cache->acquire(page(4), pageSize), mscclpp::IbError);
+}
+
+TEST_F(IbMrCacheTest, CloseDeregistersAll) {
+  auto cache = makeCache(16 * pageSize);
+  auto inUse = cache->acquire(page(0), pageSize);
+  cache->release(cache->acquire(page(2), pageSize));
+  cache->close();
+  EXPECT_EQ(deregistrations, 2);
+  cache->release(inUse);
+  EXPECT_THROW(cache->acquire(page(0), pageSize), mscclpp::Error);
+}
+
+TEST_F(IbMrCacheTest, FindsCoveringRegistrationsLikeLinearSearch) {
+  auto cache = makeCache();
+  std::mt19937 rng(7);
+  std::vector<std::pair<size_t, size_t>> ranges;
+  for (int i = 0; i < 2000; ++i) {
+    size_t first = rng() % 4096;
+    size_t last = first + rng() % 64;
+    bool covered = std::any_of(ranges.begin(), ranges.end(),
+                               [&](auto& range) { return range.first <= first && last <= range.second; });
+    int before = registrations;
+    cache->acquire(page(first), (last - first + 1) * pageSize);
+    ASSERT_EQ(registrations, before + (covered ? 0 : 1)) << "pages " << first << " to " << last;
+    if (!covered) ranges.emplace_back(first, last);
+  }
+}
@@ -0,0 +1,105 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "lru_cache.hpp"
+
+namespace {
+// Stands in for an execution context: counts how many instances are alive.
+struct FakeContext {
+  std::shared_ptr<int> alive;
+  FakeContext(std::shared_ptr<int> alive) : alive(alive) { (*alive)++; }
+  FakeContext(FakeContext&& other) = default;
+  FakeContext& operator=(FakeContext&& other) = default;
+  ~FakeContext() {
+    if (alive) (*alive)--;
+  }
+};
+
+using FakeCache = mscclpp::LruCache<std::string, FakeContext>;
+
+std::vector<std::string> keys(const FakeCache& cache) {
+  std::vector<std::string> result;
+  for (const auto& entry : cache) {
+    result.push_back(entry.key);
+  }
+  return result;
+}
+}  // namespace
+
+TEST(LruCacheTest, EvictsLeastRecentlyUsedByEntries) {
+  auto alive = std::make_shared<int>(0);
+  std::vector<std::string> evicted;
+  FakeCache cache(2, 0, [&](const std::string& key, FakeContext&) { evicted.push_back(key); });
+
+  cache.insert("a", FakeContext(alive), 10);
+  cache.insert("b", FakeContext(alive), 10);
+  ASSERT_NE(cache.find("a"), nullptr);
+  cache.insert("c", FakeContext(alive), 10);
+
+  EXPECT_EQ(evicted, std::vector<std::string>({"b"}));
+  EXPECT_EQ(keys(cache), std::vector<std::string>({"c", "a"}));
+  EXPECT_EQ(*alive, 2);
+  EXPECT_EQ(cache.bytes(), 20u);
+  EXPECT_EQ(cache.find("b"), nullptr);
+  EXPECT_EQ(cache.hits(), 1u);
+  EXPECT_EQ(cache.misses(), 1u);
+  EXPECT_EQ(cache.evictions(), 1u);
+}
+
+TEST(LruCacheTest, EvictsByBytes) {
+  auto alive = std::make_shared<int>(0);
+  FakeCache cache(0, 100);
+
+  cache.insert("a", FakeContext(alive), 40);
+  cache.insert("b", FakeContext(alive), 40);
+  cache.insert("c", FakeContext(alive), 40);
+  EXPECT_EQ(keys(cache), std::vector<std::string>({"c", "b"}));
+  EXPECT_EQ(cache.bytes(), 80u);
+
+  // an entry larger than the budget is kept alone
+  cache.insert("d", FakeContext(alive), 1000);
+  EXPECT_EQ(keys(cache), std::vector<std::string>({"d"}));
+  EXPECT_EQ(cache.bytes(), 1000u);
+  EXPECT_EQ(*alive, 1);
+}
+
+TEST(LruCacheTest, SetLimitsTrims) {
+  auto alive = std::make_shared<int>(0);
+  FakeCache cache;
+  for (int i = 0; i < 8; i++) {
+    cache.insert(std::to_string(i), FakeContext(alive), 1);
+  }
+  EXPECT_EQ(cache.size(), 8u);
+  cache.setLimits(3, 0);
+  EXPECT_EQ(keys(cache), std::vector<std::string>({"7", "6", "5"}));
+  EXPECT_EQ(*alive, 3);
+}
+
+TEST(LruCacheTest, EraseAndClear) {
+  auto alive = std::make_shared<int>(0);
+  int nEvicted = 0;
+  FakeCache cache(0, 0, [&](const std::string&, FakeContext&) { nEvicted++; });
+  for (int i = 0; i < 6; i++) {
+    cache.insert(std::to_string(i), FakeContext(alive), 1);
+  }
+  ASSERT_NE(cache.find("0"), nullptr);
+  EXPECT_EQ(cache.begin()->hits, 1u);
+
+  EXPECT_TRUE(cache.erase("3"));
+  EXPECT_FALSE(cache.erase("3"));
+  EXPECT_EQ(cache.eraseIf([](const std::string& key, const FakeContext&) { return std::stoi(key) % 2 == 0; }), 3u);
+  EXPECT_EQ(keys(cache), std::vector<std::string>({"5", "1"}));
+  EXPECT_EQ(cache.bytes(), 2u);
+
+  cache.clear();
+  EXPECT_EQ(cache.size(), 0u);
+  EXPECT_EQ(cache.bytes(), 0u);
+  EXPECT_EQ(nEvicted, 6);
+  EXPECT_EQ(*alive, 0);
+}
@@ -0,0 +1,139 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include <gtest/gtest.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <mscclpp/core.hpp>
+#include <numeric>
+#include <thread>
+
+#include "shm.hpp"
+
+class ShmConnectionTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    auto senderEndpoint = senderContext.createEndpoint(mscclpp::Transport::SharedMemory);
+    auto receiverEndpoint = receiverContext.createEndpoint(mscclpp::Transport::SharedMemory);
+    sender = senderContext.connect(senderEndpoint, receiverEndpoint);
+  }
+
+  mscclpp::Context senderContext;
+  mscclpp::Context receiverContext;
+  std::shared_ptr<mscclpp::Connection> sender;
+};
+
+TEST_F(ShmConnectionTest, WritesLandBeforeTheyReturn) {
+  const size_t count = 1024;
+  std::vector<int> src(count);
+  auto dst = mscclpp::allocUniqueShm<int>(count);
+  auto flag = mscclpp::allocUniqueShm<uint64_t>();
+  uint64_t counter = 0;
+  auto srcMem = senderContext.registerMemory(src.data(), count * sizeof(int), mscclpp::Transport::SharedMemory);
+  auto dstMem = mscclpp::RegisteredMemory::deserialize(
+      receiverContext.registerMemory(dst.get(), count * sizeof(int), mscclpp::Transport::SharedMemory).serialize());
+  auto flagMem = mscclpp::RegisteredMemory::deserialize(
+      receiverContext.registerMemory(flag.get(), sizeof(uint64_t), mscclpp::Transport::SharedMemory).serialize());
+
+  std::iota(src.begin(), src.end(), 0);
+  sender->write(dstMem, 8 * sizeof(int), srcMem, 0, 16 * sizeof(int));
+  sender->updateAndSync(flagMem, 0, &counter, 1);
+  EXPECT_EQ(*flag, 1);
+  EXPECT_EQ(counter, 1);
+  EXPECT_EQ(dst.get()[7], 0);
+  EXPECT_EQ(dst.get()[8], 0);
+  EXPECT_EQ(dst.get()[23], 15);
+  EXPECT_EQ(dst.get()[24], 0);
+  EXPECT_THROW(sender->write(dstMem, count * sizeof(int), srcMem, 0, sizeof(int)), mscclpp::Error);
+}
+
+TEST_F(ShmConnectionTest, RequestsAreCompleteWhenReturned) {
+  std::vector<int> src(16, 7);
+  auto dst = mscclpp::allocUniqueShm<int>(16);
+  auto srcMem = senderContext.registerMemory(src.data(), 16 * sizeof(int), mscclpp::Transport::SharedMemory);
+  auto dstMem = receiverContext.registerMemory(dst.get(), 16 * sizeof(int), mscclpp::Transport::SharedMemory);
+
+  auto request = sender->writeAsync(dstMem, 0, srcMem, 0, 16 * sizeof(int));
+  EXPECT_TRUE(request.test());
+  EXPECT_EQ(dst.get()[15], 7);
+  EXPECT_EQ(mscclpp::waitAny({mscclpp::Request(), request}), 0);
+  EXPECT_THROW(mscclpp::waitAny({}), mscclpp::Error);
+}
+
+TEST_F(ShmConnectionTest, WritesIntoAnotherProcess) {
+  const size_t count = 1 << 16;
+  auto dst = mscclpp::allocUniqueShm<int>(count);
+  auto flag = mscclpp::allocUniqueShm<uint64_t>();
+  auto dstData = receiverContext.registerMemory(dst.get(), count * sizeof(int), mscclpp::Transport::SharedMemory)
+                     .serialize();
+  auto flagData =
+      receiverContext.registerMemory(flag.get(), sizeof(uint64_t), mscclpp::Transport::SharedMemory).serialize();
+  std::vector<int> heap(1);
+  auto heapData =
+      receiverContext.registerMemory(heap.data(), sizeof(int), mscclpp::Transport::SharedMemory).serialize();
+
+  pid_t pid = fork();
+  ASSERT_GE(pid, 0);
+  if (pid == 0) {
+    int status = 0;
+    // a new thread of the child computes the hash of its own process, so the memory counts as remote
+    std::thread([&] {
+      try {
+        mscclpp::Context context;
+        auto endpoint = context.createEndpoint(mscclpp::Transport::SharedMemory);
+        auto connection = context.connect(endpoint, endpoint);
+        std::vector<int> src(count);
+        std::iota(src.begin(), src.end(), 1);
+        auto srcMem = context.registerMemory(src.data(), count * sizeof(int), mscclpp::Transport::SharedMemory);
+        auto dstMem = mscclpp::RegisteredMemory::deserialize(dstData);
+        auto flagMem = mscclpp::RegisteredMemory::deserialize(flagData);
+        auto heapMem = mscclpp::RegisteredMemory::deserialize(heapData);
+        // mapped again rather than inherited from the parent
+        if (dstMem.data() == nullptr || dstMem.data() == dstMem.originalDataPtr()) status = 2;
+        // memory that is not shared cannot be written by other processes
+        if (heapMem.data() != nullptr) status = 3;
+        uint64_t counter = 0;
+        connection->write(dstMem, 0, srcMem, 0, count * sizeof(int));
+        connection->updateAndSync(flagMem, 0, &counter, 42);
+      } catch (const std::exception&) {
+        status = 1;
+      }
+    }).join();
+    _exit(status);
+  }
+  int status;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+  EXPECT_EQ(*flag, 42);
+  EXPECT_EQ(dst.get()[0], 1);
+  EXPECT_EQ(dst.get()[count - 1], int(count));
+}
+
+TEST(ShmTest, MapRejectsAnotherPidNamespace) {
+  auto data = mscclpp::allocUniqueShm<int>();
+  mscclpp::ShmRegion region;
+  ASSERT_TRUE(mscclpp::findShmRegion(data.get(), sizeof(int), region));
+  ASSERT_NE(mscclpp::getPidNamespace(), 0);
+
+  void* base = mscclpp::mapPeerShm(getpid(), mscclpp::getPidNamespace(), region.fd, region.inode, region.size);
+  mscclpp::unmapPeerShm(base, region.size);
+  EXPECT_THROW(mscclpp::mapPeerShm(getpid(), mscclpp::getPidNamespace() + 1, region.fd, region.inode, region.size),
+               mscclpp::Error);
+}
+
+TEST(ShmTest, MapRejectsAFreedRegion) {
+  auto data = mscclpp::allocUniqueShm<int>();
+  mscclpp::ShmRegion freed;
+  ASSERT_TRUE(mscclpp::findShmRegion(data.get(), sizeof(int), freed));
+  data.reset();
+  // takes the descriptor of the freed region
+  auto other = mscclpp::allocUniqueShm<int>();
+  mscclpp::ShmRegion region;
+  ASSERT_TRUE(mscclpp::findShmRegion(other.get(), sizeof(int), region));
+  ASSERT_EQ(region.fd, freed.fd);
+
+  EXPECT_THROW(mscclpp::mapPeerShm(getpid(), mscclpp::getPidNamespace(), freed.fd, freed.inode, freed.size),
+               mscclpp::Error);
+}
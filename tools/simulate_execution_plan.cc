@@ -0,0 +1,214 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// Predicts the latency of execution plans over a range of message sizes with the cost model of
+// simulateExecutionPlan(), and derives the message size range in which each plan is the fastest among the plans of
+// the same collective and number of ranks.
+//
+// Usage: simulate_execution_plan [options] plan.json [plan.json ...]
+//   -s bytes       a message size to simulate, may be repeated (default: powers of 2 from 1 KiB to 256 MiB)
+//   -n ranks       ranks per node (default: 8)
+//   -p ll8|ll16    the packet type of LL plans (default: ll16)
+//   --pcie         the ranks of a node talk over PCIe instead of NVLink
+//   -v             also print every operation and the critical path
+//   -m file.jsonl  the output file of mscclpp-test, whose fastest time for the collective, number of ranks and size
+//                  is printed next to the prediction
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <nlohmann/json.hpp>
+#include <sstream>
+#include <tuple>
+
+#include "execution_simulator.hpp"
+
+namespace {
+
+struct Plan {
+  std::string path;
+  mscclpp::CompiledExecutionPlan plan;
+  std::vector<double> latencies;
+};
+
+// [{collective, ranks, size}] = the fastest time in microseconds
+using Measurements = std::map<std::tuple<std::string, int, size_t>, double>;
+
+Measurements readMeasurements(const std::string& path) {
+  std::ifstream file(path);
+  if (!file) {
+    throw std::runtime_error("Cannot open " + path);
+  }
+  Measurements measurements;
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.empty()) continue;
+    nlohmann::json entry = nlohmann::json::parse(line);
+    auto key =
+        std::make_tuple(entry["name"].get<std::string>(), entry["ranks"].get<int>(), entry["size"].get<size_t>());
+    double time = entry["time"].get<double>();
+    auto it = measurements.find(key);
+    if (it == measurements.end() || time < it->second) measurements[key] = time;
+  }
+  return measurements;
+}
+
+std::string sizeToString(size_t size) {
+  const char* units[] = {"B", "KiB", "MiB", "GiB"};
+  int unit = 0;
+  while (unit < 3 && size >= 1024 && size % 1024 == 0) {
+    size /= 1024;
+    unit++;
+  }
+  return std::to_string(size) + " " + units[unit];
+}
+
+void printDetails(const mscclpp::SimulationResult& result, std::ostream& out) {
+  out << "    rank  tb  op  type                         start    wait     end   complete  bytes by link (util)"
+            << std::endl;
+  for (const auto& op : result.operations) {
+    out << std::fixed << std::setprecision(2) << "    " << std::setw(4) << op.rank << std::setw(4)
+              << op.threadblock << std::setw(4) << op.index << "  " << std::left << std::setw(26)
+              << mscclpp::operationTypeToString(op.type) << std::right << std::setw(8) << op.startUs << std::setw(8)
+              << op.waitUs << std::setw(8) << op.endUs << std::setw(11) << op.completeUs;
+    for (int type = 0; type < mscclpp::NumLinkTypes; type++) {
+      if (op.bytes[type] == 0) continue;
+      out << "  " << mscclpp::linkTypeToString(static_cast<mscclpp::LinkType>(type)) << " " << op.bytes[type]
+                << " (" << std::setprecision(0) << op.utilization[type] * 100 << "%)" << std::setprecision(2);
+    }
+    out << std::endl;
+  }
+  out << "    critical path:";
+  for (int index : result.criticalPath) {
+    const auto& op = result.operations[index];
+    out << " " << op.rank << "/" << op.threadblock << "/" << op.index << " "
+              << mscclpp::operationTypeToString(op.type);
+  }
+  out << std::endl << "    link utilization:";
+  for (int type = 0; type < mscclpp::NumLinkTypes; type++) {
+    if (result.bytes[type] == 0) continue;
+    out << " " << mscclpp::linkTypeToString(static_cast<mscclpp::LinkType>(type)) << " " << std::setprecision(0)
+              << result.utilization[type] * 100 << "%";
+  }
+  out << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  std::vector<size_t> messageSizes;
+  std::vector<Plan> plans;
+  mscclpp::SimulationOptions options;
+  bool verbose = false;
+  Measurements measurements;
+  try {
+    for (int i = 1; i < argc; i++) {
+      bool hasValue = i + 1 < argc;
+      if (std::strcmp(argv[i], "-s") == 0 && hasValue) {
+        messageSizes.push_back(std::stoul(argv[++i]));
+      } else if (std::strcmp(argv[i], "-n") == 0 && hasValue) {
+        options.nRanksPerNode = std::stoi(argv[++i]);
+      } else if (std::strcmp(argv[i], "-p") == 0 && hasValue) {
+        std::string type = argv[++i];
+        options.packetType = type == "ll8" ? mscclpp::PacketType::LL8 : mscclpp::PacketType::LL16;
+      } else if (std::strcmp(argv[i], "--pcie") == 0) {
+        options.links.pcieWithinNode = true;
+      } else if (std::strcmp(argv[i], "-v") == 0) {
+        verbose = true;
+      } else if (std::strcmp(argv[i], "-m") == 0 && hasValue) {
+        measurements = readMeasurements(argv[++i]);
+      } else {
+        plans.push_back({argv[i], mscclpp::loadCompiledExecutionPlan(argv[i]), {}});
+      }
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  if (plans.empty()) {
+    std::cerr << "Usage: " << argv[0] << " [-s bytes ...] [-n ranksPerNode] [-p ll8|ll16] [--pcie] [-v] [-m file.jsonl]"
+              << " plan.json [plan.json ...]" << std::endl;
+    return 1;
+  }
+  if (messageSizes.empty()) {
+    for (size_t size = 1 << 10; size <= (1 << 28); size *= 2) messageSizes.push_back(size);
+  }
+  std::sort(messageSizes.begin(), messageSizes.end());
+  messageSizes.erase(std::unique(messageSizes.begin(), messageSizes.end()), messageSizes.end());
+
+  // plans that can be selected among each other
+  std::map<std::pair<std::string, int>, std::vector<Plan*>> groups;
+  for (Plan& plan : plans) {
+    groups[{plan.plan.collective, plan.plan.operationTemplates.size()}].push_back(&plan);
+  }
+
+  bool failed = false;
+  for (auto& [group, members] : groups) {
+    auto [collective, nRanks] = group;
+    std::cout << collective << " on " << nRanks << " ranks" << std::endl;
+    for (size_t i = 0; i < members.size(); i++) {
+      std::cout << "  [" << i << "] " << members[i]->path << std::endl;
+    }
+    std::cout << std::setw(10) << "size";
+    for (size_t i = 0; i < members.size(); i++) std::cout << std::setw(10) << "[" + std::to_string(i) + "] us";
+    std::cout << std::setw(8) << "best";
+    if (!measurements.empty()) std::cout << std::setw(14) << "measured us" << std::setw(8) << "ratio";
+    std::cout << std::endl;
+
+    for (size_t s = 0; s < messageSizes.size(); s++) {
+      std::ostringstream details;
+      int best = -1;
+      size_t measuredSize = 0;
+      for (size_t i = 0; i < members.size(); i++) {
+        Plan& plan = *members[i];
+        auto [inputSize, outputSize] = plan.plan.getBufferSizes(messageSizes[s]);
+        double latency = std::numeric_limits<double>::infinity();
+        try {
+          mscclpp::SimulationResult result = mscclpp::simulateExecutionPlan(plan.plan, inputSize, outputSize, options);
+          latency = result.latencyUs;
+          if (verbose) {
+            details << "  [" << i << "] at " << sizeToString(messageSizes[s]) << ": " << std::fixed
+                    << std::setprecision(2) << latency << " us" << std::endl;
+            printDetails(result, details);
+          }
+        } catch (const std::exception& e) {
+          std::cerr << plan.path << " at " << messageSizes[s] << " bytes: " << e.what() << std::endl;
+          failed = true;
+        }
+        plan.latencies.push_back(latency);
+        if (latency != std::numeric_limits<double>::infinity() &&
+            (best < 0 || latency < members[best]->latencies.back())) {
+          best = i;
+          // mscclpp-test reports the larger of the send and receive buffers
+          measuredSize = std::max(inputSize, outputSize);
+        }
+      }
+      std::cout << details.str() << std::setw(10) << sizeToString(messageSizes[s]);
+      for (const Plan* plan : members) {
+        std::cout << std::fixed << std::setprecision(2) << std::setw(10) << plan->latencies.back();
+      }
+      std::cout << std::setw(8) << (best < 0 ? "-" : "[" + std::to_string(best) + "]");
+      auto measured = measurements.find({collective, nRanks, measuredSize});
+      if (best >= 0 && measured != measurements.end()) {
+        std::cout << std::setw(14) << measured->second << std::setw(8)
+                  << members[best]->latencies.back() / measured->second;
+      }
+      std::cout << std::endl;
+    }
+
+    std::vector<std::vector<double>> latencies;
+    for (const Plan* plan : members) latencies.push_back(plan->latencies);
+    std::cout << "  message size ranges:" << std::endl;
+    for (const auto& range : mscclpp::derivePlanSizeRanges(messageSizes, latencies)) {
+      bool unbounded = range.maxMessageSize == std::numeric_limits<uint64_t>::max();
+      std::cout << "    [" << range.plan << "] " << members[range.plan]->path << ": minMessageSize "
+                << range.minMessageSize << ", maxMessageSize "
+                << (unbounded ? std::string("none") : std::to_string(range.maxMessageSize)) << std::endl;
+    }
+  }
+  return failed ? 1 : 0;
+}
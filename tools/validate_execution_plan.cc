@@ -0,0 +1,74 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// Checks execution plans before they are run: channel pairing, signal/wait balance, deadlocks, buffer bounds and
+// unordered accesses of different threadblocks to the same bytes. Prints the problems of each plan and exits with 1
+// if any plan has one.
+//
+// Usage: validate_execution_plan [-s bytes ...] plan.json [plan.json ...]
+//
+// The buffer bounds are checked at the message sizes given with -s, or at the declared minimum and maximum message
+// sizes of each plan.
+
+#include <cstring>
+#include <iostream>
+#include <mscclpp/executor.hpp>
+
+namespace {
+const char* issueTypeToString(mscclpp::PlanIssueType type) {
+  switch (type) {
+    case mscclpp::PlanIssueType::Malformed:
+      return "malformed";
+    case mscclpp::PlanIssueType::UnpairedChannel:
+      return "unpaired channel";
+    case mscclpp::PlanIssueType::UnbalancedSemaphore:
+      return "unbalanced semaphore";
+    case mscclpp::PlanIssueType::Deadlock:
+      return "deadlock";
+    case mscclpp::PlanIssueType::OutOfBounds:
+      return "out of bounds";
+    case mscclpp::PlanIssueType::Race:
+      return "race";
+    default:
+      return "unknown";
+  }
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  std::vector<size_t> messageSizes;
+  std::vector<std::string> plans;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      messageSizes.push_back(std::stoul(argv[++i]));
+    } else {
+      plans.push_back(argv[i]);
+    }
+  }
+  if (plans.empty()) {
+    std::cerr << "Usage: " << argv[0] << " [-s bytes ...] plan.json [plan.json ...]" << std::endl;
+    return 1;
+  }
+
+  bool valid = true;
+  for (const auto& planPath : plans) {
+    std::vector<mscclpp::PlanIssue> issues;
+    try {
+      issues = mscclpp::validateExecutionPlan(planPath, messageSizes);
+    } catch (const std::exception& e) {
+      std::cout << planPath << ": cannot be loaded: " << e.what() << std::endl;
+      valid = false;
+      continue;
+    }
+    if (issues.empty()) {
+      std::cout << planPath << ": OK" << std::endl;
+      continue;
+    }
+    valid = false;
+    std::cout << planPath << ": " << issues.size() << " problems" << std::endl;
+    for (const auto& issue : issues) {
+      std::cout << "  " << issueTypeToString(issue.type) << ": " << issue.message << std::endl;
+    }
+  }
+  return valid ? 0 : 1;
+}